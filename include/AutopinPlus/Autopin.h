@@ -86,6 +86,11 @@ signals:
 	 */
 	void printVersion();
 
+	/*!
+	 * \brief Prints the names of all perf events known to the gperf monitor to stdout
+	 */
+	void printEvents();
+
 	/*!
 	 * Stores a pointer to an instance of the class AutopinContext.
 	 */
@@ -76,6 +76,50 @@ class AutopinContext : public QObject {
 	 */
 	autopin_estate report(Error::autopin_errors error, QString opt, QString msg);
 
+	/*!
+	 * \brief Collects the reports of the current thread instead of passing them to the context
+	 *
+	 * An error stops the watchdog, so threads other than the one running the event loop
+	 * (e.g. a Sampler) must not change the error state. While an instance exists, report()
+	 * on the same thread only logs the message as a warning and counts it.
+	 */
+	class Quiet {
+	  public:
+		Quiet();
+		~Quiet();
+
+		Quiet(const Quiet &) = delete;
+		Quiet &operator=(const Quiet &) = delete;
+
+		/*!
+		 * \brief Returns the number of reports collected on the current thread, 0 if there is no instance
+		 */
+		static int getReports();
+
+		/*!
+		 * \brief Counts a report if there is an instance on the current thread
+		 *
+		 * \return true, if the report has been collected
+		 */
+		static bool collect();
+
+	  private:
+		/*!
+		 * The enclosing instance on the same thread or nullptr
+		 */
+		Quiet *previous;
+
+		/*!
+		 * Number of reports collected by this instance
+		 */
+		int reports = 0;
+
+		/*!
+		 * The innermost instance of the current thread or nullptr
+		 */
+		static thread_local Quiet *current;
+	};
+
 	/*!
 	 * \brief Get the global error state
 	 *
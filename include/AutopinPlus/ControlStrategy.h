@@ -13,10 +13,13 @@
 #include <AutopinPlus/ObservedProcess.h>
 #include <AutopinPlus/OS/OSServices.h>
 #include <AutopinPlus/PerformanceMonitor.h>
+#include <AutopinPlus/PlacementTree.h>
+#include <QElapsedTimer>
 #include <QTimer>
 #include <memory>
 #include <deque>
 #include <map>
+#include <vector>
 
 namespace AutopinPlus {
 
@@ -41,6 +44,11 @@ class ControlStrategy : public QObject {
 	ControlStrategy(const Configuration &config, const ObservedProcess &proc, OS::OSServices &service,
 					const PerformanceMonitor::monitor_list &monitors, AutopinContext &context);
 
+	/*!
+	 * \brief Destructor
+	 */
+	~ControlStrategy() override;
+
 	/*!
 	 * \brief Initializes the control strategy
 	 */
@@ -95,6 +103,23 @@ class ControlStrategy : public QObject {
 	 */
 	virtual void slot_UserMessage(int arg, double val);
 
+	/*!
+	 * \brief Handles a cpu which has been brought online
+	 *
+	 * \param[in] cpu The cpu
+	 */
+	virtual void slot_CpuOnline(int cpu);
+
+	/*!
+	 * \brief Handles a cpu which has been taken offline
+	 *
+	 * Tasks of the observed process which were pinned to the
+	 * cpu are handled like newly created tasks.
+	 *
+	 * \param[in] cpu The cpu
+	 */
+	virtual void slot_CpuOffline(int cpu);
+
   protected:
 	struct Task {
 		int pid;
@@ -106,6 +131,12 @@ class ControlStrategy : public QObject {
 
 	const static Task emptyTask;
 
+	/*!
+	 * \brief Placeholder for cpus which are not usable, e.g. because
+	 * they are offline or not part of the cpuset of autopin+
+	 */
+	const static Task blockedTask;
+
 	/*!
 	 * \brief Data structure that maps tasks to cores
 	 */
@@ -128,6 +159,33 @@ class ControlStrategy : public QObject {
 	 */
 	void changePinning();
 
+	/*!
+	 * \brief Moves tasks of the observed process to other cpus
+	 *
+	 * The target cpus must be free or be vacated by another moved
+	 * task, so that two tasks can be swapped.
+	 *
+	 * \param[in] moves Maps the tid of every moved task to its new cpu
+	 */
+	void moveTasks(const std::map<int, int> &moves);
+
+	/*!
+	 * \brief Reads the options for balancing the load on hybrid processors
+	 *
+	 * Reads the options <name>.load_monitor and <name>.load_interval
+	 * and starts the periodic balancing if the cpus differ in their
+	 * capacity. Should be called at the end of init().
+	 */
+	void readLoadOptions();
+
+	/*!
+	 * \brief Appends the options read by readLoadOptions() to a list
+	 * of configuration options
+	 *
+	 * \param[in,out] opts The list of configuration options
+	 */
+	void getLoadConfigOpts(Configuration::configopts &opts);
+
 	/*!
 	 * \brief Returns the nth-cpu for the nth-unpinned task
 	 *
@@ -151,6 +209,15 @@ class ControlStrategy : public QObject {
 	 */
 	int getCpuByTask(int tid);
 
+	/*!
+	 * \brief Returns the topology tree with the free cpus of the current pinning
+	 *
+	 * The tree is kept up to date with the current pinning and can be
+	 * used in getPinning() for finding free cpus. Cpus which the observed
+	 * process may not run on are never free.
+	 */
+	const PlacementTree &getPlacementTree() const;
+
 	//@{
 	/*!
 	 * Variables for storing runtime information in the constructor
@@ -198,17 +265,118 @@ class ControlStrategy : public QObject {
 	 */
 	static QMutex mutex;
 
+	/*!
+	 * \brief Stores which cpus are used by the current pinning.
+	 */
+	static PlacementTree tree;
+
+	/*!
+	 * \brief Strategies with disallowed cpus, whose allowed_tree must
+	 * be updated together with tree.
+	 */
+	static std::vector<ControlStrategy *> restricted;
+
+	/*!
+	 * \brief Usable cpus outside the affinity of the observed process,
+	 * empty if the process may run on all usable cpus.
+	 *
+	 * Other processes may still use these cpus, so they are not
+	 * blocked in the shared pinning.
+	 */
+	std::vector<bool> disallowed;
+
+	/*!
+	 * \brief Copy of the placement tree in which the disallowed cpus
+	 * are used, only maintained if disallowed is not empty.
+	 */
+	PlacementTree allowed_tree;
+
+	/*!
+	 * \brief Marks a cpu as used or free in the placement tree and in
+	 * the trees of all restricted strategies. The mutex must be held
+	 * by the caller.
+	 */
+	static void setCpuUsed(uint cpu, bool used);
+
+	/*!
+	 * \brief Rebuilds the placement tree and the trees of all
+	 * restricted strategies from the topology and the current pinning.
+	 * The mutex must be held by the caller.
+	 */
+	static void rebuildPlacementTree();
+
+	/*!
+	 * \brief Replaces the current pinning. The mutex must be held by
+	 * the caller.
+	 *
+	 * \param[in] new_pinning		The new pinning
+	 * \param[in] warn_overwrite	Warn if a task of the observed process is replaced
+	 */
+	void applyPinning(const Pinning &new_pinning, bool warn_overwrite);
+
+	/*!
+	 * \brief Returns the current load counter of a task, either the
+	 * value of the load monitor or the consumed cpu time.
+	 *
+	 * \param[in] tid The tid of the task
+	 */
+	double readLoad(int tid);
+
 	/*!
 	 * \brief If process tracing is disabled, this timer will
 	 * regularly query the OS for the current list of threads.
 	 */
 	QTimer timer;
+
+	/*!
+	 * \brief Monitor measuring the load of the tasks (e.g. cycles) or
+	 * nullptr, if the consumed cpu time is used.
+	 */
+	PerformanceMonitor *load_monitor = nullptr;
+
+	/*!
+	 * \brief Interval between two load balancing steps in
+	 * milliseconds, 0 disables load balancing.
+	 */
+	int load_interval = 1000;
+
+	/*!
+	 * \brief Timer for load balancing.
+	 */
+	QTimer load_timer;
+
+	/*!
+	 * \brief Clock for computing load rates.
+	 */
+	QElapsedTimer load_clock;
+
+	/*!
+	 * \brief Load of a task
+	 */
+	struct Load {
+		double value;
+		qint64 time;
+		double rate;
+	};
+
+	/*!
+	 * \brief Load of every task, only maintained while load balancing
+	 * is active.
+	 */
+	std::map<int, Load> loads;
   private slots:
 	/*!
 	 * \brief Handles the regular update of the list of monitored
 	 * threads if process tracing is disabled.
 	 */
 	void slot_timer();
+
+	/*!
+	 * \brief Updates the load of all tasks and moves the heaviest task
+	 * which is not running on a cpu with the highest capacity to a
+	 * faster cpu, if one is free or runs a lighter task.
+	 */
+	void slot_balanceLoad();
 };
 
 } // namespace AutopinPlus
@@ -17,7 +17,11 @@
 #include <qelapsedtimer.h>						 // for QElapsedTimer
 #include <qmutex.h>								 // for QMutex
 #include <qstringlist.h>						 // for QStringList
+#include <qtextstream.h>						 // for QTextStream
 #include <qtimer.h>								 // for QTimer
+#include <map>									 // for map
+#include <stdint.h>								 // for int64_t, uint64_t
+#include <vector>								 // for vector
 
 namespace AutopinPlus {
 namespace Logger {
@@ -62,6 +66,22 @@ class Main : public DataLogger {
 	void slot_readyReadStandardOutput();
 
   private:
+	/*!
+	 * \brief Writes all new samples of a monitor which is read by a Sampler.
+	 *
+	 * \param[in] stream  The stream to the external data logger.
+	 * \param[in] monitor The monitor.
+	 */
+	void logSamples(QTextStream &stream, PerformanceMonitor *monitor);
+
+	/*!
+	 * \brief Checks whether a monitor has the same value for all of its threads
+	 *
+	 * This is the case for monitors measuring the whole process or system (see PerformanceMonitor::getScope()), or
+	 * for all monitors if the "systemwide" option is set.
+	 */
+	bool isShared(PerformanceMonitor *monitor);
+
 	/*!
 	 * \brief The program to which the performance data will be sent and its arguments.
 	 */
@@ -73,8 +93,8 @@ class Main : public DataLogger {
 	int interval = 100;
 
 	/*!
-	 * \brief If true, we will only send performance data for the first monitored thread since we assume that the values
-	 *        are identical for all threads.
+	 * \brief If true, we will only send performance data for the first monitored thread of every monitor, as if all
+	 *        monitors were system-wide.
 	 */
 	bool systemwide = false;
 
@@ -97,6 +117,26 @@ class Main : public DataLogger {
 	 * \brief The timer responsible for keeping track of the elapsed time since the start of the logger.
 	 */
 	QElapsedTimer running;
+
+	/*!
+	 * \brief The start of the logger as returned by PerformanceMonitor::getTimestamp(), for the time of samples.
+	 */
+	int64_t started = 0;
+
+	/*!
+	 * \brief The position in the ring buffer of every sampled monitor.
+	 */
+	std::map<PerformanceMonitor *, uint64_t> cursors;
+
+	/*!
+	 * \brief The threads to read in the current data point, reused to avoid allocations.
+	 */
+	std::vector<int> tids;
+
+	/*!
+	 * \brief The values of the current data point, reused to avoid allocations.
+	 */
+	PerformanceMonitor::value_batch batch;
 };
 
 } // namespace External
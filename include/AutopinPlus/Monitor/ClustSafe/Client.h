@@ -0,0 +1,270 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <QByteArray>	 // for QByteArray
+#include <QList>		  // for QList
+#include <QMutex>		  // for QMutex
+#include <QString>		  // for QString
+#include <QThread>		  // for QThread
+#include <QWaitCondition> // for QWaitCondition
+#include <atomic>		  // for atomic
+#include <deque>		  // for deque
+#include <stdint.h>		  // for int64_t, uint16_t, uint64_t
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace ClustSafe {
+
+/*!
+ * \brief Asynchronous client polling the energy counters of a ClustSafe device.
+ *
+ * The client keeps one UDP socket to the device open and queries the energy
+ * consumed on all outlets from a background thread in a fixed interval. The
+ * device resets its counters with every answer, so the client adds up the
+ * answers and take() returns the energy since its previous call without ever
+ * waiting for the device.
+ *
+ * Up to "depth" requests are in flight at the same time. The protocol has no
+ * sequence numbers, so answers are matched to the oldest request with the same
+ * command. Every answer reports energy which hasn't been reported before, so
+ * answers arriving after their request has been given up on are still counted.
+ * A request which isn't answered within the timeout is sent again right away,
+ * and the device is regarded as unreachable after "retries" lost requests in a
+ * row, until it answers again.
+ */
+class Client : public QThread {
+  public:
+	/*!
+	 * \brief Constructor
+	 *
+	 * \param[in] host     Host name or IP address of the device
+	 * \param[in] port     Port on which the device listens
+	 * \param[in] password Password used when accessing the device
+	 * \param[in] outlets  The outlets whose values are added up
+	 * \param[in] interval Time between two requests in milliseconds
+	 * \param[in] timeout  Time after which a request is regarded as lost in milliseconds
+	 * \param[in] retries  Number of lost requests in a row after which the device is unreachable
+	 */
+	Client(QString host, uint16_t port, QString password, QList<int> outlets, int interval, int timeout, int retries);
+
+	/*!
+	 * \brief Destructor, stops polling
+	 */
+	~Client() override;
+
+	/*!
+	 * \brief Registers a user of the client and starts polling for the first one
+	 *
+	 * Waits until the device has answered the first request.
+	 *
+	 * \exception Exception This exception will be thrown if the device could not be reached.
+	 */
+	void acquire();
+
+	/*!
+	 * \brief Unregisters a user of the client and stops polling after the last one
+	 */
+	void release();
+
+	/*!
+	 * \brief Returns the energy consumed since the previous call in Joules
+	 *
+	 * \exception Exception This exception will be thrown if the device is unreachable.
+	 */
+	double take();
+
+	/*!
+	 * \brief Returns the number of requests sent to the device, including retries
+	 */
+	uint64_t getRequests() const;
+
+	/*!
+	 * \brief Returns the number of valid answers received from the device
+	 */
+	uint64_t getAnswers() const;
+
+	/*!
+	 * \brief Builds a request for the device
+	 *
+	 * \param[in] password The password used when accessing the device
+	 * \param[in] command  The command to send
+	 * \param[in] data     An optional array of binary data which usually contains arguments to the command
+	 */
+	static QByteArray buildRequest(const QString &password, uint16_t command, const QByteArray &data = QByteArray());
+
+	/*!
+	 * \brief Checks an answer of the device and returns its payload
+	 *
+	 * \param[in] answer  The answer received from the device
+	 * \param[in] command The command which the answer is expected to belong to
+	 *
+	 * \exception Exception This exception will be thrown if the answer is malformed or belongs to another command.
+	 */
+	static QByteArray parseAnswer(QByteArray answer, uint16_t command);
+
+	/*!
+	 * \brief The signature string used to address a specific kind of ClustSafe device
+	 */
+	static const QString signature;
+
+	/*!
+	 * \brief The command querying the energy consumed on all outlets
+	 */
+	static const uint16_t energy_command;
+
+	/*!
+	 * \brief The maximum number of requests in flight
+	 */
+	static const size_t depth;
+
+  protected:
+	void run() override;
+
+  private:
+	/*!
+	 * \brief Opens the socket and starts the thread
+	 *
+	 * \exception Exception This exception will be thrown if the socket could not be opened.
+	 */
+	void connectDevice();
+
+	/*!
+	 * \brief Stops the thread and closes the socket
+	 */
+	void disconnectDevice();
+
+	/*!
+	 * \brief Sends a request for the current energy consumption
+	 */
+	void send(int64_t now);
+
+	/*!
+	 * \brief Receives and accounts all answers waiting at the socket
+	 */
+	void receive();
+
+	/*!
+	 * \brief Wakes up the thread
+	 */
+	void wakeup();
+
+	/*!
+	 * Host name or IP address of the device
+	 */
+	QString host;
+
+	/*!
+	 * Port on which the device listens
+	 */
+	uint16_t port;
+
+	/*!
+	 * The outlets whose values are added up
+	 */
+	QList<int> outlets;
+
+	/*!
+	 * The request for the current energy consumption, which is the same every time
+	 */
+	QByteArray request;
+
+	/*!
+	 * Time between two requests in nanoseconds
+	 */
+	int64_t interval;
+
+	/*!
+	 * Time after which a request is regarded as lost in nanoseconds
+	 */
+	int64_t timeout;
+
+	/*!
+	 * Number of lost requests in a row after which the device is unreachable
+	 */
+	int retries;
+
+	/*!
+	 * The UDP socket connected to the device
+	 */
+	int socket_fd = -1;
+
+	/*!
+	 * Wakes up the thread for the next request
+	 */
+	int timer_fd = -1;
+
+	/*!
+	 * Wakes up the thread to stop it
+	 */
+	int event_fd = -1;
+
+	/*!
+	 * The times at which the requests in flight have been sent, oldest first
+	 */
+	std::deque<int64_t> pending;
+
+	/*!
+	 * Time at which the next request is due
+	 */
+	int64_t deadline = 0;
+
+	/*!
+	 * Number of users of the client, protected by "users_mutex"
+	 */
+	int users = 0;
+
+	/*!
+	 * Energy received since the previous call of take()
+	 */
+	double energy = 0;
+
+	/*!
+	 * Number of lost requests in a row
+	 */
+	int lost = 0;
+
+	/*!
+	 * True after the first answer of the device
+	 */
+	bool answered = false;
+
+	/*!
+	 * Protects "energy", "lost" and "answered"
+	 */
+	QMutex mutex;
+
+	/*!
+	 * Signals answers and lost requests to acquire()
+	 */
+	QWaitCondition changed;
+
+	/*!
+	 * Serializes acquire() and release()
+	 */
+	QMutex users_mutex;
+
+	/*!
+	 * Exit request for the thread
+	 */
+	std::atomic<bool> exreq{false};
+
+	/*!
+	 * Number of requests sent
+	 */
+	std::atomic<uint64_t> requests{0};
+
+	/*!
+	 * Number of valid answers received
+	 */
+	std::atomic<uint64_t> answers{0};
+};
+
+} // namespace ClustSafe
+} // namespace Monitor
+} // namespace AutopinPlus
@@ -7,17 +7,21 @@
 
 #pragma once
 
-#include <AutopinPlus/AutopinContext.h>		// for AutopinContext, etc
-#include <AutopinPlus/Configuration.h>		// for Configuration, etc
-#include <AutopinPlus/PerformanceMonitor.h> // for PerformanceMonitor
-#include <AutopinPlus/ProcessTree.h>		// for ProcessTree, etc
-#include <qbytearray.h>						// for QByteArray
-#include <qelapsedtimer.h>					// for QElapsedTimer
-#include <qglobal.h>						// for qFree
-#include <qlist.h>							// for QList
-#include <set>								// for std::set
-#include <qstring.h>						// for QString
-#include <stdint.h>							// for uint16_t, uint8_t
+#include <AutopinPlus/AutopinContext.h>				// for AutopinContext, etc
+#include <AutopinPlus/Configuration.h>				// for Configuration, etc
+#include <AutopinPlus/Monitor/ClustSafe/Client.h>	// for Client
+#include <AutopinPlus/PerformanceMonitor.h>			// for PerformanceMonitor
+#include <AutopinPlus/ProcessTree.h>				// for ProcessTree, etc
+#include <qbytearray.h>								// for QByteArray
+#include <qglobal.h>								// for qFree
+#include <qlist.h>									// for QList
+#include <qmutex.h>									// for QMutex
+#include <qstring.h>								// for QString
+#include <memory>									// for unique_ptr
+#include <set>										// for std::set
+#include <stdint.h>									// for uint16_t, uint8_t
+#include <string>									// for string
+#include <vector>									// for vector
 
 namespace AutopinPlus {
 namespace Monitor {
@@ -41,6 +45,11 @@ class Main : public PerformanceMonitor {
 	 */
 	Main(QString name, const Configuration &config, AutopinContext &context);
 
+	/*!
+	 * \brief Destructor, unsubscribes from the device
+	 */
+	~Main() override;
+
 	// Overridden from the base class
 	void init() override;
 
@@ -53,6 +62,9 @@ class Main : public PerformanceMonitor {
 	// Overridden from the base class
 	double value(int tid) override;
 
+	// Overridden from the base class
+	void values(const int *tids, size_t count, value_batch &result) override;
+
 	// Overridden from the base class
 	double stop(int tid) override;
 
@@ -75,57 +87,32 @@ class Main : public PerformanceMonitor {
 
   private:
 	/*!
-	 * \brief Sends a command to a ClustSafe device and returns the answer.
-	 *
-	 * This function sends a command to a ClustSafe device and returns the answer. If no answer was received in time
-	 * or the answer was malformed, an exception will be thrown.
-	 *
-	 * \param[in] command The command to send.
-	 * \param[in] data   An optional array of binary data which usually contains arguments to the command.
-	 */
-	static QByteArray sendCommand(uint16_t command, QByteArray data = QByteArray());
-
-	/*!
-	 * Mutex for threadsafe access to static methods (start_static,
-	 * value_static, stop_static).
-	 */
-	static QMutex mutex;
-
-	/*!
-	 * Calls readValueFromDevice() and starts the timer if necessary.
-	 *
-	 * \param[in] instance Pointer to the current instance
+	 * \brief Returns the client polling the configured device, creating it if necessary.
 	 */
-	static void start_static(ClustSafe::Main *instance);
+	static Client &getClient();
 
 	/*!
-	 * Calls readValueFromDevice() and then reads the value of
-	 * instance from the map and returns it.
+	 * \brief Returns the energy consumed since the last read from the ClustSafe device.
 	 *
-	 * \param[in] instance Pointer to the current instance
+	 * The result is the sum over the configured outlets, as polled by the client in the
+	 * background, so this never waits for the device. This is the reader of the source
+	 * which all instances share via the SampleBroker.
 	 *
-	 * \return value of this monitor.
+	 * \exception Exception This exception will be thrown if the device could not be read.
 	 */
-	static double value_static(ClustSafe::Main *instance);
+	static std::vector<double> readDevice();
 
 	/*!
-	 * Calls readValueFromDevice() and then reads the value of this
-	 * instance one last time and returns it. This function also
-	 * removes instance from the map.
-	 *
-	 * \param[in] instance Pointer to the current instance
-	 *
-	 * \return value of this monitor.
+	 * \brief Returns the key of the configured device in the SampleBroker.
 	 */
-	static double stop_static(ClustSafe::Main *instance);
+	static std::string getKey();
 
 	/*!
-	 * Reads the values from the ClustSafe device, and adds the value
-	 * to all instances of this monitor.
+	 * \brief Returns the energy consumed since this instance subscribed or was reset.
 	 *
-	 * \param[in] reset Pass true in case the value on the ClustSafe should be reset
+	 * \exception Exception This exception will be thrown if the device could not be read.
 	 */
-	static void readValueFromDevice(bool reset = false);
+	double read();
 
 	/*!
 	 * \brief The host name or IP address of the ClustSafe device.
@@ -137,59 +124,50 @@ class Main : public PerformanceMonitor {
 	 */
 	static uint16_t port;
 
-	/*!
-	 * \brief The signature string used to address a specific kind of CLustSafe device.
-	 */
-	static const QString signature;
-
 	/*!
 	 * \brief The password used when accessing the ClustSafe device.
 	 */
 	static QString password;
 
 	/*!
-	 * \brief Stores if the timer was already started.
+	 * \brief The list of outlets whose values will be added to form the resulting value.
 	 */
-	static bool timerStarted;
+	static QList<int> outlets;
 
 	/*!
-	 * \brief The list of outlets whose values will be added to form the resulting value.
+	 * \brief The amount of milliseconds between two queries of the device.
 	 */
-	static QList<int> outlets;
+	static int interval;
 
 	/*!
-	 * \brief The amount of milliseconds before a connection attempt or data read will time out.
+	 * \brief The amount of milliseconds after which a query without an answer is sent again.
 	 */
-	static const uint64_t timeout;
+	static int timeout;
 
 	/*!
-	 * \brief The amount of milliseconds after which the cached value will be refreshed.
+	 * \brief The number of unanswered queries in a row after which the device is unreachable.
 	 */
-	static const uint64_t ttl;
+	static int retries;
 
 	/*!
-	 * \brief Mapping between instances of ClustSafe::Main and their
-	 * corresponding measured value from the ClustSafe device.
-	 *
-	 * The first value is the address of the instance, the second is
-	 * the the instance's value.
+	 * \brief The client polling the device, shared by all instances.
 	 */
-	static std::map<uintptr_t, uint64_t> instanceValueMap;
+	static std::unique_ptr<Client> client;
 
 	/*!
-	 * \brief The cached value of the internal counter of the ClustSafe device.
+	 * \brief Protects "client".
 	 */
-	static uint64_t cached;
+	static QMutex client_mutex;
 
 	/*!
-	 * \brief A set of threads which are currently monitored.
+	 * \brief The id of this instance in the SampleBroker, or -1 if it isn't subscribed.
 	 */
-	std::set<int> threads;
+	int consumer = -1;
 
 	/*!
-	 * \brief The timer keeping track of the age of the cached value.
+	 * \brief A set of threads which are currently monitored.
 	 */
-	static QElapsedTimer timer;
+	std::set<int> threads;
 
 }; // class Main
 
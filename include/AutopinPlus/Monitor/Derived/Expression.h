@@ -0,0 +1,146 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <qstring.h>	 // for QString
+#include <qstringlist.h> // for QStringList
+#include <stddef.h>		 // for size_t
+#include <vector>		 // for vector
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace Derived {
+
+/*!
+ * \brief An arithmetic expression over the values of other monitors
+ *
+ * The expression is compiled once into a sequence of stack machine instructions
+ * (numbers, operands, "+", "-", "*", "/", unary "-" and parentheses are supported,
+ * constant subexpressions are folded). Every instruction is executed for a whole
+ * batch of threads at once, so that evaluating a batch is a sequence of simple loops.
+ */
+class Expression {
+  public:
+	/*!
+	 * \brief Compiles an expression
+	 *
+	 * \param[in] text The expression, e.g. "1000 * llc_miss / instructions".
+	 *
+	 * \exception Exception This exception will be thrown if the expression could not be parsed.
+	 */
+	explicit Expression(const QString &text);
+
+	/*!
+	 * \brief Returns the names of the operands in the order expected by evaluate()
+	 */
+	const QStringList &getOperands() const;
+
+	/*!
+	 * \brief Evaluates the expression for a batch of threads
+	 *
+	 * \param[in]  inputs Array with the values of every thread for each operand.
+	 * \param[in]  count  Number of threads.
+	 * \param[out] result Array for the value of every thread.
+	 */
+	void evaluate(const std::vector<const double *> &inputs, size_t count, double *result);
+
+  private:
+	/*!
+	 * \brief Operations of the stack machine
+	 */
+	typedef enum { CONSTANT, OPERAND, ADD, SUBTRACT, MULTIPLY, DIVIDE, NEGATE } opcode;
+
+	/*!
+	 * \brief An instruction of the stack machine
+	 */
+	struct Instruction {
+		/*!
+		 * The operation
+		 */
+		opcode op;
+
+		/*!
+		 * The value pushed by CONSTANT
+		 */
+		double constant;
+
+		/*!
+		 * The index of the operand pushed by OPERAND
+		 */
+		int operand;
+	};
+
+	/*!
+	 * \brief Parses a sum or difference
+	 */
+	void parseSum();
+
+	/*!
+	 * \brief Parses a product or quotient
+	 */
+	void parseProduct();
+
+	/*!
+	 * \brief Parses a signed value
+	 */
+	void parseUnary();
+
+	/*!
+	 * \brief Parses a number, an operand or an expression in parentheses
+	 */
+	void parsePrimary();
+
+	/*!
+	 * \brief Skips whitespace and returns the next character without consuming it, or 0 at the end
+	 */
+	QChar peek();
+
+	/*!
+	 * \brief Appends an instruction, folding it with preceding constants if possible
+	 */
+	void append(opcode op, double constant = 0, int operand = 0);
+
+	/*!
+	 * \brief Throws an exception describing a syntax error at the current position
+	 */
+	void fail(const QString &message) const;
+
+	/*!
+	 * The text of the expression
+	 */
+	QString text;
+
+	/*!
+	 * Position of the parser in the text
+	 */
+	int position = 0;
+
+	/*!
+	 * The compiled instructions
+	 */
+	std::vector<Instruction> code;
+
+	/*!
+	 * The names of the operands
+	 */
+	QStringList operands;
+
+	/*!
+	 * Current and maximum depth of the stack
+	 */
+	size_t depth = 0, max_depth = 0;
+
+	/*!
+	 * Storage for the stack, max_depth arrays of the batch size
+	 */
+	std::vector<double> stack;
+};
+
+} // namespace Derived
+} // namespace Monitor
+} // namespace AutopinPlus
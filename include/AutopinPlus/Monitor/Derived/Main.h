@@ -0,0 +1,130 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <AutopinPlus/Monitor/Derived/Expression.h> // for Expression
+#include <AutopinPlus/PerformanceMonitor.h>			// for PerformanceMonitor
+#include <map>										// for map
+#include <memory>									// for unique_ptr
+#include <vector>									// for vector
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace Derived {
+
+/*!
+ * \brief Performance monitor computing an expression over other monitors
+ *
+ * The value of this monitor is an arithmetic expression over the values of other
+ * configured monitors, e.g. "instructions / cycles" for the instructions per cycle.
+ * Starting, reading and stopping a thread is forwarded to all monitors used in the
+ * expression, so that strategies can use this monitor on its own. The scope of the
+ * value is the narrowest scope of these monitors.
+ *
+ * Monitors which already measured a thread before it was started here are shared with
+ * their other users and can't be reset. Their value at start() is recorded as a baseline
+ * and the expression is evaluated over the increase since then, which assumes that the
+ * values of these monitors are cumulative.
+ */
+class Main : public PerformanceMonitor {
+  public:
+	/*!
+	 * \brief Constructor
+	 *
+	 * \param[in] name		Name of the monitor
+	 * \param[in] config	Reference to the current Configuration instance
+	 * \param[in] monitors	The configured monitors, which the operands are looked up in
+	 * \param[in] context	Reference to the context of the object calling the constructor
+	 */
+	Main(QString name, const Configuration &config, const PerformanceMonitor::monitor_list &monitors,
+		 AutopinContext &context);
+
+	void init() override;
+	QString getUnit() override;
+	monscope getScope() override;
+	bool isCumulative() override;
+	Configuration::configopts getConfigOpts() override;
+	void start(int tid) override;
+	double value(int tid) override;
+	void values(const int *tids, size_t count, value_batch &result) override;
+	double coverage(int tid) override;
+	double stop(int tid) override;
+	void clear(int tid) override;
+	ProcessTree::autopin_tid_list getMonitoredTasks() override;
+
+  private:
+	/*!
+	 * The configured monitors
+	 */
+	const PerformanceMonitor::monitor_list &monitors;
+
+	/*!
+	 * The compiled expression
+	 */
+	std::unique_ptr<Expression> expression;
+
+	/*!
+	 * The text of the expression
+	 */
+	QString text;
+
+	/*!
+	 * The unit of the value
+	 */
+	QString unit;
+
+	/*!
+	 * The monitors used in the expression, in the order of Expression::getOperands()
+	 */
+	std::vector<PerformanceMonitor *> operands;
+
+	/*!
+	 * Whether the value of the expression accumulates over the measurement
+	 */
+	bool cumulative = false;
+
+	/*!
+	 * \brief A monitored thread
+	 */
+	struct Task {
+		/*!
+		 * Which operands were started for the thread by this monitor
+		 */
+		std::vector<bool> started;
+
+		/*!
+		 * The values of the operands when the thread was started, 0 for the operands
+		 * started by this monitor
+		 */
+		std::vector<double> baselines;
+	};
+
+	/*!
+	 * The monitored threads
+	 */
+	std::map<int, Task> tasks;
+
+	/*!
+	 * Buffers for batch reads, one per operand
+	 */
+	std::vector<value_batch> batches;
+
+	/*!
+	 * Pointers to the values of the operands, passed to the expression
+	 */
+	std::vector<const double *> inputs;
+
+	/*!
+	 * Values of the operands of a single thread
+	 */
+	std::vector<double> scalars;
+};
+
+} // namespace Derived
+} // namespace Monitor
+} // namespace AutopinPlus
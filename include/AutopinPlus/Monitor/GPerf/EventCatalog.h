@@ -0,0 +1,67 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <AutopinPlus/Monitor/GPerf/Sensor.h> // for Sensor
+#include <qstring.h>						  // for QString
+#include <qstringlist.h>					  // for QStringList
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace GPerf {
+
+/*!
+ * \brief Catalog of all perf events known by name.
+ *
+ * The catalog contains the generic hardware, cache and software events of the
+ * kernel and the event aliases of all PMUs under /sys/bus/event_source/devices.
+ * It is built once and shared by all gperf monitors, so that the sysfs files
+ * of a PMU are only read once. Tracepoints and sysfs event files outside of
+ * the scanned PMUs are resolved on first use and then cached as well.
+ *
+ * The catalog is not thread-safe, it must only be used from the main thread.
+ */
+namespace EventCatalog {
+
+/*!
+ * \brief Builds the catalog.
+ *
+ * Is called automatically on first use, but must be called again if the
+ * mount point of sysfs is changed afterwards.
+ */
+void setup();
+
+/*!
+ * \brief Resolves the name of an event to a sensor.
+ *
+ * Supported names are
+ *   - the generic events, e.g. "hardware/cpu-cycles" or "cache/l1d-read-miss",
+ *   - the events of a PMU, e.g. "power/energy-pkg",
+ *   - the absolute path of an event file in sysfs, e.g.
+ *     "/sys/bus/event_source/devices/power/events/energy-pkg",
+ *   - tracepoints, e.g. "tracepoint/sched:sched_switch".
+ *
+ * \param[in] name The name of the event.
+ *
+ * \exception Exception This exception will be thrown if the event is unknown.
+ *
+ * \return The sensor, its name is set to the name of the event.
+ */
+Sensor getSensor(const QString &name);
+
+/*!
+ * \brief Returns the names of all events in the catalog, sorted.
+ *
+ * Tracepoints are not included, they are listed in tracefs.
+ */
+QStringList getNames();
+
+} // namespace EventCatalog
+} // namespace GPerf
+} // namespace Monitor
+} // namespace AutopinPlus
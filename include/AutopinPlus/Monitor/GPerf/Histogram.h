@@ -0,0 +1,127 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint64_t, uint32_t, int32_t
+#include <vector>   // for vector
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace GPerf {
+
+/*!
+ * \brief A compact histogram of 64 bit keys, e.g. instruction or data addresses.
+ *
+ * The histogram is an open addressing hash table with a fixed capacity, so that adding a
+ * key never allocates memory. Keys which don't fit anymore are only counted in total.
+ * Besides the count, every key remembers the thread it has been seen from.
+ */
+class Histogram {
+  public:
+	/*!
+	 * \brief Owner of keys which have been seen from more than one thread.
+	 */
+	static const int32_t shared = -1;
+
+	/*!
+	 * \brief Constructor
+	 *
+	 * \param[in] capacity Maximum number of different keys, rounded up to a power of two.
+	 */
+	explicit Histogram(unsigned int capacity = 1024);
+
+	/*!
+	 * \brief Counts a key.
+	 *
+	 * \param[in] key   The key, 0 is ignored.
+	 * \param[in] owner The thread the key has been seen from.
+	 *
+	 * \return The owner of the key after adding it, i.e. "owner" if the key has only been
+	 *         seen from this thread, "shared" if it has been seen from other threads too,
+	 *         or "owner" if the key didn't fit into the histogram.
+	 */
+	int32_t add(uint64_t key, int32_t owner = 0);
+
+	/*!
+	 * \brief Removes all keys.
+	 */
+	void clear();
+
+	/*!
+	 * \brief Halves the count of every key and removes the keys whose count drops to 0.
+	 *
+	 * Makes room for new keys in a full histogram while keeping the frequent ones. The
+	 * total is not changed.
+	 */
+	void age();
+
+	/*!
+	 * \brief Checks if no more keys fit into the histogram.
+	 */
+	bool isFull() const;
+
+	/*!
+	 * \brief Returns the number of keys added, including the keys which didn't fit.
+	 */
+	uint64_t getTotal() const;
+
+	/*!
+	 * \brief Returns the count of the most frequent key.
+	 */
+	uint32_t getMax() const;
+
+	/*!
+	 * \brief Returns the most frequent key or 0 if the histogram is empty.
+	 */
+	uint64_t getMaxKey() const;
+
+	/*!
+	 * \brief Returns the number of different keys in the histogram.
+	 */
+	unsigned int size() const;
+
+  private:
+	/*!
+	 * \brief Returns the slot of a key or the empty slot it would be stored in.
+	 */
+	size_t find(uint64_t key) const;
+
+	/*!
+	 * \brief A slot of the hash table, empty if the key is 0.
+	 */
+	struct Entry {
+		uint64_t key;
+		uint32_t count;
+		int32_t owner;
+	};
+
+	/*!
+	 * The hash table.
+	 */
+	std::vector<Entry> entries;
+
+	/*!
+	 * Number of used slots.
+	 */
+	unsigned int used = 0;
+
+	/*!
+	 * Number of keys added.
+	 */
+	uint64_t total = 0;
+
+	/*!
+	 * The slot of the most frequent key or -1.
+	 */
+	int max = -1;
+};
+
+} // namespace GPerf
+} // namespace Monitor
+} // namespace AutopinPlus
@@ -9,13 +9,19 @@
 
 #include <AutopinPlus/AutopinContext.h>		  // for AutopinContext, etc
 #include <AutopinPlus/Configuration.h>		  // for Configuration, etc
+#include <AutopinPlus/Monitor/GPerf/Histogram.h>	// for Histogram
+#include <AutopinPlus/Monitor/GPerf/SampleBuffer.h> // for SampleBuffer
 #include <AutopinPlus/Monitor/GPerf/Sensor.h> // for Sensor
+#include <AutopinPlus/OS/BatchReader.h>		  // for BatchReader
 #include <AutopinPlus/PerformanceMonitor.h>   // for PerformanceMonitor
 #include <AutopinPlus/ProcessTree.h>		  // for ProcessTree, etc
+#include <memory>							  // for unique_ptr
 #include <qlist.h>							  // for QList
 #include <qmap.h>							  // for QMap
 #include <qstring.h>						  // for QString
+#include <stdint.h>							  // for uint64_t
 #include <sys/types.h>						  // for pid_t
+#include <vector>							  // for vector
 
 namespace AutopinPlus {
 namespace Monitor {
@@ -23,6 +29,26 @@ namespace GPerf {
 
 /*!
  * \brief A generic performance monitor based on the perf subsystem of the Linux kernel.
+ *
+ * A monitor can use several sensors. Their counters are opened as perf event groups,
+ * so that they are scheduled together and all of them are read with a single read().
+ * If the kernel has to multiplex the counters, the values are extrapolated from the
+ * time the groups were actually running, which is reported as coverage.
+ *
+ * In process scope, the counters are opened once for all threads of the observed
+ * process and inherited by threads created later. Every monitored thread then reports
+ * the value of the whole process since the thread has been started. System scope works
+ * the same way with counters which count on all processors, it is selected automatically
+ * if all sensors belong to uncore PMUs.
+ *
+ * Optionally, counters which count on the processor they are read from can be read
+ * from userspace with rdpmc instead of a read() syscall, and batch reads of many
+ * threads can be submitted to an io_uring at once.
+ *
+ * In sampling mode, the first sensor is sampled for the whole process instead. The samples
+ * are collected from one ring buffer per processor into per-thread histograms of
+ * instruction and data addresses, and a summary metric of these histograms is reported
+ * as the value of a thread.
  */
 class Main : public PerformanceMonitor {
   public:
@@ -35,6 +61,13 @@ class Main : public PerformanceMonitor {
 	 */
 	Main(QString name, const Configuration &config, AutopinContext &context);
 
+	/*!
+	 * \brief Destructor
+	 *
+	 * Closes the counters of the process.
+	 */
+	~Main();
+
 	// Overridden from the base class
 	void init() override;
 
@@ -44,9 +77,18 @@ class Main : public PerformanceMonitor {
 	// Overridden from the base class
 	void start(int tid) override;
 
+	// Overridden from the base class
+	void start(ProcessTree::autopin_tid_list tasks) override;
+
 	// Overridden from the base class
 	double value(int tid) override;
 
+	// Overridden from the base class
+	void values(const int *tids, size_t count, value_batch &result) override;
+
+	// Overridden from the base class
+	double coverage(int tid) override;
+
 	// Overridden from the base class
 	double stop(int tid) override;
 
@@ -58,6 +100,10 @@ class Main : public PerformanceMonitor {
 
 	// Overridden from the base class
 	QString getUnit() override;
+	bool isCumulative() override;
+
+	// Overridden from the base class
+	void setObservedProcessPid(int pid) override;
 
   private:
 	/*!
@@ -84,6 +130,293 @@ class Main : public PerformanceMonitor {
 	 */
 	QString showSensor(const Sensor &input);
 
+	/*!
+	 * \brief A perf event group, i.e. counters which are scheduled together and read with a single read().
+	 */
+	struct Group {
+		/*!
+		 * The file descriptor of the group leader.
+		 */
+		int leader;
+
+		/*!
+		 * The thread the group is restricted to or -1 if it counts system-wide.
+		 */
+		pid_t pid;
+
+		/*!
+		 * The processor the group is bound to or -1 for all processors.
+		 */
+		int processor;
+
+		/*!
+		 * The thread which opened the group to monitor itself or -1. Counters of a thread can only be read from
+		 * userspace by that thread.
+		 */
+		pid_t owner = -1;
+
+		/*!
+		 * The file descriptors of all counters in the group, starting with the leader.
+		 */
+		QList<int> fds;
+
+		/*!
+		 * The kernel ids of the counters, in the order of "fds".
+		 */
+		QList<uint64_t> ids;
+
+		/*!
+		 * The index of the sensor of every counter, in the order of "fds".
+		 */
+		QList<int> sensors;
+
+		/*!
+		 * The mapped perf pages of the counters for reading them from userspace, in the order of "fds". Contains
+		 * nullptr for counters which cannot be read from userspace.
+		 */
+		QList<perf_event_mmap_page *> pages;
+
+		/*!
+		 * The time the group was enabled when it was last reset, in nanoseconds.
+		 */
+		uint64_t enabled = 0;
+
+		/*!
+		 * The time the group was running when it was last reset, in nanoseconds.
+		 */
+		uint64_t running = 0;
+	};
+
+	/*!
+	 * \brief Ways of combining the values of several sensors into one value.
+	 */
+	enum Combine { FIRST, SUM, RATIO };
+
+	/*!
+	 * \brief Whether the sensors are counted or sampled.
+	 */
+	enum Mode { COUNT, SAMPLE };
+
+	/*!
+	 * \brief Summary metrics of the samples of a thread.
+	 */
+	enum Metric { SAMPLES, HOTSPOT, SHARED };
+
+	/*!
+	 * \brief The samples of a thread since it has been started.
+	 */
+	struct ThreadSamples {
+		/*!
+		 * Histogram of the instruction addresses.
+		 */
+		Histogram ips;
+
+		/*!
+		 * Number of samples.
+		 */
+		uint64_t samples = 0;
+
+		/*!
+		 * Number of samples with a data address.
+		 */
+		uint64_t addresses = 0;
+
+		/*!
+		 * Number of samples with a data address in a cache line which has been sampled from other threads too.
+		 */
+		uint64_t shared = 0;
+	};
+
+	/*!
+	 * \brief Returns the processors to monitor for a sensor.
+	 *
+	 * \param[in] sensor The index of the sensor.
+	 *
+	 * \return The processors configured by the user or the sensor, or just -1 for all processors.
+	 */
+	QList<int> getProcessors(int sensor) const;
+
+	/*!
+	 * \brief Opens a counter for a sensor in an existing or a new group.
+	 *
+	 * \param[in]     sensor    The index of the sensor.
+	 * \param[in]     pid       The thread to monitor or -1 to monitor all threads.
+	 * \param[in]     processor The processor to monitor or -1 for all processors.
+	 * \param[in,out] groups    The groups of the thread, a new group is appended if necessary.
+	 *
+	 * \return true on success, false if the counter could not be opened (in which case errno will be set).
+	 */
+	bool openCounter(int sensor, pid_t pid, int processor, QList<Group> &groups);
+
+	/*!
+	 * \brief Opens inherited counters for all threads of a process.
+	 *
+	 * \param[in] pid The process to monitor.
+	 *
+	 * \return true on success, false if a counter could not be opened (in which case errno will be set).
+	 */
+	bool openProcess(int pid);
+
+	/*!
+	 * \brief Returns all threads of a process.
+	 *
+	 * \param[in] pid The process.
+	 *
+	 * \return The threads of the process or just the pid, if they cannot be determined.
+	 */
+	QList<int> getTasks(int pid) const;
+
+	/*!
+	 * \brief Opens the sampling events of a process and maps one ring buffer per processor.
+	 *
+	 * \param[in] pid The process to sample.
+	 *
+	 * \return true on success, false otherwise (in which case errno will be set).
+	 */
+	bool openSampling(int pid);
+
+	/*!
+	 * \brief Reads all samples from the ring buffers without blocking and adds them to the histograms.
+	 */
+	void drainSamples();
+
+	/*!
+	 * \brief Returns the configured metric of the samples of a thread.
+	 */
+	double getMetric(const ThreadSamples &samples) const;
+
+	/*!
+	 * \brief Reads a group into "buffer".
+	 *
+	 * \return true on success, false if the group could not be read.
+	 */
+	bool readGroup(const Group &group);
+
+	/*!
+	 * \brief Reads a group into "buffer" from the mapped perf pages, using rdpmc.
+	 *
+	 * Uses the same layout as reading the group with read().
+	 *
+	 * \return true on success, false if a counter is currently not readable from userspace.
+	 */
+	bool readPages(const Group &group);
+
+	/*!
+	 * \brief Unmaps the perf pages and closes the file descriptors of a group.
+	 *
+	 * \return true on success, false if a file descriptor could not be closed (in which case errno will be set).
+	 */
+	bool closeGroup(const Group &group);
+
+	/*!
+	 * \brief Reads all groups of a thread and sums up the counters of every sensor.
+	 *
+	 * Counters which have not been running all the time since the last reset are
+	 * extrapolated to the time they have been enabled. If io_uring is enabled, the
+	 * groups are read with a single BatchReader batch, e.g. all groups of the process
+	 * in process and system scope.
+	 *
+	 * \param[in]  groups   The groups of the thread.
+	 * \param[out] result   The scaled sum of the counters of every sensor.
+	 * \param[out] coverage The lowest fraction of the enabled time any group was running.
+	 *
+	 * \return true on success, false if a group could not be read.
+	 */
+	bool readGroups(const QList<Group> &groups, std::vector<double> &result, double &coverage);
+
+	/*!
+	 * \brief Adds the counters of a group to the values of the sensors.
+	 *
+	 * \param[in]     group    The group.
+	 * \param[in]     data     The data read from the group.
+	 * \param[in,out] result   The values of the sensors.
+	 * \param[in,out] coverage The lowest coverage so far, lowered if the group has a lower coverage.
+	 */
+	void addGroup(const Group &group, const uint64_t *data, std::vector<double> &result, double &coverage) const;
+
+	/*!
+	 * \brief Queues a read of every group in "reader" at "offset" of "batch_data".
+	 *
+	 * Groups which can be read from userspace are read right away. "batch_data" must
+	 * be large enough for all groups of the batch.
+	 *
+	 * \param[in]     groups The groups to read.
+	 * \param[in,out] offset The position of the data of the first group, advanced past the last group.
+	 */
+	void queueGroups(const QList<Group> &groups, size_t &offset);
+
+	/*!
+	 * \brief Sums up the counters of groups queued by queueGroups() after the batch has been submitted.
+	 *
+	 * \param[in]     groups   The groups in the order they have been queued.
+	 * \param[in,out] offset   The position of the data of the first group, advanced past the last group.
+	 * \param[in,out] request  The index of the first group in "batch_requests", advanced past the last group.
+	 * \param[out]    result   The scaled sum of the counters of every sensor.
+	 * \param[out]    coverage The lowest fraction of the enabled time any group was running.
+	 *
+	 * \return true on success, false if a group could not be read.
+	 */
+	bool addQueuedGroups(const QList<Group> &groups, size_t &offset, size_t &request, std::vector<double> &result,
+						 double &coverage);
+
+	/*!
+	 * \brief Implementation of values() for thread scope which reads all groups with a BatchReader.
+	 */
+	void valuesBatched(const int *tids, size_t count, value_batch &result);
+
+	/*!
+	 * \brief Combines the values of all sensors as configured by the "combine" option.
+	 */
+	double combineValues(const std::vector<double> &values) const;
+
+	/*!
+	 * \brief Parses a string to a way of combining sensors.
+	 *
+	 * \exception Exception This exception will be thrown if the string could not be parsed.
+	 */
+	static Combine readCombine(const QString &input);
+
+	/*!
+	 * \brief Converts a way of combining sensors into a string.
+	 */
+	static QString showCombine(Combine input);
+
+	/*!
+	 * \brief Parses a string to a mode.
+	 *
+	 * \exception Exception This exception will be thrown if the string could not be parsed.
+	 */
+	static Mode readMode(const QString &input);
+
+	/*!
+	 * \brief Converts a mode into a string.
+	 */
+	static QString showMode(Mode input);
+
+	/*!
+	 * \brief Parses a string to a metric.
+	 *
+	 * \exception Exception This exception will be thrown if the string could not be parsed.
+	 */
+	static Metric readMetric(const QString &input);
+
+	/*!
+	 * \brief Converts a metric into a string.
+	 */
+	static QString showMetric(Metric input);
+
+	/*!
+	 * \brief Parses a list of sample fields (ip, tid, time, addr) to a sample_type.
+	 *
+	 * \exception Exception This exception will be thrown if a field could not be parsed.
+	 */
+	static uint64_t readSampleType(const QStringList &input);
+
+	/*!
+	 * \brief Converts a sample_type into a list of sample fields.
+	 */
+	static QStringList showSampleType(uint64_t input);
+
 	/*!
 	 * \brief A wrapper around the "perf_event_open()" syscall.
 	 *
@@ -105,14 +438,115 @@ class Main : public PerformanceMonitor {
 	QList<int> processors;
 
 	/*!
-	 * The perf sensor to use.
+	 * The perf sensors to use.
+	 */
+	QList<Sensor> sensors;
+
+	/*!
+	 * How the values of several sensors are combined.
+	 */
+	Combine combine = FIRST;
+
+	/*!
+	 * Whether the sensors are counted or sampled.
+	 */
+	Mode mode = COUNT;
+
+	/*!
+	 * The number of events between two samples.
+	 */
+	uint64_t sample_period = 100000;
+
+	/*!
+	 * The fields of every sample, the thread id is always included.
+	 */
+	uint64_t sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID;
+
+	/*!
+	 * The metric reported in sampling mode.
+	 */
+	Metric metric = SAMPLES;
+
+	/*!
+	 * The number of data pages of every ring buffer, a power of two.
+	 */
+	int buffer_pages = 8;
+
+	/*!
+	 * The file descriptors of all sampling events.
+	 */
+	QList<int> sample_fds;
+
+	/*!
+	 * One ring buffer per processor, the sampling events of all threads on that processor write into it.
+	 */
+	std::vector<std::unique_ptr<SampleBuffer>> sample_buffers;
+
+	/*!
+	 * The samples of every monitored thread in sampling mode.
+	 */
+	QMap<int, ThreadSamples> sample_threads;
+
+	/*!
+	 * The sampled data addresses of all threads, by cache line.
+	 */
+	Histogram lines{65536};
+
+	/*!
+	 * Whether counters are read from userspace where possible.
+	 */
+	bool rdpmc = false;
+
+	/*!
+	 * Reader for the groups of batch reads, nullptr if every group is read with read().
+	 */
+	std::unique_ptr<OS::BatchReader> reader;
+
+	/*!
+	 * Buffer for the data of all groups of a batch read.
+	 */
+	std::vector<uint64_t> batch_data;
+
+	/*!
+	 * The index of the read of every group in "reader", or -1 if it has been read from userspace.
+	 */
+	std::vector<ssize_t> batch_requests;
+
+	/*!
+	 * A mapping from a specific thread to its perf event groups.
+	 */
+	QMap<int, QList<Group>> threads;
+
+	/*!
+	 * The perf event groups of the process, only used in process and system scope.
+	 */
+	QList<Group> process_groups;
+
+	/*!
+	 * The values of all sensors of the process when a thread has been started, only used in process and system
+	 * scope.
+	 */
+	QMap<int, std::vector<double>> baselines;
+
+	/*!
+	 * The coverage of the last value read for every thread.
+	 */
+	QMap<int, double> coverages;
+
+	/*!
+	 * Buffer for reading groups, large enough for the biggest group.
+	 */
+	std::vector<uint64_t> buffer;
+
+	/*!
+	 * Buffer for the values of all sensors of a thread.
 	 */
-	Sensor sensor;
+	std::vector<double> sensor_values;
 
 	/*!
-	 * A mapping from a specific thread to a list of associated file descriptors.
+	 * Buffer for the values of all sensors of the process.
 	 */
-	QMap<int, QList<int>> threads;
+	std::vector<double> process_values;
 }; // class Main
 
 } // namespace GPerf
@@ -0,0 +1,133 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <linux/perf_event.h> // for perf_event_mmap_page
+#include <stddef.h>			  // for size_t
+#include <stdint.h>			  // for uint64_t, uint32_t
+#include <vector>			  // for vector
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace GPerf {
+
+/*!
+ * \brief Reader for the mmap ring buffer of a sampling perf event.
+ *
+ * Follows the protocol of linux/perf_event.h: the kernel appends records at data_head,
+ * the reader consumes them up to data_head and then advances data_tail. Reading never
+ * blocks, it only returns the records which are already in the buffer.
+ */
+class SampleBuffer {
+  public:
+	/*!
+	 * \brief A decoded PERF_RECORD_SAMPLE, fields not requested in sample_type are 0.
+	 */
+	struct Sample {
+		uint64_t ip;
+		uint32_t pid;
+		uint32_t tid;
+		uint64_t time;
+		uint64_t addr;
+	};
+
+	/*!
+	 * \brief Constructor
+	 *
+	 * \param[in] fd          The file descriptor of the sampling event.
+	 * \param[in] sample_type The sample_type the event has been opened with, only
+	 *                        PERF_SAMPLE_IP, TID, TIME and ADDR are supported.
+	 */
+	SampleBuffer(int fd, uint64_t sample_type);
+
+	/*!
+	 * \brief Destructor, unmaps the buffer but doesn't close the file descriptor.
+	 */
+	~SampleBuffer();
+
+	SampleBuffer(const SampleBuffer &) = delete;
+	SampleBuffer &operator=(const SampleBuffer &) = delete;
+
+	/*!
+	 * \brief Maps the ring buffer.
+	 *
+	 * \param[in] pages Number of data pages, must be a power of two.
+	 *
+	 * \return true on success, false otherwise (in which case errno will be set).
+	 */
+	bool map(size_t pages);
+
+	/*!
+	 * \brief Returns the next sample in the buffer, skipping all other records.
+	 *
+	 * \param[out] sample The sample.
+	 *
+	 * \return true if a sample has been read, false if the buffer is empty.
+	 */
+	bool next(Sample &sample);
+
+	/*!
+	 * \brief Returns the number of samples the kernel has dropped because the buffer was full.
+	 */
+	uint64_t getLost() const;
+
+	/*!
+	 * \brief Returns the file descriptor of the event.
+	 */
+	int getFd() const;
+
+  private:
+	/*!
+	 * \brief Copies bytes from the data area at a position, handling the wrap-around.
+	 */
+	void copy(uint64_t position, void *target, size_t size) const;
+
+	/*!
+	 * The file descriptor of the event.
+	 */
+	int fd;
+
+	/*!
+	 * The sample_type of the event.
+	 */
+	uint64_t sample_type;
+
+	/*!
+	 * The mapped metadata page, followed by the data area.
+	 */
+	perf_event_mmap_page *header = nullptr;
+
+	/*!
+	 * The data area.
+	 */
+	const char *data = nullptr;
+
+	/*!
+	 * Size of the data area in bytes.
+	 */
+	size_t data_size = 0;
+
+	/*!
+	 * Size of the whole mapping in bytes.
+	 */
+	size_t map_size = 0;
+
+	/*!
+	 * Number of samples dropped by the kernel.
+	 */
+	uint64_t lost = 0;
+
+	/*!
+	 * Buffer for a single record.
+	 */
+	std::vector<char> record;
+};
+
+} // namespace GPerf
+} // namespace Monitor
+} // namespace AutopinPlus
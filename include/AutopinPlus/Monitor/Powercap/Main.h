@@ -0,0 +1,176 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <AutopinPlus/Configuration.h>		// for Configuration, etc
+#include <AutopinPlus/PerformanceMonitor.h> // for PerformanceMonitor
+#include <AutopinPlus/ProcessTree.h>		// for ProcessTree, etc
+#include <QString>							// for QString
+#include <QStringList>						// for QStringList
+#include <map>								// for map
+#include <stdint.h>							// for uint64_t
+#include <string>							// for string
+#include <vector>							// for vector
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace Powercap {
+
+/*!
+ * \brief Performance monitor reading the RAPL energy counters from the powercap sysfs interface
+ *
+ * Unlike the power/energy-* events of the perf PMU, the counters in
+ * /sys/class/powercap/intel-rapl:* can also be read if perf_event_paranoid
+ * doesn't allow system-wide events. Every zone (a package or one of its subzones
+ * like "core" or "dram") is read with pread() on a file descriptor which is kept
+ * open, and its wraparound is undone with max_energy_range_uj. The zones are read
+ * through the SampleBroker, so that all monitors of the process share the reads.
+ *
+ * The value of a thread is the energy in Joules since it was started, either of the
+ * whole system or of the packages or NUMA nodes the thread is allowed to run on.
+ * RAPL only measures packages, so the energy of a node is estimated as the share of
+ * its cpus in the energy of its package.
+ */
+class Main : public PerformanceMonitor {
+  public:
+	/*!
+	 * \brief Constructor
+	 *
+	 * \param[in] name		Name of the monitor
+	 * \param[in] config	Reference to the current Configuration instance
+	 * \param[in] context	Reference to the context of the object calling the constructor
+	 */
+	Main(QString name, const Configuration &config, AutopinContext &context);
+
+	/*!
+	 * \brief Destructor, unsubscribes from the zones
+	 */
+	~Main() override;
+
+	void init() override;
+	QString getUnit() override;
+	Configuration::configopts getConfigOpts() override;
+	void start(int tid) override;
+	double value(int tid) override;
+	void values(const int *tids, size_t count, value_batch &result) override;
+	double stop(int tid) override;
+	void clear(int tid) override;
+	ProcessTree::autopin_tid_list getMonitoredTasks() override;
+
+	/*!
+	 * \brief Returns the increase of an energy counter between two reads
+	 *
+	 * \param[in] last    The previous value of the counter
+	 * \param[in] current The current value of the counter
+	 * \param[in] range   The maximum value of the counter, after which it wraps to 0, or 0 if unknown
+	 */
+	static uint64_t getDelta(uint64_t last, uint64_t current, uint64_t range);
+
+  private:
+	/*!
+	 * \brief A powercap zone
+	 */
+	struct Zone {
+		/*!
+		 * The sysfs directory of the zone
+		 */
+		QString path;
+
+		/*!
+		 * The domain, e.g. "package", "core", "uncore", "dram" or "psys"
+		 */
+		QString domain;
+
+		/*!
+		 * The index of the package in "packages"
+		 */
+		int package;
+
+		/*!
+		 * The maximum value of the energy counter or 0 if unknown
+		 */
+		uint64_t range;
+	};
+
+	/*!
+	 * \brief A monitored thread
+	 */
+	struct Task {
+		/*!
+		 * The share of the energy of every package which is accounted to the thread
+		 */
+		std::vector<double> weights;
+
+		/*!
+		 * The weighted energy in microjoules when the thread was started
+		 */
+		double baseline;
+	};
+
+	/*!
+	 * \brief Finds the zones of the configured domains in sysfs
+	 */
+	void findZones();
+
+	/*!
+	 * \brief Computes the weights of the packages for a thread
+	 */
+	std::vector<double> getWeights(int tid);
+
+	/*!
+	 * \brief Reads the energy of all zones and adds it up per package
+	 *
+	 * \exception Exception This exception will be thrown if a zone could not be read.
+	 */
+	void readPackages();
+
+	/*!
+	 * \brief Returns the weighted energy in microjoules of the last read
+	 */
+	double getEnergy(const std::vector<double> &weights) const;
+
+	/*!
+	 * The domains to measure
+	 */
+	QStringList domains;
+
+	/*!
+	 * The zones of the configured domains
+	 */
+	std::vector<Zone> zones;
+
+	/*!
+	 * The physical package ids of the packages measured by the zones, -1 stands for the
+	 * whole system (e.g. the "psys" domain)
+	 */
+	std::vector<int> packages;
+
+	/*!
+	 * The key of the zones in the SampleBroker
+	 */
+	std::string key;
+
+	/*!
+	 * The id of this monitor in the SampleBroker, or -1 if it isn't subscribed
+	 */
+	int consumer = -1;
+
+	/*!
+	 * The energy in microjoules per package of the last read
+	 */
+	std::vector<double> energy;
+
+	/*!
+	 * The monitored threads
+	 */
+	std::map<int, Task> tasks;
+};
+
+} // namespace Powercap
+} // namespace Monitor
+} // namespace AutopinPlus
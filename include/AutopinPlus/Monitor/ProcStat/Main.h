@@ -0,0 +1,200 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <AutopinPlus/Configuration.h>		// for Configuration, etc
+#include <AutopinPlus/PerformanceMonitor.h> // for PerformanceMonitor
+#include <AutopinPlus/ProcessTree.h>		// for ProcessTree, etc
+#include <QString>							// for QString
+#include <map>								// for map
+#include <stddef.h>							// for size_t
+#include <stdint.h>							// for int64_t
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace ProcStat {
+
+/*!
+ * \brief Performance monitor reading the statistics of threads from procfs
+ *
+ * The monitor doesn't need perf counters or any privileges beyond reading the
+ * files of the observed process. It reports one field of
+ *
+ *   - /proc/<pid>/task/<tid>/schedstat (time on the cpu, time waiting on a run queue, timeslices),
+ *   - /proc/<pid>/task/<tid>/stat (user and system time),
+ *   - /proc/<pid>/task/<tid>/sched (migrations between cpus),
+ *   - /proc/<pid>/task/<tid>/status (voluntary and nonvoluntary context switches) or
+ *   - /proc/<pid>/task/<tid>/io (bytes read from and written to storage).
+ *
+ * The files below /proc/<tid> can't be used, as stat and io contain the totals of the
+ * whole process there. If the kernel doesn't provide the sched file, migrations are
+ * counted as changes of the last cpu in stat between two reads.
+ *
+ * The file of every thread is opened once in start() and read with a single pread()
+ * per value, values() reads all requested threads in one sweep. The value is the
+ * increase of the field since the thread was started, optionally divided by the
+ * elapsed time.
+ */
+class Main : public PerformanceMonitor {
+  public:
+	/*!
+	 * \brief The fields which can be monitored
+	 */
+	enum Field {
+		RUNTIME,
+		WAIT,
+		TIMESLICES,
+		UTIME,
+		STIME,
+		MIGRATIONS,
+		VOLUNTARY,
+		NONVOLUNTARY,
+		READ_BYTES,
+		WRITE_BYTES
+	};
+
+	/*!
+	 * \brief Constructor
+	 *
+	 * \param[in] name		Name of the monitor
+	 * \param[in] config	Reference to the current Configuration instance
+	 * \param[in] context	Reference to the context of the object calling the constructor
+	 */
+	Main(QString name, const Configuration &config, AutopinContext &context);
+
+	/*!
+	 * \brief Destructor, closes the files of all threads
+	 */
+	~Main() override;
+
+	void init() override;
+	QString getUnit() override;
+	bool isCumulative() override;
+	Configuration::configopts getConfigOpts() override;
+	void start(int tid) override;
+	double value(int tid) override;
+	void values(const int *tids, size_t count, value_batch &result) override;
+	double stop(int tid) override;
+	void clear(int tid) override;
+	ProcessTree::autopin_tid_list getMonitoredTasks() override;
+
+	/*!
+	 * \brief Converts a string to a field
+	 *
+	 * \param[in] string The name of the field
+	 *
+	 * \exception Exception This exception will be thrown if the string is not the name of a field.
+	 */
+	static Field readField(const QString &string);
+
+	/*!
+	 * \brief Converts a field to a string
+	 */
+	static QString showField(Field field);
+
+	/*!
+	 * \brief Extracts a field from the contents of its file
+	 *
+	 * \param[in] field  The field to extract
+	 * \param[in] buffer The null-terminated contents of the file of the field
+	 * \param[out] ok    Set to false if the field could not be found
+	 *
+	 * \return The value of the field, times are converted to seconds. MIGRATIONS is read
+	 *         from the sched file.
+	 */
+	static double parseField(Field field, const char *buffer, bool &ok);
+
+  private:
+	/*!
+	 * \brief A monitored thread
+	 */
+	struct Task {
+		/*!
+		 * The open file of the field
+		 */
+		int fd;
+
+		/*!
+		 * The path of the file
+		 */
+		QString path;
+
+		/*!
+		 * The value of the field when the thread was started
+		 */
+		double baseline;
+
+		/*!
+		 * The time in nanoseconds when the thread was started
+		 */
+		int64_t started;
+
+		/*!
+		 * The cpu the thread ran on at the previous read, only used for sampled migrations
+		 */
+		int cpu;
+
+		/*!
+		 * The number of changes of the cpu seen so far, only used for sampled migrations
+		 */
+		double migrations;
+	};
+
+	/*!
+	 * \brief Returns the pid of the process a thread belongs to
+	 *
+	 * \exception Exception This exception will be thrown if the pid is unknown and could not be read.
+	 */
+	int getPid(int tid) const;
+
+	/*!
+	 * \brief Returns the name of the file in procfs which contains the field
+	 */
+	QString getFile() const;
+
+	/*!
+	 * \brief Returns the path of the file of the field for a thread
+	 */
+	QString getPath(int pid, int tid) const;
+
+	/*!
+	 * \brief Reads the current value of the field of a thread
+	 *
+	 * \exception Exception This exception will be thrown if the file could not be read or parsed.
+	 */
+	double readTask(int tid, Task &task);
+
+	/*!
+	 * \brief Turns the current value of the field into the value of the monitor
+	 */
+	double getValue(const Task &task, double current, int64_t timestamp) const;
+
+	/*!
+	 * The monitored field
+	 */
+	Field field = WAIT;
+
+	/*!
+	 * Count migrations as changes of the last cpu, because the sched file is missing
+	 */
+	bool sampled = false;
+
+	/*!
+	 * Report the increase per second instead of the increase
+	 */
+	bool rate = true;
+
+	/*!
+	 * The monitored threads
+	 */
+	std::map<int, Task> tasks;
+};
+
+} // namespace ProcStat
+} // namespace Monitor
+} // namespace AutopinPlus
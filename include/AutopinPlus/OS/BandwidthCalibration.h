@@ -0,0 +1,65 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <AutopinPlus/OS/Topology.h>
+#include <QString>
+#include <vector>
+
+namespace AutopinPlus {
+namespace OS {
+namespace BandwidthCalibration {
+
+/*!
+ * \brief Data structure for storing the bandwidth of every numa node
+ *
+ * The n-th entry of a node contains the sustainable bandwidth in MB/s when n+1
+ * cores of the node access its memory at the same time. Nodes without usable
+ * cpus have no entries.
+ */
+using Bandwidths = std::vector<std::vector<float>>;
+
+/*!
+ * \brief Measures the sustainable memory bandwidth of every numa node
+ *
+ * A STREAM triad kernel runs on memory of the node, using one hardware thread of
+ * 1, 2, 4, ... cores of the node. The bandwidth for the remaining numbers of cores
+ * is interpolated.
+ *
+ * \param[in] topology	The topology of the machine
+ * \param[in] cpus		The usable cpus, only these are used for the measurements
+ *
+ * \return The bandwidth of every node.
+ */
+Bandwidths measure(const Topology &topology, const std::vector<int> &cpus);
+
+/*!
+ * \brief Loads bandwidths from a file
+ *
+ * \param[in]  path			Path of the file
+ * \param[out] bandwidths	The bandwidths
+ *
+ * \return true, if the file exists and could be parsed.
+ */
+bool load(QString path, Bandwidths &bandwidths);
+
+/*!
+ * \brief Stores bandwidths in a file
+ *
+ * Missing directories are created.
+ *
+ * \param[in] path			Path of the file
+ * \param[in] bandwidths	The bandwidths
+ *
+ * \return true on success.
+ */
+bool save(QString path, const Bandwidths &bandwidths);
+};
+
+} // namespace OS
+} // namespace AutopinPlus
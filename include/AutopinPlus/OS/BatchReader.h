@@ -0,0 +1,160 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+namespace AutopinPlus {
+namespace OS {
+
+/*!
+ * \brief Reads from many file descriptors with as few syscalls as possible
+ *
+ * All reads added to the batch are submitted to an io_uring at once and
+ * completed with a single io_uring_enter() call per ring size. If io_uring
+ * is not available (old kernel, seccomp or disabled by the administrator),
+ * every read is done with a plain read() syscall instead.
+ *
+ * The class does not depend on Qt, so that it can be used by the tools as well.
+ */
+class BatchReader {
+  public:
+	/*!
+	 * \brief Constructor
+	 *
+	 * \param[in] entries Size of the submission queue, larger batches are split
+	 */
+	explicit BatchReader(unsigned int entries = 1024);
+
+	/*!
+	 * \brief Destructor
+	 */
+	~BatchReader();
+
+	BatchReader(const BatchReader &) = delete;
+	BatchReader &operator=(const BatchReader &) = delete;
+
+	/*!
+	 * \brief Checks if the reads are done with io_uring
+	 */
+	bool isAsync() const;
+
+	/*!
+	 * \brief Removes all reads from the batch
+	 */
+	void clear();
+
+	/*!
+	 * \brief Adds a read to the batch
+	 *
+	 * The buffer must stay valid until submit() has returned.
+	 *
+	 * \param[in] fd     The file descriptor to read from
+	 * \param[in] buffer The buffer to read into
+	 * \param[in] size   The number of bytes to read
+	 *
+	 * \return Index of the read in the batch
+	 */
+	size_t add(int fd, void *buffer, size_t size);
+
+	/*!
+	 * \brief Returns the number of reads in the batch
+	 */
+	size_t size() const;
+
+	/*!
+	 * \brief Performs all reads of the batch
+	 */
+	void submit();
+
+	/*!
+	 * \brief Returns the result of a read of the last submit()
+	 *
+	 * \param[in] index Index of the read as returned by add()
+	 *
+	 * \return The number of bytes read or a negative errno value
+	 */
+	ssize_t getResult(size_t index) const;
+
+	/*!
+	 * \brief Returns the number of syscalls the last submit() needed
+	 */
+	size_t getSyscalls() const;
+
+  private:
+	/*!
+	 * \brief A single read of the batch
+	 */
+	struct Request {
+		int fd;
+		void *buffer;
+		size_t size;
+	};
+
+	/*!
+	 * \brief Creates the io_uring and maps its rings
+	 *
+	 * \return true on success, false if io_uring is not available
+	 */
+	bool setup(unsigned int entries);
+
+	/*!
+	 * \brief Unmaps the rings and closes the io_uring
+	 */
+	void teardown();
+
+	/*!
+	 * \brief Submits the reads [first, last) to the io_uring and waits for their completion
+	 *
+	 * \return true on success, false if the io_uring failed
+	 */
+	bool submitRing(size_t first, size_t last);
+
+	/*!
+	 * Reads of the batch
+	 */
+	std::vector<Request> requests;
+
+	/*!
+	 * Results of the reads
+	 */
+	std::vector<ssize_t> results;
+
+	/*!
+	 * Syscalls needed by the last submit()
+	 */
+	size_t syscalls = 0;
+
+	//@{
+	/*!
+	 * The io_uring and its mapped rings, ring_fd is -1 if io_uring is not used
+	 */
+	int ring_fd = -1;
+	void *sq_ring = nullptr;
+	void *cq_ring = nullptr;
+	void *sqes = nullptr;
+	size_t sq_ring_size = 0;
+	size_t cq_ring_size = 0;
+	size_t sqes_size = 0;
+	unsigned int sq_entries = 0;
+	unsigned int *sq_head = nullptr;
+	unsigned int *sq_tail = nullptr;
+	unsigned int *sq_mask = nullptr;
+	unsigned int *sq_array = nullptr;
+	unsigned int *cq_head = nullptr;
+	unsigned int *cq_tail = nullptr;
+	unsigned int *cq_mask = nullptr;
+	void *cqes = nullptr;
+	//@}
+};
+
+} // namespace OS
+} // namespace AutopinPlus
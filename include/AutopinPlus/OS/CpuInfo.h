@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <AutopinPlus/OS/Topology.h>
 #include <vector>
 #include <QString>
 
@@ -21,19 +22,94 @@ namespace CpuInfo {
 void setupCpuInfo();
 
 /*!
- * \brief Returns the number of available cpus.
+ * \brief Returns the number of possible cpus.
+ *
+ * Cpu ids may be sparse, so this is the highest possible cpu id
+ * plus one. Not all of these cpus are necessarily usable.
  *
  * \return The number of cpus.
  */
 int getCpuCount();
 
+/*!
+ * \brief Checks if autopin+ may pin tasks to a cpu.
+ *
+ * A cpu is usable if it is online, contained in the affinity
+ * mask of autopin+ and in the effective cpuset of its cgroup.
+ *
+ * \param[in] cpu Specifies the cpu.
+ *
+ * \return true, if the cpu is usable.
+ */
+bool isCpuUsable(int cpu);
+
+/*!
+ * \brief Returns all usable cpus.
+ *
+ * \return A sorted vector of cpu indexes.
+ */
+std::vector<int> getUsableCpus();
+
+/*!
+ * \brief Returns the cpus a task may run on.
+ *
+ * \param[in] tid Specifies the task, 0 for autopin+ itself.
+ *
+ * \return A sorted vector of cpu indexes, empty on error.
+ */
+std::vector<int> getAffinity(int tid);
+
+/*!
+ * \brief Pins the calling thread to a cpu.
+ *
+ * \param[in] cpu Specifies the cpu.
+ *
+ * \return true on success.
+ */
+bool pinCurrentThread(int cpu);
+
 /*!
  * \brief Returns the distance between two cpus.
  *
+ * If measured latencies have been set, the distance is the latency
+ * in nanoseconds, otherwise the numa distance of the nodes of the
+ * cpus. Distances should therefore only be compared to each other.
+ *
  * \return The distance between cpu0 and cpu1.
  */
 int getCpuDistance(int cpu0, int cpu1);
 
+/*!
+ * \brief Sets measured latencies between all pairs of cpus.
+ *
+ * \param[in] values Flat matrix of latencies in nanoseconds, see LatencyCalibration.
+ */
+void setLatencies(const std::vector<float> &values);
+
+/*!
+ * \brief Checks if measured latencies are available.
+ *
+ * \return true, if setLatencies() has been called with a valid matrix.
+ */
+bool hasLatencies();
+
+/*!
+ * \brief Sets the measured memory bandwidth of the numa nodes.
+ *
+ * \param[in] values Bandwidths in MB/s, see BandwidthCalibration.
+ */
+void setBandwidths(const std::vector<std::vector<float>> &values);
+
+/*!
+ * \brief Returns the sustainable memory bandwidth of a numa node.
+ *
+ * \param[in] node  Specifies the node.
+ * \param[in] cores Number of cores accessing the memory of the node.
+ *
+ * \return The bandwidth in MB/s or 0, if it has not been measured.
+ */
+float getNodeBandwidth(int node, int cores);
+
 /*!
  * \brief Returns the index of the cpus on a nume node
  *
@@ -59,6 +135,24 @@ int getNodeCount();
  */
 int getNodeByCpu(int cpu);
 
+/*!
+ * \brief Returns the topology of the cpus.
+ *
+ * \return The topology.
+ */
+const Topology &getTopology();
+
+/*!
+ * \brief Returns a signature of the machine.
+ *
+ * Calibration results may only be reused on a machine with the same
+ * signature. The signature covers the cpu model, the topology and
+ * the usable cpus.
+ *
+ * \return The signature as a hex string.
+ */
+QString getSignature();
+
 std::vector<int> parseSysRangeFile(QString path);
 
 std::vector<int> parseSysNodeDistance(QString path);
@@ -0,0 +1,94 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <QSocketNotifier>
+#include <AutopinPlus/AutopinContext.h>
+
+namespace AutopinPlus {
+namespace OS {
+
+/*!
+ * \brief Singleton, which dispatches cpu hotplug events
+ *
+ * This class listens for kernel uevents on a netlink socket and converts cpu
+ * online/offline events to qt signals. Before a signal is emitted, the CpuInfo
+ * is refreshed, so receivers already see the new topology and usable cpus.
+ */
+class HotplugDispatcher : public QObject {
+	Q_OBJECT
+  public:
+	/*!
+	 * \brief Get the instance of the HotplugDispatcher
+	 */
+	static HotplugDispatcher &getInstance();
+
+	/*!
+	 * Must be called before the HotplugDispatcher emits any signals.
+	 * Should be called usally once at the beginning of
+	 * the lifetime of the application.
+	 */
+	static int setupHotplugHandler();
+
+	/*!
+	 * Delete functions, so we don't accidently end up with another
+	 * instance of HotplugDispatcher
+	 */
+	HotplugDispatcher(HotplugDispatcher const &) = delete;
+	void operator=(HotplugDispatcher const &) = delete;
+
+  public slots:
+	/*!
+	 * Slot for handling incoming uevents.
+	 */
+	void slot_handleUevent();
+
+signals:
+	/*!
+	 * Emitted, when a cpu has been brought online
+	 *
+	 * \param[in] cpu The cpu
+	 */
+	void sig_CpuOnline(int cpu);
+
+	/*!
+	 * Emitted, when a cpu has been taken offline
+	 *
+	 * \param[in] cpu The cpu
+	 */
+	void sig_CpuOffline(int cpu);
+
+  private:
+	/*!
+	 * \brief Constructor
+	 */
+	HotplugDispatcher();
+
+	/*!
+	 * \brief AutopinContext used by this class to log error messages
+	 */
+	const AutopinContext context;
+
+	/*!
+	 * \brief File descriptor of the netlink socket
+	 */
+	int fd = -1;
+
+	/*!
+	 * \brief SocketNotifier for fd
+	 */
+	QSocketNotifier *snUevent = nullptr;
+
+	/*!
+	 * \brief Initalizes the HotplugDispatcher
+	 */
+	int init();
+};
+
+} // namespace OS
+} // namespace AutopinPlus
@@ -0,0 +1,59 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <AutopinPlus/OS/Topology.h>
+#include <QString>
+#include <vector>
+
+namespace AutopinPlus {
+namespace OS {
+namespace LatencyCalibration {
+
+/*!
+ * \brief Measures the cache-line transfer latency between all pairs of cpus
+ *
+ * Instead of measuring every pair, one pair is measured for every class of pairs:
+ * hardware threads of one core, cores sharing a last level cache and every pair
+ * of last level caches. Measurements of disjoint pairs run in parallel.
+ *
+ * \param[in] topology	The topology of the machine
+ * \param[in] cpus		The usable cpus, only these are used for the measurements
+ *
+ * \return A flat cpu_count x cpu_count matrix of one-way latencies in nanoseconds or
+ * 	an empty vector if there are not enough usable cpus.
+ */
+std::vector<float> measure(const Topology &topology, const std::vector<int> &cpus);
+
+/*!
+ * \brief Loads a latency matrix from a file
+ *
+ * \param[in]  path			Path of the file
+ * \param[in]  cpu_count	Expected number of cpus
+ * \param[out] latencies	The latency matrix
+ *
+ * \return true, if the file exists and contains a matrix of the expected size.
+ */
+bool load(QString path, int cpu_count, std::vector<float> &latencies);
+
+/*!
+ * \brief Stores a latency matrix in a file
+ *
+ * Missing directories are created.
+ *
+ * \param[in] path		Path of the file
+ * \param[in] cpu_count	Number of cpus
+ * \param[in] latencies	The latency matrix
+ *
+ * \return true on success.
+ */
+bool save(QString path, int cpu_count, const std::vector<float> &latencies);
+};
+
+} // namespace OS
+} // namespace AutopinPlus
@@ -87,6 +87,25 @@ class OSServices : public QObject {
 	 */
 	int setAffinity(int tid, int cpu);
 
+	/*!
+	 * \brief Records pinnings instead of applying them
+	 *
+	 * After calling this function, setAffinity() only appends a line
+	 * "<milliseconds since epoch> <tid> <cpu>" to the given file and
+	 * succeeds. Together with a synthetic sysfs tree (see SystemPaths),
+	 * this allows to evaluate strategies on topologies of other machines.
+	 *
+	 * \param[in] path	Path of the file, which is truncated
+	 *
+	 * \return true, if the file could be opened
+	 */
+	static bool setAffinityLog(const QString &path);
+
+	/*!
+	 * \brief Checks if pinnings are recorded instead of applied
+	 */
+	static bool isRecordingAffinity();
+
 	/*!
 	 * \brief Attaches autopin+ to a process
 	 *
@@ -200,6 +219,18 @@ class OSServices : public QObject {
 	 */
 	int getTaskSortId(int tid);
 
+	/*!
+	 * \brief Returns the cpu time consumed by a task
+	 *
+	 * The cpu time is the sum of the user and system time from /proc/tid/stat.
+	 * No error is reported, as the task may have terminated in the meantime.
+	 *
+	 * \param[in] tid	tid of the task
+	 *
+	 * \return The cpu time in clock ticks or -1 if it could not be read
+	 */
+	qint64 getTaskCpuTime(int tid);
+
 	/*!
 	 * \brief Returns the hostname of the host running autopin+
 	 *
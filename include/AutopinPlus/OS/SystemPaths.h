@@ -0,0 +1,78 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <QString>
+
+namespace AutopinPlus {
+namespace OS {
+
+/*!
+ * \brief Mount points of sysfs and procfs
+ *
+ * All accesses to sysfs and procfs go through these functions, so that
+ * autopin+ can be run against a synthetic tree (see tools/generate-sysfs.py),
+ * e.g. for testing strategies on topologies of large machines.
+ */
+namespace SystemPaths {
+
+/*!
+ * \brief Sets the mount point of sysfs, defaults to /sys
+ *
+ * Must be called before CpuInfo::setupCpuInfo().
+ *
+ * \param[in] root The mount point
+ */
+void setSysfsRoot(const QString &root);
+
+/*!
+ * \brief Sets the mount point of procfs, defaults to /proc
+ *
+ * \param[in] root The mount point
+ */
+void setProcfsRoot(const QString &root);
+
+/*!
+ * \brief Returns the mount point of sysfs
+ */
+QString getSysfsRoot();
+
+/*!
+ * \brief Checks if the mount point of sysfs has been changed
+ *
+ * In this case, the topology is not necessarily the one of the machine
+ * running autopin+.
+ */
+bool isSysfsOverridden();
+
+/*!
+ * \brief Returns the path of a file in sysfs
+ *
+ * \param[in] path Path relative to the mount point, starting with a slash
+ */
+QString sysfs(const QString &path);
+
+/*!
+ * \brief Returns the path of a file in procfs
+ *
+ * \param[in] path Path relative to the mount point, starting with a slash
+ */
+QString procfs(const QString &path);
+
+/*!
+ * \brief Maps an absolute path below /sys to the configured mount point
+ *
+ * Paths outside of /sys are returned unchanged.
+ *
+ * \param[in] path An absolute path
+ */
+QString mapSysfs(const QString &path);
+};
+
+} // namespace OS
+} // namespace AutopinPlus
@@ -0,0 +1,201 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <QString>
+#include <vector>
+
+namespace AutopinPlus {
+namespace OS {
+
+/*!
+ * \brief Immutable description of the cpu topology of the machine
+ *
+ * Stores the package, numa node, core, L2 cache and last level cache of every cpu as well
+ * as the cpus sharing each of these resources. All groups of cpus are stored in flat arrays,
+ * so that queries neither allocate memory nor follow pointers.
+ */
+class Topology {
+  public:
+	/*!
+	 * \brief A contiguous, sorted list of cpus which is owned by a Topology
+	 */
+	class CpuList {
+	  public:
+		CpuList(const int *first, const int *last) : first(first), last(last) {}
+
+		const int *begin() const { return first; }
+		const int *end() const { return last; }
+		int size() const { return last - first; }
+		bool empty() const { return first == last; }
+		int operator[](int index) const { return first[index]; }
+
+	  private:
+		const int *first;
+		const int *last;
+	};
+
+	/*!
+	 * \brief Classes of cores on hybrid processors
+	 */
+	enum CoreClass { STANDARD, PERFORMANCE, EFFICIENCY };
+
+	/*!
+	 * \brief Capacity of the fastest cpus, the capacities of all other cpus are scaled accordingly
+	 */
+	static const int max_capacity = 1024;
+
+	/*!
+	 * \brief Constructor
+	 *
+	 * Creates an empty topology without any cpus.
+	 */
+	Topology();
+
+	/*!
+	 * \brief Reads the topology of the first cpus from sysfs
+	 *
+	 * Information which is not provided by the kernel is replaced by sensible defaults:
+	 * every cpu forms its own core and caches, belongs to package and node 0 and has
+	 * the maximum capacity.
+	 *
+	 * \param[in] cpu_count Number of cpus to read
+	 * \param[in] root      Mount point of sysfs, can be changed for testing with a fake sysfs tree
+	 *
+	 * \return The topology of the machine
+	 */
+	static Topology read(int cpu_count, const QString &root = "/sys");
+
+	/*!
+	 * \brief Returns the number of cpus in the topology
+	 */
+	int getCpuCount() const;
+
+	//@{
+	/*!
+	 * \brief Returns the identifier of a resource of a cpu
+	 *
+	 * Packages and nodes are identified by the numbers assigned by the kernel. Cores and
+	 * caches are identified by the lowest cpu sharing them, so that they are unique
+	 * across packages.
+	 *
+	 * \param[in] cpu Specifies the cpu.
+	 */
+	int getPackage(int cpu) const;
+	int getNode(int cpu) const;
+	int getCore(int cpu) const;
+	int getL2(int cpu) const;
+	int getLLC(int cpu) const;
+	//@}
+
+	/*!
+	 * \brief Returns the class of the core of a cpu
+	 *
+	 * Taken from /sys/devices/cpu_core/cpus and /sys/devices/cpu_atom/cpus. Without
+	 * these files, cpus in a slower capacity class than the fastest cpus are of class
+	 * EFFICIENCY and the fastest ones of class PERFORMANCE. On processors without
+	 * different core types, all cpus are of class STANDARD.
+	 *
+	 * \param[in] cpu Specifies the cpu.
+	 */
+	CoreClass getCoreClass(int cpu) const;
+
+	/*!
+	 * \brief Returns the relative performance of a cpu
+	 *
+	 * Taken from cpu_capacity or, if not available, from acpi_cppc/highest_perf and
+	 * scaled, so that the fastest cpus have a capacity of max_capacity. All cpus of a
+	 * core class, or without core classes all cpus whose capacities are less than 10%
+	 * apart, get the same capacity, so that the slightly different highest_perf of
+	 * preferred cores doesn't create classes of their own.
+	 *
+	 * \param[in] cpu Specifies the cpu.
+	 */
+	int getCapacity(int cpu) const;
+
+	/*!
+	 * \brief Checks if the cpus differ in their core class
+	 */
+	bool isHybrid() const;
+
+	//@{
+	/*!
+	 * \brief Returns the cpus sharing a resource with a cpu, including the cpu itself
+	 *
+	 * \param[in] cpu Specifies the cpu.
+	 */
+	CpuList getSiblings(int cpu) const;
+	CpuList getL2Sharers(int cpu) const;
+	CpuList getLLCSharers(int cpu) const;
+	CpuList getPackageCpus(int cpu) const;
+	CpuList getNodeCpus(int cpu) const;
+	//@}
+
+  private:
+	/*!
+	 * \brief The resources of a single cpu
+	 */
+	struct Cpu {
+		int package;
+		int node;
+		int core;
+		int l2;
+		int llc;
+		CoreClass core_class;
+		int capacity;
+	};
+
+	/*!
+	 * \brief Partition of the cpus into groups sharing a resource
+	 */
+	struct Groups {
+		/*!
+		 * Group of the n-th cpu
+		 */
+		std::vector<int> group;
+
+		/*!
+		 * Start of the n-th group in members, followed by the end of the last group
+		 */
+		std::vector<int> offsets;
+
+		/*!
+		 * Cpus of all groups, sorted by group and cpu
+		 */
+		std::vector<int> members;
+
+		/*!
+		 * \brief Builds the groups from the identifier of the resource of every cpu
+		 */
+		void build(const std::vector<int> &ids);
+
+		/*!
+		 * \brief Returns the group of a cpu
+		 */
+		CpuList get(int cpu) const;
+	};
+
+	/*!
+	 * Resources of the n-th cpu
+	 */
+	std::vector<Cpu> cpus;
+
+	//@{
+	/*!
+	 * Groups of cpus sharing a resource
+	 */
+	Groups siblings;
+	Groups l2;
+	Groups llc;
+	Groups packages;
+	Groups nodes;
+	//@}
+};
+
+} // namespace OS
+} // namespace AutopinPlus
@@ -10,10 +10,15 @@
 #include <AutopinPlus/AutopinContext.h> // for AutopinContext
 #include <AutopinPlus/Configuration.h>  // for Configuration, etc
 #include <AutopinPlus/ProcessTree.h>	// for ProcessTree, etc
+#include <AutopinPlus/SampleRing.h>		// for SampleRing
+#include <AutopinPlus/SampleWindow.h>	// for SampleWindow
 #include <deque>						// for deque
 #include <map>							// for map
+#include <qmutex.h>						// for QMutex
 #include <qstring.h>					// for QString
 #include <memory>
+#include <stdint.h>						// for int64_t
+#include <vector>						// for vector
 
 namespace AutopinPlus {
 
@@ -34,12 +39,64 @@ class PerformanceMonitor {
 	 */
 	typedef std::map<int, double> autopin_measurements;
 
+	/*!
+	 * \brief Status of a single value of a batch read
+	 */
+	typedef enum { VALUE_OK, VALUE_UNMONITORED, VALUE_FAILED } valstatus;
+
+	/*!
+	 * \brief Struct-of-arrays storage for the result of a batch read
+	 *
+	 * The n-th entry of every array belongs to the n-th requested task. The arrays
+	 * only grow, so a batch which is reused for every read does not allocate memory
+	 * once it has reached the number of monitored tasks.
+	 */
+	struct value_batch {
+		/*!
+		 * Performance value of every task or 0 if the status is not VALUE_OK
+		 */
+		std::vector<double> values;
+
+		/*!
+		 * Monotonic time of every read in nanoseconds
+		 */
+		std::vector<int64_t> timestamps;
+
+		/*!
+		 * Status of every value
+		 */
+		std::vector<valstatus> status;
+
+		/*!
+		 * Coverage of every value, see coverage(int)
+		 */
+		std::vector<double> coverage;
+
+		/*!
+		 * Number of valid entries, the arrays may be larger
+		 */
+		size_t count = 0;
+
+		/*!
+		 * \brief Prepares the batch for reading the given number of values
+		 */
+		void resize(size_t new_count);
+	};
+
   public:
 	/*!
 	 * \brief Different types of performance monitors
 	 */
 	typedef enum { MAX, MIN, UNKNOWN } montype;
 
+	/*!
+	 * \brief Granularity of the values measured by a performance monitor
+	 *
+	 * All threads within the same unit of the scope (e.g. the same process or the whole
+	 * system) share the same measurement, so it only has to be started and read once per unit.
+	 */
+	typedef enum { THREAD, PROCESS, NODE, PACKAGE, SYSTEM } monscope;
+
 	/*!
 	 * \brief Constructor
 	 *
@@ -66,6 +123,27 @@ class PerformanceMonitor {
 	 */
 	montype getValType();
 
+	/*!
+	 * \brief Returns the scope of the values measured by the monitor
+	 *
+	 * Data loggers and strategies can use it to read a monitor only once per unit of its
+	 * scope instead of once per thread.
+	 *
+	 * \return Scope of the performance monitor
+	 */
+	virtual monscope getScope();
+
+	/*!
+	 * \brief Returns whether the value accumulates over the measurement
+	 *
+	 * Cumulative values like event counts or energy grow with the time a thread is measured,
+	 * so strategies comparing measurements of different lengths divide them by the elapsed
+	 * time. Ratios and rates are already independent of the length of the measurement.
+	 *
+	 * \return True if the value accumulates over the measurement
+	 */
+	virtual bool isCumulative();
+
 	/*!
 	 * \brief Returns the type of the performance monitor
 	 *
@@ -83,10 +161,13 @@ class PerformanceMonitor {
 	/*!
 	 * \brief Sets the pid of the observed process
 	 *
+	 * Called once the observed process has been started. Monitors which measure the
+	 * process as a whole can set up their measurement here.
+	 *
 	 * \param[in] pid The pid of the process under observation
 	 *
 	 */
-	void setObservedProcessPid(int npid) ;
+	virtual void setObservedProcessPid(int npid) ;
 	
 	/*!
 	 * \brief Get the unit of the performance monitor.
@@ -121,6 +202,22 @@ class PerformanceMonitor {
 	 */
 	virtual double value(int tid) = 0;
 
+	/*!
+	 * \brief Returns the coverage of the last value read for a task
+	 *
+	 * Monitors based on hardware counters may have to share the counters with other
+	 * events, in which case the counters only run for a part of the measurement and the
+	 * values are extrapolated. The coverage is the fraction of the measurement in which
+	 * the counters were actually running. Strategies can use it to discard or extend
+	 * measurements which rely too much on extrapolation. The default implementation
+	 * returns 1.0, i.e. the values are always exact.
+	 *
+	 * \param[in] tid The tid of the task
+	 *
+	 * \return Coverage between 0.0 and 1.0
+	 */
+	virtual double coverage(int tid);
+
 	/*!
 	 * \brief Stops performance measuring for a task
 	 *
@@ -142,7 +239,9 @@ class PerformanceMonitor {
 	 * \brief Starts performance measuring for a set of tasks
 	 *
 	 * If the performance of one of the tasks is already being measured all
-	 * previous performance values of this task will be cleared.
+	 * previous performance values of this task will be cleared. Monitors whose
+	 * start() reads counters shared by a wider scope (see getScope()) should
+	 * override it to read them only once for all tasks.
 	 *
 	 * \param[in] tasks	List with tids of the tasks
 	 */
@@ -151,6 +250,10 @@ class PerformanceMonitor {
 	/*!
 	 * \brief Stops performance measuring for set of tasks
 	 *
+	 * Outside of thread scope (see getScope()), the values are read with a
+	 * single call of values(), which reads shared counters once per unit of
+	 * the scope, and the tasks are cleared afterwards.
+	 *
 	 * \param[in] tasks	List with tids of the tasks
 	 *
 	 * \return Performance of the tasks
@@ -168,12 +271,105 @@ class PerformanceMonitor {
 	/*!
 	 * \brief Reads the current performance value of a set of tasks
 	 *
+	 * Outside of thread scope (see getScope()), the values are read with a
+	 * single call of values() like in stop().
+	 *
 	 * \param[in] tasks	List with tids of the tasks
 	 *
 	 * \return Performance of the tasks
 	 */
 	virtual autopin_measurements value(ProcessTree::autopin_tid_list tasks);
 
+	/*!
+	 * \brief Reads the current performance values of a batch of tasks
+	 *
+	 * Unlike the other functions for reading values, problems with single tasks
+	 * are not reported to the context but stored in the status of the value, so
+	 * that one failing task does not abort the whole batch. The default
+	 * implementation marks tasks which are not in getMonitoredTasks() as
+	 * VALUE_UNMONITORED and calls value(int) for all others. Errors of value(int)
+	 * are still reported to the context there, unless they are collected by an
+	 * AutopinContext::Quiet (as on a Sampler thread), so monitors whose reads can
+	 * fail should override it with a native bulk implementation.
+	 *
+	 * \param[in]  tids	Array with the tids of the tasks
+	 * \param[in]  count	Number of tasks in the array
+	 * \param[out] result	Storage for the values, resized to count
+	 */
+	virtual void values(const int *tids, size_t count, value_batch &result);
+
+	/*!
+	 * \brief Reads a batch of tasks and records the values in their windows
+	 *
+	 * Works like values(), but additionally appends every valid value to the
+	 * SampleWindow of its task, which is the basis of the windowed statistics
+	 * (see getRate() etc.). Windows of tasks which are not part of the batch
+	 * anymore are dropped, so the batch should contain all monitored tasks.
+	 *
+	 * \param[in]  tids	Array with the tids of the tasks
+	 * \param[in]  count	Number of tasks in the array
+	 * \param[out] result	Storage for the values, resized to count
+	 */
+	void sample(const int *tids, size_t count, value_batch &result);
+
+	/*!
+	 * \brief Sets the configuration of the windows created from now on
+	 */
+	void setWindowConfig(const SampleWindow::Config &config);
+
+	/*!
+	 * \brief Returns the change of the value of a task per second
+	 *
+	 * Windows are only filled from the samples of a Sampler thread or by sample(),
+	 * i.e. if the monitor is read by the external logger. The getters don't lock the
+	 * mutex of the monitor, so they never wait for a read of the sampler. Without
+	 * enough values, 0 is returned and
+	 * the status is set to VALUE_UNMONITORED, so that it isn't mistaken for a reading.
+	 *
+	 * \param[in]  tid    The tid of the task
+	 * \param[in]  span   The time to compute the rate over in milliseconds, e.g. 500 for the last half second
+	 * \param[out] status If not nullptr, set to VALUE_OK or to VALUE_UNMONITORED if less than two values of the
+	 *                    task are in its window
+	 *
+	 * \return The rate or 0 if less than two values of the task are in its window
+	 */
+	double getRate(int tid, int span, valstatus *status = nullptr);
+
+	/*!
+	 * \brief Returns the exponentially weighted moving average of a task, see SampleWindow::getEwma()
+	 *
+	 * The status is set like in getRate(), one value is enough.
+	 */
+	double getEwma(int tid, valstatus *status = nullptr);
+
+	/*!
+	 * \brief Returns the smallest value of a task in its window, see SampleWindow::getMinimum()
+	 *
+	 * The status is set like in getRate(), one value is enough.
+	 */
+	double getMinimum(int tid, valstatus *status = nullptr);
+
+	/*!
+	 * \brief Returns the largest value of a task in its window, see SampleWindow::getMaximum()
+	 *
+	 * The status is set like in getRate(), one value is enough.
+	 */
+	double getMaximum(int tid, valstatus *status = nullptr);
+
+	/*!
+	 * \brief Returns the mean value of a task in its window, see SampleWindow::getMean()
+	 *
+	 * The status is set like in getRate(), one value is enough.
+	 */
+	double getMean(int tid, valstatus *status = nullptr);
+
+	/*!
+	 * \brief Returns a percentile of the values of a task in its window, see SampleWindow::getPercentile()
+	 *
+	 * The status is set like in getRate(), one value is enough.
+	 */
+	double getPercentile(int tid, double quantile, valstatus *status = nullptr);
+
 	/*!
 	 * \brief Stops all running measurements
 	 *
@@ -221,6 +417,56 @@ class PerformanceMonitor {
 	 */
 	static QString showMontype(const montype &type);
 
+	/*!
+	 * \brief Parses a string into a monscope.
+	 *
+	 * This function parses the supplied string into a monscope. If this fails, an exception is thrown.
+	 *
+	 * \param[in] string The string to be parsed.
+	 *
+	 * \exception Exception This exception will be thrown if the string could not be parsed.
+	 *
+	 * \return The parsed monscope.
+	 */
+	static monscope readMonscope(const QString &string);
+
+	/*!
+	 * \brief Converts a monscope into a string.
+	 *
+	 * This function converts the supplied monscope into a string. If this fails, an exception is thrown.
+	 *
+	 * \param[in] scope The monscope to be converted.
+	 *
+	 * \exception Exception This exception will be thrown if the supplied monscope was invalid.
+	 *
+	 * \return A string representing the supplied monscope.
+	 */
+	static QString showMonscope(const monscope &scope);
+
+	/*!
+	 * \brief Returns the current monotonic time in nanoseconds as used for batch reads
+	 */
+	static int64_t getTimestamp();
+
+	/*!
+	 * \brief Returns the mutex which serializes all accesses to the monitor
+	 *
+	 * The mutex is recursive. Monitors lock it in all methods which access the
+	 * monitored threads, so that they can be read from a Sampler thread.
+	 */
+	QMutex &getMutex();
+
+	/*!
+	 * \brief Returns the samples of the monitor, if it is read by a Sampler
+	 *
+	 * \return The ring buffer or nullptr, if the monitor is not sampled.
+	 */
+	std::shared_ptr<const SampleRing> getSamples() const;
+
+	/*!
+	 * \brief Sets the samples of the monitor, see Sampler::add()
+	 */
+	void setSamples(std::shared_ptr<const SampleRing> ring);
 
   protected:
 	/*!
@@ -238,6 +484,11 @@ class PerformanceMonitor {
 	 */
 	montype valtype;
 
+	/*!
+	 * Scope of the performance monitor
+	 */
+	monscope valscope;
+
 	/*!
 	 * Type of the monitor
 	 */
@@ -249,9 +500,69 @@ class PerformanceMonitor {
 	QString name;
 	
 	/**
-	 * The pid being monitored
+	 * The pid being monitored, -1 until setObservedProcessPid() has been called
 	 **/
-	 int monitored_pid;
+	 int monitored_pid = -1;
+
+	/*!
+	 * Serializes all accesses to the monitor, see getMutex()
+	 */
+	QMutex access_mutex{QMutex::Recursive};
+
+	/*!
+	 * The samples of the monitor, if it is read by a Sampler
+	 */
+	std::shared_ptr<const SampleRing> samples;
+
+	/*!
+	 * Configuration of new windows
+	 */
+	SampleWindow::Config window_config;
+
+	/*!
+	 * The windows of the sampled tasks
+	 */
+	std::map<int, SampleWindow> windows;
+
+	/*!
+	 * Protects the windows and their configuration, independent of "access_mutex"
+	 */
+	QMutex window_mutex;
+
+	/*!
+	 * Position of the windows in "samples"
+	 */
+	uint64_t window_cursor = 0;
+
+	/*!
+	 * \brief Appends the new samples of the Sampler thread to the windows
+	 *
+	 * "window_mutex" must be held by the caller.
+	 */
+	void readSamples();
+
+	/*!
+	 * \brief Returns the window of a task if it has enough values for a statistic
+	 *
+	 * \param[in]  tid     The tid of the task
+	 * \param[in]  minimum The number of values the statistic needs
+	 * \param[out] status  If not nullptr, set to VALUE_OK or VALUE_UNMONITORED
+	 *
+	 * \return The window or nullptr if the task has no window or too few values
+	 */
+	const SampleWindow *findWindow(int tid, size_t minimum, valstatus *status);
+
+	/*!
+	 * \brief Reads the values of tasks sharing the counters of a wider scope as one batch
+	 *
+	 * The first task which could not be read is reported to the context.
+	 *
+	 * \param[in]  tasks  List with tids of the tasks
+	 * \param[out] result The values of the tasks read before the first failure
+	 *
+	 * \return False if a task could not be read
+	 */
+	bool readShared(const ProcessTree::autopin_tid_list &tasks, autopin_measurements &result);
 
 };
 
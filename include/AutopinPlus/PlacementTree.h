@@ -0,0 +1,217 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <AutopinPlus/OS/Topology.h>
+#include <vector>
+
+namespace AutopinPlus {
+
+/*!
+ * \brief Hierarchical view of the cpu topology for placing tasks
+ *
+ * The levels of the tree are machine, package, numa node, last level cache, core and
+ * hardware thread (cpu). Every node stores the number of free cpus in its subtree per
+ * capacity class, so that marking a cpu as used or free only updates the ancestors of
+ * the cpu, in time proportional to the depth of the tree times the number of capacity
+ * classes (one, or two to three on hybrid processors). Finding a free cpu descends the
+ * tree and compares the children on every level, in time proportional to the depth
+ * times the fanout. On hybrid processors, ties are broken in favour of the cpus with
+ * the highest capacity (see OS::Topology::getCapacity()).
+ */
+class PlacementTree {
+  public:
+	/*!
+	 * \brief Levels of the tree, from the root to the leaves
+	 */
+	enum Level { MACHINE = 0, PACKAGE, NODE, CACHE, CORE, THREAD };
+
+	/*!
+	 * \brief Constructor
+	 *
+	 * Creates an empty tree without any cpus.
+	 */
+	PlacementTree();
+
+	/*!
+	 * \brief Builds the tree from a topology
+	 *
+	 * All cpus are marked as free.
+	 *
+	 * \param[in] topology The topology of the machine
+	 */
+	void build(const OS::Topology &topology);
+
+	/*!
+	 * \brief Marks a cpu as used or free
+	 *
+	 * \param[in] cpu	The cpu
+	 * \param[in] used	true, if a task has been pinned to the cpu
+	 */
+	void setUsed(int cpu, bool used);
+
+	/*!
+	 * \brief Checks if a cpu is free
+	 *
+	 * \param[in] cpu	The cpu
+	 *
+	 * \return true, if no task is pinned to the cpu
+	 */
+	bool isFree(int cpu) const;
+
+	/*!
+	 * \brief Returns the number of free cpus in the whole tree
+	 */
+	int getFreeCount() const;
+
+	/*!
+	 * \brief Finds the free cpu closest to another cpu
+	 *
+	 * Walks up from the anchor to the lowest ancestor with a free cpu and descends
+	 * from there into the child with the highest capacity. All children of that
+	 * ancestor are equally close to the anchor, as the child containing the anchor
+	 * has no free cpu. Above the numa node level, the free node with the lowest
+	 * distance to the anchor is chosen (see CpuInfo::getCpuDistance()).
+	 *
+	 * \param[in] anchor	The cpu to stay close to or -1 for the free cpu with the highest capacity
+	 *
+	 * \return The free cpu or -1 if all cpus are used
+	 */
+	int findCompact(int anchor) const;
+
+	/*!
+	 * \brief Finds a free cpu in the least used part of the machine
+	 *
+	 * Descends from the root into the child with the fewest used cpus on every level,
+	 * preferring the child with the most free cpus among equally used children.
+	 *
+	 * \return The free cpu or -1 if all cpus are used
+	 */
+	int findScatter() const;
+
+	/*!
+	 * \brief Finds a free cpu in the least used part of a numa node
+	 *
+	 * \param[in] node	The numa node
+	 *
+	 * \return The free cpu or -1 if all cpus of the node are used
+	 */
+	int findScatter(int node) const;
+
+	/*!
+	 * \brief Returns the number of free cpus of a numa node
+	 *
+	 * \param[in] node	The numa node
+	 */
+	int getFreeCount(int node) const;
+
+	/*!
+	 * \brief Returns the numa nodes with at least one cpu
+	 */
+	std::vector<int> getNodes() const;
+
+	/*!
+	 * \brief Returns the highest capacity of all free cpus
+	 *
+	 * \return The capacity or 0 if all cpus are used
+	 */
+	int getFreeCapacity() const;
+
+  private:
+	/*!
+	 * \brief A node of the tree
+	 */
+	struct Node {
+		/*!
+		 * Level of the node
+		 */
+		Level level;
+
+		/*!
+		 * Index of the parent node or -1 for the root
+		 */
+		int parent;
+
+		/*!
+		 * Identifier of the package, node, cache, core or cpu represented by the node
+		 */
+		int id;
+
+		/*!
+		 * Some cpu in the subtree, used for looking up numa distances
+		 */
+		int cpu;
+
+		/*!
+		 * Number of cpus in the subtree
+		 */
+		int size;
+
+		/*!
+		 * Number of free cpus in the subtree
+		 */
+		int free;
+
+		/*!
+		 * Highest capacity of the free cpus in the subtree or 0 if all cpus are used
+		 */
+		int capacity;
+
+		/*!
+		 * Number of free cpus in the subtree per capacity class, see "classes"
+		 */
+		std::vector<int> free_by_class;
+
+		/*!
+		 * Indexes of the child nodes
+		 */
+		std::vector<int> children;
+	};
+
+	/*!
+	 * \brief Descends from a node to a free cpu
+	 *
+	 * \param[in] node		Index of the node to start at, must have a free cpu
+	 * \param[in] spread	If true, prefer the least used child, otherwise the closest one
+	 *
+	 * \return The free cpu
+	 */
+	int descend(int node, bool spread) const;
+
+	/*!
+	 * All nodes of the tree, the root is stored at index 0
+	 */
+	std::vector<Node> nodes;
+
+	/*!
+	 * Index of the leaf node of every cpu or -1 for unknown cpus
+	 */
+	std::vector<int> leaves;
+
+	/*!
+	 * Indexes of the nodes on the numa node level
+	 */
+	std::vector<int> numa_nodes;
+
+	/*!
+	 * Capacity of every cpu
+	 */
+	std::vector<int> capacities;
+
+	/*!
+	 * The distinct capacities of the cpus, from the highest to the lowest
+	 */
+	std::vector<int> classes;
+
+	/*!
+	 * Index of the capacity class of every cpu in "classes"
+	 */
+	std::vector<int> cpu_classes;
+};
+
+} // namespace AutopinPlus
@@ -0,0 +1,187 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <functional> // for function
+#include <map>		  // for map
+#include <memory>	 // for shared_ptr
+#include <mutex>	  // for mutex
+#include <stdint.h>   // for int64_t, uint64_t
+#include <string>	 // for string
+#include <vector>	 // for vector
+
+namespace AutopinPlus {
+
+/*!
+ * \brief Shares the reads of system-wide sources between all monitors of the process.
+ *
+ * Sources like the energy counters of a machine measure the whole system, but every
+ * monitor instance (e.g. one per watchdog in daemon mode) would read them on its own.
+ * The broker registers every physical source once, identified by a key, and coalesces
+ * all reads within a time to live into a single read of the source.
+ *
+ * Every consumer of a source has its own baseline, so that it still sees the values
+ * since its own start: a consumer gets the running totals of the source minus the
+ * totals when it subscribed or was reset last.
+ *
+ * Sources may throw exceptions from their reader, which are passed on to the consumer
+ * that triggered the read.
+ */
+class SampleBroker {
+  public:
+	/*!
+	 * \brief How the values returned by a reader relate to each other
+	 */
+	typedef enum {
+		ABSOLUTE, //!< Every read returns the current values of ever-increasing counters
+		DELTA	 //!< Every read returns the increase since the last read, e.g. of counters reset on read
+	} kind;
+
+	/*!
+	 * \brief Reads the current values of a source
+	 */
+	typedef std::function<std::vector<double>()> reader;
+
+	/*!
+	 * \brief Returns the broker of the process
+	 */
+	static SampleBroker &getInstance();
+
+	/*!
+	 * \brief Subscribes to a source, registering it if necessary
+	 *
+	 * The reader and the other parameters of the first subscription of a source are used
+	 * until all consumers have unsubscribed, later subscriptions share them.
+	 *
+	 * \param[in] key  Unique name of the physical source, e.g. its address.
+	 * \param[in] ttl  Time in nanoseconds during which the last read is reused.
+	 * \param[in] type How the values of the reader have to be accumulated.
+	 * \param[in] read Function reading the source.
+	 *
+	 * \return The id of the consumer, its baseline is the current value of the source.
+	 */
+	int subscribe(const std::string &key, int64_t ttl, kind type, reader read);
+
+	/*!
+	 * \brief Returns the increase of the values of a source since the baseline of a consumer
+	 */
+	std::vector<double> value(int consumer);
+
+	/*!
+	 * \brief Sets the baseline of a consumer to the current value of its source
+	 */
+	void reset(int consumer);
+
+	/*!
+	 * \brief Unsubscribes a consumer, unregistering its source if it was the last one
+	 */
+	void unsubscribe(int consumer);
+
+	/*!
+	 * \brief Returns how often a source has actually been read
+	 */
+	uint64_t getReads(const std::string &key) const;
+
+  private:
+	/*!
+	 * \brief A registered source
+	 */
+	struct Source {
+		/*!
+		 * Function reading the source
+		 */
+		reader read;
+
+		/*!
+		 * How the values of the reader have to be accumulated
+		 */
+		kind type;
+
+		/*!
+		 * Time in nanoseconds during which the last read is reused
+		 */
+		int64_t ttl;
+
+		/*!
+		 * Time of the last read or -1 if the source hasn't been read yet
+		 */
+		int64_t timestamp = -1;
+
+		/*!
+		 * The running totals of the source
+		 */
+		std::vector<double> totals;
+
+		/*!
+		 * Number of reads of the source
+		 */
+		uint64_t reads = 0;
+
+		/*!
+		 * Number of consumers
+		 */
+		int consumers = 0;
+
+		/*!
+		 * Serializes the reads of the source
+		 */
+		std::mutex mutex;
+	};
+
+	/*!
+	 * \brief A consumer of a source
+	 */
+	struct Consumer {
+		/*!
+		 * Key of the source
+		 */
+		std::string key;
+
+		/*!
+		 * The source, kept alive while the consumer is subscribed
+		 */
+		std::shared_ptr<Source> source;
+
+		/*!
+		 * The totals of the source at the start of the consumer's measurement
+		 */
+		std::vector<double> baseline;
+	};
+
+	/*!
+	 * \brief Returns the running totals of a source, reading it if the last read has expired
+	 */
+	static std::vector<double> update(Source &source);
+
+	/*!
+	 * \brief Returns the current monotonic time in nanoseconds
+	 */
+	static int64_t now();
+
+	/*!
+	 * The registered sources by key
+	 */
+	std::map<std::string, std::shared_ptr<Source>> sources;
+
+	/*!
+	 * The consumers by id
+	 */
+	std::map<int, Consumer> consumers;
+
+	/*!
+	 * The id of the next consumer
+	 */
+	int next = 0;
+
+	/*!
+	 * Protects "sources", "consumers" and "next", but not the contents of the sources
+	 */
+	mutable std::mutex mutex;
+};
+
+} // namespace AutopinPlus
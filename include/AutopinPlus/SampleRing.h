@@ -0,0 +1,133 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <atomic>	// for atomic
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint64_t, int64_t
+#include <vector>	// for vector
+
+namespace AutopinPlus {
+
+/*!
+ * \brief A lock-free ring buffer of timestamped samples.
+ *
+ * The ring has a single producer (the sampler thread) and any number of
+ * consumers. The producer never waits for the consumers: if the ring is full,
+ * the oldest samples are overwritten. Every consumer keeps its own cursor and
+ * never blocks the producer or the other consumers. A consumer which has
+ * fallen behind by more than the capacity skips the overwritten samples.
+ *
+ * Every slot is protected by a sequence number (a seqlock), all fields are
+ * accessed atomically, so that a consumer can detect and retry a slot which
+ * is overwritten while it is being read.
+ */
+class SampleRing {
+  public:
+	/*!
+	 * \brief A sample of a thread.
+	 */
+	struct Sample {
+		/*!
+		 * Time of the sample, as returned by PerformanceMonitor::getTimestamp().
+		 */
+		int64_t timestamp;
+
+		/*!
+		 * The thread.
+		 */
+		int tid;
+
+		/*!
+		 * A PerformanceMonitor::valstatus.
+		 */
+		int status;
+
+		/*!
+		 * The value of the monitor.
+		 */
+		double value;
+
+		/*!
+		 * The coverage of the value.
+		 */
+		double coverage;
+	};
+
+	/*!
+	 * \brief Constructor
+	 *
+	 * \param[in] capacity Number of samples, rounded up to a power of two.
+	 */
+	explicit SampleRing(size_t capacity = 4096);
+
+	SampleRing(const SampleRing &) = delete;
+	SampleRing &operator=(const SampleRing &) = delete;
+
+	/*!
+	 * \brief Appends a sample, overwriting the oldest one if the ring is full.
+	 *
+	 * Must only be called from the producer.
+	 */
+	void push(const Sample &sample);
+
+	/*!
+	 * \brief Reads the next sample after a cursor.
+	 *
+	 * \param[in,out] cursor Position of the consumer, 0 to start with the oldest sample in the ring.
+	 * \param[out]    sample The sample.
+	 *
+	 * \return true if a sample has been read, false if there is no new sample.
+	 */
+	bool read(uint64_t &cursor, Sample &sample) const;
+
+	/*!
+	 * \brief Returns the position after the newest sample, i.e. the cursor of a consumer which
+	 *        is only interested in future samples.
+	 */
+	uint64_t getHead() const;
+
+	/*!
+	 * \brief Returns the number of samples which have been skipped by consumers.
+	 */
+	uint64_t getSkipped() const;
+
+  private:
+	/*!
+	 * \brief A slot of the ring.
+	 *
+	 * The sequence number is odd while the slot is being written. Otherwise it is twice the
+	 * position of the sample in the slot plus two, so that a consumer can check that the slot
+	 * still contains the sample it is looking for.
+	 */
+	struct Slot {
+		std::atomic<uint64_t> sequence{0};
+		std::atomic<int64_t> timestamp{0};
+		std::atomic<int> tid{0};
+		std::atomic<int> status{0};
+		std::atomic<double> value{0};
+		std::atomic<double> coverage{0};
+	};
+
+	/*!
+	 * The ring buffer.
+	 */
+	std::vector<Slot> buffer;
+
+	/*!
+	 * Position of the next sample.
+	 */
+	std::atomic<uint64_t> head{0};
+
+	/*!
+	 * Number of samples skipped by consumers.
+	 */
+	mutable std::atomic<uint64_t> skipped{0};
+};
+
+} // namespace AutopinPlus
@@ -0,0 +1,304 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <deque>	 // for deque
+#include <qstring.h> // for QString
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for int64_t, uint64_t, uint32_t
+#include <vector>	// for vector
+
+namespace AutopinPlus {
+
+/*!
+ * \brief Statistics over the recent values of a monitored thread.
+ *
+ * The window keeps a fixed number of timestamped values in a ring. The statistics
+ * (minimum, maximum, mean and percentiles) cover all values which are at most the
+ * configured length old and are updated incrementally whenever a value enters or
+ * leaves the window. Minimum and maximum are kept in monotonic queues, percentiles
+ * in a logarithmic histogram with a bounded relative error, so that pushing a value
+ * takes amortized constant time.
+ *
+ * The statistics can either be computed over the values themselves or, for monitors
+ * which return cumulative counts, over the rate between two consecutive values.
+ */
+class SampleWindow {
+  public:
+	/*!
+	 * \brief The values the statistics are computed over
+	 */
+	typedef enum {
+		VALUE, //!< The values of the monitor
+		RATE   //!< The change of the values per second
+	} signal;
+
+	/*!
+	 * \brief Configuration of a window
+	 */
+	struct Config {
+		/*!
+		 * Length of the window in nanoseconds
+		 */
+		int64_t length = 1000000000;
+
+		/*!
+		 * Maximum number of values in the window, rounded up to a power of two
+		 */
+		size_t capacity = 256;
+
+		/*!
+		 * Time constant of the exponentially weighted moving average in nanoseconds
+		 */
+		int64_t ewma = 1000000000;
+
+		/*!
+		 * The values the statistics are computed over
+		 */
+		signal source = VALUE;
+
+		/*!
+		 * Relative error of the percentiles
+		 */
+		double accuracy = 0.01;
+	};
+
+	/*!
+	 * \brief Constructor
+	 *
+	 * \param[in] config The configuration of the window.
+	 */
+	explicit SampleWindow(const Config &config);
+
+	/*!
+	 * \brief Appends a value
+	 *
+	 * Values must be pushed in the order of their timestamps. In RATE windows, a value
+	 * smaller than the previous one restarts the cumulative value and has no signal.
+	 *
+	 * \param[in] timestamp Time of the value, see PerformanceMonitor::getTimestamp().
+	 * \param[in] value     The value.
+	 */
+	void push(int64_t timestamp, double value);
+
+	/*!
+	 * \brief Returns the number of values the statistics are computed over
+	 */
+	size_t getCount() const;
+
+	/*!
+	 * \brief Returns the change of the values per second
+	 *
+	 * The rate is computed between the newest value and the newest value which is at
+	 * least the given time older, or the oldest value in the window if there is none.
+	 * For RATE windows, values before the last restart of the cumulative value are
+	 * not used.
+	 *
+	 * \param[in] span The time to compute the rate over in nanoseconds.
+	 *
+	 * \return The rate or 0 if there are less than two values.
+	 */
+	double getRate(int64_t span) const;
+
+	/*!
+	 * \brief Returns the exponentially weighted moving average, or 0 if the window is empty
+	 */
+	double getEwma() const;
+
+	/*!
+	 * \brief Returns the smallest value in the window, or 0 if the window is empty
+	 */
+	double getMinimum() const;
+
+	/*!
+	 * \brief Returns the largest value in the window, or 0 if the window is empty
+	 */
+	double getMaximum() const;
+
+	/*!
+	 * \brief Returns the mean of the values in the window, or 0 if the window is empty
+	 */
+	double getMean() const;
+
+	/*!
+	 * \brief Returns a percentile of the values in the window
+	 *
+	 * \param[in] quantile The quantile between 0.0 and 1.0, e.g. 0.99 for the 99th percentile.
+	 *
+	 * \return The percentile within the configured accuracy, or 0 if the window is empty.
+	 */
+	double getPercentile(double quantile) const;
+
+	/*!
+	 * \brief Parses a string into a signal.
+	 *
+	 * \param[in] string The string to be parsed.
+	 *
+	 * \exception Exception This exception will be thrown if the string could not be parsed.
+	 *
+	 * \return The parsed signal.
+	 */
+	static signal readSignal(const QString &string);
+
+	/*!
+	 * \brief Converts a signal into a string.
+	 *
+	 * \param[in] source The signal to be converted.
+	 *
+	 * \exception Exception This exception will be thrown if the supplied signal was invalid.
+	 *
+	 * \return A string representing the supplied signal.
+	 */
+	static QString showSignal(const signal &source);
+
+  private:
+	/*!
+	 * \brief A value in the ring
+	 */
+	struct Entry {
+		/*!
+		 * Time of the value
+		 */
+		int64_t timestamp;
+
+		/*!
+		 * The value of the monitor
+		 */
+		double value;
+
+		/*!
+		 * The value the statistics are computed over
+		 */
+		double signal;
+
+		/*!
+		 * Bucket of the signal in the histogram
+		 */
+		int bucket;
+
+		/*!
+		 * Whether the entry has a signal, i.e. is part of the statistics
+		 */
+		bool valid;
+	};
+
+	/*!
+	 * \brief Histogram with logarithmic buckets, one for each sign
+	 *
+	 * Bucket i of a sign covers the magnitudes (gamma^(i-1), gamma^i]. The histogram only
+	 * stores the range of buckets which has been used so far.
+	 */
+	struct Histogram {
+		/*!
+		 * Number of values per bucket, starting with the bucket "offset"
+		 */
+		std::vector<uint32_t> counts;
+
+		/*!
+		 * The bucket of the first count
+		 */
+		int offset = 0;
+
+		/*!
+		 * \brief Adds a value to a bucket
+		 */
+		void add(int bucket, int delta);
+	};
+
+	/*!
+	 * \brief Adds the entry at a position to the statistics
+	 */
+	void insert(uint64_t position);
+
+	/*!
+	 * \brief Removes the entry at a position from the statistics
+	 */
+	void evict(uint64_t position);
+
+	/*!
+	 * \brief Returns the histogram bucket of a signal
+	 */
+	int getBucket(double signal) const;
+
+	/*!
+	 * \brief Returns the representative value of a histogram bucket
+	 */
+	double getBucketValue(int bucket) const;
+
+	/*!
+	 * The configuration
+	 */
+	Config config;
+
+	/*!
+	 * The ring of values
+	 */
+	std::vector<Entry> entries;
+
+	/*!
+	 * Position of the next value
+	 */
+	uint64_t head = 0;
+
+	/*!
+	 * Position of the oldest value in the statistics
+	 */
+	uint64_t first = 0;
+
+	/*!
+	 * Position of the first value after the last decrease of a cumulative value, see push()
+	 */
+	uint64_t restart = 0;
+
+	/*!
+	 * Number of values in the statistics
+	 */
+	size_t count = 0;
+
+	/*!
+	 * Sum of the values in the statistics
+	 */
+	double sum = 0;
+
+	/*!
+	 * The exponentially weighted moving average
+	 */
+	double ewma = 0;
+
+	/*!
+	 * Whether the moving average has been initialized with a first value
+	 */
+	bool averaged = false;
+
+	/*!
+	 * Positions of the candidates for the minimum, with increasing values
+	 */
+	std::deque<uint64_t> minima;
+
+	/*!
+	 * Positions of the candidates for the maximum, with decreasing values
+	 */
+	std::deque<uint64_t> maxima;
+
+	/*!
+	 * Histograms of the positive and the magnitudes of the negative values
+	 */
+	Histogram positive, negative;
+
+	/*!
+	 * Number of values which are too close to zero for the histograms
+	 */
+	size_t zeros = 0;
+
+	/*!
+	 * Base of the logarithmic buckets and its logarithm
+	 */
+	double gamma, log_gamma;
+};
+
+} // namespace AutopinPlus
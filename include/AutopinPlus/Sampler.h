@@ -0,0 +1,169 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <AutopinPlus/PerformanceMonitor.h> // for PerformanceMonitor
+#include <AutopinPlus/SampleRing.h>			// for SampleRing
+#include <QMutex>							// for QMutex
+#include <QString>							// for QString
+#include <QThread>							// for QThread
+#include <atomic>							// for atomic
+#include <memory>							// for shared_ptr
+#include <stdint.h>							// for int64_t, uint64_t
+#include <vector>							// for vector
+
+namespace AutopinPlus {
+
+/*!
+ * \brief Samples performance monitors periodically on a thread of its own.
+ *
+ * Reading a performance monitor can block for a long time (e.g. the ClustSafe
+ * monitor waits for a network device). To keep such reads away from the Qt event
+ * loop, there is one sampler thread per monitor type, shared by all watchdogs.
+ * Every monitor added to a sampler is read at its own interval and all threads it
+ * monitors are published to a SampleRing, which loggers and strategies can read
+ * without blocking.
+ *
+ * The thread sleeps on a timerfd with absolute deadlines, so that the sampling
+ * times don't drift. If a read takes longer than the interval, the missed
+ * deadlines are skipped instead of being sampled in a burst.
+ *
+ * Accesses of the sampler thread to a monitor are serialized with all other
+ * accesses by the mutex of the monitor (see PerformanceMonitor::getMutex()).
+ * Errors of the monitor are not reported to its context from the sampler thread,
+ * they only set the status of the failed values (see AutopinContext::Quiet).
+ */
+class Sampler : public QThread {
+  public:
+	/*!
+	 * \brief Returns the sampler of a monitor type, creating it if necessary.
+	 *
+	 * \param[in] type The type of the monitors, see PerformanceMonitor::getType().
+	 */
+	static Sampler &getInstance(const QString &type);
+
+	/*!
+	 * \brief Destructor, stops the thread.
+	 */
+	~Sampler() override;
+
+	/*!
+	 * \brief Starts sampling a monitor and starts the thread if necessary.
+	 *
+	 * \param[in] monitor  The monitor, must be removed before it is destroyed.
+	 * \param[in] interval The interval between two samples in milliseconds.
+	 * \param[in] capacity The capacity of the ring buffer in samples.
+	 *
+	 * \return The ring buffer of the monitor.
+	 */
+	std::shared_ptr<const SampleRing> add(PerformanceMonitor *monitor, int interval, size_t capacity);
+
+	/*!
+	 * \brief Stops sampling a monitor.
+	 *
+	 * Waits until the monitor is not being sampled anymore.
+	 *
+	 * \param[in] monitor The monitor.
+	 */
+	void remove(PerformanceMonitor *monitor);
+
+	/*!
+	 * \brief Returns the number of deadlines which have been missed because sampling took too long.
+	 */
+	uint64_t getMissed() const;
+
+  protected:
+	/*!
+	 * \brief The method which will be executed by the thread
+	 */
+	void run() override;
+
+  private:
+	/*!
+	 * \brief A monitor which is sampled.
+	 */
+	struct Entry {
+		/*!
+		 * The monitor.
+		 */
+		PerformanceMonitor *monitor;
+
+		/*!
+		 * The interval between two samples in nanoseconds.
+		 */
+		int64_t interval;
+
+		/*!
+		 * The time of the next sample, see PerformanceMonitor::getTimestamp().
+		 */
+		int64_t deadline;
+
+		/*!
+		 * The samples.
+		 */
+		std::shared_ptr<SampleRing> ring;
+
+		/*!
+		 * The tasks of the previous sample, sorted by tid.
+		 */
+		std::vector<int> tasks;
+	};
+
+	/*!
+	 * \brief Constructor
+	 */
+	Sampler();
+
+	/*!
+	 * \brief Reads all threads of a monitor and publishes the values.
+	 */
+	void sample(Entry &entry);
+
+	/*!
+	 * \brief Wakes up the thread, e.g. to recompute the next deadline.
+	 */
+	void wakeup();
+
+	/*!
+	 * The monitors, protected by "entries_mutex".
+	 */
+	std::vector<Entry> entries;
+
+	/*!
+	 * Protects "entries", held by the thread while sampling.
+	 */
+	QMutex entries_mutex;
+
+	/*!
+	 * The timer the thread sleeps on.
+	 */
+	int timer_fd = -1;
+
+	/*!
+	 * Wakes up the thread if the monitors change or the thread shall exit.
+	 */
+	int event_fd = -1;
+
+	/*!
+	 * Variable indicating that the thread shall exit.
+	 */
+	std::atomic<bool> exreq{false};
+
+	/*!
+	 * Number of missed deadlines.
+	 */
+	std::atomic<uint64_t> missed{0};
+
+	/*!
+	 * Buffers of the thread for reading a monitor.
+	 */
+	std::vector<int> tids;
+	PerformanceMonitor::value_batch batch;
+};
+
+} // namespace AutopinPlus
@@ -0,0 +1,182 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#pragma once
+
+#include <AutopinPlus/PerformanceMonitor.h> // for PerformanceMonitor::montype
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <vector>
+
+namespace AutopinPlus {
+namespace Strategy {
+namespace Autopin1 {
+
+/*!
+ * \brief Singleton, which shares the exploration of a schedule between identical watchdogs
+ *
+ * In daemon mode, several replicas of the same workload are often observed by separate
+ * watchdogs, each running the autopin1 strategy with the same schedule. Instead of testing
+ * every pinning in every replica, all strategies with the same workload fingerprint join one
+ * exploration. Each of them claims a different untested pinning, measures it and reports the
+ * result back. As soon as all pinnings have been measured, every member is notified about the
+ * best pinning via sig_explorationFinished().
+ */
+class Coordinator : public QObject {
+	Q_OBJECT
+  public:
+	/*!
+	 * \brief Get the instance of the Coordinator
+	 */
+	static Coordinator &getInstance() {
+		static Coordinator instance;
+		return instance;
+	}
+
+	/*!
+	 * Delete funtions to ensure singleton functionality
+	 */
+	Coordinator(Coordinator const &) = delete;
+	void operator=(Coordinator const &) = delete;
+
+	/*!
+	 * \brief Joins the exploration for a workload fingerprint
+	 *
+	 * The first member of an exploration determines the number of pinnings and the
+	 * value type of the monitor. Later members must use the same values, otherwise
+	 * joining fails.
+	 *
+	 * \param[in] fingerprint Fingerprint of the workload
+	 * \param[in] pinnings    Number of pinnings in the schedule
+	 * \param[in] type        Value type of the performance monitor used for comparing pinnings
+	 *
+	 * \return The number of members of the exploration (including the caller) or -1 if the
+	 * 	exploration is incompatible with the supplied parameters.
+	 */
+	int join(const QString &fingerprint, int pinnings, PerformanceMonitor::montype type);
+
+	/*!
+	 * \brief Leaves an exploration
+	 *
+	 * All pinnings claimed but not reported by the leaving member are handed back to the
+	 * remaining members.
+	 *
+	 * \param[in] fingerprint Fingerprint of the workload
+	 * \param[in] claimed     Pinning which is currently claimed by the leaving member or -1
+	 */
+	void leave(const QString &fingerprint, int claimed);
+
+	/*!
+	 * \brief Claims the next untested pinning
+	 *
+	 * \param[in] fingerprint Fingerprint of the workload
+	 *
+	 * \return Index of the claimed pinning or -1 if there are no more untested pinnings.
+	 */
+	int claimPinning(const QString &fingerprint);
+
+	/*!
+	 * \brief Reports the result of a claimed pinning
+	 *
+	 * \param[in] fingerprint Fingerprint of the workload
+	 * \param[in] pinning     Index of the measured pinning
+	 * \param[in] result      Performance value of the pinning
+	 */
+	void reportResult(const QString &fingerprint, int pinning, double result);
+
+	/*!
+	 * \brief Returns the best pinning of a finished exploration
+	 *
+	 * \param[in] fingerprint Fingerprint of the workload
+	 *
+	 * \return Index of the best pinning or -1 if the exploration has not finished yet.
+	 */
+	int getBestPinning(const QString &fingerprint);
+
+  signals:
+	/*!
+	 * \brief Emitted, when all pinnings of an exploration have been measured
+	 *
+	 * \param[in] fingerprint Fingerprint of the workload
+	 * \param[in] best        Index of the best pinning
+	 * \param[in] performance Performance value of the best pinning
+	 */
+	void sig_explorationFinished(QString fingerprint, int best, double performance);
+
+	/*!
+	 * \brief Emitted, when a leaving member hands back a pinning it has not measured
+	 *
+	 * \param[in] fingerprint Fingerprint of the workload
+	 */
+	void sig_pinningReleased(QString fingerprint);
+
+  private:
+	/*!
+	 * \brief Constructor
+	 */
+	Coordinator();
+
+	/*!
+	 * \brief State of one shared exploration
+	 */
+	struct Exploration {
+		/*!
+		 * Value type of the monitor used for comparing pinnings
+		 */
+		PerformanceMonitor::montype type;
+
+		/*!
+		 * Number of watchdogs taking part in the exploration
+		 */
+		int members;
+
+		/*!
+		 * Pinnings which have not been claimed yet, in schedule order
+		 */
+		std::vector<int> pending;
+
+		/*!
+		 * Stores if the result of the n-th pinning has been reported
+		 */
+		std::vector<bool> measured;
+
+		/*!
+		 * Results of the pinnings, valid if measured is true
+		 */
+		std::vector<double> results;
+
+		/*!
+		 * Index of the best pinning or -1 while the exploration is running
+		 */
+		int best;
+	};
+
+	/*!
+	 * \brief Determines the best pinning if all pinnings have been measured
+	 *
+	 * \param[in] exploration The exploration to check
+	 *
+	 * \return true, if the exploration has just been finished.
+	 */
+	bool finish(Exploration &exploration);
+
+	/*!
+	 * \brief Mapping between workload fingerprints and their explorations
+	 */
+	QMap<QString, Exploration> explorations;
+
+	/*!
+	 * \brief Mutex for thread-safe access to the explorations
+	 */
+	QMutex mutex;
+};
+
+} // namespace Autopin1
+} // namespace Strategy
+} // namespace AutopinPlus
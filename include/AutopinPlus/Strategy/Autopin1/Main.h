@@ -37,6 +37,13 @@ class Main : public ControlStrategy {
 	Main(const Configuration &config, const ObservedProcess &proc, OS::OSServices &service,
 		 const PerformanceMonitor::monitor_list &monitors, AutopinContext &context);
 
+	/*!
+	 * \brief Destructor
+	 *
+	 * Leaves the shared exploration, if there is one.
+	 */
+	~Main();
+
 	void init() override;
 	Configuration::configopts getConfigOpts() override;
 
@@ -61,6 +68,23 @@ class Main : public ControlStrategy {
 	void slot_TaskTerminated(int tid) override;
 	void slot_PhaseChanged(int newphase) override;
 
+  private slots:
+	/*!
+	 * \brief Applies the best pinning once a shared exploration has finished
+	 *
+	 * \param[in] fingerprint Fingerprint of the finished exploration
+	 * \param[in] best        Index of the best pinning
+	 * \param[in] performance Performance value of the best pinning
+	 */
+	void slot_explorationFinished(QString fingerprint, int best, double performance);
+
+	/*!
+	 * \brief Takes over a pinning which has been released by another watchdog
+	 *
+	 * \param[in] fingerprint Fingerprint of the exploration
+	 */
+	void slot_pinningReleased(QString fingerprint);
+
   private:
 	/*!
 	 * \brief Data structure for storing the pinning.
@@ -118,13 +142,39 @@ class Main : public ControlStrategy {
 	 */
 	void checkPinnedTasks();
 
+	/*!
+	 * \brief Applies the best pinning after all pinnings have been tested
+	 */
+	void applyBestPinning();
+
+	/*!
+	 * \brief Returns the lowest coverage of the monitor for all pinned tasks
+	 *
+	 * Only tasks which are still being measured are considered.
+	 *
+	 * \return The coverage or 1.0 if the coverage is not checked
+	 */
+	double getCoverage();
+
+	/*!
+	 * \brief Builds the fingerprint of the observed workload
+	 *
+	 * Watchdogs running the same command with the same schedule, timings and
+	 * performance monitor produce the same fingerprint and can therefore share
+	 * the exploration of the schedule.
+	 *
+	 * \return The fingerprint as a string
+	 */
+	QString getFingerprint();
+
 	/*!
 	 * Stores the pinnings
 	 */
 	pinning_list pinnings;
 
 	/*!
-	 * The pinning which is currently tested
+	 * The pinning which is currently tested. If the exploration is
+	 * shared, -1 means that no pinning is claimed at the moment.
 	 */
 	int current_pinning;
 
@@ -138,6 +188,11 @@ class Main : public ControlStrategy {
 	 */
 	double best_performance;
 
+	/*!
+	 * Prefix of the options of this strategy
+	 */
+	const QString config_prefix = "autopin1.";
+
 	/*!
 	 * Init time
 	 */
@@ -168,6 +223,21 @@ class Main : public ControlStrategy {
 	 */
 	QTimer measure_timer;
 
+	/*!
+	 * Minimum coverage of the performance monitor for accepting a measurement
+	 */
+	double min_coverage;
+
+	/*!
+	 * Maximum number of times the measure time is extended because of a low coverage
+	 */
+	int max_extensions;
+
+	/*!
+	 * Number of times the measurement of the current pinning has been extended
+	 */
+	int extensions;
+
 	/*!
 	 * Stores if the second thread should not be pinned
 	 * because OpenMP is used with icc.
@@ -216,6 +286,18 @@ class Main : public ControlStrategy {
 	 * the creation/termination of tasks are currently enabled.
 	 */
 	bool notifications;
+
+	/*!
+	 * Stores if the exploration of the schedule is shared with
+	 * other watchdogs observing the same workload.
+	 */
+	bool share_exploration;
+
+	/*!
+	 * Fingerprint of the observed workload, used for finding
+	 * watchdogs to share the exploration with.
+	 */
+	QString fingerprint;
 };
 
 } // namespace Autopin1
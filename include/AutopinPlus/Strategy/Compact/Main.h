@@ -54,6 +54,12 @@ class Main : public ControlStrategy {
 	 * \brief Stores the currently new Task for getPinning;
 	 */
 	int new_task_tid = 0;
+
+	/*!
+	 * \brief The cpu the last task of the observed process has been pinned to
+	 * or -1, if no task has been pinned yet.
+	 */
+	int anchor_cpu = -1;
 };
 
 } // namespace Compact
@@ -13,14 +13,22 @@
 #include <AutopinPlus/ObservedProcess.h>	// for ObservedProcess
 #include <AutopinPlus/OS/OSServices.h>		// for OSServices
 #include <AutopinPlus/PerformanceMonitor.h> // for PerformanceMonitor, etc
+#include <QElapsedTimer>
+#include <QTimer>
+#include <map>
+#include <vector>
 
 namespace AutopinPlus {
 namespace Strategy {
 namespace Scatter {
 
 /*!
- * \brief A control strategy which tries to put tasks as near as
- * possible to each other.
+ * \brief A control strategy which tries to put tasks as far as
+ * possible from each other.
+ *
+ * If a bandwidth monitor is configured, tasks are instead placed on
+ * the numa node with the lowest predicted memory bandwidth
+ * utilisation and periodically moved between nodes to equalise it.
  */
 class Main : public ControlStrategy {
 	Q_OBJECT
@@ -48,33 +56,98 @@ class Main : public ControlStrategy {
 	void slot_TaskCreated(int tid) override;
 	void slot_TaskTerminated(int tid) override;
 
+  private slots:
+	/*!
+	 * \brief Updates the bandwidth demand of all tasks and moves one
+	 * task, if the nodes are unevenly utilised.
+	 */
+	void slot_rebalance();
+
   private:
 	Pinning getPinning(const Pinning &current_pinning) override;
 
+	/*!
+	 * \brief Returns the numa node with the lowest predicted bandwidth
+	 * utilisation after adding a task.
+	 *
+	 * \param[in] node_demand Current bandwidth demand of every node in bytes/s
+	 * \param[in] node_cpus   Cpus of the tasks of the observed process on every node
+	 * \param[in] demand      Bandwidth demand of the new task in bytes/s
+	 *
+	 * \return The node or -1 if there are no free cpus.
+	 */
+	int selectNode(const std::map<int, double> &node_demand, const std::map<int, std::vector<int>> &node_cpus,
+				   double demand);
+
+	/*!
+	 * \brief Returns the predicted bandwidth utilisation of a numa node.
+	 *
+	 * The calibrated bandwidth depends on the number of cores accessing
+	 * the memory. Without a bandwidth calibration, every cpu of the node
+	 * is assumed to provide the same bandwidth, so the utilisation is the
+	 * demand per cpu of the node.
+	 *
+	 * \param[in] node   The node
+	 * \param[in] demand Total bandwidth demand on the node in bytes/s
+	 * \param[in] cores  Number of cores used by the observed process on the node
+	 */
+	double getUtilisation(int node, double demand, int cores);
+
+	/*!
+	 * \brief Returns the number of cores the cpus belong to.
+	 */
+	static int countCores(const std::vector<int> &cpus);
+
+	/*!
+	 * \brief Returns the average bandwidth demand of all tasks in bytes/s.
+	 */
+	double getAverageDemand();
+
 	/*!
 	 * \brief Stores the currently new Task for getPinning.
 	 */
 	int new_task_tid = 0;
 
 	/*!
-	 * \brief Count of task pinned on the n-th numa node
+	 * \brief Monitor counting memory accesses (e.g. last level cache
+	 * misses) or nullptr, if bandwidth-aware placement is disabled.
+	 */
+	PerformanceMonitor *bandwidth_monitor = nullptr;
+
+	/*!
+	 * \brief Bytes transferred per event counted by the bandwidth monitor.
+	 */
+	double bytes_per_event = 64;
+
+	/*!
+	 * \brief Interval between two rebalancing steps in milliseconds, 0
+	 * disables rebalancing.
 	 */
-	std::vector<int> pinCount;
+	int rebalance_interval = 1000;
 
 	/*!
-	 * \brief Sorts an std::vector and returns an vector of the indexes
+	 * \brief Timer for rebalancing.
 	 */
-	template <typename T> std::vector<size_t> sort_indexes(const std::vector<T> &v) const {
+	QTimer rebalance_timer;
 
-		// initialize original index locations
-		std::vector<size_t> idx(v.size());
-		for (size_t i = 0; i != idx.size(); ++i) idx[i] = i;
+	/*!
+	 * \brief Clock for computing rates.
+	 */
+	QElapsedTimer clock;
 
-		// sort indexes based on comparing values in v
-		std::sort(idx.begin(), idx.end(), [&v](size_t i1, size_t i2) { return v[i1] < v[i2]; });
+	/*!
+	 * \brief Bandwidth demand of a task
+	 */
+	struct Demand {
+		double value;
+		qint64 time;
+		double rate;
+	};
 
-		return idx;
-	}
+	/*!
+	 * \brief Bandwidth demand of every task with a running bandwidth monitor.
+	 */
+	std::map<int, Demand> demands;
 };
 
 } // namespace Scatter
@@ -117,6 +117,18 @@ signals:
 	 */
 	void createComponentConnections();
 
+	/*!
+	 * \brief Configures the windowed statistics of all monitors from their "window" options
+	 */
+	void configureWindows();
+
+	/*!
+	 * \brief Adds all monitors with a "sampler_interval" option to the sampler of their type
+	 *
+	 * Must be called after the monitors have been set up for the observed process.
+	 */
+	void startSamplers();
+
 	/*!
 	 * Stores a unique pointer to current context.
 	 */
@@ -10,8 +10,15 @@
 #include <AutopinPlus/OS/OSServices.h>
 #include <AutopinPlus/OS/SignalDispatcher.h>
 #include <AutopinPlus/OS/CpuInfo.h>
+#include <AutopinPlus/OS/HotplugDispatcher.h>
+#include <AutopinPlus/OS/BandwidthCalibration.h>
+#include <AutopinPlus/OS/LatencyCalibration.h>
+#include <AutopinPlus/OS/SystemPaths.h>
 #include <AutopinPlus/MQTTClient.h>
 #include <AutopinPlus/Monitor/ClustSafe/Main.h>
+#include <AutopinPlus/Monitor/GPerf/EventCatalog.h>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QString>
 #include <memory>
@@ -30,9 +37,14 @@
 	return;
 
 using AutopinPlus::OS::SignalDispatcher;
+using AutopinPlus::OS::HotplugDispatcher;
 using AutopinPlus::OS::OSServices;
 
 namespace CpuInfo = AutopinPlus::OS::CpuInfo;
+namespace LatencyCalibration = AutopinPlus::OS::LatencyCalibration;
+namespace BandwidthCalibration = AutopinPlus::OS::BandwidthCalibration;
+namespace SystemPaths = AutopinPlus::OS::SystemPaths;
+namespace EventCatalog = AutopinPlus::Monitor::GPerf::EventCatalog;
 
 namespace AutopinPlus {
 
@@ -41,12 +53,23 @@ Autopin::Autopin(int &_argc, char *const *_argv)
 
 void Autopin::slot_autopinSetup() {
 
-	struct option long_options[] = {
-		{"conf", 1, NULL, 'c'}, {"daemon", 0, NULL, 'd'}, {"version", 0, NULL, 'v'}, {"help", 0, NULL, 'h'}};
+	struct option long_options[] = {{"conf", 1, NULL, 'c'},
+									{"daemon", 0, NULL, 'd'},
+									{"version", 0, NULL, 'v'},
+									{"help", 0, NULL, 'h'},
+									{"sysfs", 1, NULL, 'S'},
+									{"procfs", 1, NULL, 'P'},
+									{"record-affinity", 1, NULL, 'R'},
+									{"list-events", 0, NULL, 'L'},
+									{NULL, 0, NULL, 0}};
 
 	// Parsing commandline arguments
 	std::list<QString> configPaths;
 	QString globalConfigPath = "";
+	QString sysfsRoot = qgetenv("AUTOPIN_SYSFS");
+	QString procfsRoot = qgetenv("AUTOPIN_PROCFS");
+	QString affinityLog = "";
+	bool listEvents = false;
 
 	int opt;
 	while ((opt = getopt_long(argc, argv, "vhdc:", long_options, NULL)) != -1) {
@@ -63,6 +86,18 @@ void Autopin::slot_autopinSetup() {
 		case ('d'):
 			isDaemon = true;
 			break;
+		case ('S'):
+			sysfsRoot = optarg;
+			break;
+		case ('P'):
+			procfsRoot = optarg;
+			break;
+		case ('R'):
+			affinityLog = optarg;
+			break;
+		case ('L'):
+			listEvents = true;
+			break;
 		case ('?'):
 			std::cout << "\n";
 			printHelp();
@@ -74,8 +109,18 @@ void Autopin::slot_autopinSetup() {
 		globalConfigPath = QString(argv[optind]);
 	}
 
+	// The events are read from sysfs, so this has to wait for the --sysfs option.
+	if (listEvents) {
+		if (!sysfsRoot.isEmpty()) SystemPaths::setSysfsRoot(sysfsRoot);
+		printEvents();
+		EXIT(0);
+	}
+
 	// Load global config file
 	Configuration *globalConfig = nullptr;
+	bool calibrateLatency = false;
+	bool calibrateBandwidth = false;
+	QString calibrationCache = QDir::homePath() + "/.cache/autopin+";
 
 	QFile globalConfigFile(globalConfigPath);
 	if (globalConfigFile.exists() && globalConfigFile.open(QIODevice::ReadOnly)) {
@@ -137,6 +182,15 @@ void Autopin::slot_autopinSetup() {
 
 		AutopinPlus::Monitor::ClustSafe::Main::init_static(*globalConfig, *context);
 
+		if (globalConfig->configOptionBool("calibration.latency"))
+			calibrateLatency = globalConfig->getConfigOptionBool("calibration.latency");
+
+		if (globalConfig->configOptionBool("calibration.bandwidth"))
+			calibrateBandwidth = globalConfig->getConfigOptionBool("calibration.bandwidth");
+
+		if (globalConfig->configOptionExists("calibration.cache") > 0)
+			calibrationCache = globalConfig->getConfigOption("calibration.cache");
+
 		delete globalConfig;
 	}
 
@@ -147,9 +201,87 @@ void Autopin::slot_autopinSetup() {
 		EXIT(1);
 	}
 
+	if (!sysfsRoot.isEmpty()) {
+		context->info("Using sysfs at " + sysfsRoot);
+		SystemPaths::setSysfsRoot(sysfsRoot);
+	}
+
+	if (!procfsRoot.isEmpty()) {
+		context->info("Using procfs at " + procfsRoot);
+		SystemPaths::setProcfsRoot(procfsRoot);
+	}
+
+	if (!affinityLog.isEmpty()) {
+		context->info("Recording pinnings in " + affinityLog + " instead of applying them");
+		if (!OSServices::setAffinityLog(affinityLog)) {
+			context->report(Error::FILE_NOT_FOUND, "affinity_log", "Cannot open " + affinityLog);
+			EXIT(1);
+		}
+	}
+
 	// Setting up CpuInfo
 	context->info("Getting information about the cpu");
 	CpuInfo::setupCpuInfo();
+	context->info("  - Usable cpus: " + QString::number(CpuInfo::getUsableCpus().size()) + " of " +
+				  QString::number(CpuInfo::getCpuCount()));
+
+	if (HotplugDispatcher::setupHotplugHandler() != 0)
+		context->warn("Cannot listen for cpu hotplug events, the topology will not be updated");
+
+	if (calibrateLatency) {
+		const auto &topology = CpuInfo::getTopology();
+		auto cpus = CpuInfo::getUsableCpus();
+		QString path = calibrationCache + "/latency-" + CpuInfo::getSignature();
+
+		std::vector<float> latencies;
+		if (LatencyCalibration::load(path, topology.getCpuCount(), latencies)) {
+			context->info("  - Loaded cpu latencies from " + path);
+		} else if (SystemPaths::isSysfsOverridden()) {
+			context->warn("Cannot measure cpu latencies of a synthetic topology, using numa distances instead");
+		} else {
+			context->info("  - Measuring cpu latencies");
+			QElapsedTimer timer;
+			timer.start();
+
+			latencies = LatencyCalibration::measure(topology, cpus);
+			if (latencies.empty()) {
+				context->warn("Could not measure cpu latencies, using numa distances instead");
+			} else {
+				context->info("  - Measured cpu latencies in " + QString::number(timer.elapsed()) + " ms");
+				if (!LatencyCalibration::save(path, topology.getCpuCount(), latencies))
+					context->warn("Could not store cpu latencies in " + path);
+			}
+		}
+
+		CpuInfo::setLatencies(latencies);
+	}
+
+	if (calibrateBandwidth) {
+		const auto &topology = CpuInfo::getTopology();
+		QString path = calibrationCache + "/bandwidth-" + CpuInfo::getSignature();
+
+		BandwidthCalibration::Bandwidths bandwidths;
+		if (BandwidthCalibration::load(path, bandwidths)) {
+			context->info("  - Loaded memory bandwidths from " + path);
+		} else if (SystemPaths::isSysfsOverridden()) {
+			context->warn("Cannot measure memory bandwidths of a synthetic topology");
+		} else {
+			context->info("  - Measuring memory bandwidths");
+			QElapsedTimer timer;
+			timer.start();
+
+			bandwidths = BandwidthCalibration::measure(topology, CpuInfo::getUsableCpus());
+			if (bandwidths.empty()) {
+				context->warn("Could not measure memory bandwidths");
+			} else {
+				context->info("  - Measured memory bandwidths in " + QString::number(timer.elapsed()) + " ms");
+				if (!BandwidthCalibration::save(path, bandwidths))
+					context->warn("Could not store memory bandwidths in " + path);
+			}
+		}
+
+		CpuInfo::setBandwidths(bandwidths);
+	}
 
 	// Read configuration
 	context->info("Reading configurations ...");
@@ -210,12 +342,35 @@ void Autopin::printHelp() {
 			  << "There can be multiple occurrences of this option!\n";
 	std::cout << std::left << std::setw(30) << "  -d, --daemon"
 			  << "Run autopin as a daemon.\n";
+	std::cout << std::left << std::setw(30) << "      --sysfs=DIR"
+			  << "Read the cpu topology from a sysfs tree at DIR\n";
+	std::cout << std::left << std::setw(30) << ""
+			  << "(defaults to $AUTOPIN_SYSFS or /sys)\n";
+	std::cout << std::left << std::setw(30) << "      --procfs=DIR"
+			  << "Read process information from a procfs tree at DIR\n";
+	std::cout << std::left << std::setw(30) << ""
+			  << "(defaults to $AUTOPIN_PROCFS or /proc)\n";
+	std::cout << std::left << std::setw(30) << "      --record-affinity=FILE"
+			  << "Write pinnings to FILE instead of applying them\n";
+	std::cout << std::left << std::setw(30) << "      --list-events"
+			  << "Prints the perf events known to the gperf monitor and exit\n";
 	std::cout << std::left << std::setw(30) << "  -v, --version"
 			  << "Prints version and exit\n";
 	std::cout << std::left << std::setw(30) << "  -h, --help"
 			  << "Prints this help and exit\n";
 }
 
+void Autopin::printEvents() {
+	for (auto name : EventCatalog::getNames()) {
+		auto sensor = EventCatalog::getSensor(name);
+		std::cout << std::left << std::setw(40) << name.toStdString() << "type=" << sensor.attr.type << ",config=0x"
+				  << std::hex << sensor.attr.config << std::dec;
+		if (!sensor.unit.isEmpty()) std::cout << " (" << sensor.unit.toStdString() << ")";
+		std::cout << "\n";
+	}
+	std::cout << "\nTracepoints (tracepoint/<subsystem>:<event>) are listed in /sys/kernel/tracing/events.\n";
+}
+
 void Autopin::printVersion() {
 	std::cout << applicationName().toStdString() << " " << applicationVersion().toStdString() << std::endl;
 	std::cout << "QT Version: " << qVersion() << std::endl;
@@ -35,6 +35,11 @@ void AutopinContext::debug(QString msg) const {
 }
 
 autopin_estate AutopinContext::report(Error::autopin_errors error, QString opt, QString msg) {
+	if (Quiet::collect()) {
+		warn(msg);
+		return AUTOPIN_NOERROR;
+	}
+
 	autopin_estate result;
 	result = err.report(error, opt);
 	if (isError()) {
@@ -50,6 +55,21 @@ autopin_estate AutopinContext::report(Error::autopin_errors error, QString opt,
 
 void AutopinContext::setPid(int pid) { name = name + " (pid: " + std::to_string(pid) + ")"; }
 
+thread_local AutopinContext::Quiet *AutopinContext::Quiet::current = nullptr;
+
+AutopinContext::Quiet::Quiet() : previous(current) { current = this; }
+
+AutopinContext::Quiet::~Quiet() { current = previous; }
+
+int AutopinContext::Quiet::getReports() { return current != nullptr ? current->reports : 0; }
+
+bool AutopinContext::Quiet::collect() {
+	if (current == nullptr) return false;
+
+	current->reports++;
+	return true;
+}
+
 bool AutopinContext::isError() const { return err.autopinErrorState() == AUTOPIN_ERROR; }
 
 void AutopinContext::setupLogging(const AutopinContext::logging_t type, const QString &path) {
@@ -6,8 +6,11 @@
  */
 
 #include <AutopinPlus/ControlStrategy.h>
+#include <AutopinPlus/Exception.h>
 #include <AutopinPlus/OS/OSServices.h>
 #include <AutopinPlus/OS/CpuInfo.h>
+#include <AutopinPlus/OS/HotplugDispatcher.h>
+#include <AutopinPlus/Tools.h>
 
 #include <algorithm>
 #include <QChar>
@@ -21,12 +24,25 @@ namespace AutopinPlus {
 
 ControlStrategy::Pinning ControlStrategy::pinning;
 QMutex ControlStrategy::mutex;
+PlacementTree ControlStrategy::tree;
+std::vector<ControlStrategy *> ControlStrategy::restricted;
 
 ControlStrategy::ControlStrategy(const Configuration &config, const ObservedProcess &proc, OS::OSServices &service,
 								 const PerformanceMonitor::monitor_list &monitors, AutopinContext &context)
-	: config(config), proc(proc), service(service), monitors(monitors), context(context), name("ControlStrategy") {}
+	: config(config), proc(proc), service(service), monitors(monitors), context(context), name("ControlStrategy") {
+	connect(&OS::HotplugDispatcher::getInstance(), SIGNAL(sig_CpuOnline(int)), this, SLOT(slot_CpuOnline(int)));
+	connect(&OS::HotplugDispatcher::getInstance(), SIGNAL(sig_CpuOffline(int)), this, SLOT(slot_CpuOffline(int)));
+	connect(&load_timer, SIGNAL(timeout()), this, SLOT(slot_balanceLoad()));
+}
+
+ControlStrategy::~ControlStrategy() {
+	QMutexLocker ml(&mutex);
+	auto it = std::find(restricted.begin(), restricted.end(), this);
+	if (it != restricted.end()) restricted.erase(it);
+}
 
 const ControlStrategy::Task ControlStrategy::emptyTask = {0, 0};
+const ControlStrategy::Task ControlStrategy::blockedTask = {-1, -1};
 
 bool ControlStrategy::Task::operator==(const ControlStrategy::Task &rhs) const {
 	return (this->tid == rhs.tid) && (this->pid == rhs.pid);
@@ -39,10 +55,33 @@ bool ControlStrategy::Task::operator!=(const ControlStrategy::Task &rhs) const {
 bool ControlStrategy::Task::isCpuFree() const { return (*this == emptyTask); }
 
 void ControlStrategy::init() {
+	QMutexLocker ml(&mutex);
+
 	if (pinning.empty()) {
 		int cpuCount = OS::CpuInfo::getCpuCount();
-		for (int i = 0; i < cpuCount; i++) pinning.push_back(emptyTask);
+		for (int i = 0; i < cpuCount; i++) pinning.push_back(OS::CpuInfo::isCpuUsable(i) ? emptyTask : blockedTask);
 	}
+
+	// A process we attach to may be restricted to fewer cpus than autopin+ itself. Only this
+	// strategy must avoid them, so they are not blocked in the shared pinning.
+	disallowed.clear();
+	if (proc.getPid() > 0) {
+		auto allowed = OS::CpuInfo::getAffinity(proc.getPid());
+		if (!allowed.empty()) {
+			for (uint cpu = 0; cpu < pinning.size(); cpu++) {
+				if (!OS::CpuInfo::isCpuUsable(cpu) || std::binary_search(allowed.begin(), allowed.end(), (int)cpu))
+					continue;
+				disallowed.resize(pinning.size(), false);
+				disallowed[cpu] = true;
+			}
+		}
+	}
+
+	auto it = std::find(restricted.begin(), restricted.end(), this);
+	if (disallowed.empty() && it != restricted.end()) restricted.erase(it);
+	if (!disallowed.empty() && it == restricted.end()) restricted.push_back(this);
+
+	rebuildPlacementTree();
 }
 
 QString ControlStrategy::getName() { return name; }
@@ -65,16 +104,27 @@ void ControlStrategy::slot_watchdogReady() {
 void ControlStrategy::slot_TaskCreated(int tid) {
 	tasks.push_back(tid);
 	changePinning();
+
+	// Tasks pinned again after a cpu went offline are already monitored
+	if (load_timer.isActive() && loads.count(tid) == 0 && getCpuByTask(tid) != -1) {
+		if (load_monitor != nullptr) load_monitor->start(tid);
+		loads[tid] = {readLoad(tid), load_clock.elapsed(), 0};
+	}
 }
 
 void ControlStrategy::slot_TaskTerminated(int tid) {
 	auto it_tasks = std::find(tasks.begin(), tasks.end(), tid);
 	if (it_tasks != tasks.end()) tasks.erase(it_tasks);
 
+	if (loads.erase(tid) > 0 && load_monitor != nullptr) load_monitor->clear(tid);
+
 	QMutexLocker ml(&mutex);
 	Task t = {proc.getPid(), tid};
 	auto it_pinning = std::find(pinning.begin(), pinning.end(), t);
-	if (it_pinning != pinning.end()) *it_pinning = emptyTask;
+	if (it_pinning != pinning.end()) {
+		*it_pinning = emptyTask;
+		setCpuUsed(it_pinning - pinning.begin(), false);
+	}
 
 	ml.unlock();
 	changePinning();
@@ -83,12 +133,80 @@ void ControlStrategy::slot_TaskTerminated(int tid) {
 void ControlStrategy::slot_PhaseChanged(int) {}
 void ControlStrategy::slot_UserMessage(int, double) {}
 
+void ControlStrategy::slot_CpuOnline(int cpu) {
+	QMutexLocker ml(&mutex);
+	if (cpu < 0 || (uint)cpu >= pinning.size()) return;
+
+	if (pinning[cpu] == blockedTask && OS::CpuInfo::isCpuUsable(cpu)) pinning[cpu] = emptyTask;
+
+	rebuildPlacementTree();
+}
+
+void ControlStrategy::slot_CpuOffline(int cpu) {
+	QMutexLocker ml(&mutex);
+	if (cpu < 0 || (uint)cpu >= pinning.size()) return;
+
+	// Every strategy receives the signal. A cpu with a task is only blocked by the strategy owning the
+	// task, otherwise the owner would find the cpu already blocked and never pin its task again.
+	Task old_task = pinning[cpu];
+	bool owner = old_task.pid == proc.getPid() && !old_task.isCpuFree() && old_task != blockedTask;
+	if (!owner && !old_task.isCpuFree()) return;
+
+	if (!OS::CpuInfo::isCpuUsable(cpu)) pinning[cpu] = blockedTask;
+
+	rebuildPlacementTree();
+	ml.unlock();
+
+	// The kernel has already migrated the task, pin it again
+	if (owner) {
+		context.info("Cpu " + QString::number(cpu) + " is offline, pinning task " + QString::number(old_task.tid) +
+					 " again");
+
+		auto it_tasks = std::find(tasks.begin(), tasks.end(), old_task.tid);
+		if (it_tasks != tasks.end()) tasks.erase(it_tasks);
+
+		slot_TaskCreated(old_task.tid);
+	}
+}
+
 ControlStrategy::Pinning ControlStrategy::getPinning(const Pinning &pinning) { return pinning; }
 
 void ControlStrategy::changePinning() {
 	QMutexLocker ml(&mutex);
+	applyPinning(getPinning(ControlStrategy::pinning), true);
+}
+
+void ControlStrategy::moveTasks(const std::map<int, int> &moves) {
+	QMutexLocker ml(&mutex);
+	Pinning new_pinning = pinning;
+
+	// Remove all moved tasks first, so that tasks can be swapped
+	std::map<int, int> found;
+	for (const auto &move : moves) {
+		Task t = {proc.getPid(), move.first};
+		auto it = std::find(new_pinning.begin(), new_pinning.end(), t);
+		if (it == new_pinning.end()) continue;
+
+		*it = emptyTask;
+		found.insert(move);
+	}
+
+	for (const auto &move : found) {
+		if (move.second < 0 || (uint)move.second >= new_pinning.size() || !new_pinning[move.second].isCpuFree() ||
+			(!disallowed.empty() && disallowed[move.second])) {
+			context.warn("ControlStrategy." + name + " could not move task " + QString::number(move.first) +
+						 " to cpu " + QString::number(move.second));
+			return;
+		}
+
+		new_pinning[move.second] = {proc.getPid(), move.first};
+	}
+
+	applyPinning(new_pinning, false);
+}
+
+void ControlStrategy::applyPinning(const Pinning &new_pinning, bool warn_overwrite) {
 	int pid = proc.getPid();
-	Pinning new_pinning = getPinning(ControlStrategy::pinning);
 
 	for (uint i = 0; i < pinning.size(); i++) {
 		Task new_task = new_pinning[i];
@@ -96,12 +214,21 @@ void ControlStrategy::changePinning() {
 		if (new_task != old_task) {
 			// Test whether this ControlStrategy is allowed to
 			// overwrite this pinning.
-			if (!old_task.isCpuFree() && old_task.pid != pid) {
+			if (old_task == blockedTask) {
+				context.report(Error::STRATEGY, "unusable_cpu",
+							   "ControlStrategy." + name + " tried to pin a task to the unusable cpu " +
+								   QString::number(i) + ". Bailing out!");
+			} else if (!old_task.isCpuFree() && old_task.pid != pid) {
 				context.report(Error::STRATEGY, "wrong_cpu",
 							   "ControlStrategy." + name +
 								   " tried to overwrite a pinning from another strategy. Bailing out!");
+			} else if (new_task.isCpuFree()) {
+				// The task has been moved to another cpu
+				pinning[i] = emptyTask;
+				setCpuUsed(i, false);
 			} else {
-				if (old_task.pid == pid) context.warn("ControlStrategy." + name + " is overwritting its own pinning!");
+				if (old_task.pid == pid && warn_overwrite)
+					context.warn("ControlStrategy." + name + " is overwritting its own pinning!");
 				int ret = service.setAffinity(new_task.tid, i);
 				if (ret != 0) {
 					context.report(Error::STRATEGY, "set_affinity", "Could not pin thread " +
@@ -109,6 +236,7 @@ void ControlStrategy::changePinning() {
 																		QString::number(i));
 				} else {
 					pinning[i] = new_task;
+					setCpuUsed(i, !new_task.isCpuFree());
 					context.info("Pinned task " + QString::number(new_task.tid) + " to cpu " + QString::number(i));
 				}
 			}
@@ -152,4 +280,128 @@ int ControlStrategy::getCpuByTask(int tid) {
 
 	return -1;
 }
+
+const PlacementTree &ControlStrategy::getPlacementTree() const { return disallowed.empty() ? tree : allowed_tree; }
+
+void ControlStrategy::readLoadOptions() {
+	if (config.configOptionExists(name + ".load_monitor") > 0) {
+		QString monitor_name = config.getConfigOption(name + ".load_monitor");
+
+		for (auto &monitor : monitors) {
+			if (monitor->getName() == monitor_name) load_monitor = monitor.get();
+		}
+
+		if (load_monitor == nullptr) {
+			context.report(Error::BAD_CONFIG, "no_monitor",
+						   name + ".init() failed: Could not find the monitor \"" + monitor_name + "\".");
+			return;
+		}
+
+		context.info("  - " + name + ".load_monitor = " + monitor_name);
+	}
+
+	if (config.configOptionExists(name + ".load_interval") > 0) {
+		try {
+			load_interval = Tools::readInt(config.getConfigOption(name + ".load_interval"));
+			context.info("  - " + name + ".load_interval = " + QString::number(load_interval));
+		} catch (const Exception &) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init() failed: Could not parse the 'load_interval' option.");
+			return;
+		}
+	}
+
+	// Balancing is pointless if all cpus are equally fast
+	if (load_interval > 0 && OS::CpuInfo::getTopology().isHybrid()) {
+		context.info("  - Cpus differ in their capacity, balancing the load every " + QString::number(load_interval) +
+					 " ms");
+		load_clock.start();
+		load_timer.setInterval(load_interval);
+		load_timer.start();
+	}
+}
+
+void ControlStrategy::getLoadConfigOpts(Configuration::configopts &opts) {
+	if (load_monitor != nullptr)
+		opts.push_back(Configuration::configopt("load_monitor", QStringList(load_monitor->getName())));
+	opts.push_back(Configuration::configopt("load_interval", QStringList(QString::number(load_interval))));
+}
+
+double ControlStrategy::readLoad(int tid) {
+	if (load_monitor != nullptr) return load_monitor->value(tid);
+
+	return std::max<qint64>(0, service.getTaskCpuTime(tid));
+}
+
+void ControlStrategy::slot_balanceLoad() {
+	qint64 now = load_clock.elapsed();
+
+	for (auto &entry : loads) {
+		Load &load = entry.second;
+		double value = readLoad(entry.first);
+
+		if (now > load.time) load.rate = std::max(0.0, value - load.value) * 1000 / (now - load.time);
+
+		load.value = value;
+		load.time = now;
+	}
+
+	const auto &topology = OS::CpuInfo::getTopology();
+	std::map<int, int> cpus;
+	for (auto &entry : loads) {
+		int cpu = getCpuByTask(entry.first);
+		if (cpu != -1) cpus[entry.first] = cpu;
+	}
+
+	// Find the heaviest task which could run on a faster cpu
+	int heavy = 0, max_capacity = 0;
+	for (auto &entry : cpus) max_capacity = std::max(max_capacity, topology.getCapacity(entry.second));
+	max_capacity = std::max(max_capacity, getPlacementTree().getFreeCapacity());
+
+	for (auto &entry : cpus) {
+		if (topology.getCapacity(entry.second) >= max_capacity || loads[entry.first].rate <= 0) continue;
+		if (heavy == 0 || loads[entry.first].rate > loads[heavy].rate) heavy = entry.first;
+	}
+
+	if (heavy == 0) return;
+
+	int heavy_cpu = cpus[heavy];
+	int heavy_capacity = topology.getCapacity(heavy_cpu);
+
+	// Prefer a free faster cpu
+	if (getPlacementTree().getFreeCapacity() > heavy_capacity) {
+		int target = getPlacementTree().findCompact(-1);
+
+		context.info("Moving task " + QString::number(heavy) + " from cpu " + QString::number(heavy_cpu) +
+					 " to the faster cpu " + QString::number(target));
+		moveTasks({{heavy, target}});
+		return;
+	}
+
+	// Otherwise swap it with the lightest task on a faster cpu
+	int light = 0;
+	for (auto &entry : cpus) {
+		if (topology.getCapacity(entry.second) <= heavy_capacity) continue;
+		if (light == 0 || loads[entry.first].rate < loads[light].rate) light = entry.first;
+	}
+
+	// Only swap, if the load differs noticeably
+	if (light == 0 || loads[heavy].rate < 1.2 * loads[light].rate) return;
+
+	context.info("Swapping task " + QString::number(heavy) + " on cpu " + QString::number(heavy_cpu) + " with task " +
+				 QString::number(light) + " on the faster cpu " + QString::number(cpus[light]));
+	moveTasks({{heavy, cpus[light]}, {light, heavy_cpu}});
+}
+
+void ControlStrategy::setCpuUsed(uint cpu, bool used) {
+	tree.setUsed(cpu, used);
+	for (auto strategy : restricted) strategy->allowed_tree.setUsed(cpu, used || strategy->disallowed[cpu]);
+}
+
+void ControlStrategy::rebuildPlacementTree() {
+	tree.build(OS::CpuInfo::getTopology());
+	for (auto strategy : restricted) strategy->allowed_tree.build(OS::CpuInfo::getTopology());
+
+	for (uint cpu = 0; cpu < pinning.size(); cpu++) setCpuUsed(cpu, !pinning[cpu].isCpuFree());
+}
 } // namespace AutopinPlus
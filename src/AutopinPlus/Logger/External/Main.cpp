@@ -14,6 +14,7 @@
 #include <AutopinPlus/Exception.h>				 // for Exception
 #include <AutopinPlus/Logger/External/Process.h> // for Process
 #include <AutopinPlus/PerformanceMonitor.h>		 // for PerformanceMonitor, etc
+#include <AutopinPlus/SampleRing.h>				 // for SampleRing
 #include <AutopinPlus/Tools.h>					 // for Tools
 #include <qelapsedtimer.h>						 // for QElapsedTimer
 #include <qmutex.h>								 // for QMutex
@@ -75,6 +76,7 @@ void Main::init() {
 
 	// Start the timer which counts the time since the program was started.
 	running.start();
+	started = PerformanceMonitor::getTimestamp();
 
 	// Setup the timer which will periodically query the performance monitors and forward the data...
 	connect(&timer, SIGNAL(timeout()), this, SLOT(slot_logDataPoint()));
@@ -89,7 +91,7 @@ Configuration::configopts Main::getConfigOpts() const {
 
 	result.push_back(Configuration::configopt("command", command));
 	result.push_back(Configuration::configopt("interval", QStringList(QString::number(interval))));
-	result.push_back(Configuration::configopt("interval", QStringList(systemwide ? "true" : "false")));
+	result.push_back(Configuration::configopt("systemwide", QStringList(systemwide ? "true" : "false")));
 
 	return result;
 }
@@ -103,24 +105,77 @@ void Main::slot_logDataPoint() {
 		return;
 	}
 
-	// Emit data points for all monitors and threads.
+	// Emit data points for all monitors and threads, reading all threads of a monitor in one batch.
+	QTextStream stream(&process);
 	for (auto i = monitors.begin(); i != monitors.end(); i++) {
-		for (auto task : (*i)->getMonitoredTasks()) {
-			QTextStream(&process) << (*i)->getName() << "	" << task << "	" << fixed << running.elapsed() / 1000.0
-								  << "	" << fixed << (*i)->value(task) << "	"
-								  << ((*i)->getUnit().isEmpty() ? "none" : (*i)->getUnit()) << endl;
-
-			// If the user told us, that the performance monitors are system-wide, stop after the first thread.
-			if (systemwide) {
-				break;
-			}
+		// Monitors which are read by a sampler thread are never read here, as reading them may block.
+		if ((*i)->getSamples() != nullptr) {
+			logSamples(stream, i->get());
+			continue;
+		}
+
+		// All threads are sampled, as sample() drops the windows of the threads missing in the batch.
+		tids.clear();
+		for (auto task : (*i)->getMonitoredTasks()) tids.push_back(task);
+
+		(*i)->sample(tids.data(), tids.size(), batch);
+
+		// Monitors which measure the whole process or system have the same value for all threads, so only the first
+		// one is written. The user can force this for all monitors.
+		bool shared = isShared(i->get());
+
+		QString monitor = (*i)->getName();
+		QString unit = (*i)->getUnit().isEmpty() ? "none" : (*i)->getUnit();
+		double time = running.elapsed() / 1000.0;
+
+		for (size_t j = 0; j < batch.count; j++) {
+			if (batch.status[j] != PerformanceMonitor::VALUE_OK) continue;
+
+			stream << monitor << "	" << tids[j] << "	" << fixed << time << "	" << fixed << batch.values[j] << "	"
+				   << unit << "\n";
+			if (shared) break;
 		}
 	}
+	stream.flush();
 
 	// Release the lock, we are done here.
 	mutex.unlock();
 }
 
+void Main::logSamples(QTextStream &stream, PerformanceMonitor *monitor) {
+	auto ring = monitor->getSamples();
+
+	// Start with the samples taken after the first data point.
+	auto cursor = cursors.find(monitor);
+	if (cursor == cursors.end()) cursor = cursors.insert(std::make_pair(monitor, ring->getHead())).first;
+
+	QString name = monitor->getName();
+	QString unit = monitor->getUnit().isEmpty() ? "none" : monitor->getUnit();
+
+	bool shared = isShared(monitor);
+
+	SampleRing::Sample sample;
+	int64_t last = -1;
+	while (ring->read(cursor->second, sample)) {
+		if (sample.status != PerformanceMonitor::VALUE_OK) continue;
+
+		// All threads of a sample share its timestamp, so only the first one is written for shared values.
+		if (shared && sample.timestamp == last) continue;
+		last = sample.timestamp;
+
+		double time = (sample.timestamp - started) / 1000000000.0;
+		stream << name << "	" << sample.tid << "	" << fixed << time << "	" << fixed << sample.value << "	" << unit
+			   << "\n";
+	}
+}
+
+bool Main::isShared(PerformanceMonitor *monitor) {
+	if (systemwide) return true;
+
+	PerformanceMonitor::monscope scope = monitor->getScope();
+	return scope == PerformanceMonitor::PROCESS || scope == PerformanceMonitor::SYSTEM;
+}
+
 void Main::slot_readyReadStandardError() {
 	QTextStream stream(process.readAllStandardError());
 
@@ -0,0 +1,350 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Monitor/ClustSafe/Client.h>
+
+#include <AutopinPlus/Exception.h>			// for Exception
+#include <AutopinPlus/PerformanceMonitor.h> // for PerformanceMonitor
+#include <QMutexLocker>						// for QMutexLocker
+#include <QtEndian>							// for qFromBigEndian
+#include <algorithm>						// for min
+#include <errno.h>							// for errno, EINTR
+#include <netdb.h>							// for getaddrinfo, freeaddrinfo, gai_strerror
+#include <poll.h>							// for poll
+#include <string.h>							// for strerror
+#include <sys/eventfd.h>					// for eventfd
+#include <sys/socket.h>						// for socket, connect, send, recv
+#include <sys/timerfd.h>					// for timerfd_create, timerfd_settime
+#include <unistd.h>							// for read, write, close
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace ClustSafe {
+
+const QString Client::signature = "MEGware";
+
+const uint16_t Client::energy_command = 0x010F;
+
+const size_t Client::depth = 4;
+
+/*!
+ * \brief Convert a uint16_t to a QByteArray.
+ *
+ * This function convert a unsigned 16-bit integer to a two-element byte array.
+ *
+ * \param[in] value The value to be converted.
+ *
+ * \return The resulting array which contains the specified value in network byte order.
+ */
+static inline QByteArray toArray(uint16_t value) {
+	QByteArray result;
+
+	result.append((uint8_t)((value >> 8)));
+	result.append((uint8_t)((value >> 0)));
+
+	return result;
+}
+
+/*!
+ * \brief Calculates a (very simple) checksum over an array.
+ *
+ * \param[in] array The array to be checksummed.
+ *
+ * \return The calculated checksum.
+ */
+static inline uint8_t calculateChecksum(QByteArray const &array) {
+	uint8_t result = 0;
+
+	// Simply add up all bytes in the input array.
+	for (auto value : array) {
+		result += value;
+	}
+
+	return result;
+}
+
+/*!
+* \brief Checks if an array has a specific prefix and drops it.
+*
+* This function checks if an array has a specific prefix and drops it. If the prefix is not present, an exception
+* will be thrown.
+*
+* \param[in] array  The array to be checked
+* \param[in] prefix The prefix which should be present
+* \param[in] field  A description what the prefix is supposed to be.
+*
+* \exception Exception This exception will be thrown if the specified prefix is not present.
+*/
+static inline void checkAndDrop(QByteArray &array, const QByteArray &prefix, const QString &field) {
+	// Check if array starts with the expected prefix.
+	if (array.startsWith(prefix)) {
+		array.remove(0, prefix.size());
+	} else {
+		throw Exception(".checkAndDrop(" + array.toHex() + ", " + prefix.toHex() + ", " + field +
+						") failed: Second argument is not a prefix of the first argument.");
+	}
+}
+
+Client::Client(QString host, uint16_t port, QString password, QList<int> outlets, int interval, int timeout,
+			   int retries)
+	: host(host), port(port), outlets(outlets), interval((int64_t)interval * 1000000),
+	  timeout((int64_t)timeout * 1000000), retries(retries) {
+	// Set the data to "0x01" which means "reset all counters after the response is sent".
+	request = buildRequest(password, energy_command, QByteArray(1, 1));
+
+	// Both are created in blocking mode, the thread only reads them after poll() reported them as readable.
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	event_fd = eventfd(0, EFD_CLOEXEC);
+}
+
+Client::~Client() {
+	disconnectDevice();
+
+	if (timer_fd != -1) ::close(timer_fd);
+	if (event_fd != -1) ::close(event_fd);
+}
+
+void Client::acquire() {
+	QMutexLocker users_locker(&users_mutex);
+
+	if (users == 0) {
+		connectDevice();
+
+		// Wait until the device has either answered or all retries have been lost.
+		QMutexLocker locker(&mutex);
+		while (!answered && lost < retries) changed.wait(&mutex);
+
+		if (!answered) {
+			locker.unlock();
+			disconnectDevice();
+			throw Exception("Client::acquire() failed: The device at " + host + ":" + QString::number(port) +
+							" didn't answer " + QString::number(retries) + " requests.");
+		}
+	}
+
+	users++;
+}
+
+void Client::release() {
+	QMutexLocker users_locker(&users_mutex);
+
+	if (users > 0 && --users == 0) disconnectDevice();
+}
+
+double Client::take() {
+	QMutexLocker locker(&mutex);
+
+	if (!answered || lost >= retries) {
+		throw Exception("Client::take() failed: The device at " + host + ":" + QString::number(port) +
+						" didn't answer the last " + QString::number(lost) + " requests.");
+	}
+
+	double result = energy;
+	energy = 0;
+
+	return result;
+}
+
+uint64_t Client::getRequests() const { return requests.load(); }
+
+uint64_t Client::getAnswers() const { return answers.load(); }
+
+QByteArray Client::buildRequest(const QString &password, uint16_t command, const QByteArray &data) {
+	QByteArray result;
+
+	result.append(signature.toUtf8());
+	result.append((char)0);
+	result.append(password.toUtf8().leftJustified(16, 0, true));
+	result.append(toArray(command));
+	result.append(toArray(data.size()));
+	result.append(data.left(0xFFFF));
+	result.append((char)calculateChecksum(toArray(command) + toArray(data.size()) + data.left(0xFFFF)));
+
+	return result;
+}
+
+QByteArray Client::parseAnswer(QByteArray answer, uint16_t command) {
+	checkAndDrop(answer, signature.toUtf8(), "signature");
+	checkAndDrop(answer, QByteArray(1, 1), "device");
+	checkAndDrop(answer, QByteArray(1, 1), "status");
+	checkAndDrop(answer, QByteArray(15, 0), "padding");
+	checkAndDrop(answer, toArray(command), "command");
+
+	QByteArray payload = answer.mid(2 /* length field */, answer.size() - 2 /* length field */ - 1 /* checksum field */);
+
+	checkAndDrop(answer, toArray(payload.size()), "length");
+	checkAndDrop(answer, payload, "payload");
+	checkAndDrop(answer, QByteArray(1, calculateChecksum(toArray(command) + toArray(payload.size()) + payload)),
+				 "checksum");
+
+	return payload;
+}
+
+void Client::run() {
+	if (socket_fd == -1 || timer_fd == -1 || event_fd == -1) return;
+
+	deadline = PerformanceMonitor::getTimestamp();
+
+	while (!exreq) {
+		int64_t now = PerformanceMonitor::getTimestamp();
+
+		// Give up on requests which haven't been answered in time and send them again right away.
+		while (!pending.empty() && now - pending.front() >= timeout) {
+			pending.pop_front();
+
+			{
+				QMutexLocker locker(&mutex);
+				lost++;
+			}
+			changed.wakeAll();
+
+			send(now);
+		}
+
+		// Requests are sent in a fixed interval, without waiting for the answers to the previous ones.
+		if (now >= deadline) {
+			if (pending.size() < depth) send(now);
+
+			deadline += interval;
+			if (deadline <= now) deadline = now + interval;
+		}
+
+		// Sleep until the next request is due or the oldest one times out.
+		int64_t wakeup_time = deadline;
+		if (!pending.empty()) wakeup_time = std::min(wakeup_time, pending.front() + timeout);
+
+		itimerspec spec = {};
+		spec.it_value.tv_sec = wakeup_time / 1000000000;
+		spec.it_value.tv_nsec = wakeup_time % 1000000000;
+		timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+		pollfd fds[3] = {{socket_fd, POLLIN, 0}, {timer_fd, POLLIN, 0}, {event_fd, POLLIN, 0}};
+		if (poll(fds, 3, -1) == -1) continue;
+
+		uint64_t count;
+		if (fds[2].revents & POLLIN) {
+			if (read(event_fd, &count, sizeof(count)) < 0) continue;
+		}
+		if (fds[1].revents & POLLIN) {
+			if (read(timer_fd, &count, sizeof(count)) < 0) continue;
+		}
+		if (fds[0].revents & (POLLIN | POLLERR)) receive();
+	}
+}
+
+void Client::connectDevice() {
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	addrinfo *addresses = nullptr;
+	int error = getaddrinfo(host.toUtf8().constData(), QString::number(port).toUtf8().constData(), &hints, &addresses);
+	if (error != 0) {
+		throw Exception("Client::connectDevice() failed: Could not resolve " + host + " (" +
+						QString(gai_strerror(error)) + ").");
+	}
+
+	// A connected UDP socket only receives datagrams from the device.
+	for (addrinfo *address = addresses; address != nullptr; address = address->ai_next) {
+		socket_fd = ::socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+						   address->ai_protocol);
+		if (socket_fd == -1) continue;
+
+		if (::connect(socket_fd, address->ai_addr, address->ai_addrlen) == 0) break;
+
+		::close(socket_fd);
+		socket_fd = -1;
+	}
+	error = errno;
+	freeaddrinfo(addresses);
+
+	if (socket_fd == -1) {
+		throw Exception("Client::connectDevice() failed: Could not connect to " + host + ":" + QString::number(port) +
+						" (" + QString(strerror(error)) + ").");
+	}
+
+	pending.clear();
+	{
+		QMutexLocker locker(&mutex);
+		energy = 0;
+		lost = 0;
+		answered = false;
+	}
+
+	exreq = false;
+	start();
+}
+
+void Client::disconnectDevice() {
+	if (isRunning()) {
+		exreq = true;
+		wakeup();
+		wait();
+	}
+
+	if (socket_fd != -1) {
+		::close(socket_fd);
+		socket_fd = -1;
+	}
+}
+
+void Client::send(int64_t now) {
+	// A request which couldn't be sent is lost just like one without an answer.
+	if (::send(socket_fd, request.constData(), request.size(), 0) == request.size()) requests++;
+
+	pending.push_back(now);
+}
+
+void Client::receive() {
+	char buffer[65536];
+
+	while (true) {
+		ssize_t size = ::recv(socket_fd, buffer, sizeof(buffer), 0);
+		if (size < 0 && errno == EINTR) continue;
+
+		// E.g. EAGAIN if all answers have been received or ECONNREFUSED if no device is listening
+		if (size < 0) return;
+
+		double value = 0;
+		try {
+			QByteArray payload = parseAnswer(QByteArray(buffer, size), energy_command);
+
+			// Add the value of all outlets in which we are interested.
+			for (auto outlet : outlets) {
+				if (outlet >= 0 && (size_t)payload.size() >= outlet * sizeof(uint32_t) + sizeof(uint32_t)) {
+					value += qFromBigEndian<qint32>(((uint32_t *)payload.data())[outlet]);
+				} else {
+					throw Exception("No data received for outlet #" + QString::number(outlet) + ".");
+				}
+			}
+		} catch (const Exception &) {
+			// Malformed answers are dropped, their request will time out.
+			continue;
+		}
+
+		// The answer belongs to the oldest request in flight, if it hasn't been given up on yet.
+		if (!pending.empty()) pending.pop_front();
+		answers++;
+
+		{
+			QMutexLocker locker(&mutex);
+			energy += value;
+			lost = 0;
+			answered = true;
+		}
+		changed.wakeAll();
+	}
+}
+
+void Client::wakeup() {
+	uint64_t count = 1;
+	if (write(event_fd, &count, sizeof(count)) < 0) return;
+}
+
+} // namespace ClustSafe
+} // namespace Monitor
+} // namespace AutopinPlus
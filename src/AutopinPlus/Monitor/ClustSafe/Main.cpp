@@ -11,26 +11,25 @@
 #include <AutopinPlus/Configuration.h>		// for Configuration, etc
 #include <AutopinPlus/Error.h>				// for Error, Error::::BAD_CONFIG, etc
 #include <AutopinPlus/Exception.h>			// for Exception
-#include <AutopinPlus/PerformanceMonitor.h> // for PerformanceMonitor
+#include <AutopinPlus/PerformanceMonitor.h>	// for PerformanceMonitor
 #include <AutopinPlus/ProcessTree.h>
-#include <AutopinPlus/Tools.h> // for Tools
-#include <qbytearray.h>		   // for QByteArray
-#include <qelapsedtimer.h>	 // for QElapsedTimer
-#include <qstring.h>		   // for operator+, QString
-#include <qstringlist.h>	   // for QStringList
-#include <QtEndian>			   // for qFromBigEndian
-#include <QUdpSocket>		   // for QUdpSocket, etc.
+#include <AutopinPlus/SampleBroker.h>		// for SampleBroker
+#include <AutopinPlus/Tools.h>				// for Tools
+#include <qbytearray.h>						// for QByteArray
+#include <qmutex.h>							// for QMutexLocker
+#include <qstring.h>						// for operator+, QString
+#include <qstringlist.h>					// for QStringList
 
 namespace AutopinPlus {
 namespace Monitor {
 namespace ClustSafe {
 
 // Inialization of static variables
-const QString Main::signature = "MEGware";
+int Main::interval = 10;
 
-const uint64_t Main::timeout = 1000;
+int Main::timeout = 1000;
 
-const uint64_t Main::ttl = 10;
+int Main::retries = 3;
 
 QString Main::host = "localhost";
 
@@ -40,71 +39,9 @@ QString Main::password = "";
 
 QList<int> Main::outlets = {1};
 
-bool Main::timerStarted = false;
+std::unique_ptr<Client> Main::client;
 
-QElapsedTimer Main::timer;
-
-QMutex Main::mutex;
-
-std::map<uintptr_t, uint64_t> Main::instanceValueMap;
-
-/*!
- * \brief Convert a uint16_t to a QByteArray.
- *
- * This function convert a unsigned 16-bit integer to a two-element byte array.
- *
- * \param[in] value The value to be converted.
- *
- * \return The resulting array which contains the specified value in network byte order.
- */
-static inline QByteArray toArray(uint16_t value) {
-	QByteArray result;
-
-	result.append((uint8_t)((value >> 8)));
-	result.append((uint8_t)((value >> 0)));
-
-	return result;
-}
-
-/*!
- * \brief Calculates a (very simple) checksum over an array.
- *
- * \param[in] array The array to be checksummed.
- *
- * \return The calculated checksum.
- */
-static inline uint8_t calculateChecksum(QByteArray const &array) {
-	uint8_t result = 0;
-
-	// Simply add up all bytes in the input array.
-	for (auto value : array) {
-		result += value;
-	}
-
-	return result;
-}
-
-/*!
-* \brief Checks if an array has a specific prefix and drops it.
-*
-* This function checks if an array has a specific prefix and drops it. If the prefix is not present, an exception
-* will be thrown.
-*
-* \param[in] array  The array to be checked
-* \param[in] prefix The prefix which should be present
-* \param[in] field  A description what the prefix is supposed to be.
-*
-* \exception Exception This exception will be thrown if the specified prefix is not present.
-*/
-static inline void checkAndDrop(QByteArray &array, const QByteArray &prefix, const QString &field) {
-	// Check if array starts with the expected prefix.
-	if (array.startsWith(prefix)) {
-		array.remove(0, prefix.size());
-	} else {
-		throw Exception(".checkAndDrop(" + array.toHex() + ", " + prefix.toHex() + ", " + field +
-						") failed: Second argument is not a prefix of the first argument.");
-	}
-}
+QMutex Main::client_mutex;
 
 Main::Main(QString name, const Configuration &config, AutopinContext &context)
 	: PerformanceMonitor(name, config, context) {
@@ -113,6 +50,16 @@ Main::Main(QString name, const Configuration &config, AutopinContext &context)
 
 	// Set the "valtype" field of the base class to minimal, as almost always smaller values are "better".
 	valtype = PerformanceMonitor::montype::MIN;
+
+	// The device measures the energy of whole machines, so all threads share one measurement.
+	valscope = PerformanceMonitor::monscope::SYSTEM;
+}
+
+Main::~Main() {
+	if (consumer != -1) {
+		SampleBroker::getInstance().unsubscribe(consumer);
+		getClient().release();
+	}
 }
 
 void Main::init() { context.info("Initializing " + name + " (" + type + ")"); }
@@ -145,12 +92,36 @@ void Main::init_static(const Configuration &config, const AutopinContext &contex
 		}
 	}
 
+	// Read and parse the "interval", "timeout" and "retries" options
+	try {
+		if (config.configOptionExists("clust.interval") > 0) {
+			Main::interval = Tools::readInt(config.getConfigOption("clust.interval"));
+		}
+		if (config.configOptionExists("clust.timeout") > 0) {
+			Main::timeout = Tools::readInt(config.getConfigOption("clust.timeout"));
+		}
+		if (config.configOptionExists("clust.retries") > 0) {
+			Main::retries = Tools::readInt(config.getConfigOption("clust.retries"));
+		}
+	} catch (const Exception &e) {
+		context.error("ClustSafe::Main::init_static() failed: Could not parse the 'interval', 'timeout' or "
+					  "'retries' option (" +
+					  QString(e.what()) + ").");
+	}
+	if (Main::interval <= 0 || Main::timeout <= 0 || Main::retries <= 0) {
+		context.error("ClustSafe::Main::init_static() failed: The 'interval', 'timeout' and 'retries' options must "
+					  "be positive.");
+	}
+
 	context.info("Using following values for ClustSafe");
 	context.info("Host = " + Main::host);
 	context.info("Port = :" + QString::number(Main::port));
 	QString outlets = "";
 	for (const auto &elem : Main::outlets) outlets += QString::number(elem);
 	context.info("Outlets = " + outlets);
+	context.info("Interval = " + QString::number(Main::interval) + " ms");
+	context.info("Timeout = " + QString::number(Main::timeout) + " ms");
+	context.info("Retries = " + QString::number(Main::retries));
 }
 
 Configuration::configopts Main::getConfigOpts() {
@@ -160,31 +131,37 @@ Configuration::configopts Main::getConfigOpts() {
 }
 
 void Main::start(int thread) {
-	try {
-		start_static(this);
-	} catch (const Exception &e) {
-		context.report(Error::MONITOR, "start", name + ".start(" + QString::number(thread) +
-													") failed: Could not reset the ClustSafe device (" +
-													QString(e.what()) + ")");
-		return;
+	QMutexLocker locker(&access_mutex);
+
+	// All threads share the measurement, so it is only restarted for the first one. Threads
+	// started later on join the running measurement instead of restarting it for all others.
+	if (threads.empty()) {
+		try {
+			// The device is polled for all instances of the process together, each one only
+			// keeps the energy counted so far as its own baseline.
+			getClient().acquire();
+			try {
+				consumer = SampleBroker::getInstance().subscribe(getKey(), (int64_t)interval * 1000000,
+																 SampleBroker::DELTA, &Main::readDevice);
+			} catch (const Exception &) {
+				getClient().release();
+				throw;
+			}
+		} catch (const Exception &e) {
+			context.report(Error::MONITOR, "start", name + ".start(" + QString::number(thread) +
+														") failed: Could not read the ClustSafe device (" +
+														QString(e.what()) + ")");
+			return;
+		}
 	}
 
 	// Insert the thread into our thread set.
 	threads.insert(thread);
 }
-void Main::start_static(ClustSafe::Main *instance) {
-	QMutexLocker ml(&mutex);
-
-	readValueFromDevice(true);
-	instanceValueMap[reinterpret_cast<uintptr_t>(instance)] = 0;
-
-	if (!timerStarted) {
-		timer.start();
-		timerStarted = true;
-	}
-}
 
 double Main::value(int thread) {
+	QMutexLocker locker(&access_mutex);
+
 	// Check if we are actually monitoring that thread. If not, error out.
 	if (!threads.count(thread)) {
 		context.report(Error::MONITOR, "value",
@@ -193,25 +170,47 @@ double Main::value(int thread) {
 	}
 
 	try {
-		return value_static(this);
+		return read();
 	} catch (const Exception &e) {
 		context.report(Error::MONITOR, "value", name + QString(e.what()));
 		return 0;
 	}
 }
 
-double Main::value_static(ClustSafe::Main *instance) {
-	QMutexLocker ml(&mutex);
+void Main::values(const int *tids, size_t count, value_batch &result) {
+	QMutexLocker locker(&access_mutex);
+
+	result.resize(count);
+
+	// The device measures the whole system, so it is only read once for all threads
+	double value = 0;
+	bool ok = true;
+	if (!threads.empty()) {
+		try {
+			value = read();
+		} catch (const Exception &) {
+			ok = false;
+		}
+	}
 
-	readValueFromDevice();
-	return instanceValueMap[reinterpret_cast<uintptr_t>(instance)];
+	int64_t timestamp = getTimestamp();
+	for (size_t i = 0; i < count; i++) {
+		bool monitored = threads.count(tids[i]) > 0;
+
+		result.values[i] = monitored && ok ? value : 0;
+		result.timestamps[i] = timestamp;
+		result.status[i] = !monitored ? VALUE_UNMONITORED : (ok ? VALUE_OK : VALUE_FAILED);
+		result.coverage[i] = monitored && ok ? 1.0 : 0;
+	}
 }
 
 double Main::stop(int thread) {
+	QMutexLocker locker(&access_mutex);
+
 	// Before stopping the counter, get its value one last time...
 	double result = 0;
 	try {
-		result = stop_static(this);
+		result = read();
 	} catch (const Exception &e) {
 		context.report(Error::MONITOR, "stop",
 					   name + ".stop(" + QString::number(thread) + ") failed: value() failed: " + QString(e.what()));
@@ -228,20 +227,21 @@ double Main::stop(int thread) {
 	return result;
 }
 
-double Main::stop_static(ClustSafe::Main *instance) {
-	QMutexLocker ml(&mutex);
-
-	readValueFromDevice();
-	uintptr_t ptr = reinterpret_cast<uintptr_t>(instance);
-	double result = instanceValueMap[ptr];
-	instanceValueMap.erase(ptr);
+void Main::clear(int thread) {
+	QMutexLocker locker(&access_mutex);
+	threads.erase(thread);
 
-	return result;
+	// The measurement ends with the last thread, which releases the device for the other instances.
+	if (threads.empty() && consumer != -1) {
+		SampleBroker::getInstance().unsubscribe(consumer);
+		getClient().release();
+		consumer = -1;
+	}
 }
 
-void Main::clear(int thread) { threads.erase(thread); }
-
 ProcessTree::autopin_tid_list Main::getMonitoredTasks() {
+	QMutexLocker locker(&access_mutex);
+
 	ProcessTree::autopin_tid_list result;
 
 	// Iterate over our thread set o get a list of all threads which are currently being monitored.
@@ -257,94 +257,28 @@ QString Main::getUnit() {
 	return "Joules";
 }
 
-void Main::readValueFromDevice(bool reset) {
-	int timeElapsed = timer.elapsed();
-	// Only send a new query if the cached value is too old.
-	if (reset || (timeElapsed > 0 && static_cast<uint>(timeElapsed) > ttl)) {
-		// Try to get the current energy consumption.
-		QByteArray payload;
-		uint64_t value = 0;
-		try {
-			// Set the command to 0x010F which means "get the current energy consumption on all outlets".
-			// Set the data to "0x01" which means "reset all counters after the response is sent".
-			payload = sendCommand(0x010F, QByteArray(1, 1));
-		} catch (const Exception &e) {
-			throw Exception("Could not read from the ClustSafe device (" + QString(e.what()) + ")");
-		}
-
-		// Re-add the value of all outlets in which we are interested.
-		for (auto outlet : outlets) {
-			if (payload.size() >= 0 &&
-				static_cast<uint>(payload.size()) >= outlet * sizeof(uint32_t) + sizeof(uint32_t)) {
-				value += qFromBigEndian<qint32>(((uint32_t *)payload.data())[outlet]);
-			} else {
-				throw Exception("No data received for outlet #" + QString::number(outlet) + ".");
-			}
-		}
-
-		// Restart the timer.
-		timer.restart();
+double Main::read() {
+	if (consumer == -1) throw Exception("No measurement has been started.");
 
-		// Update the values of all instances.
-		for (auto iterator = instanceValueMap.begin(); iterator != instanceValueMap.end(); iterator++) {
-			iterator->second += value;
-		}
-	}
+	return SampleBroker::getInstance().value(consumer)[0];
 }
 
-QByteArray Main::sendCommand(uint16_t command, QByteArray data) {
-	// Create the socket.
-	QUdpSocket socket;
-
-	// Create the request.
-	QByteArray request;
-	request.append(signature.toUtf8());
-	request.append((char)0);
-	request.append(password.toUtf8().leftJustified(16, 0, true));
-	request.append(toArray(command));
-	request.append(toArray(data.size()));
-	request.append(data.left(0xFFFF));
-	request.append((char)calculateChecksum(toArray(command) + toArray(data.size()) + data.left(0xFFFF)));
-
-	// Connect to the specified host.
-	socket.connectToHost(host, port);
-
-	// Wait until the specified timeout for the connection to become ready.
-	if (!socket.waitForConnected(timeout)) {
-		throw Exception(".sendCommand(" + QString::number(command) + ", " + data.toHex() +
-						") failed: Could not establish connection within " + QString::number(timeout) + " ms");
-	}
-
-	// Send the request.
-	if (socket.write(request) != request.size()) {
-		throw Exception(".sendCommand(" + QString::number(command) + ", " + data.toHex() +
-						") failed: Could not send request.");
-	}
-
-	// Wait for the specified timeout for a response/
-	if (!socket.waitForReadyRead(timeout)) {
-		throw Exception(".sendCommand(" + QString::number(command) + ", " + data.toHex() +
-						") failed: Did not receive any data within " + QString::number(timeout) + " ms");
-	}
+std::string Main::getKey() { return ("clustsafe:" + host + ":" + QString::number(port)).toStdString(); }
 
-	// Read the response.
-	QByteArray response = socket.readAll();
-	checkAndDrop(response, signature.toUtf8(), "signature");
-	checkAndDrop(response, QByteArray(1, 1), "device");
-	checkAndDrop(response, QByteArray(1, 1), "status");
-	checkAndDrop(response, QByteArray(15, 0), "padding");
-	checkAndDrop(response, toArray(command), "command");
+Client &Main::getClient() {
+	QMutexLocker locker(&client_mutex);
 
-	QByteArray payload =
-		response.mid(2 /* length field */, response.size() - 2 /* length field */ - 1 /* checksum field */);
+	if (client == nullptr) client.reset(new Client(host, port, password, outlets, interval, timeout, retries));
 
-	checkAndDrop(response, toArray(payload.size()), "length");
-	checkAndDrop(response, payload, "payload");
-	checkAndDrop(response, QByteArray(1, calculateChecksum(toArray(command) + toArray(payload.size()) + payload)),
-				 "checksum");
+	return *client;
+}
 
-	// Return the payload
-	return payload;
+std::vector<double> Main::readDevice() {
+	try {
+		return {getClient().take()};
+	} catch (const Exception &e) {
+		throw Exception("Could not read from the ClustSafe device (" + QString(e.what()) + ")");
+	}
 }
 
 } // namespace ClustSafe
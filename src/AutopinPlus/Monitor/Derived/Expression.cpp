@@ -0,0 +1,198 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Monitor/Derived/Expression.h>
+
+#include <AutopinPlus/Exception.h> // for Exception
+#include <algorithm>			   // for max
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace Derived {
+
+Expression::Expression(const QString &text) : text(text) {
+	parseSum();
+	if (!peek().isNull()) fail("Unexpected character");
+	if (code.empty()) fail("Empty expression");
+}
+
+const QStringList &Expression::getOperands() const { return operands; }
+
+void Expression::evaluate(const std::vector<const double *> &inputs, size_t count, double *result) {
+	if (stack.size() < max_depth * count) stack.resize(max_depth * count);
+
+	// The top of the stack is always an array of "count" values starting at "top".
+	double *top = stack.data() - count;
+	for (const auto &instruction : code) {
+		double *below = top - count;
+
+		switch (instruction.op) {
+		case CONSTANT:
+			top += count;
+			for (size_t i = 0; i < count; i++) top[i] = instruction.constant;
+			break;
+		case OPERAND:
+			top += count;
+			for (size_t i = 0; i < count; i++) top[i] = inputs[instruction.operand][i];
+			break;
+		case ADD:
+			for (size_t i = 0; i < count; i++) below[i] += top[i];
+			top = below;
+			break;
+		case SUBTRACT:
+			for (size_t i = 0; i < count; i++) below[i] -= top[i];
+			top = below;
+			break;
+		case MULTIPLY:
+			for (size_t i = 0; i < count; i++) below[i] *= top[i];
+			top = below;
+			break;
+		case DIVIDE:
+			for (size_t i = 0; i < count; i++) below[i] /= top[i];
+			top = below;
+			break;
+		case NEGATE:
+			for (size_t i = 0; i < count; i++) top[i] = -top[i];
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) result[i] = top[i];
+}
+
+void Expression::parseSum() {
+	parseProduct();
+
+	while (peek() == '+' || peek() == '-') {
+		QChar op = text[position++];
+		parseProduct();
+		append(op == '+' ? ADD : SUBTRACT);
+	}
+}
+
+void Expression::parseProduct() {
+	parseUnary();
+
+	while (peek() == '*' || peek() == '/') {
+		QChar op = text[position++];
+		parseUnary();
+		append(op == '*' ? MULTIPLY : DIVIDE);
+	}
+}
+
+void Expression::parseUnary() {
+	if (peek() == '-') {
+		position++;
+		parseUnary();
+		append(NEGATE);
+	} else if (peek() == '+') {
+		position++;
+		parseUnary();
+	} else {
+		parsePrimary();
+	}
+}
+
+void Expression::parsePrimary() {
+	QChar next = peek();
+
+	if (next == '(') {
+		position++;
+		parseSum();
+		if (peek() != ')') fail("Expected ')'");
+		position++;
+	} else if (next.isDigit() || next == '.') {
+		int start = position;
+		while (position < text.size() && (text[position].isDigit() || text[position] == '.')) position++;
+
+		// Accept an exponent, e.g. "1e-3"
+		if (position < text.size() && text[position].toLower() == 'e') {
+			position++;
+			if (position < text.size() && (text[position] == '+' || text[position] == '-')) position++;
+			while (position < text.size() && text[position].isDigit()) position++;
+		}
+
+		bool ok = false;
+		double constant = text.mid(start, position - start).toDouble(&ok);
+		if (!ok) fail("Invalid number");
+		append(CONSTANT, constant);
+	} else if (next.isLetter() || next == '_') {
+		int start = position;
+		while (position < text.size() && (text[position].isLetterOrNumber() || text[position] == '_')) position++;
+
+		QString name = text.mid(start, position - start);
+		int operand = operands.indexOf(name);
+		if (operand == -1) {
+			operand = operands.size();
+			operands.append(name);
+		}
+		append(OPERAND, 0, operand);
+	} else {
+		fail(next.isNull() ? "Unexpected end of expression" : "Unexpected character");
+	}
+}
+
+QChar Expression::peek() {
+	while (position < text.size() && text[position].isSpace()) position++;
+
+	return position < text.size() ? text[position] : QChar();
+}
+
+void Expression::append(opcode op, double constant, int operand) {
+	size_t size = code.size();
+
+	// Fold operations on constants, e.g. "2 * 1000 * x" is compiled to "2000 * x".
+	if (op == NEGATE && size >= 1 && code[size - 1].op == CONSTANT) {
+		code[size - 1].constant = -code[size - 1].constant;
+		return;
+	}
+	if (op != CONSTANT && op != OPERAND && op != NEGATE && size >= 2 && code[size - 1].op == CONSTANT &&
+		code[size - 2].op == CONSTANT) {
+		double left = code[size - 2].constant, right = code[size - 1].constant;
+		code.pop_back();
+		depth--;
+
+		switch (op) {
+		case ADD:
+			code.back().constant = left + right;
+			break;
+		case SUBTRACT:
+			code.back().constant = left - right;
+			break;
+		case MULTIPLY:
+			code.back().constant = left * right;
+			break;
+		default:
+			code.back().constant = left / right;
+			break;
+		}
+		return;
+	}
+
+	Instruction instruction;
+	instruction.op = op;
+	instruction.constant = constant;
+	instruction.operand = operand;
+	code.push_back(instruction);
+
+	// Values are pushed by constants and operands, binary operations pop one.
+	if (op == CONSTANT || op == OPERAND) {
+		depth++;
+		max_depth = std::max(max_depth, depth);
+	} else if (op != NEGATE) {
+		depth--;
+	}
+}
+
+void Expression::fail(const QString &message) const {
+	throw Exception("Expression::Expression(" + text + ") failed: " + message + " at position " +
+					QString::number(position + 1) + ".");
+}
+
+} // namespace Derived
+} // namespace Monitor
+} // namespace AutopinPlus
@@ -0,0 +1,279 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Monitor/Derived/Main.h>
+
+#include <AutopinPlus/AutopinContext.h> // for AutopinContext
+#include <AutopinPlus/Configuration.h>  // for Configuration, etc
+#include <AutopinPlus/Error.h>			// for Error, Error::::BAD_CONFIG
+#include <AutopinPlus/Exception.h>		// for Exception
+#include <algorithm>					// for min
+#include <math.h>						// for isfinite
+#include <qmutex.h>						// for QMutexLocker
+#include <qstringlist.h>				// for QStringList
+#include <stdint.h>						// for INT64_MAX
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace Derived {
+
+Main::Main(QString name, const Configuration &config, const PerformanceMonitor::monitor_list &monitors,
+		   AutopinContext &context)
+	: PerformanceMonitor(name, config, context), monitors(monitors) {
+	type = "derived";
+}
+
+void Main::init() {
+	QMutexLocker locker(&access_mutex);
+
+	context.info("Initializing \"" + name + "\" (derived)");
+
+	// Read and compile the "expression" option
+	if (config.configOptionExists(name + ".expression") <= 0) {
+		context.report(Error::BAD_CONFIG, "option_missing", name + ".init(): The 'expression' option is missing.");
+		return;
+	}
+
+	text = config.getConfigOptionList(name + ".expression").join(" ");
+	try {
+		expression.reset(new Expression(text));
+		context.info("  - " + name + ".expression = " + text);
+	} catch (const Exception &e) {
+		context.report(Error::BAD_CONFIG, "option_format",
+					   name + ".init(): Could not parse the 'expression' option (" + QString(e.what()) + ").");
+		return;
+	}
+
+	// Look up the monitors used in the expression
+	operands.clear();
+	for (const auto &operand : expression->getOperands()) {
+		PerformanceMonitor *monitor = nullptr;
+		for (const auto &elem : monitors) {
+			if (elem->getName() == operand) monitor = elem.get();
+		}
+
+		if (monitor == nullptr || monitor == this) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init(): The expression uses the unknown monitor \"" + operand + "\".");
+			return;
+		}
+
+		// Derived operands could form a cycle, which would start and read the monitors forever.
+		if (monitor->getType() == type) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init(): The expression uses the derived monitor \"" + operand + "\".");
+			return;
+		}
+
+		operands.push_back(monitor);
+	}
+
+	batches.resize(operands.size());
+	inputs.resize(operands.size());
+	scalars.resize(operands.size());
+
+	// Read the "unit" option
+	unit = "";
+	if (config.configOptionExists(name + ".unit") > 0) {
+		unit = config.getConfigOption(name + ".unit");
+		context.info("  - " + name + ".unit = " + unit);
+	}
+
+	// Read and parse the "valtype" option
+	valtype = UNKNOWN;
+	if (config.configOptionExists(name + ".valtype") > 0) {
+		try {
+			valtype = readMontype(config.getConfigOption(name + ".valtype"));
+			context.info("  - " + name + ".valtype = " + showMontype(valtype));
+		} catch (const Exception &e) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init(): Could not parse the 'valtype' option (" + QString(e.what()) + ").");
+			return;
+		}
+	}
+
+	// Read the "cumulative" option
+	cumulative = false;
+	if (config.configOptionExists(name + ".cumulative") > 0) {
+		cumulative = config.getConfigOptionBool(name + ".cumulative");
+		context.info("  - " + name + ".cumulative = " + QString(cumulative ? "true" : "false"));
+	}
+}
+
+QString Main::getUnit() { return unit; }
+
+bool Main::isCumulative() { return cumulative; }
+
+PerformanceMonitor::monscope Main::getScope() {
+	QMutexLocker locker(&access_mutex);
+
+	// The scopes are ordered from the narrowest to the widest. An expression without any
+	// operands is a constant, which is the same for the whole system.
+	monscope result = SYSTEM;
+	for (auto operand : operands) result = std::min(result, operand->getScope());
+
+	return result;
+}
+
+Configuration::configopts Main::getConfigOpts() {
+	Configuration::configopts result;
+
+	result.push_back(Configuration::configopt("expression", QStringList(text)));
+
+	if (!unit.isEmpty()) {
+		result.push_back(Configuration::configopt("unit", QStringList(unit)));
+	}
+
+	if (valtype != PerformanceMonitor::UNKNOWN) {
+		result.push_back(Configuration::configopt("valtype", QStringList(showMontype(valtype))));
+	}
+
+	result.push_back(Configuration::configopt("cumulative", QStringList(cumulative ? "true" : "false")));
+
+	return result;
+}
+
+void Main::start(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	// The operands are configured monitors which may also be read by others, e.g. a logger or a
+	// strategy. Starting them again would reset their measurement for those, so operands which
+	// already monitor the thread are only read, and their current value becomes the baseline.
+	Task task;
+	task.started.assign(operands.size(), false);
+	task.baselines.assign(operands.size(), 0);
+
+	auto it = tasks.find(tid);
+	if (it != tasks.end()) task.started = it->second.started;
+
+	for (size_t i = 0; i < operands.size(); i++) {
+		ProcessTree::autopin_tid_list monitored = operands[i]->getMonitoredTasks();
+		if (monitored.find(tid) != monitored.end()) {
+			task.baselines[i] = operands[i]->value(tid);
+		} else {
+			operands[i]->start(tid);
+			task.started[i] = true;
+		}
+		if (context.isError()) return;
+	}
+
+	tasks[tid] = task;
+}
+
+double Main::value(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	auto it = tasks.find(tid);
+
+	for (size_t i = 0; i < operands.size(); i++) {
+		scalars[i] = operands[i]->value(tid);
+		if (context.isError()) return 0;
+		if (it != tasks.end()) scalars[i] -= it->second.baselines[i];
+		inputs[i] = &scalars[i];
+	}
+
+	double result = 0;
+	expression->evaluate(inputs, 1, &result);
+
+	// E.g. a division by a counter which hasn't counted anything yet
+	return isfinite(result) ? result : 0;
+}
+
+void Main::values(const int *tids, size_t count, value_batch &result) {
+	QMutexLocker locker(&access_mutex);
+
+	result.resize(count);
+
+	for (size_t i = 0; i < operands.size(); i++) {
+		operands[i]->values(tids, count, batches[i]);
+		inputs[i] = batches[i].values.data();
+	}
+
+	// Shared operands are measured since the thread was started here
+	for (size_t j = 0; j < count; j++) {
+		auto it = tasks.find(tids[j]);
+		if (it == tasks.end()) continue;
+
+		for (size_t i = 0; i < operands.size(); i++) {
+			if (batches[i].status[j] == VALUE_OK) batches[i].values[j] -= it->second.baselines[i];
+		}
+	}
+
+	expression->evaluate(inputs, count, result.values.data());
+
+	// A value is valid only if all of its operands are. It is as old as its oldest operand
+	// and as exact as its least exact one.
+	for (size_t i = 0; i < count; i++) {
+		result.status[i] = VALUE_OK;
+		result.timestamps[i] = INT64_MAX;
+		result.coverage[i] = 1.0;
+
+		for (const auto &batch : batches) {
+			if (batch.status[i] != VALUE_OK) result.status[i] = batch.status[i];
+			result.timestamps[i] = std::min(result.timestamps[i], batch.timestamps[i]);
+			result.coverage[i] = std::min(result.coverage[i], batch.coverage[i]);
+		}
+
+		if (result.status[i] == VALUE_OK && !isfinite(result.values[i])) result.status[i] = VALUE_FAILED;
+		if (result.status[i] != VALUE_OK || operands.empty()) {
+			result.timestamps[i] = getTimestamp();
+		}
+		if (result.status[i] != VALUE_OK) {
+			result.values[i] = 0;
+			result.coverage[i] = 0;
+		}
+	}
+}
+
+double Main::coverage(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	double result = 1.0;
+	for (auto operand : operands) result = std::min(result, operand->coverage(tid));
+
+	return result;
+}
+
+double Main::stop(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	// Stopping an operand would end the measurement for its other users as well.
+	double result = value(tid);
+	if (context.isError()) return 0;
+
+	clear(tid);
+
+	return result;
+}
+
+void Main::clear(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	auto it = tasks.find(tid);
+	if (it == tasks.end()) return;
+
+	// Only the operands started by this monitor are released.
+	for (size_t i = 0; i < operands.size(); i++) {
+		if (it->second.started[i]) operands[i]->clear(tid);
+	}
+
+	tasks.erase(it);
+}
+
+ProcessTree::autopin_tid_list Main::getMonitoredTasks() {
+	QMutexLocker locker(&access_mutex);
+
+	ProcessTree::autopin_tid_list result;
+
+	for (const auto &task : tasks) result.insert(task.first);
+
+	return result;
+}
+
+} // namespace Derived
+} // namespace Monitor
+} // namespace AutopinPlus
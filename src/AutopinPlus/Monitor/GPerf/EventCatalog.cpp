@@ -0,0 +1,350 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Monitor/GPerf/EventCatalog.h>
+
+#include <AutopinPlus/Exception.h>		// for Exception
+#include <AutopinPlus/OS/CpuInfo.h>		// for parseSysRangeFile
+#include <AutopinPlus/OS/SystemPaths.h> // for SystemPaths
+#include <AutopinPlus/Tools.h>			// for Tools
+#include <linux/perf_event.h>			// for PERF_TYPE_HARDWARE, etc
+#include <qdir.h>						// for QDir
+#include <qfileinfo.h>					// for QFileInfo
+#include <qhash.h>						// for QHash
+#include <qlist.h>						// for QList
+#include <stdint.h>						// for uint32_t, uint64_t
+#include <string.h>						// for memset
+#include <utility>						// for pair
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace GPerf {
+namespace EventCatalog {
+
+/*!
+ * \brief A generic event of the kernel.
+ */
+struct GenericEvent {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+};
+
+/*!
+ * The generic hardware and software events.
+ */
+static constexpr GenericEvent generic_events[] = {
+	{"hardware/cpu-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{"hardware/instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{"hardware/cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+	{"hardware/cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+	{"hardware/branch-instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+	{"hardware/branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{"hardware/bus-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES},
+	{"hardware/stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+	{"hardware/stalled-cycles-backend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+	{"hardware/ref-cpu-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES},
+	{"software/cpu-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK},
+	{"software/task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+	{"software/page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+	{"software/context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+	{"software/cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+	{"software/page-faults-min", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN},
+	{"software/page-faults-maj", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ},
+	{"software/alignment-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_ALIGNMENT_FAULTS},
+	{"software/emulation-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_EMULATION_FAULTS},
+	{"software/dummy", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_DUMMY},
+};
+
+/*!
+ * \brief A part of the name and config of the generic cache events.
+ */
+struct CachePart {
+	const char *name;
+	uint64_t config;
+};
+
+/*!
+ * The caches of the generic cache events.
+ */
+static constexpr CachePart cache_ids[] = {
+	{"l1d", PERF_COUNT_HW_CACHE_L1D}, {"l1i", PERF_COUNT_HW_CACHE_L1I}, {"ll", PERF_COUNT_HW_CACHE_LL},
+	{"dtlb", PERF_COUNT_HW_CACHE_DTLB}, {"itlb", PERF_COUNT_HW_CACHE_ITLB}, {"bpu", PERF_COUNT_HW_CACHE_BPU},
+	{"node", PERF_COUNT_HW_CACHE_NODE},
+};
+
+/*!
+ * The operations of the generic cache events.
+ */
+static constexpr CachePart cache_ops[] = {
+	{"read", PERF_COUNT_HW_CACHE_OP_READ},
+	{"write", PERF_COUNT_HW_CACHE_OP_WRITE},
+	{"prefetch", PERF_COUNT_HW_CACHE_OP_PREFETCH},
+};
+
+/*!
+ * The results of the generic cache events.
+ */
+static constexpr CachePart cache_results[] = {
+	{"access", PERF_COUNT_HW_CACHE_RESULT_ACCESS}, {"miss", PERF_COUNT_HW_CACHE_RESULT_MISS},
+};
+
+/*!
+ * \brief A field of a PMU format, e.g. "config:0-7,32-35".
+ */
+struct FormatField {
+	/*!
+	 * The field of the perf_event_attr struct.
+	 */
+	QString field;
+
+	/*!
+	 * The bit ranges in the field, from the least significant bits of the value upwards.
+	 */
+	QList<std::pair<int, int>> ranges;
+};
+
+/*!
+ * All events by name, including the resolved tracepoints and event files.
+ */
+static QHash<QString, Sensor> events;
+
+/*!
+ * The names of the generic and PMU events.
+ */
+static QStringList names;
+
+/*!
+ * Maps the canonical path of every event file of a scanned PMU to its name.
+ */
+static QHash<QString, QString> files;
+
+/*!
+ * The parsed format files, by path.
+ */
+static QHash<QString, FormatField> formats;
+
+/*!
+ * Whether setup() has been called.
+ */
+static bool ready = false;
+
+/*!
+ * \brief Returns a sensor with the default settings of all sensors.
+ */
+static Sensor makeSensor(const QString &name, uint32_t type, uint64_t config) {
+	Sensor result;
+
+	memset(&(result.attr), 0, sizeof(result.attr));
+
+	// All sensors start in a disabled state and require manual enabling.
+	result.attr.disabled = 1;
+	result.attr.size = sizeof(result.attr);
+	result.attr.type = type;
+	result.attr.config = config;
+
+	result.name = name;
+	result.scale = 1.0;
+
+	return result;
+}
+
+/*!
+ * \brief Parses a format file of a PMU.
+ *
+ * \exception Exception This exception will be thrown if the file could not be parsed.
+ */
+static const FormatField &readFormat(const QString &path) {
+	auto it = formats.constFind(path);
+	if (it != formats.constEnd()) return it.value();
+
+	FormatField result;
+	auto field_position = Tools::readPair(Tools::readLine(path), ":");
+	result.field = field_position.first;
+
+	// Single bits have no upper bound.
+	for (auto range : field_position.second.split(",")) {
+		auto bounds = range.split("-");
+		int lower = Tools::readInt(bounds.first());
+		int upper = Tools::readInt(bounds.last());
+		if (bounds.size() > 2 || lower > upper || upper > 63) {
+			throw Exception("EventCatalog::readFormat(" + path + ") failed: Invalid bit range " + range + ".");
+		}
+		result.ranges.append(std::make_pair(lower, upper));
+	}
+
+	return formats.insert(path, result).value();
+}
+
+/*!
+ * \brief Parses an event file in the events directory of a PMU.
+ *
+ * \exception Exception This exception will be thrown if the file could not be parsed.
+ */
+static Sensor readEventFile(const QString &name, const QString &path) {
+	QString pmu = QFileInfo(path).absolutePath() + "/..";
+
+	Sensor result = makeSensor(name, Tools::readULong(Tools::readLine(pmu + "/type")), 0);
+
+	for (auto selector : Tools::readLine(path).split(",")) {
+		// Some selectors don't have a value associated with them, which means
+		// that they are just one bit which needs to be set.
+		auto variable_value = selector.split("=");
+		auto variable = variable_value.first().trimmed();
+		QString text = variable_value.size() > 1 ? variable_value[1] : "1";
+		uint64_t value = Tools::readULong(text);
+
+		const FormatField &format = readFormat(pmu + "/format/" + variable);
+
+		// Distribute the value over the bit ranges of the field.
+		uint64_t bits = 0;
+		for (const auto &range : format.ranges) {
+			int width = range.second - range.first + 1;
+			uint64_t part = width == 64 ? value : value & ((1ULL << width) - 1);
+			bits |= part << range.first;
+			value = width == 64 ? 0 : value >> width;
+		}
+
+		// Check if the value actually fits in the alloted space.
+		if (value != 0) {
+			throw Exception("EventCatalog::readEventFile(" + path + ") failed: Could not fit " + text +
+							" in the " + variable + " field.");
+		}
+
+		// The other fields of the perf_event_attr struct are not meant for selecting the
+		// desired counter.
+		if (format.field == "config") {
+			result.attr.config |= bits;
+		} else if (format.field == "config1") {
+			result.attr.config1 |= bits;
+		} else if (format.field == "config2") {
+			result.attr.config2 |= bits;
+		} else {
+			throw Exception("EventCatalog::readEventFile(" + path + ") failed: Setting the " + format.field +
+							" field in the perf_event_attr struct is not supported.");
+		}
+	}
+
+	// The scale, the unit and the processors are optional, so ignore them if they are missing.
+	try {
+		result.scale = Tools::readDouble(Tools::readLine(path + ".scale"));
+	} catch (const Exception &e) {
+	}
+
+	try {
+		result.unit = Tools::readLine(path + ".unit");
+	} catch (const Exception &e) {
+	}
+
+	for (int cpu : OS::CpuInfo::parseSysRangeFile(pmu + "/cpumask")) result.processors.append(cpu);
+
+	return result;
+}
+
+/*!
+ * \brief Resolves the id of a tracepoint in tracefs.
+ *
+ * \exception Exception This exception will be thrown if the tracepoint is unknown.
+ */
+static Sensor readTracepoint(const QString &name) {
+	auto subsystem_event = Tools::readPair(name.mid(QString("tracepoint/").length()), ":");
+	QString path = "/events/" + subsystem_event.first + "/" + subsystem_event.second + "/id";
+
+	// Recent kernels mount tracefs on its own, older ones only below debugfs.
+	for (auto root : {"/kernel/tracing", "/kernel/debug/tracing"}) {
+		try {
+			return makeSensor(name, PERF_TYPE_TRACEPOINT,
+							  Tools::readULong(Tools::readLine(OS::SystemPaths::sysfs(root + path))));
+		} catch (const Exception &e) {
+		}
+	}
+
+	throw Exception("EventCatalog::readTracepoint(" + name + ") failed: Unknown tracepoint or tracefs not accessible.");
+}
+
+void setup() {
+	events.clear();
+	names.clear();
+	files.clear();
+	formats.clear();
+
+	for (const auto &event : generic_events) {
+		events.insert(event.name, makeSensor(event.name, event.type, event.config));
+	}
+
+	for (const auto &id : cache_ids) {
+		for (const auto &op : cache_ops) {
+			for (const auto &result : cache_results) {
+				QString name = QString("cache/") + id.name + "-" + op.name + "-" + result.name;
+				events.insert(name, makeSensor(name, PERF_TYPE_HW_CACHE,
+											   id.config | (op.config << 8) | (result.config << 16)));
+			}
+		}
+	}
+
+	// Add the event aliases of all PMUs. Events which cannot be parsed (e.g. because they
+	// require a parameter) are skipped, they can still be configured manually.
+	QDir devices(OS::SystemPaths::sysfs("/bus/event_source/devices"));
+	for (auto pmu : devices.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+		QDir dir(devices.filePath(pmu + "/events"));
+		for (auto event : dir.entryList(QDir::Files)) {
+			if (event.contains('.')) continue;
+
+			QString name = pmu + "/" + event;
+			if (events.contains(name)) continue;
+
+			try {
+				events.insert(name, readEventFile(name, dir.filePath(event)));
+				files.insert(QFileInfo(dir.filePath(event)).canonicalFilePath(), name);
+			} catch (const Exception &e) {
+			}
+		}
+	}
+
+	names = events.keys();
+	names.sort();
+
+	ready = true;
+}
+
+Sensor getSensor(const QString &name) {
+	if (!ready) setup();
+
+	auto it = events.constFind(name);
+	if (it != events.constEnd()) return it.value();
+
+	Sensor result;
+	if (name.startsWith("/")) {
+		QString path = OS::SystemPaths::mapSysfs(name);
+		QString canonical = QFileInfo(path).canonicalFilePath();
+
+		if (files.contains(canonical)) {
+			result = events.value(files.value(canonical));
+			result.name = name;
+		} else {
+			result = readEventFile(name, path);
+		}
+	} else if (name.startsWith("tracepoint/")) {
+		result = readTracepoint(name);
+	} else {
+		throw Exception("EventCatalog::getSensor(" + name + ") failed: Unknown event.");
+	}
+
+	events.insert(name, result);
+	return result;
+}
+
+QStringList getNames() {
+	if (!ready) setup();
+
+	return names;
+}
+
+} // namespace EventCatalog
+} // namespace GPerf
+} // namespace Monitor
+} // namespace AutopinPlus
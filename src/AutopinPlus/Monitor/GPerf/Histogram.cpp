@@ -0,0 +1,93 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Monitor/GPerf/Histogram.h>
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace GPerf {
+
+Histogram::Histogram(unsigned int capacity) {
+	// The table is kept at most half full, so that probe sequences stay short.
+	unsigned int slots = 2;
+	while (slots < 2 * capacity) slots *= 2;
+
+	entries.assign(slots, Entry{0, 0, 0});
+}
+
+int32_t Histogram::add(uint64_t key, int32_t owner) {
+	if (key == 0) return owner;
+
+	total++;
+
+	size_t slot = find(key);
+	Entry &entry = entries[slot];
+	if (entry.key == 0) {
+		// Full, only count the key in total.
+		if (isFull()) return owner;
+
+		entry.key = key;
+		entry.owner = owner;
+		used++;
+	} else if (entry.owner != owner) {
+		entry.owner = shared;
+	}
+
+	entry.count++;
+	if (max == -1 || entry.count > entries[max].count) max = slot;
+
+	return entry.owner;
+}
+
+void Histogram::clear() {
+	if (used > 0) entries.assign(entries.size(), Entry{0, 0, 0});
+
+	used = 0;
+	total = 0;
+	max = -1;
+}
+
+void Histogram::age() {
+	std::vector<Entry> old(entries.size(), Entry{0, 0, 0});
+	old.swap(entries);
+	used = 0;
+	max = -1;
+
+	// Removing keys would break the probe sequences of the remaining ones, so they are inserted again.
+	for (const auto &entry : old) {
+		if (entry.key == 0 || entry.count < 2) continue;
+
+		size_t slot = find(entry.key);
+		entries[slot] = Entry{entry.key, entry.count / 2, entry.owner};
+		used++;
+		if (max == -1 || entries[slot].count > entries[max].count) max = slot;
+	}
+}
+
+bool Histogram::isFull() const { return 2 * (used + 1) > entries.size(); }
+
+size_t Histogram::find(uint64_t key) const {
+	// Multiplicative hashing spreads the often aligned addresses over the table.
+	size_t mask = entries.size() - 1;
+	size_t slot = ((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+
+	while (entries[slot].key != 0 && entries[slot].key != key) slot = (slot + 1) & mask;
+
+	return slot;
+}
+
+uint64_t Histogram::getTotal() const { return total; }
+
+uint32_t Histogram::getMax() const { return max == -1 ? 0 : entries[max].count; }
+
+uint64_t Histogram::getMaxKey() const { return max == -1 ? 0 : entries[max].key; }
+
+unsigned int Histogram::size() const { return used; }
+
+} // namespace GPerf
+} // namespace Monitor
+} // namespace AutopinPlus
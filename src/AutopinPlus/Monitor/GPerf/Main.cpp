@@ -11,23 +11,31 @@
 #include <AutopinPlus/Configuration.h>		  // for Configuration, etc
 #include <AutopinPlus/Error.h>				  // for Error, Error::::MONITOR, etc
 #include <AutopinPlus/Exception.h>			  // for Exception
+#include <AutopinPlus/Monitor/GPerf/EventCatalog.h> // for EventCatalog
 #include <AutopinPlus/Monitor/GPerf/Sensor.h> // for Sensor
+#include <AutopinPlus/OS/BatchReader.h>		  // for BatchReader
+#include <AutopinPlus/OS/CpuInfo.h>			  // for parseSysRangeFile
+#include <AutopinPlus/OS/SystemPaths.h>		  // for SystemPaths
 #include <AutopinPlus/PerformanceMonitor.h>   // for PerformanceMonitor, etc
 #include <AutopinPlus/ProcessTree.h>
 #include <AutopinPlus/Tools.h> // for Tools
+#include <algorithm>		   // for min
 #include <errno.h>			   // for errno
 #include <iostream>			   // for cout, operator<<, ostream, etc
 #include <linux/perf_event.h>  // for perf_event_attr, etc
-#include <qfileinfo.h>		   // for QFileInfo
+#include <qdir.h>			   // for QDir
 #include <qlist.h>			   // for QList
 #include <qmap.h>			   // for QMap
+#include <qmutex.h>			   // for QMutexLocker
 #include <qstring.h>		   // for QString, operator+
 #include <qstringlist.h>	   // for QStringList
 #include <stddef.h>			   // for size_t
 #include <stdint.h>			   // for uint64_t
+#include <sched.h>			   // for sched_getcpu
 #include <string.h>			   // for strerror, memset
 #include <syscall.h>		   // for __NR_perf_event_open
 #include <sys/ioctl.h>		   // for ioctl
+#include <sys/mman.h>		   // for mmap, munmap
 #include <unistd.h>			   // for close, read, syscall, etc
 #include <utility>			   // for pair
 
@@ -44,6 +52,14 @@ Main::Main(QString name, const Configuration &config, AutopinContext &context)
 	valtype = PerformanceMonitor::montype::MIN;
 }
 
+Main::~Main() {
+	for (const auto &group : process_groups) closeGroup(group);
+
+	// Unmap the ring buffers before closing the events they belong to.
+	sample_buffers.clear();
+	for (auto fd : sample_fds) close(fd);
+}
+
 void Main::init() {
 	context.info("Initializing " + name + " (" + type + ")");
 
@@ -63,8 +79,12 @@ void Main::init() {
 	// Read and parse the "sensor" option
 	if (config.configOptionExists(name + ".sensor") > 0) {
 		try {
-			sensor = readSensor(config.getConfigOption(name + ".sensor"));
-			context.info("  - " + name + ".sensor = " + showSensor(sensor));
+			// The watchdog initializes the monitors twice, so start from scratch.
+			sensors.clear();
+			for (auto input : config.getConfigOptionList(name + ".sensor")) {
+				sensors.append(readSensor(input));
+				context.info("  - " + name + ".sensor = " + showSensor(sensors.last()));
+			}
 		} catch (const Exception &e) {
 			context.report(Error::BAD_CONFIG, "option_format",
 						   name + ".init() failed: Could not parse the 'sensor' option (" + QString(e.what()) + ").");
@@ -76,6 +96,151 @@ void Main::init() {
 		return;
 	}
 
+	// Read and parse the "combine" option
+	if (config.configOptionExists(name + ".combine") > 0) {
+		try {
+			combine = readCombine(config.getConfigOption(name + ".combine"));
+			context.info("  - " + name + ".combine = " + showCombine(combine));
+		} catch (const Exception &e) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init() failed: Could not parse the 'combine' option (" + QString(e.what()) + ").");
+			return;
+		}
+	}
+
+	if (combine == RATIO && sensors.size() != 2) {
+		context.report(Error::BAD_CONFIG, "option_format",
+					   name + ".init() failed: The 'ratio' combination requires exactly two sensors.");
+		return;
+	}
+
+	// Read and parse the "scope" option
+	valscope = THREAD;
+	if (config.configOptionExists(name + ".scope") > 0) {
+		try {
+			valscope = readMonscope(config.getConfigOption(name + ".scope"));
+			context.info("  - " + name + ".scope = " + showMonscope(valscope));
+		} catch (const Exception &e) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init() failed: Could not parse the 'scope' option (" + QString(e.what()) + ").");
+			return;
+		}
+
+		if (valscope != THREAD && valscope != PROCESS && valscope != SYSTEM) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init() failed: The scope must be one of 'thread', 'process', 'system'.");
+			return;
+		}
+	} else {
+		// Sensors of uncore PMUs (e.g. "energy-pkg") can only count on the processors of their
+		// PMU and never per thread, so all threads would read the same system-wide counters.
+		bool uncore = !sensors.isEmpty();
+		for (const auto &sensor : sensors) uncore = uncore && !sensor.processors.isEmpty();
+		if (uncore) {
+			valscope = SYSTEM;
+			context.info("  - " + name + ".scope = " + showMonscope(valscope) + " (all sensors are system-wide)");
+		}
+	}
+
+	// Read and parse the "mode" option
+	if (config.configOptionExists(name + ".mode") > 0) {
+		try {
+			mode = readMode(config.getConfigOption(name + ".mode"));
+			context.info("  - " + name + ".mode = " + showMode(mode));
+		} catch (const Exception &e) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init() failed: Could not parse the 'mode' option (" + QString(e.what()) + ").");
+			return;
+		}
+	}
+
+	if (mode == SAMPLE) {
+		if (sensors.size() != 1) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init() failed: The 'sample' mode requires exactly one sensor.");
+			return;
+		}
+
+		// Read and parse the "sample_period" option
+		if (config.configOptionExists(name + ".sample_period") > 0) {
+			try {
+				sample_period = Tools::readULong(config.getConfigOption(name + ".sample_period"));
+				if (sample_period == 0) throw Exception("The period must be positive.");
+				context.info("  - " + name + ".sample_period = " + QString::number(sample_period));
+			} catch (const Exception &e) {
+				context.report(Error::BAD_CONFIG, "option_format",
+							   name + ".init() failed: Could not parse the 'sample_period' option (" +
+								   QString(e.what()) + ").");
+				return;
+			}
+		}
+
+		// Read and parse the "sample_type" option
+		if (config.configOptionExists(name + ".sample_type") > 0) {
+			try {
+				sample_type = readSampleType(config.getConfigOptionList(name + ".sample_type"));
+				context.info("  - " + name + ".sample_type = " + showSampleType(sample_type).join(" "));
+			} catch (const Exception &e) {
+				context.report(Error::BAD_CONFIG, "option_format",
+							   name + ".init() failed: Could not parse the 'sample_type' option (" +
+								   QString(e.what()) + ").");
+				return;
+			}
+		}
+
+		// Read and parse the "metric" option
+		if (config.configOptionExists(name + ".metric") > 0) {
+			try {
+				metric = readMetric(config.getConfigOption(name + ".metric"));
+				context.info("  - " + name + ".metric = " + showMetric(metric));
+			} catch (const Exception &e) {
+				context.report(Error::BAD_CONFIG, "option_format",
+							   name + ".init() failed: Could not parse the 'metric' option (" + QString(e.what()) +
+								   ").");
+				return;
+			}
+		}
+
+		if (metric == SHARED && !(sample_type & PERF_SAMPLE_ADDR)) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init() failed: The 'shared' metric requires 'addr' in the 'sample_type' option.");
+			return;
+		}
+
+		// Read and parse the "buffer_pages" option
+		if (config.configOptionExists(name + ".buffer_pages") > 0) {
+			try {
+				buffer_pages = Tools::readInt(config.getConfigOption(name + ".buffer_pages"));
+				if (buffer_pages <= 0 || (buffer_pages & (buffer_pages - 1)) != 0) {
+					throw Exception("The number of pages must be a power of two.");
+				}
+				context.info("  - " + name + ".buffer_pages = " + QString::number(buffer_pages));
+			} catch (const Exception &e) {
+				context.report(Error::BAD_CONFIG, "option_format",
+							   name + ".init() failed: Could not parse the 'buffer_pages' option (" +
+								   QString(e.what()) + ").");
+				return;
+			}
+		}
+	}
+
+	// Read the "rdpmc" option
+	if (config.configOptionExists(name + ".rdpmc") > 0) {
+		rdpmc = config.getConfigOptionBool(name + ".rdpmc");
+		context.info("  - " + name + ".rdpmc = " + QString(rdpmc ? "true" : "false"));
+#if !defined(__i386__) && !defined(__x86_64__)
+		if (rdpmc) context.warn("  - Reading counters from userspace is not supported on this architecture");
+#endif
+	}
+
+	// Read the "io_uring" option
+	reader.reset();
+	if (config.configOptionExists(name + ".io_uring") > 0 && config.getConfigOptionBool(name + ".io_uring")) {
+		reader.reset(new OS::BatchReader());
+		context.info("  - " + name + ".io_uring = true");
+		if (!reader->isAsync()) context.warn("  - io_uring is not available, falling back to read()");
+	}
+
 	// Read and parse the "valtype" option
 	if (config.configOptionExists(name + ".valtype") > 0) {
 		try {
@@ -92,12 +257,36 @@ void Main::init() {
 Configuration::configopts Main::getConfigOpts() {
 	Configuration::configopts result;
 
-	result.push_back(Configuration::configopt("sensor", QStringList(sensor.name)));
+	QStringList names;
+	for (const auto &sensor : sensors) names.append(sensor.name);
+	result.push_back(Configuration::configopt("sensor", names));
+
+	if (sensors.size() > 1) {
+		result.push_back(Configuration::configopt("combine", QStringList(showCombine(combine))));
+	}
 
 	if (!processors.isEmpty()) {
 		result.push_back(Configuration::configopt("processors", Tools::showInts(processors)));
 	}
 
+	result.push_back(Configuration::configopt("scope", QStringList(showMonscope(valscope))));
+
+	if (mode == SAMPLE) {
+		result.push_back(Configuration::configopt("mode", QStringList(showMode(mode))));
+		result.push_back(Configuration::configopt("sample_period", QStringList(QString::number(sample_period))));
+		result.push_back(Configuration::configopt("sample_type", showSampleType(sample_type)));
+		result.push_back(Configuration::configopt("metric", QStringList(showMetric(metric))));
+		result.push_back(Configuration::configopt("buffer_pages", QStringList(QString::number(buffer_pages))));
+	}
+
+	if (rdpmc) {
+		result.push_back(Configuration::configopt("rdpmc", QStringList("true")));
+	}
+
+	if (reader != nullptr) {
+		result.push_back(Configuration::configopt("io_uring", QStringList("true")));
+	}
+
 	if (valtype != PerformanceMonitor::UNKNOWN) {
 		result.push_back(Configuration::configopt("valtype", QStringList(showMontype(valtype))));
 	}
@@ -106,29 +295,63 @@ Configuration::configopts Main::getConfigOpts() {
 }
 
 void Main::start(int thread) {
-	// If we already have a monitor for that thread, disable, reset, and re-enable it.
+	QMutexLocker locker(&access_mutex);
+
+	// In sampling mode, the events of the whole process are already running, so only the
+	// histograms of the thread are reset.
+	if (mode == SAMPLE) {
+		if (sample_buffers.empty()) {
+			context.report(Error::MONITOR, "create", name + ".start(" + QString::number(thread) +
+														 ") failed: The samples of the process are not available.");
+			return;
+		}
+
+		// Samples taken before the start don't belong to the measurement.
+		drainSamples();
+		if (sample_threads.isEmpty()) lines.clear();
+		sample_threads[thread] = ThreadSamples();
+		return;
+	}
+
+	// In process and system scope, all threads share the same counters, so just remember their
+	// current values as the start of the measurement of this thread.
+	if (valscope != THREAD) {
+		double process_coverage;
+		if (process_groups.isEmpty() || !readGroups(process_groups, baselines[thread], process_coverage)) {
+			baselines.remove(thread);
+			context.report(Error::MONITOR, "create", name + ".start(" + QString::number(thread) +
+														 ") failed: The counters of the process are not available.");
+		}
+		return;
+	}
+
+	// If we already have a monitor for that thread, disable, reset, and re-enable it. All operations on the group
+	// leaders affect the whole group.
 	if (threads.contains(thread)) {
 		// First disable all monitors for that thread.
-		for (auto fd : threads[thread]) {
-			if (ioctl(fd, PERF_EVENT_IOC_DISABLE) == -1) {
+		for (const auto &group : threads[thread]) {
+			if (ioctl(group.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP) == -1) {
 				context.report(Error::MONITOR, "reset",
 							   name + ".start(" + QString::number(thread) + ") failed: Could not disable monitor.");
 				return;
 			}
 		}
 
-		// Then reset them all to zero.
-		for (auto fd : threads[thread]) {
-			if (ioctl(fd, PERF_EVENT_IOC_RESET) == -1) {
+		// Then reset them all to zero. Resetting doesn't affect the enabled and running times, so remember them as
+		// the start of the new measurement.
+		for (auto &group : threads[thread]) {
+			if (ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) == -1 || !readGroup(group)) {
 				context.report(Error::MONITOR, "reset",
 							   name + ".start(" + QString::number(thread) + ") failed: Could not reset monitor.");
 				return;
 			}
+			group.enabled = buffer[1];
+			group.running = buffer[2];
 		}
 
 		// Finally re-enable them all.
-		for (auto fd : threads[thread]) {
-			if (ioctl(fd, PERF_EVENT_IOC_ENABLE) == -1) {
+		for (const auto &group : threads[thread]) {
+			if (ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == -1) {
 				context.report(Error::MONITOR, "reset",
 							   name + ".start(" + QString::number(thread) + ") failed: Could not re-enable monitor.");
 				return;
@@ -136,87 +359,78 @@ void Main::start(int thread) {
 		}
 		// Otherwise create a new monitor and enable it.
 	} else {
-		// Create a new monitor on all the processors specified either by the user or by the sensor itself. If none are
-		// specified, monitor all processors.
-		QList<int> tmp;
-		tmp << -1;
-		if (!processors.isEmpty())
-			tmp = processors;
-		else if (!sensor.processors.isEmpty())
-			tmp = sensor.processors;
-		for (auto processor : tmp) {
-			int fd;
-
-			/*
-			 * Creating a new counter by calling perf_event_open(2)
-			 * ----------------------------------------------------
-			 *
-			 * The first argument (attr) is set to the address of the struct stored
-			 * in "sensor.attr" variable which has hopefully been set up correctly
-			 * by the init() function.
-			 *
-			 * The second argument (pid) is set to the thread id (TID) we received,
-			 * which instructs the kernel to monitor just this specific thread.
-			 * However, for some counters (for example RAPL counters) this will not
-			 * work, because they are "uncore by nature" [0,1] and cannot
-			 * differentiate between threads (or even processor cores on the same
-			 * socket). So, if thread-specific monitoring fails, we just emit a
-			 * warning and try again with the second argument set to -1, which tells
-			 * the kernel to measure all processes/threads.
-			 *
-			 * [0]
-			 *     http://git.kernel.org/cgit/linux/kernel/git/torvalds/linux.git/commit?id=4788e5b4b2338f85fa42a712a182d8afd65d7c58
-			 * [1] http://en.wikipedia.org/wiki/Uncore
-			 *
-			 * The third argument (cpu) is set to value of the "processor" variable
-			 * which iterates of either a user-supplied list of processors, a list
-			 * automatically determined by the sensor config and read from the
-			 * "sensor.processors" variable, or the special list which just contains
-			 * one value, -1. In the last case we create just one counter which will
-			 * monitor all processors combined. However, setting both the second and
-			 * third argument to -1 (which would mean something like "monitor all
-			 * processes/threads on all processors") is invalid and will return an
-			 * error. It is therefore absolutely necessary that all counters which
-			 * don't support thread-specific monitoring (and therefore require the
-			 * second argument to be -1) have access to a correctly set up list of
-			 * processors to monitor, either supplied by user or automatically
-			 * determined.
-			 *
-			 * The fourth argument (group_fd) is always set to -1, which tells the
-			 * kernel to create a new group for every counter because grouping
-			 * counters together (so that they start and stop at the same time and
-			 * therefore actually monitor the same time interval) does not seem to
-			 * work reliably, especially with counters which also don't support
-			 * thread-specific monitoring. However, since all the counters are first
-			 * created in a disabled state and then enabled in one batch, this
-			 * shouldn't matter too much, unless the measurement time is really
-			 * small or you start comparing or dividing the indivual results, which
-			 * you shouldn't do anyway (adding them is fine though).
-			 *
-			 * The fifth argument (flags) is always 0 because we don't need any of
-			 * the available flags.
-			 */
-
-			// First try to create the monitor restricted to a specific thread.
-			if ((fd = perf_event_open(&sensor.attr, thread, processor, -1, 0)) >= 0) {
-				threads[thread].append(fd);
-				// Then try to create the monitor system-wide.
-			} else if ((fd = perf_event_open(&sensor.attr, -1, processor, -1, 0)) >= 0) {
-				context.debug(name + ".start(" + QString::number(thread) +
-							  "): Could not restrict monitor to a specific thread (" + QString(strerror(errno)) + ").");
-				threads[thread].append(fd);
-				// Finally give up.
-			} else {
-				context.report(Error::MONITOR, "create", name + ".start(" + QString::number(thread) +
-															 ") failed: Could not create monitor (" +
-															 QString(strerror(errno)) + ").");
-				return;
+		QList<Group> &groups = threads[thread];
+
+		for (int index = 0; index < sensors.size(); index++) {
+			// Create a new monitor on all the processors specified either by the user or by the sensor itself. If
+			// none are specified, monitor all processors.
+			for (auto processor : getProcessors(index)) {
+				/*
+				 * Creating a new counter by calling perf_event_open(2)
+				 * ----------------------------------------------------
+				 *
+				 * The first argument (attr) is set to the address of a copy of the
+				 * struct stored in "sensors[index].attr" which has hopefully been set
+				 * up correctly by the init() function.
+				 *
+				 * The second argument (pid) is set to the thread id (TID) we received,
+				 * which instructs the kernel to monitor just this specific thread.
+				 * However, for some counters (for example RAPL counters) this will not
+				 * work, because they are "uncore by nature" [0,1] and cannot
+				 * differentiate between threads (or even processor cores on the same
+				 * socket). So, if thread-specific monitoring fails, we just emit a
+				 * warning and try again with the second argument set to -1, which tells
+				 * the kernel to measure all processes/threads.
+				 *
+				 * [0]
+				 *     http://git.kernel.org/cgit/linux/kernel/git/torvalds/linux.git/commit?id=4788e5b4b2338f85fa42a712a182d8afd65d7c58
+				 * [1] http://en.wikipedia.org/wiki/Uncore
+				 *
+				 * The third argument (cpu) is set to value of the "processor" variable
+				 * which iterates of either a user-supplied list of processors, a list
+				 * automatically determined by the sensor config and read from the
+				 * "sensors[index].processors" variable, or the special list which just
+				 * contains one value, -1. In the last case we create just one counter
+				 * which will monitor all processors combined. However, setting both the
+				 * second and third argument to -1 (which would mean something like
+				 * "monitor all processes/threads on all processors") is invalid and will
+				 * return an error. It is therefore absolutely necessary that all
+				 * counters which don't support thread-specific monitoring (and therefore
+				 * require the second argument to be -1) have access to a correctly set
+				 * up list of processors to monitor, either supplied by user or
+				 * automatically determined.
+				 *
+				 * The fourth argument (group_fd) is set to the leader of an existing
+				 * group for the same thread and processor, so that all sensors are
+				 * started and stopped at the same time and can be read with a single
+				 * read(). Sensors which cannot be grouped (e.g. because they belong to
+				 * a different PMU) get a group of their own.
+				 *
+				 * The fifth argument (flags) is always 0 because we don't need any of
+				 * the available flags.
+				 */
+
+				// First try to create the monitor restricted to a specific thread.
+				if (openCounter(index, thread, processor, groups)) {
+					continue;
+					// Then try to create the monitor system-wide.
+				} else if (openCounter(index, -1, processor, groups)) {
+					context.debug(name + ".start(" + QString::number(thread) +
+								  "): Could not restrict monitor to a specific thread (" + QString(strerror(errno)) +
+								  ").");
+					// Finally give up.
+				} else {
+					context.report(Error::MONITOR, "create", name + ".start(" + QString::number(thread) +
+																 ") failed: Could not create monitor (" +
+																 QString(strerror(errno)) + ").");
+					return;
+				}
 			}
 		}
 
 		// All monitors have been successfully created, it's time to enable them.
-		for (auto fd : threads[thread]) {
-			if (ioctl(fd, PERF_EVENT_IOC_ENABLE) == -1) {
+		for (const auto &group : groups) {
+			if (ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == -1) {
 				context.report(Error::MONITOR, "start",
 							   name + ".start(" + QString::number(thread) + ") failed: Could not enable monitor.");
 				return;
@@ -225,7 +439,285 @@ void Main::start(int thread) {
 	}
 }
 
+QList<int> Main::getProcessors(int sensor) const {
+	if (!processors.isEmpty()) return processors;
+	if (!sensors[sensor].processors.isEmpty()) return sensors[sensor].processors;
+
+	QList<int> result;
+	result << -1;
+	return result;
+}
+
+bool Main::openCounter(int sensor, pid_t pid, int processor, QList<Group> &groups) {
+	perf_event_attr attr = sensors[sensor].attr;
+
+	// In process scope, threads created later on inherit the counters of their parent and the
+	// kernel adds up their values when reading the counters of the parent.
+	attr.inherit = (valscope == PROCESS && pid != -1) ? 1 : 0;
+	attr.read_format =
+		PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	// Only the group leader starts disabled, the other counters follow the state of the leader.
+	int fd = -1, group_index = -1;
+	attr.disabled = 0;
+	for (int i = 0; i < groups.size() && fd < 0; i++) {
+		if (groups[i].pid != pid || groups[i].processor != processor) continue;
+
+		fd = perf_event_open(&attr, pid, processor, groups[i].leader, 0);
+		if (fd >= 0) group_index = i;
+	}
+
+	if (fd < 0) {
+		attr.disabled = 1;
+		fd = perf_event_open(&attr, pid, processor, -1, 0);
+		if (fd < 0) return false;
+
+		Group group;
+		group.leader = fd;
+		group.pid = pid;
+		group.processor = processor;
+		if (pid != -1 && pid == syscall(__NR_gettid)) group.owner = pid;
+		groups.append(group);
+		group_index = groups.size() - 1;
+	}
+
+	uint64_t id = 0;
+	if (ioctl(fd, PERF_EVENT_IOC_ID, &id) == -1) {
+		int error = errno;
+		if (groups[group_index].leader == fd) groups.removeAt(group_index);
+		close(fd);
+		errno = error;
+		return false;
+	}
+
+	// The perf page of a counter can only be used to read it if it counts on the processor
+	// which reads it, i.e. if it monitors the calling thread or is bound to a processor.
+	perf_event_mmap_page *page = nullptr;
+	if (rdpmc && !attr.inherit && (groups[group_index].owner != -1 || (pid == -1 && processor != -1))) {
+		void *addr = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+		if (addr != MAP_FAILED) page = static_cast<perf_event_mmap_page *>(addr);
+	}
+
+	Group &group = groups[group_index];
+	group.fds.append(fd);
+	group.ids.append(id);
+	group.sensors.append(sensor);
+	group.pages.append(page);
+
+	// Reading a group returns the number of counters and the enabled and running times, followed by a value and an id
+	// for every counter.
+	size_t size = 3 + 2 * group.fds.size();
+	if (buffer.size() < size) buffer.resize(size);
+
+	return true;
+}
+
+QList<int> Main::getTasks(int pid) const {
+	QList<int> result;
+	QDir dir(OS::SystemPaths::procfs("/" + QString::number(pid) + "/task"));
+	for (const auto &entry : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+		bool ok;
+		int task = entry.toInt(&ok);
+		if (ok) result.append(task);
+	}
+	if (result.isEmpty()) result.append(pid);
+
+	return result;
+}
+
+bool Main::openProcess(int pid) {
+	// Counters are only inherited by threads which are created after the counters have been
+	// opened, so all threads which already exist need counters of their own. These are only
+	// opened for counters on all processors, as counters bound to processors would need one
+	// counter per thread and processor. Threads which exist at that time are then not counted
+	// apart from the main thread.
+	QList<int> tasks = getTasks(pid);
+
+	for (int index = 0; index < sensors.size(); index++) {
+		for (auto processor : getProcessors(index)) {
+			// In system scope, the counters are opened only once for every processor. Counters
+			// which count on all processors at once can't count system-wide, so they are opened
+			// on every online processor instead.
+			if (valscope == SYSTEM) {
+				std::vector<int> cpus(1, processor);
+				if (processor == -1) {
+					cpus = OS::CpuInfo::parseSysRangeFile(OS::SystemPaths::sysfs("/devices/system/cpu/online"));
+				}
+
+				for (auto cpu : cpus) {
+					if (!openCounter(index, -1, cpu, process_groups)) return false;
+				}
+				continue;
+			}
+
+			QList<int> targets = tasks;
+			if (processor != -1) targets = QList<int>() << pid;
+
+			for (auto task : targets) {
+				if (openCounter(index, task, processor, process_groups)) continue;
+
+				// The thread may have exited in the meantime.
+				if (errno == ESRCH) continue;
+
+				// Sensors which cannot be restricted to a thread (uncore PMUs) count system-wide,
+				// which covers all threads at once.
+				if (errno != EINVAL && errno != EOPNOTSUPP) return false;
+				if (!openCounter(index, -1, processor, process_groups)) return false;
+				context.debug(name + ".setObservedProcessPid(" + QString::number(pid) +
+							  "): Could not restrict monitor to the process (" + QString(strerror(errno)) + ").");
+				break;
+			}
+		}
+	}
+
+	for (const auto &group : process_groups) {
+		if (ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == -1) return false;
+	}
+
+	return true;
+}
+
+bool Main::openSampling(int pid) {
+	// Sample on the configured processors or, as inherited events cannot be opened for all
+	// processors at once, on every online processor.
+	QList<int> cpus = getProcessors(0);
+	if (cpus.contains(-1)) {
+		cpus.clear();
+		for (int cpu : OS::CpuInfo::parseSysRangeFile(OS::SystemPaths::sysfs("/devices/system/cpu/online"))) {
+			cpus.append(cpu);
+		}
+	}
+
+	perf_event_attr attr = sensors[0].attr;
+	attr.sample_period = sample_period;
+	attr.sample_type = sample_type | PERF_SAMPLE_TID;
+	attr.read_format = 0;
+	attr.inherit = 1;
+	attr.disabled = 1;
+
+	QList<int> tasks = getTasks(pid);
+	for (auto cpu : cpus) {
+		// All events on a processor write into the ring buffer of the first one.
+		int output = -1;
+		for (auto task : tasks) {
+			int fd = perf_event_open(&attr, task, cpu, -1, 0);
+			if (fd == -1) {
+				// The thread may have exited in the meantime.
+				if (errno == ESRCH) continue;
+				return false;
+			}
+			sample_fds.append(fd);
+
+			if (output == -1) {
+				std::unique_ptr<SampleBuffer> buffer(new SampleBuffer(fd, attr.sample_type));
+				if (!buffer->map(buffer_pages)) return false;
+				sample_buffers.push_back(std::move(buffer));
+				output = fd;
+			} else if (ioctl(fd, PERF_EVENT_IOC_SET_OUTPUT, output) == -1) {
+				return false;
+			}
+		}
+	}
+
+	for (auto fd : sample_fds) {
+		if (ioctl(fd, PERF_EVENT_IOC_ENABLE, 0) == -1) return false;
+	}
+
+	return true;
+}
+
+void Main::drainSamples() {
+	SampleBuffer::Sample sample;
+	for (auto &buffer : sample_buffers) {
+		while (buffer->next(sample)) {
+			// Cache lines are tracked for all threads, so that sharing with threads which are
+			// not monitored is noticed as well. Rarely sampled lines are evicted once the
+			// histogram is full, so that new lines are still tracked in long measurements.
+			int32_t owner = Histogram::shared;
+			if (sample.addr != 0) {
+				if (lines.isFull()) lines.age();
+				owner = lines.add(sample.addr >> 6, sample.tid);
+			}
+
+			auto it = sample_threads.find(sample.tid);
+			if (it == sample_threads.end()) continue;
+
+			it->samples++;
+			it->ips.add(sample.ip);
+			if (sample.addr != 0) {
+				it->addresses++;
+				if (owner == Histogram::shared) it->shared++;
+			}
+		}
+	}
+}
+
+double Main::getMetric(const ThreadSamples &samples) const {
+	switch (metric) {
+	case HOTSPOT:
+		return samples.samples != 0 ? (double)samples.ips.getMax() / samples.samples : 0;
+	case SHARED:
+		return samples.addresses != 0 ? (double)samples.shared / samples.addresses : 0;
+	default:
+		return samples.samples;
+	}
+}
+
+void Main::start(ProcessTree::autopin_tid_list tasks) {
+	QMutexLocker locker(&access_mutex);
+
+	if (mode == SAMPLE || valscope == THREAD || tasks.empty()) {
+		PerformanceMonitor::start(tasks);
+		return;
+	}
+
+	// All threads share the counters, so they are read once and the values are the baseline of every thread.
+	std::vector<double> baseline;
+	double process_coverage;
+	if (process_groups.isEmpty() || !readGroups(process_groups, baseline, process_coverage)) {
+		for (const auto &task : tasks) baselines.remove(task);
+		context.report(Error::MONITOR, "create", name + ".start(" + QString::number(*tasks.begin()) +
+													 ") failed: The counters of the process are not available.");
+		return;
+	}
+
+	for (const auto &task : tasks) baselines[task] = baseline;
+}
+
 double Main::value(int thread) {
+	QMutexLocker locker(&access_mutex);
+
+	if (mode == SAMPLE) {
+		drainSamples();
+
+		auto it = sample_threads.constFind(thread);
+		if (it == sample_threads.constEnd()) {
+			context.report(Error::MONITOR, "value",
+						   name + ".value(" + QString::number(thread) + ") failed: Thread is not being monitored.");
+			return 0;
+		}
+
+		return getMetric(it.value());
+	}
+
+	if (valscope != THREAD) {
+		auto it = baselines.constFind(thread);
+		if (it == baselines.constEnd()) {
+			context.report(Error::MONITOR, "value",
+						   name + ".value(" + QString::number(thread) + ") failed: Thread is not being monitored.");
+			return 0;
+		}
+
+		if (!readGroups(process_groups, sensor_values, coverages[thread])) {
+			context.report(Error::MONITOR, "value",
+						   name + ".value(" + QString::number(thread) + ") failed: Could not read from monitor.");
+			return 0;
+		}
+
+		for (size_t i = 0; i < sensor_values.size(); i++) sensor_values[i] -= it.value()[i];
+		return combineValues(sensor_values);
+	}
+
 	// Check if we are actually monitoring that thread. If not, error out.
 	if (!threads.contains(thread)) {
 		context.report(Error::MONITOR, "value",
@@ -233,33 +725,377 @@ double Main::value(int thread) {
 		return 0;
 	}
 
-	double result = 0;
+	double &thread_coverage = coverages[thread];
+	if (!readGroups(threads[thread], sensor_values, thread_coverage)) {
+		context.report(Error::MONITOR, "value",
+					   name + ".value(" + QString::number(thread) + ") failed: Could not read from monitor.");
+		return 0;
+	}
+
+	return combineValues(sensor_values);
+}
+
+void Main::values(const int *tids, size_t count, value_batch &result) {
+	QMutexLocker locker(&access_mutex);
 
-	// Summarize the values of all counters which we have created for that thread. This
+	result.resize(count);
+
+	// In sampling mode, the ring buffers are drained only once for the whole batch.
+	if (mode == SAMPLE) {
+		drainSamples();
+		int64_t timestamp = getTimestamp();
+
+		for (size_t i = 0; i < count; i++) {
+			auto it = sample_threads.constFind(tids[i]);
+			bool ok = it != sample_threads.constEnd();
+
+			result.values[i] = ok ? getMetric(it.value()) : 0;
+			result.timestamps[i] = ok ? timestamp : 0;
+			result.status[i] = ok ? VALUE_OK : VALUE_UNMONITORED;
+			result.coverage[i] = ok ? 1.0 : 0;
+		}
+
+		return;
+	}
+
+	// In process and system scope, the counters are read only once for the whole batch.
+	if (valscope != THREAD) {
+		double process_coverage = 0;
+		bool ok = !baselines.isEmpty() && readGroups(process_groups, process_values, process_coverage);
+		int64_t timestamp = getTimestamp();
+		sensor_values.resize(sensors.size());
+
+		for (size_t i = 0; i < count; i++) {
+			auto it = baselines.constFind(tids[i]);
+			if (it == baselines.constEnd()) {
+				result.values[i] = 0;
+				result.timestamps[i] = 0;
+				result.status[i] = VALUE_UNMONITORED;
+				result.coverage[i] = 0;
+				continue;
+			}
+
+			if (ok) {
+				for (size_t j = 0; j < process_values.size(); j++) sensor_values[j] = process_values[j] - it.value()[j];
+				coverages[tids[i]] = process_coverage;
+			}
+
+			result.values[i] = ok ? combineValues(sensor_values) : 0;
+			result.timestamps[i] = timestamp;
+			result.status[i] = ok ? VALUE_OK : VALUE_FAILED;
+			result.coverage[i] = ok ? process_coverage : 0;
+		}
+
+		return;
+	}
+
+	if (reader != nullptr) {
+		valuesBatched(tids, count, result);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		// A single lookup per thread, unmonitored threads are not an error in a batch.
+		auto it = threads.constFind(tids[i]);
+		if (it == threads.constEnd()) {
+			result.values[i] = 0;
+			result.timestamps[i] = 0;
+			result.status[i] = VALUE_UNMONITORED;
+			result.coverage[i] = 0;
+			continue;
+		}
+
+		double &thread_coverage = coverages[tids[i]];
+		bool ok = readGroups(it.value(), sensor_values, thread_coverage);
+
+		result.values[i] = ok ? combineValues(sensor_values) : 0;
+		result.timestamps[i] = getTimestamp();
+		result.status[i] = ok ? VALUE_OK : VALUE_FAILED;
+		result.coverage[i] = ok ? thread_coverage : 0;
+	}
+}
+
+void Main::valuesBatched(const int *tids, size_t count, value_batch &result) {
+	// Reserve space for the data of all groups first, so that the buffers stay valid while
+	// the reads are queued.
+	size_t words = 0;
+	for (size_t i = 0; i < count; i++) {
+		auto it = threads.constFind(tids[i]);
+		if (it == threads.constEnd()) continue;
+
+		for (const auto &group : it.value()) words += 3 + 2 * group.fds.size();
+	}
+	if (batch_data.size() < words) batch_data.resize(words);
+
+	reader->clear();
+	batch_requests.clear();
+	size_t offset = 0;
+	for (size_t i = 0; i < count; i++) {
+		auto it = threads.constFind(tids[i]);
+		if (it != threads.constEnd()) queueGroups(it.value(), offset);
+	}
+
+	reader->submit();
+	int64_t timestamp = getTimestamp();
+
+	// Evaluate the groups in the same order as they have been queued.
+	offset = 0;
+	size_t request = 0;
+	for (size_t i = 0; i < count; i++) {
+		auto it = threads.constFind(tids[i]);
+		if (it == threads.constEnd()) {
+			result.values[i] = 0;
+			result.timestamps[i] = 0;
+			result.status[i] = VALUE_UNMONITORED;
+			result.coverage[i] = 0;
+			continue;
+		}
+
+		double &thread_coverage = coverages[tids[i]];
+		bool ok = addQueuedGroups(it.value(), offset, request, sensor_values, thread_coverage);
+
+		result.values[i] = ok ? combineValues(sensor_values) : 0;
+		result.timestamps[i] = timestamp;
+		result.status[i] = ok ? VALUE_OK : VALUE_FAILED;
+		result.coverage[i] = ok ? thread_coverage : 0;
+	}
+}
+
+void Main::queueGroups(const QList<Group> &groups, size_t &offset) {
+	// Queue a read for every group which cannot be read from userspace.
+	for (const auto &group : groups) {
+		size_t size = 3 + 2 * group.fds.size();
+		if (rdpmc && readPages(group)) {
+			std::copy(buffer.begin(), buffer.begin() + size, batch_data.begin() + offset);
+			batch_requests.push_back(-1);
+		} else {
+			batch_requests.push_back(reader->add(group.leader, &batch_data[offset], size * sizeof(uint64_t)));
+		}
+		offset += size;
+	}
+}
+
+bool Main::addQueuedGroups(const QList<Group> &groups, size_t &offset, size_t &request, std::vector<double> &result,
+						   double &coverage) {
+	bool ok = true;
+	result.assign(sensors.size(), 0);
+	coverage = 1.0;
+
+	// All groups are skipped, even after a failed read, so that the following groups stay in sync.
+	for (const auto &group : groups) {
+		size_t size = 3 + 2 * group.fds.size();
+		ssize_t id = batch_requests[request++];
+		if (id != -1 && reader->getResult(id) != (ssize_t)(size * sizeof(uint64_t))) ok = false;
+		if (ok) addGroup(group, &batch_data[offset], result, coverage);
+		offset += size;
+	}
+
+	return ok;
+}
+
+double Main::coverage(int thread) {
+	QMutexLocker locker(&access_mutex);
+
+	// Samples are not multiplexed, they are either taken or lost.
+	if (mode == SAMPLE) return sample_threads.contains(thread) ? 1.0 : 0;
+
+	// Threads which haven't been read yet have no coverage at all.
+	return coverages.value(thread, 0);
+}
+
+bool Main::readGroup(const Group &group) {
+	// Reading from userspace fails whenever a counter is not active on this processor, so fall
+	// back to the syscall in that case.
+	if (rdpmc && readPages(group)) return true;
+
+	size_t size = (3 + 2 * group.fds.size()) * sizeof(uint64_t);
+	return read(group.leader, buffer.data(), size) == (ssize_t)size;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+static inline uint64_t rdpmc_read(uint32_t counter) {
+	uint32_t low, high;
+	asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+	return low | ((uint64_t)high) << 32;
+}
+
+static inline uint64_t rdtsc_read() {
+	uint32_t low, high;
+	asm volatile("rdtsc" : "=a"(low), "=d"(high));
+	return low | ((uint64_t)high) << 32;
+}
+#endif
+
+/*!
+ * \brief Reads a counter from its perf page as described in linux/perf_event.h
+ *
+ * \return true on success, false if the counter is not active on this processor
+ */
+static bool readPage(const volatile perf_event_mmap_page *page, uint64_t &count, uint64_t &enabled,
+					 uint64_t &running) {
+#if defined(__i386__) || defined(__x86_64__)
+	uint32_t seq;
+	do {
+		seq = page->lock;
+		asm volatile("" ::: "memory");
+
+		uint32_t index = page->index;
+		if (!page->cap_user_rdpmc || !page->cap_user_time || index == 0) return false;
+
+		enabled = page->time_enabled;
+		running = page->time_running;
+
+		// The times are only updated by the kernel when the counter is scheduled, so add the
+		// time since then. The counter is active, so it has been running all of that time.
+		uint64_t cycles = rdtsc_read();
+		uint16_t shift = page->time_shift;
+		uint64_t mult = page->time_mult;
+		uint64_t quot = cycles >> shift;
+		uint64_t rem = cycles & (((uint64_t)1 << shift) - 1);
+		uint64_t delta = page->time_offset + quot * mult + ((rem * mult) >> shift);
+		enabled += delta;
+		running += delta;
+
+		// The hardware counter is narrower than 64 bits and has to be sign extended.
+		uint16_t width = page->pmc_width;
+		int64_t pmc = rdpmc_read(index - 1);
+		pmc <<= 64 - width;
+		pmc >>= 64 - width;
+		count = page->offset + pmc;
+
+		asm volatile("" ::: "memory");
+	} while (page->lock != seq);
+
+	return true;
+#else
+	(void)page;
+	(void)count;
+	(void)enabled;
+	(void)running;
+	return false;
+#endif
+}
+
+bool Main::readPages(const Group &group) {
+	// The counters of a thread are only active while that thread runs, so they can only be read
+	// from userspace by the thread itself. Other threads, e.g. the sampler, use the syscall.
+	if (group.pid != -1 && group.owner != syscall(__NR_gettid)) return false;
+
+	// rdpmc reads the counters of the processor it is executed on, so make sure the reading
+	// thread hasn't been migrated in the meantime.
+	int processor = sched_getcpu();
+	if (group.processor != -1 && group.processor != processor) return false;
+
+	buffer[0] = group.fds.size();
+	for (int j = 0; j < group.fds.size(); j++) {
+		uint64_t count, enabled, running;
+		if (group.pages[j] == nullptr || !readPage(group.pages[j], count, enabled, running)) return false;
+
+		if (j == 0) {
+			buffer[1] = enabled;
+			buffer[2] = running;
+		}
+		buffer[3 + 2 * j] = count;
+		buffer[4 + 2 * j] = group.ids[j];
+	}
+
+	return sched_getcpu() == processor;
+}
+
+bool Main::closeGroup(const Group &group) {
+	bool result = true;
+
+	for (int j = 0; j < group.fds.size(); j++) {
+		if (group.pages[j] != nullptr) munmap(group.pages[j], sysconf(_SC_PAGESIZE));
+		if (close(group.fds[j]) == -1) result = false;
+	}
+
+	return result;
+}
+
+bool Main::readGroups(const QList<Group> &groups, std::vector<double> &result, double &coverage) {
+	// The groups of the process (one per processor in system scope) are read with a single batch.
+	if (reader != nullptr && groups.size() > 1) {
+		size_t words = 0;
+		for (const auto &group : groups) words += 3 + 2 * group.fds.size();
+		if (batch_data.size() < words) batch_data.resize(words);
+
+		reader->clear();
+		batch_requests.clear();
+		size_t offset = 0;
+		queueGroups(groups, offset);
+		reader->submit();
+
+		size_t request = 0;
+		offset = 0;
+		return addQueuedGroups(groups, offset, request, result, coverage);
+	}
+
+	result.assign(sensors.size(), 0);
+	coverage = 1.0;
+
+	// Summarize the values of all groups which we have created for that thread. This
 	// makes sense, because we might have a counter which only counts on one processor core
-	// or socket, in which case the start() function has created one counter for every such
+	// or socket, in which case the start() function has created one group for every such
 	// unit.
-	for (auto fd : threads[thread]) {
-		uint64_t raw;
+	for (const auto &group : groups) {
+		if (!readGroup(group)) return false;
+		addGroup(group, buffer.data(), result, coverage);
+	}
 
-		// All counters return unsigned 64-bit integer values, which can be read one
-		// value at a time.
-		if (read(fd, &raw, sizeof(raw)) == -1) {
-			context.report(Error::MONITOR, "value",
-						   name + ".value(" + QString::number(thread) + ") failed: Could not read from monitor.");
-			return 0;
-		}
+	return true;
+}
+
+void Main::addGroup(const Group &group, const uint64_t *data, std::vector<double> &result, double &coverage) const {
+	// A single read returns the number of counters in the group and the times the group
+	// has been enabled and running, followed by the value and the id of every counter.
+	uint64_t nr = data[0];
+	uint64_t enabled = data[1] - group.enabled;
+	uint64_t running = data[2] - group.running;
+
+	// If there are more events than hardware counters, the kernel multiplexes them and the
+	// group only counts while it is scheduled. Extrapolate the values to the full time the
+	// group has been enabled. A group which hasn't been scheduled at all contributes nothing.
+	double factor = 1.0;
+	if (enabled > 0) {
+		factor = running > 0 ? (double)enabled / running : 0;
+		coverage = std::min(coverage, (double)running / enabled);
+	}
+
+	for (uint64_t j = 0; j < nr; j++) {
+		uint64_t raw = data[3 + 2 * j];
+		uint64_t id = data[4 + 2 * j];
+
+		// The kernel returns the counters in the order they have been added to the group,
+		// so the id almost always matches at the same position.
+		int counter = (j < (uint64_t)group.ids.size() && group.ids[j] == id) ? j : group.ids.indexOf(id);
+		if (counter == -1) continue;
 
 		// Some counters return values which need to be scaled before they can be used
-		// meaningfully. If this isn't the case, "sensor.scale" will be 1.0, so we can
+		// meaningfully. If this isn't the case, the scale will be 1.0, so we can
 		// safely multiply here.
-		result += raw * sensor.scale;
+		int sensor = group.sensors[counter];
+		result[sensor] += raw * sensors[sensor].scale * factor;
 	}
+}
 
-	return result;
+double Main::combineValues(const std::vector<double> &values) const {
+	switch (combine) {
+	case SUM: {
+		double result = 0;
+		for (auto value : values) result += value;
+		return result;
+	}
+	case RATIO:
+		return values[1] != 0 ? values[0] / values[1] : 0;
+	default:
+		return values.empty() ? 0 : values[0];
+	}
 }
 
 double Main::stop(int thread) {
+	QMutexLocker locker(&access_mutex);
+
 	// Before stopping the counter, get its value one last time...
 	double result = value(thread);
 	if (context.isError()) {
@@ -278,11 +1114,26 @@ double Main::stop(int thread) {
 }
 
 void Main::clear(int thread) {
+	QMutexLocker locker(&access_mutex);
+
+	// In sampling mode, the events stay open for threads which are started later on.
+	if (mode == SAMPLE) {
+		sample_threads.remove(thread);
+		return;
+	}
+
+	// In process and system scope, the counters stay open for threads which are started later on.
+	if (valscope != THREAD) {
+		baselines.remove(thread);
+		coverages.remove(thread);
+		return;
+	}
+
 	// Check if we are actually monitoring that thread. If not, just silently ignore it.
 	if (threads.contains(thread)) {
 		// Close all the counters which have been created for that thread.
-		for (auto fd : threads[thread]) {
-			if (close(fd) == -1) {
+		for (const auto &group : threads[thread]) {
+			if (!closeGroup(group)) {
 				context.report(Error::MONITOR, "stop", name + ".clear(" + QString::number(thread) +
 														   ") failed: Could not close a file descriptor (" +
 														   QString(strerror(errno)) + ").");
@@ -290,10 +1141,13 @@ void Main::clear(int thread) {
 			}
 		}
 		threads.remove(thread);
+		coverages.remove(thread);
 	}
 }
 
 ProcessTree::autopin_tid_list Main::getMonitoredTasks() {
+	QMutexLocker locker(&access_mutex);
+
 	ProcessTree::autopin_tid_list result;
 
 	// Iterate over our thread id -> file descriptors map to get a list of all threads which
@@ -302,12 +1156,64 @@ ProcessTree::autopin_tid_list Main::getMonitoredTasks() {
 		result.insert(thread);
 	}
 
+	for (auto thread : baselines.keys()) {
+		result.insert(thread);
+	}
+
+	for (auto thread : sample_threads.keys()) {
+		result.insert(thread);
+	}
+
 	return result;
 }
 
+void Main::setObservedProcessPid(int pid) {
+	QMutexLocker locker(&access_mutex);
+
+	PerformanceMonitor::setObservedProcessPid(pid);
+
+	if (mode == SAMPLE) {
+		// Threads created later on inherit the events, so open them as early as possible.
+		if (!openSampling(pid)) {
+			context.report(Error::MONITOR, "create", name + ".setObservedProcessPid(" + QString::number(pid) +
+														 ") failed: Could not create sampling monitor (" +
+														 QString(strerror(errno)) + ").");
+			return;
+		}
+
+		context.debug(name + ".setObservedProcessPid(" + QString::number(pid) + "): Opened " +
+					  QString::number(sample_fds.size()) + " sampling events with " +
+					  QString::number(sample_buffers.size()) + " ring buffers.");
+		return;
+	}
+
+	if (valscope == THREAD) return;
+
+	// The observed process has just been started, so the counters are inherited by almost all of its threads.
+	if (!openProcess(pid)) {
+		context.report(Error::MONITOR, "create", name + ".setObservedProcessPid(" + QString::number(pid) +
+													 ") failed: Could not create monitor (" + QString(strerror(errno)) +
+													 ").");
+		return;
+	}
+
+	int count = 0;
+	for (const auto &group : process_groups) count += group.fds.size();
+	context.debug(name + ".setObservedProcessPid(" + QString::number(pid) + "): Opened " + QString::number(count) +
+				  " counters for the process.");
+}
+
 QString Main::getUnit() {
-	// Return the unit as configured by the sensor.
-	return sensor.unit;
+	// Return the unit as configured by the first sensor, a ratio of two sensors has no unit.
+	if (mode == SAMPLE || combine == RATIO || sensors.isEmpty()) return "";
+	return sensors[0].unit;
+}
+
+bool Main::isCumulative() {
+	// Ratios of two sensors and the fractions reported by the sample metrics are independent
+	// of the length of the measurement.
+	if (mode == SAMPLE) return metric == SAMPLES;
+	return combine != RATIO;
 }
 
 Sensor Main::readSensor(const QString &input) {
@@ -337,258 +1243,7 @@ Sensor Main::readSensor(const QString &input) {
 	// Set the name of the sensor the string we received as our input.
 	result.name = input;
 
-	if (input.startsWith("/")) {
-		// Support sensors described by files under "/sys/bus/event_source/devices/*/events/".
-
-		// Set result.attr.type
-		result.attr.type = Tools::readULong(Tools::readLine(QFileInfo(input).absolutePath() + "/../type"));
-
-		// Set result.atrr.config, sensor.attr.config1, result.attr.config2
-		for (QString selector : Tools::readLine(input).split(",")) {
-			std::pair<QString, QString> variable_value;
-
-			// Some selectors don't have a value associated with them, which means
-			// that they are just one bit which needs to be set.
-			try {
-				variable_value = Tools::readPair(selector, "=");
-			} catch (const Exception &e) {
-				variable_value.first = selector;
-				variable_value.second = "1";
-			}
-
-			auto variable = variable_value.first;
-			auto value = Tools::readULong(variable_value.second);
-			auto field_position =
-				Tools::readPair(Tools::readLine(QFileInfo(input).absolutePath() + "/../format/" + variable), ":");
-			auto field = field_position.first;
-			auto position = field_position.second;
-
-			// Some positions don't have a lower and upper bound because they are
-			// just one bit in which case the lower and upper bound are identical.
-			std::pair<QString, QString> lower_upper;
-
-			try {
-				lower_upper = Tools::readPair(position, "-");
-			} catch (const Exception &e) {
-				lower_upper.first = position;
-				lower_upper.second = position;
-			}
-
-			auto lower = Tools::readULong(lower_upper.first);
-			auto upper = Tools::readULong(lower_upper.second);
-
-			// Check if the value actually fits in the alloted space.
-			if (value >= 1UL << (upper - lower + 1)) {
-				throw Exception(name + ".readSensor(" + input + ") failed: Could not fit " + QString::number(value) +
-								" in " + QString::number(upper - lower + 1) + " bits.");
-			}
-
-			// We currently only support setting the various "config" fields in the
-			// perf_event_attr struct. However, the other fields all have special
-			// a special purpose and are not meant for selecting the desired
-			// counter, so this should be fine.
-			if (field == "config") {
-				result.attr.config |= value << lower;
-			} else if (field == "config1") {
-				result.attr.config1 |= value << lower;
-			} else if (field == "config2") {
-				result.attr.config2 |= value << lower;
-			} else {
-				throw Exception(name + ".readSensor(" + input + ") failed: Setting the " + field +
-								" field in the perf_event_attr struct is not supported.");
-			}
-		}
-
-		// Try to set result.scale. If this fails, we just ignore it silently since we
-		// have a sensible default.
-		try {
-			result.scale = Tools::readDouble(Tools::readLine(input + ".scale"));
-		} catch (const Exception &e) {
-		}
-
-		// Try to set result.unit. If this fails, we just ignore it silently since we
-		// have a sensible default.
-		try {
-			result.unit = Tools::readLine(input + ".unit");
-		} catch (const Exception &e) {
-		}
-
-		// Try to set result.processors. If this fails, we just ignore it silently
-		// since we have a sensible default.
-		try {
-			result.processors =
-				Tools::readInts(Tools::readLine(QFileInfo(input).absolutePath() + "/../cpumask").split(","));
-		} catch (const Exception &e) {
-		}
-	} else if (input.startsWith("hardware/")) {
-		// Support all hardware counters abstracted by the kernel.
-		result.attr.type = PERF_TYPE_HARDWARE;
-
-		if (input == "hardware/cpu-cycles") {
-			result.attr.config = PERF_COUNT_HW_CPU_CYCLES;
-		} else if (input == "hardware/instructions") {
-			result.attr.config = PERF_COUNT_HW_INSTRUCTIONS;
-		} else if (input == "hardware/cache-references") {
-			result.attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
-		} else if (input == "hardware/cache-misses") {
-			result.attr.config = PERF_COUNT_HW_CACHE_MISSES;
-		} else if (input == "hardware/branch-instructions") {
-			result.attr.config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS;
-		} else if (input == "hardware/branch-misses") {
-			result.attr.config = PERF_COUNT_HW_BRANCH_MISSES;
-		} else if (input == "hardware/bus-cycles") {
-			result.attr.config = PERF_COUNT_HW_BUS_CYCLES;
-		} else if (input == "hardware/stalled-cycles-frontend") {
-			result.attr.config = PERF_COUNT_HW_STALLED_CYCLES_FRONTEND;
-		} else if (input == "hardware/stalled-cycles-backend") {
-			result.attr.config = PERF_COUNT_HW_STALLED_CYCLES_BACKEND;
-		} else if (input == "hardware/ref-cpu-cycles") {
-			result.attr.config = PERF_COUNT_HW_REF_CPU_CYCLES;
-		} else {
-			throw Exception(name + ".readSensor(" + input + "): Unknown hardware sensor.");
-		}
-
-	} else if (input.startsWith("cache/")) {
-		// Support all cache counters abstracted by the kernel.
-
-		result.attr.type = PERF_TYPE_HW_CACHE;
-
-		if (input == "cache/l1d-read-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/l1d-read-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/l1d-write-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/l1d-write-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/l1d-prefetch-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/l1d-prefetch-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-
-		} else if (input == "cache/l1i-read-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/l1i-read-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/l1i-write-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/l1i-write-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/l1i-prefetch-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/l1i-prefetch-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-
-		} else if (input == "cache/ll-read-access") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/ll-read-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/ll-write-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/ll-write-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/ll-prefetch-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/ll-prefetch-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-
-		} else if (input == "cache/dtlb-read-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/dtlb-read-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/dtlb-write-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/dtlb-write-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/dtlb-prefetch-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/dtlb-prefetch-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-
-		} else if (input == "cache/itlb-read-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/itlb-read-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/itlb-write-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/itlb-write-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/itlb-prefetch-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/itlb-prefetch-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-
-		} else if (input == "cache/bpu-read-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_BPU | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/bpu-read-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_BPU | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/bpu-write-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_BPU | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/bpu-write-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_BPU | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/bpu-prefetch-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_BPU | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/bpu-prefetch-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_BPU | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-
-		} else if (input == "cache/node-read-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/node-read-miss") {
-			result.attr.config =
-				PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/node-write-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/node-write-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else if (input == "cache/node-prefetch-access") {
-			result.attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
-		} else if (input == "cache/node-prefetch-miss") {
-			result.attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_PREFETCH << 8) |
-								 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
-		} else {
-			throw Exception(name + ".readSensor(" + input + "): failed: Unknown cache sensor.");
-		}
-	} else if (input.startsWith("gate/")) {
+	if (input.startsWith("gate/")) {
 		// Support the sensors necessary for a full gate diagnostic.
 
 		// Set the "type" field.
@@ -750,34 +1405,6 @@ Sensor Main::readSensor(const QString &input) {
 
 		// Configure the remaining sensors.
 		readSensor("gate/" + QString::number(input.split("/")[1].toULong(nullptr, 0x24) + 1, 0x24));
-	} else if (input.startsWith("software/")) {
-		// Support all software counters provided by the kernel.
-
-		result.attr.type = PERF_TYPE_SOFTWARE;
-
-		if (input == "software/cpu-clock") {
-			result.attr.config = PERF_COUNT_SW_CPU_CLOCK;
-		} else if (input == "software/task-clock") {
-			result.attr.config = PERF_COUNT_SW_TASK_CLOCK;
-		} else if (input == "software/page-faults") {
-			result.attr.config = PERF_COUNT_SW_PAGE_FAULTS;
-		} else if (input == "software/context-switches") {
-			result.attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
-		} else if (input == "software/cpu-migrations") {
-			result.attr.config = PERF_COUNT_SW_CPU_MIGRATIONS;
-		} else if (input == "software/page-faults-min") {
-			result.attr.config = PERF_COUNT_SW_PAGE_FAULTS_MIN;
-		} else if (input == "software/page-faults-maj") {
-			result.attr.config = PERF_COUNT_SW_PAGE_FAULTS_MAJ;
-		} else if (input == "software/alignment-faults") {
-			result.attr.config = PERF_COUNT_SW_ALIGNMENT_FAULTS;
-		} else if (input == "software/emulation-faults") {
-			result.attr.config = PERF_COUNT_SW_EMULATION_FAULTS;
-		} else if (input == "software/dummy") {
-			result.attr.config = PERF_COUNT_SW_DUMMY;
-		} else {
-			throw Exception(name + ".readSensor(" + input + "): Unknown software sensor.");
-		}
 	} else if (input.startsWith("perf_event_attr/")) {
 		// Support setting up the "perf_event_attr" struct manually.
 
@@ -880,7 +1507,12 @@ Sensor Main::readSensor(const QString &input) {
 			}
 		}
 	} else {
-		throw Exception(name + ".readSensor(" + input + ") failed: Unknown sensor format.");
+		// All named events are resolved by the catalog, which is shared by all monitors.
+		Sensor event = EventCatalog::getSensor(input);
+		result.attr = event.attr;
+		result.processors = event.processors;
+		result.scale = event.scale;
+		result.unit = event.unit;
 	}
 
 	context.debug("     - " + name + ".readSensor(" + input + ") = " + showSensor(result));
@@ -898,6 +1530,110 @@ QString Main::showSensor(const Sensor &input) {
 	return result;
 }
 
+Main::Combine Main::readCombine(const QString &input) {
+	if (input.toLower() == "first") {
+		return FIRST;
+	} else if (input.toLower() == "sum") {
+		return SUM;
+	} else if (input.toLower() == "ratio") {
+		return RATIO;
+	} else {
+		throw Exception("GPerf::readCombine(" + input + ") failed: Must be one of 'first', 'sum', 'ratio'.");
+	}
+}
+
+QString Main::showCombine(Combine input) {
+	switch (input) {
+	case FIRST:
+		return "first";
+	case SUM:
+		return "sum";
+	case RATIO:
+		return "ratio";
+	default:
+		throw Exception("GPerf::showCombine(" + QString::number(input) + ") failed: Invalid combination.");
+	}
+}
+
+Main::Mode Main::readMode(const QString &input) {
+	if (input.toLower() == "count") {
+		return COUNT;
+	} else if (input.toLower() == "sample") {
+		return SAMPLE;
+	} else {
+		throw Exception("GPerf::readMode(" + input + ") failed: Must be one of 'count', 'sample'.");
+	}
+}
+
+QString Main::showMode(Mode input) {
+	switch (input) {
+	case COUNT:
+		return "count";
+	case SAMPLE:
+		return "sample";
+	default:
+		throw Exception("GPerf::showMode(" + QString::number(input) + ") failed: Invalid mode.");
+	}
+}
+
+Main::Metric Main::readMetric(const QString &input) {
+	if (input.toLower() == "samples") {
+		return SAMPLES;
+	} else if (input.toLower() == "hotspot") {
+		return HOTSPOT;
+	} else if (input.toLower() == "shared") {
+		return SHARED;
+	} else {
+		throw Exception("GPerf::readMetric(" + input + ") failed: Must be one of 'samples', 'hotspot', 'shared'.");
+	}
+}
+
+QString Main::showMetric(Metric input) {
+	switch (input) {
+	case SAMPLES:
+		return "samples";
+	case HOTSPOT:
+		return "hotspot";
+	case SHARED:
+		return "shared";
+	default:
+		throw Exception("GPerf::showMetric(" + QString::number(input) + ") failed: Invalid metric.");
+	}
+}
+
+uint64_t Main::readSampleType(const QStringList &input) {
+	// The thread id is required to attribute the samples to the threads.
+	uint64_t result = PERF_SAMPLE_TID;
+
+	for (const auto &field : input) {
+		if (field.toLower() == "ip") {
+			result |= PERF_SAMPLE_IP;
+		} else if (field.toLower() == "tid") {
+			result |= PERF_SAMPLE_TID;
+		} else if (field.toLower() == "time") {
+			result |= PERF_SAMPLE_TIME;
+		} else if (field.toLower() == "addr") {
+			result |= PERF_SAMPLE_ADDR;
+		} else {
+			throw Exception("GPerf::readSampleType(" + field +
+							") failed: Must be one of 'ip', 'tid', 'time', 'addr'.");
+		}
+	}
+
+	return result;
+}
+
+QStringList Main::showSampleType(uint64_t input) {
+	QStringList result;
+
+	if (input & PERF_SAMPLE_IP) result.append("ip");
+	if (input & PERF_SAMPLE_TID) result.append("tid");
+	if (input & PERF_SAMPLE_TIME) result.append("time");
+	if (input & PERF_SAMPLE_ADDR) result.append("addr");
+
+	return result;
+}
+
 int Main::perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags) {
 	return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
 }
@@ -0,0 +1,113 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Monitor/GPerf/SampleBuffer.h>
+
+#include <string.h>   // for memcpy
+#include <sys/mman.h> // for mmap, munmap
+#include <unistd.h>   // for sysconf
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace GPerf {
+
+SampleBuffer::SampleBuffer(int fd, uint64_t sample_type) : fd(fd), sample_type(sample_type) {}
+
+SampleBuffer::~SampleBuffer() {
+	if (header != nullptr) munmap(header, map_size);
+}
+
+bool SampleBuffer::map(size_t pages) {
+	size_t page_size = sysconf(_SC_PAGESIZE);
+
+	// The first page contains the metadata, the data area follows.
+	map_size = (pages + 1) * page_size;
+	void *addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) return false;
+
+	header = static_cast<perf_event_mmap_page *>(addr);
+	data = static_cast<const char *>(addr) + page_size;
+	data_size = pages * page_size;
+
+	return true;
+}
+
+bool SampleBuffer::next(Sample &sample) {
+	if (header == nullptr) return false;
+
+	// Only this thread writes data_tail, the kernel writes data_head.
+	uint64_t tail = header->data_tail;
+	uint64_t head = __atomic_load_n(&header->data_head, __ATOMIC_ACQUIRE);
+
+	while (tail < head) {
+		perf_event_header record_header;
+		copy(tail, &record_header, sizeof(record_header));
+		if (record_header.size < sizeof(record_header)) break;
+
+		if (record.size() < record_header.size) record.resize(record_header.size);
+		copy(tail, record.data(), record_header.size);
+		tail += record_header.size;
+
+		const char *position = record.data() + sizeof(record_header);
+		if (record_header.type == PERF_RECORD_LOST) {
+			// struct { u64 id; u64 lost; }
+			uint64_t count;
+			memcpy(&count, position + sizeof(uint64_t), sizeof(count));
+			lost += count;
+			continue;
+		} else if (record_header.type != PERF_RECORD_SAMPLE) {
+			continue;
+		}
+
+		// The fields are stored in the order of the bits of sample_type.
+		memset(&sample, 0, sizeof(sample));
+		if (sample_type & PERF_SAMPLE_IP) {
+			memcpy(&sample.ip, position, sizeof(sample.ip));
+			position += sizeof(uint64_t);
+		}
+		if (sample_type & PERF_SAMPLE_TID) {
+			memcpy(&sample.pid, position, sizeof(sample.pid));
+			memcpy(&sample.tid, position + sizeof(uint32_t), sizeof(sample.tid));
+			position += sizeof(uint64_t);
+		}
+		if (sample_type & PERF_SAMPLE_TIME) {
+			memcpy(&sample.time, position, sizeof(sample.time));
+			position += sizeof(uint64_t);
+		}
+		if (sample_type & PERF_SAMPLE_ADDR) {
+			memcpy(&sample.addr, position, sizeof(sample.addr));
+			position += sizeof(uint64_t);
+		}
+
+		__atomic_store_n(&header->data_tail, tail, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	__atomic_store_n(&header->data_tail, tail, __ATOMIC_RELEASE);
+	return false;
+}
+
+uint64_t SampleBuffer::getLost() const { return lost; }
+
+int SampleBuffer::getFd() const { return fd; }
+
+void SampleBuffer::copy(uint64_t position, void *target, size_t size) const {
+	// The size of the data area is a power of two.
+	size_t offset = position & (data_size - 1);
+	size_t first = data_size - offset;
+
+	if (first >= size) {
+		memcpy(target, data + offset, size);
+	} else {
+		memcpy(target, data + offset, first);
+		memcpy(static_cast<char *>(target) + first, data, size - first);
+	}
+}
+
+} // namespace GPerf
+} // namespace Monitor
+} // namespace AutopinPlus
@@ -53,7 +53,9 @@ Configuration::configopts Main::getConfigOpts() {
 	return result;
 }
 
-void Main::start(int /*tid*/) { 
+void Main::start(int /*tid*/) {
+	QMutexLocker locker(&access_mutex);
+
 	if(st.pid_uo!= -1){
 		//We only need to init the spm once no matter how many threads there are
 		return;
@@ -72,6 +74,8 @@ void Main::start(int /*tid*/) {
 }
 
 double Main::value(int /*tid*/) {
+	QMutexLocker locker(&access_mutex);
+
 	//Will return the average number of executed instructions
 	if( !st.metrics.number_pf_samples || !st.metrics.running_accum || !st.metrics.running_accum[2] ){
 		return 0;
@@ -82,16 +86,22 @@ double Main::value(int /*tid*/) {
 }
 
 double Main::stop(int /*tid*/) {
+	QMutexLocker locker(&access_mutex);
+
 	context.info("Sampling stopped ");
 	st.end_recording=B_TRUE;
 	return 0;
 }
 
 void Main::clear(int tid) {
+	QMutexLocker locker(&access_mutex);
+
 	if (rands.find(tid) != rands.end()) rands.erase(tid);
 }
 
 ProcessTree::autopin_tid_list Main::getMonitoredTasks() {
+	QMutexLocker locker(&access_mutex);
+
 	ProcessTree::autopin_tid_list result;
 
 	return result;
@@ -0,0 +1,463 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Monitor/Powercap/Main.h>
+
+#include <AutopinPlus/AutopinContext.h> // for AutopinContext
+#include <AutopinPlus/Error.h>			// for Error, Error::::BAD_CONFIG, etc
+#include <AutopinPlus/Exception.h>		// for Exception
+#include <AutopinPlus/OS/CpuInfo.h>		// for CpuInfo
+#include <AutopinPlus/OS/SystemPaths.h> // for SystemPaths
+#include <AutopinPlus/SampleBroker.h>	// for SampleBroker
+#include <AutopinPlus/Tools.h>			// for Tools
+#include <QDir>							// for QDir
+#include <QMutexLocker>					// for QMutexLocker
+#include <algorithm>					// for find
+#include <errno.h>						// for errno
+#include <fcntl.h>						// for open, O_RDONLY, O_CLOEXEC
+#include <memory>						// for shared_ptr
+#include <set>							// for set
+#include <stdlib.h>						// for strtoull
+#include <string.h>						// for strerror
+#include <unistd.h>						// for pread, close
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace Powercap {
+
+/*!
+ * The time in nanoseconds during which a read of the zones is shared. RAPL updates
+ * the counters about once per millisecond, so more frequent reads return the same values.
+ */
+static const int64_t ttl = 1000000;
+
+/*!
+ * \brief Reads the energy counters of a list of zones
+ *
+ * The reader is the source of the zones in the SampleBroker, so it is shared by all
+ * monitors measuring the same zones. It keeps the counters open and returns the
+ * energy in microjoules of every zone since the reader was created.
+ */
+class ZoneReader {
+  public:
+	/*!
+	 * \brief Opens the energy counters
+	 *
+	 * \exception Exception This exception will be thrown if a counter could not be opened.
+	 */
+	ZoneReader(const std::vector<QString> &paths, const std::vector<uint64_t> &ranges) : ranges(ranges) {
+		for (const auto &path : paths) {
+			int fd = open((path + "/energy_uj").toUtf8().constData(), O_RDONLY | O_CLOEXEC);
+			if (fd == -1) {
+				int error = errno;
+				for (int elem : fds) close(elem);
+				throw Exception("ZoneReader::ZoneReader() failed: Could not open " + path + "/energy_uj (" +
+								QString(strerror(error)) + ").");
+			}
+			fds.push_back(fd);
+		}
+
+		last.resize(fds.size());
+		totals.resize(fds.size(), 0);
+		for (size_t i = 0; i < fds.size(); i++) last[i] = readCounter(i);
+	}
+
+	~ZoneReader() {
+		for (int fd : fds) close(fd);
+	}
+
+	/*!
+	 * \brief Reads all counters, undoing their wraparound
+	 *
+	 * \exception Exception This exception will be thrown if a counter could not be read.
+	 */
+	std::vector<double> read() {
+		for (size_t i = 0; i < fds.size(); i++) {
+			uint64_t current = readCounter(i);
+			totals[i] += Main::getDelta(last[i], current, ranges[i]);
+			last[i] = current;
+		}
+
+		return totals;
+	}
+
+  private:
+	/*!
+	 * \brief Reads a counter with a single pread() on its open file
+	 */
+	uint64_t readCounter(size_t index) {
+		char buffer[32];
+
+		ssize_t size = pread(fds[index], buffer, sizeof(buffer) - 1, 0);
+		if (size <= 0) {
+			throw Exception("ZoneReader::readCounter() failed: Could not read a counter (" +
+							QString(size < 0 ? strerror(errno) : "empty file") + ").");
+		}
+		buffer[size] = 0;
+
+		return strtoull(buffer, nullptr, 10);
+	}
+
+	/*!
+	 * The open energy_uj files
+	 */
+	std::vector<int> fds;
+
+	/*!
+	 * The maximum values of the counters
+	 */
+	std::vector<uint64_t> ranges;
+
+	/*!
+	 * The values of the previous read
+	 */
+	std::vector<uint64_t> last;
+
+	/*!
+	 * The energy since the creation of the reader
+	 */
+	std::vector<double> totals;
+};
+
+Main::Main(QString name, const Configuration &config, AutopinContext &context)
+	: PerformanceMonitor(name, config, context) {
+	type = "powercap";
+
+	// Less energy is better
+	valtype = MIN;
+
+	// All threads share the measurement, unless the "scope" option narrows it down.
+	valscope = SYSTEM;
+}
+
+Main::~Main() {
+	if (consumer != -1) SampleBroker::getInstance().unsubscribe(consumer);
+}
+
+void Main::init() {
+	QMutexLocker locker(&access_mutex);
+
+	context.info("Initializing " + name + " (" + type + ")");
+
+	// Read and check the "domains" option
+	domains = QStringList("package");
+	if (config.configOptionExists(name + ".domains") > 0) {
+		domains = config.getConfigOptionList(name + ".domains");
+	}
+	for (const auto &domain : domains) {
+		if (domain != "package" && domain != "core" && domain != "uncore" && domain != "dram" && domain != "psys") {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init(): Unknown domain \"" + domain + "\" in the 'domains' option.");
+			return;
+		}
+	}
+	context.info("  - " + name + ".domains = " + domains.join(" "));
+
+	// Read and parse the "scope" option
+	valscope = SYSTEM;
+	if (config.configOptionExists(name + ".scope") > 0) {
+		try {
+			valscope = readMonscope(config.getConfigOption(name + ".scope"));
+		} catch (const Exception &e) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init(): Could not parse the 'scope' option (" + QString(e.what()) + ").");
+			return;
+		}
+		if (valscope != SYSTEM && valscope != PACKAGE && valscope != NODE) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init(): The 'scope' option must be system, package or node.");
+			return;
+		}
+	}
+	context.info("  - " + name + ".scope = " + showMonscope(valscope));
+
+	findZones();
+	if (context.isError()) return;
+
+	if (zones.empty()) {
+		context.report(Error::UNSUPPORTED, "critical",
+					   name + ".init(): No powercap zones found for the domains " + domains.join(", ") + " in " +
+						   OS::SystemPaths::sysfs("/class/powercap") + ".");
+		return;
+	}
+
+	for (const auto &zone : zones) {
+		context.info("  - Using zone " + zone.path + " (" + zone.domain + ", package " +
+					 QString::number(packages[zone.package]) + ")");
+
+		// The energy of the whole system can't be split up by package or node.
+		if (packages[zone.package] == -1 && valscope != SYSTEM) {
+			context.report(Error::BAD_CONFIG, "inconsistent",
+						   name + ".init(): The domain \"" + zone.domain +
+							   "\" can only be measured with scope system.");
+			return;
+		}
+
+		// Since Linux 5.10, energy_uj is only readable by root.
+		if (access((zone.path + "/energy_uj").toUtf8().constData(), R_OK) != 0) {
+			context.report(Error::MONITOR, "critical",
+						   name + ".init(): Cannot read " + zone.path + "/energy_uj (" + QString(strerror(errno)) +
+							   ").");
+			return;
+		}
+	}
+}
+
+QString Main::getUnit() { return "Joules"; }
+
+Configuration::configopts Main::getConfigOpts() {
+	Configuration::configopts result;
+
+	result.push_back(Configuration::configopt("domains", domains));
+	result.push_back(Configuration::configopt("scope", QStringList(showMonscope(valscope))));
+
+	return result;
+}
+
+void Main::start(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	try {
+		// The first thread subscribes to the zones.
+		if (consumer == -1) {
+			std::vector<QString> paths;
+			std::vector<uint64_t> ranges;
+			for (const auto &zone : zones) {
+				paths.push_back(zone.path);
+				ranges.push_back(zone.range);
+			}
+
+			// The counters are only opened if this monitor registers the zones, the broker
+			// calls the reader with the lock of the zones held.
+			std::shared_ptr<std::unique_ptr<ZoneReader>> reader(new std::unique_ptr<ZoneReader>());
+			auto read = [paths, ranges, reader]() {
+				if (*reader == nullptr) reader->reset(new ZoneReader(paths, ranges));
+				return (*reader)->read();
+			};
+			consumer = SampleBroker::getInstance().subscribe(key, ttl, SampleBroker::ABSOLUTE, read);
+		}
+
+		readPackages();
+	} catch (const Exception &e) {
+		context.report(Error::MONITOR, "start",
+					   name + ".start(" + QString::number(tid) + ") failed: " + QString(e.what()));
+		return;
+	}
+
+	Task task;
+	task.weights = getWeights(tid);
+	task.baseline = getEnergy(task.weights);
+	tasks[tid] = task;
+}
+
+double Main::value(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	auto it = tasks.find(tid);
+	if (it == tasks.end()) {
+		context.report(Error::MONITOR, "value",
+					   name + ".value(" + QString::number(tid) + ") failed: Thread is not being monitored.");
+		return 0;
+	}
+
+	try {
+		readPackages();
+	} catch (const Exception &e) {
+		context.report(Error::MONITOR, "value",
+					   name + ".value(" + QString::number(tid) + ") failed: " + QString(e.what()));
+		return 0;
+	}
+
+	return (getEnergy(it->second.weights) - it->second.baseline) / 1e6;
+}
+
+void Main::values(const int *tids, size_t count, value_batch &result) {
+	QMutexLocker locker(&access_mutex);
+
+	result.resize(count);
+
+	// The zones are read once for all threads.
+	bool ok = true;
+	if (!tasks.empty()) {
+		try {
+			readPackages();
+		} catch (const Exception &) {
+			ok = false;
+		}
+	}
+
+	int64_t timestamp = getTimestamp();
+	for (size_t i = 0; i < count; i++) {
+		auto it = tasks.find(tids[i]);
+		bool monitored = it != tasks.end();
+
+		result.values[i] = monitored && ok ? (getEnergy(it->second.weights) - it->second.baseline) / 1e6 : 0;
+		result.timestamps[i] = timestamp;
+		result.status[i] = !monitored ? VALUE_UNMONITORED : (ok ? VALUE_OK : VALUE_FAILED);
+		result.coverage[i] = monitored && ok ? 1.0 : 0;
+	}
+}
+
+double Main::stop(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	double result = value(tid);
+	if (context.isError()) return 0;
+
+	clear(tid);
+
+	return result;
+}
+
+void Main::clear(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	tasks.erase(tid);
+
+	// The last thread releases the counters.
+	if (tasks.empty() && consumer != -1) {
+		SampleBroker::getInstance().unsubscribe(consumer);
+		consumer = -1;
+	}
+}
+
+ProcessTree::autopin_tid_list Main::getMonitoredTasks() {
+	QMutexLocker locker(&access_mutex);
+
+	ProcessTree::autopin_tid_list result;
+
+	for (const auto &task : tasks) result.insert(task.first);
+
+	return result;
+}
+
+uint64_t Main::getDelta(uint64_t last, uint64_t current, uint64_t range) {
+	if (current >= last) return current - last;
+
+	// The counter has wrapped around after reaching "range". Without a range, the
+	// increase is unknown and the read is skipped.
+	return range >= last ? range - last + current : 0;
+}
+
+void Main::findZones() {
+	zones.clear();
+	packages.clear();
+
+	// The class directory lists all zones, the subzones of a package "intel-rapl:<n>"
+	// are named "intel-rapl:<n>:<m>". The "intel-rapl-mmio" zones measure the same
+	// packages through another interface, so they are skipped.
+	QDir dir(OS::SystemPaths::sysfs("/class/powercap"));
+	QStringList entries = dir.entryList(QStringList("intel-rapl:*"), QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+
+	for (const auto &entry : entries) {
+		QString path = dir.filePath(entry);
+		QStringList parts = entry.split(":");
+
+		Zone zone;
+		zone.path = path;
+
+		int package = -1;
+		try {
+			QString zone_name = Tools::readLine(path + "/name");
+
+			// The domain of a package is named "package-<id>" or "package-<id>-die-<id>",
+			// its subzones are named after their domain.
+			QString parent = zone_name;
+			if (parts.size() > 2) parent = Tools::readLine(dir.filePath(parts[0] + ":" + parts[1]) + "/name");
+			if (parent.startsWith("package-")) package = Tools::readInt(parent.section('-', 1, 1));
+
+			zone.domain = parts.size() > 2 ? zone_name : zone_name.section('-', 0, 0);
+		} catch (const Exception &e) {
+			context.report(Error::MONITOR, "critical",
+						   name + ".init(): Could not read the powercap zone " + path + " (" + QString(e.what()) +
+							   ").");
+			return;
+		}
+
+		if (!domains.contains(zone.domain)) continue;
+
+		// The counters of some zones (e.g. "psys") are not limited.
+		try {
+			zone.range = Tools::readULong(Tools::readLine(path + "/max_energy_range_uj"));
+		} catch (const Exception &) {
+			zone.range = 0;
+		}
+
+		auto it = std::find(packages.begin(), packages.end(), package);
+		zone.package = it - packages.begin();
+		if (it == packages.end()) packages.push_back(package);
+
+		zones.push_back(zone);
+	}
+
+	key = "powercap:";
+	for (const auto &zone : zones) key += zone.path.toStdString() + ";";
+
+	energy.assign(packages.size(), 0);
+}
+
+std::vector<double> Main::getWeights(int tid) {
+	std::vector<double> result(packages.size(), valscope == SYSTEM ? 1.0 : 0.0);
+	if (valscope == SYSTEM) return result;
+
+	const auto &topology = OS::CpuInfo::getTopology();
+
+	std::vector<int> cpus;
+	for (int cpu : OS::CpuInfo::getAffinity(tid)) {
+		if (cpu >= 0 && cpu < topology.getCpuCount()) cpus.push_back(cpu);
+	}
+
+	// Without an affinity, the thread may run anywhere.
+	if (cpus.empty()) {
+		for (int cpu = 0; cpu < topology.getCpuCount(); cpu++) cpus.push_back(cpu);
+	}
+
+	if (valscope == PACKAGE) {
+		for (int cpu : cpus) {
+			auto it = std::find(packages.begin(), packages.end(), topology.getPackage(cpu));
+			if (it != packages.end()) result[it - packages.begin()] = 1.0;
+		}
+		return result;
+	}
+
+	// The energy of a package is split up between its nodes by their number of cpus.
+	std::set<int> nodes;
+	for (int cpu : cpus) nodes.insert(topology.getNode(cpu));
+
+	std::vector<int> total(packages.size(), 0), used(packages.size(), 0);
+	for (int cpu = 0; cpu < topology.getCpuCount(); cpu++) {
+		auto it = std::find(packages.begin(), packages.end(), topology.getPackage(cpu));
+		if (it == packages.end()) continue;
+
+		total[it - packages.begin()]++;
+		if (nodes.count(topology.getNode(cpu))) used[it - packages.begin()]++;
+	}
+
+	for (size_t i = 0; i < packages.size(); i++) {
+		if (total[i] > 0) result[i] = (double)used[i] / total[i];
+	}
+
+	return result;
+}
+
+void Main::readPackages() {
+	std::vector<double> totals = SampleBroker::getInstance().value(consumer);
+
+	energy.assign(packages.size(), 0);
+	for (size_t i = 0; i < zones.size() && i < totals.size(); i++) energy[zones[i].package] += totals[i];
+}
+
+double Main::getEnergy(const std::vector<double> &weights) const {
+	double result = 0;
+	for (size_t i = 0; i < weights.size() && i < energy.size(); i++) result += weights[i] * energy[i];
+
+	return result;
+}
+
+} // namespace Powercap
+} // namespace Monitor
+} // namespace AutopinPlus
@@ -0,0 +1,463 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Monitor/ProcStat/Main.h>
+
+#include <AutopinPlus/AutopinContext.h> // for AutopinContext
+#include <AutopinPlus/Error.h>			// for Error, Error::::BAD_CONFIG, etc
+#include <AutopinPlus/Exception.h>		// for Exception
+#include <AutopinPlus/OS/SystemPaths.h> // for SystemPaths
+#include <QMutexLocker>					// for QMutexLocker
+#include <QStringList>					// for QStringList
+#include <errno.h>						// for errno
+#include <fcntl.h>						// for open, O_RDONLY, O_CLOEXEC
+#include <stdlib.h>						// for strtod
+#include <string.h>						// for strerror, strrchr, strchr, strncmp
+#include <unistd.h>						// for pread, close, sysconf, getpid
+
+namespace AutopinPlus {
+namespace Monitor {
+namespace ProcStat {
+
+/*!
+ * The names of the fields, in the order of Main::Field
+ */
+static const char *field_names[] = {"runtime",	"wait",		 "timeslices",   "utime",	   "stime",
+									"migrations", "voluntary", "nonvoluntary", "read_bytes", "write_bytes"};
+
+/*!
+ * \brief Returns the number after a key like "voluntary_ctxt_switches:" at the start of a line
+ *
+ * Blanks and a colon between the key and the number are skipped, as in "se.nr_migrations    :    3".
+ */
+static double parseKey(const char *buffer, const char *key, bool &ok) {
+	size_t length = strlen(key);
+
+	for (const char *line = buffer; line != nullptr && *line != 0; line = strchr(line, '\n')) {
+		if (*line == '\n') line++;
+		if (strncmp(line, key, length) != 0) continue;
+
+		const char *number = line + length;
+		while (*number == ' ' || *number == '\t' || *number == ':') number++;
+		return strtod(number, nullptr);
+	}
+
+	ok = false;
+	return 0;
+}
+
+/*!
+ * \brief Returns a numeric field of a stat file, counting from 1 like proc(5)
+ *
+ * The name of the thread may contain spaces and parentheses, so the fields are counted
+ * from the state (field 3) after the last ')'.
+ */
+static double parseStat(const char *buffer, int index, bool &ok) {
+	const char *fields = strrchr(buffer, ')');
+	if (fields == nullptr) {
+		ok = false;
+		return 0;
+	}
+
+	char *end = const_cast<char *>(fields + 1);
+	double result = 0;
+	for (int i = 3; i <= index; i++) {
+		while (*end == ' ') end++;
+		if (*end == 0) {
+			ok = false;
+			return 0;
+		}
+		char *next = end;
+		result = strtod(end, &next);
+		while (*next != ' ' && *next != 0) next++;
+		end = next;
+	}
+
+	return result;
+}
+
+Main::Main(QString name, const Configuration &config, AutopinContext &context)
+	: PerformanceMonitor(name, config, context) {
+	type = "procstat";
+}
+
+Main::~Main() {
+	for (const auto &task : tasks) close(task.second.fd);
+}
+
+void Main::init() {
+	QMutexLocker locker(&access_mutex);
+
+	context.info("Initializing " + name + " (" + type + ")");
+
+	// Read and parse the "field" option
+	field = WAIT;
+	if (config.configOptionExists(name + ".field") > 0) {
+		try {
+			field = readField(config.getConfigOption(name + ".field"));
+		} catch (const Exception &e) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init(): Could not parse the 'field' option (" + QString(e.what()) + ").");
+			return;
+		}
+	}
+	context.info("  - " + name + ".field = " + showField(field));
+
+	// Read the "rate" option
+	rate = true;
+	if (config.configOptionExists(name + ".rate") > 0) rate = config.getConfigOptionBool(name + ".rate");
+	context.info("  - " + name + ".rate = " + QString(rate ? "true" : "false"));
+
+	// Less waiting, preemption and migrations are better, more time on the cpu is better.
+	switch (field) {
+	case WAIT:
+	case NONVOLUNTARY:
+	case MIGRATIONS:
+		valtype = MIN;
+		break;
+	case RUNTIME:
+	case UTIME:
+		valtype = MAX;
+		break;
+	default:
+		valtype = UNKNOWN;
+	}
+
+	// Read and parse the "valtype" option
+	if (config.configOptionExists(name + ".valtype") > 0) {
+		try {
+			valtype = readMontype(config.getConfigOption(name + ".valtype"));
+		} catch (const Exception &e) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init(): Could not parse the 'valtype' option (" + QString(e.what()) + ").");
+			return;
+		}
+	}
+	context.info("  - " + name + ".valtype = " + showMontype(valtype));
+
+	// sched needs CONFIG_SCHED_DEBUG, without it migrations are sampled from the last cpu in stat.
+	QString thread = "/self/task/" + QString::number(getpid()) + "/";
+	sampled = false;
+	if (field == MIGRATIONS && access(OS::SystemPaths::procfs(thread + "sched").toUtf8().constData(), R_OK) != 0) {
+		context.warn("  - " + OS::SystemPaths::procfs(thread + "sched") +
+					 " is not available, only migrations between two reads are counted");
+		sampled = true;
+	}
+
+	// schedstat needs CONFIG_SCHED_INFO, io needs CONFIG_TASK_IO_ACCOUNTING.
+	QString path = OS::SystemPaths::procfs(thread + getFile());
+	if (access(path.toUtf8().constData(), R_OK) != 0) {
+		context.report(Error::UNSUPPORTED, "critical",
+					   name + ".init(): Cannot read " + path + " (" + QString(strerror(errno)) + ").");
+		return;
+	}
+}
+
+QString Main::getUnit() {
+	QString result;
+
+	switch (field) {
+	case RUNTIME:
+	case WAIT:
+	case UTIME:
+	case STIME:
+		result = "seconds";
+		break;
+	case TIMESLICES:
+		result = "timeslices";
+		break;
+	case MIGRATIONS:
+		result = "migrations";
+		break;
+	case VOLUNTARY:
+	case NONVOLUNTARY:
+		result = "context switches";
+		break;
+	case READ_BYTES:
+	case WRITE_BYTES:
+		result = "bytes";
+		break;
+	}
+
+	return rate ? result + " per second" : result;
+}
+
+bool Main::isCumulative() { return !rate; }
+
+Configuration::configopts Main::getConfigOpts() {
+	Configuration::configopts result;
+
+	result.push_back(Configuration::configopt("field", QStringList(showField(field))));
+	result.push_back(Configuration::configopt("rate", QStringList(rate ? "true" : "false")));
+	result.push_back(Configuration::configopt("valtype", QStringList(showMontype(valtype))));
+
+	return result;
+}
+
+void Main::start(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	// Restarting a thread resets its baseline.
+	clear(tid);
+
+	Task task;
+	try {
+		task.path = getPath(getPid(tid), tid);
+	} catch (const Exception &e) {
+		context.report(Error::MONITOR, "start",
+					   name + ".start(" + QString::number(tid) + ") failed: " + QString(e.what()));
+		return;
+	}
+
+	task.fd = open(task.path.toUtf8().constData(), O_RDONLY | O_CLOEXEC);
+	if (task.fd == -1) {
+		context.report(Error::MONITOR, "start",
+					   name + ".start(" + QString::number(tid) + ") failed: Could not open " + task.path + " (" +
+						   QString(strerror(errno)) + ").");
+		return;
+	}
+	task.cpu = -1;
+	task.migrations = 0;
+
+	try {
+		task.baseline = readTask(tid, task);
+	} catch (const Exception &e) {
+		close(task.fd);
+		context.report(Error::MONITOR, "start",
+					   name + ".start(" + QString::number(tid) + ") failed: " + QString(e.what()));
+		return;
+	}
+	task.started = getTimestamp();
+
+	tasks[tid] = task;
+}
+
+double Main::value(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	auto it = tasks.find(tid);
+	if (it == tasks.end()) {
+		context.report(Error::MONITOR, "value",
+					   name + ".value(" + QString::number(tid) + ") failed: Thread is not being monitored.");
+		return 0;
+	}
+
+	double current;
+	try {
+		current = readTask(tid, it->second);
+	} catch (const Exception &e) {
+		context.report(Error::MONITOR, "value",
+					   name + ".value(" + QString::number(tid) + ") failed: " + QString(e.what()));
+		return 0;
+	}
+
+	return getValue(it->second, current, getTimestamp());
+}
+
+void Main::values(const int *tids, size_t count, value_batch &result) {
+	QMutexLocker locker(&access_mutex);
+
+	result.resize(count);
+
+	// One pread() per thread on the files opened by start(), threads which have exited fail on their own.
+	for (size_t i = 0; i < count; i++) {
+		auto it = tasks.find(tids[i]);
+
+		result.values[i] = 0;
+		result.status[i] = VALUE_UNMONITORED;
+		result.coverage[i] = 0;
+
+		if (it != tasks.end()) {
+			try {
+				double current = readTask(tids[i], it->second);
+				result.timestamps[i] = getTimestamp();
+				result.values[i] = getValue(it->second, current, result.timestamps[i]);
+				result.status[i] = VALUE_OK;
+				result.coverage[i] = 1.0;
+				continue;
+			} catch (const Exception &) {
+				result.status[i] = VALUE_FAILED;
+			}
+		}
+
+		result.timestamps[i] = getTimestamp();
+	}
+}
+
+double Main::stop(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	double result = value(tid);
+	if (context.isError()) return 0;
+
+	clear(tid);
+
+	return result;
+}
+
+void Main::clear(int tid) {
+	QMutexLocker locker(&access_mutex);
+
+	auto it = tasks.find(tid);
+	if (it == tasks.end()) return;
+
+	close(it->second.fd);
+	tasks.erase(it);
+}
+
+ProcessTree::autopin_tid_list Main::getMonitoredTasks() {
+	QMutexLocker locker(&access_mutex);
+
+	ProcessTree::autopin_tid_list result;
+
+	for (const auto &task : tasks) result.insert(task.first);
+
+	return result;
+}
+
+Main::Field Main::readField(const QString &string) {
+	for (size_t i = 0; i < sizeof(field_names) / sizeof(field_names[0]); i++) {
+		if (string == field_names[i]) return (Field)i;
+	}
+
+	throw Exception("Main::readField(" + string + ") failed: Unknown field.");
+}
+
+QString Main::showField(Field field) { return field_names[field]; }
+
+double Main::parseField(Field field, const char *buffer, bool &ok) {
+	ok = true;
+
+	switch (field) {
+	case RUNTIME:
+	case WAIT:
+	case TIMESLICES: {
+		// "<runtime in ns> <wait in ns> <timeslices>"
+		char *end;
+		double runtime = strtod(buffer, &end);
+		double wait = strtod(end, &end);
+		double timeslices = strtod(end, &end);
+		if (end == buffer) ok = false;
+
+		if (field == RUNTIME) return runtime / 1e9;
+		if (field == WAIT) return wait / 1e9;
+		return timeslices;
+	}
+	case UTIME:
+	case STIME: {
+		// utime and stime are fields 14 and 15, in clock ticks
+		static const double ticks = sysconf(_SC_CLK_TCK);
+		return parseStat(buffer, field == UTIME ? 14 : 15, ok) / ticks;
+	}
+	case MIGRATIONS:
+		return parseKey(buffer, "se.nr_migrations", ok);
+	case VOLUNTARY:
+		return parseKey(buffer, "voluntary_ctxt_switches:", ok);
+	case NONVOLUNTARY:
+		return parseKey(buffer, "nonvoluntary_ctxt_switches:", ok);
+	case READ_BYTES:
+		return parseKey(buffer, "read_bytes:", ok);
+	case WRITE_BYTES:
+		return parseKey(buffer, "write_bytes:", ok);
+	}
+
+	ok = false;
+	return 0;
+}
+
+QString Main::getFile() const {
+	switch (field) {
+	case RUNTIME:
+	case WAIT:
+	case TIMESLICES:
+		return "schedstat";
+	case UTIME:
+	case STIME:
+		return "stat";
+	case MIGRATIONS:
+		return sampled ? "stat" : "sched";
+	case VOLUNTARY:
+	case NONVOLUNTARY:
+		return "status";
+	case READ_BYTES:
+	case WRITE_BYTES:
+		return "io";
+	}
+
+	return "";
+}
+
+int Main::getPid(int tid) const {
+	if (monitored_pid > 0) return monitored_pid;
+
+	// Before the observed process is known, the process of the thread is looked up.
+	QString path = OS::SystemPaths::procfs("/" + QString::number(tid) + "/status");
+	char buffer[4096];
+	ssize_t size = -1;
+
+	int fd = open(path.toUtf8().constData(), O_RDONLY | O_CLOEXEC);
+	if (fd != -1) {
+		size = pread(fd, buffer, sizeof(buffer) - 1, 0);
+		close(fd);
+	}
+	if (size <= 0) {
+		throw Exception("Main::getPid(" + QString::number(tid) + ") failed: Could not read " + path + ".");
+	}
+	buffer[size] = 0;
+
+	bool ok = true;
+	int result = parseKey(buffer, "Tgid:", ok);
+	if (!ok) {
+		throw Exception("Main::getPid(" + QString::number(tid) + ") failed: No Tgid in " + path + ".");
+	}
+
+	return result;
+}
+
+QString Main::getPath(int pid, int tid) const {
+	// The files below /proc/<tid> contain the totals of the whole process for stat and io.
+	return OS::SystemPaths::procfs("/" + QString::number(pid) + "/task/" + QString::number(tid) + "/" + getFile());
+}
+
+double Main::readTask(int tid, Task &task) {
+	char buffer[4096];
+
+	ssize_t size = pread(task.fd, buffer, sizeof(buffer) - 1, 0);
+	if (size <= 0) {
+		throw Exception("Main::readTask(" + QString::number(tid) + ") failed: Could not read " + task.path + " (" +
+						QString(size < 0 ? strerror(errno) : "thread has exited") + ").");
+	}
+	buffer[size] = 0;
+
+	bool ok = true;
+	double result = sampled ? parseStat(buffer, 39, ok) : parseField(field, buffer, ok);
+	if (!ok) {
+		throw Exception("Main::readTask(" + QString::number(tid) + ") failed: Could not find the field " +
+						showField(field) + " in " + task.path + ".");
+	}
+
+	if (!sampled) return result;
+
+	// Field 39 is the cpu the thread ran on last. Only its changes between two reads can be seen,
+	// so this undercounts and more frequent reads count more migrations.
+	if (task.cpu != -1 && task.cpu != (int)result) task.migrations++;
+	task.cpu = (int)result;
+
+	return task.migrations;
+}
+
+double Main::getValue(const Task &task, double current, int64_t timestamp) const {
+	double result = current - task.baseline;
+	if (!rate) return result;
+
+	double elapsed = (timestamp - task.started) / 1e9;
+	return elapsed > 0 ? result / elapsed : 0;
+}
+
+} // namespace ProcStat
+} // namespace Monitor
+} // namespace AutopinPlus
@@ -71,9 +71,14 @@ Configuration::configopts Main::getConfigOpts() {
 	return result;
 }
 
-void Main::start(int tid) { rands[tid] = getRandomValue(); }
+void Main::start(int tid) {
+	QMutexLocker locker(&access_mutex);
+	rands[tid] = getRandomValue();
+}
 
 double Main::value(int tid) {
+	QMutexLocker locker(&access_mutex);
+
 	if (rands.find(tid) != rands.end()) return rands[tid];
 
 	context.report(Error::MONITOR, "value", "Could not random result for " + QString::number(tid));
@@ -81,6 +86,8 @@ double Main::value(int tid) {
 }
 
 double Main::stop(int tid) {
+	QMutexLocker locker(&access_mutex);
+
 	double result = value(tid);
 	if (context.isError()) {
 		return 0;
@@ -91,10 +98,14 @@ double Main::stop(int tid) {
 }
 
 void Main::clear(int tid) {
+	QMutexLocker locker(&access_mutex);
+
 	if (rands.find(tid) != rands.end()) rands.erase(tid);
 }
 
 ProcessTree::autopin_tid_list Main::getMonitoredTasks() {
+	QMutexLocker locker(&access_mutex);
+
 	ProcessTree::autopin_tid_list result;
 
 	for (auto &elem : rands) result.insert(elem.first);
@@ -0,0 +1,216 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/OS/BandwidthCalibration.h>
+
+#include <AutopinPlus/OS/CpuInfo.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <numa.h>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+#include <stdlib.h>
+#include <thread>
+
+namespace AutopinPlus {
+namespace OS {
+
+/*!
+ * Number of elements of each of the three arrays, large enough to exceed all caches
+ */
+static const size_t elements = 8 * 1024 * 1024;
+
+/*!
+ * Number of timed runs per measurement, the fastest one is used
+ */
+static const int runs = 3;
+
+/*!
+ * \brief Allocates memory on a numa node
+ */
+static double *allocate(int node, size_t size) {
+	if (numa_available() < 0) return static_cast<double *>(malloc(size));
+	return static_cast<double *>(numa_alloc_onnode(size, node));
+}
+
+/*!
+ * \brief Frees memory allocated with allocate()
+ */
+static void release(double *data, size_t size) {
+	if (numa_available() < 0)
+		free(data);
+	else
+		numa_free(data, size);
+}
+
+/*!
+ * \brief Runs the triad kernel on the given cpus, each on its share of the arrays
+ *
+ * \return The bandwidth in MB/s or 0 on failure
+ */
+static float triad(const std::vector<int> &cpus, double *a, const double *b, const double *c) {
+	std::atomic<int> ready(0);
+	std::atomic<bool> start(false);
+	std::atomic<int> failed(0);
+	std::vector<std::thread> workers;
+
+	size_t chunk = elements / cpus.size();
+
+	for (unsigned int i = 0; i < cpus.size(); i++) {
+		workers.push_back(std::thread([&, i]() {
+			if (!CpuInfo::pinCurrentThread(cpus[i])) failed++;
+			ready++;
+
+			while (!start.load()) {
+			}
+
+			const size_t first = i * chunk, last = first + chunk;
+			for (size_t j = first; j < last; j++) a[j] = b[j] + 3.0 * c[j];
+		}));
+	}
+
+	while (ready.load() < (int)cpus.size()) {
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	start.store(true);
+	for (auto &worker : workers) worker.join();
+	auto end = std::chrono::steady_clock::now();
+
+	if (failed.load() > 0) return 0;
+
+	double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1e9;
+	double bytes = 3.0 * sizeof(double) * chunk * cpus.size();
+
+	return bytes / seconds / 1e6;
+}
+
+BandwidthCalibration::Bandwidths BandwidthCalibration::measure(const Topology &topology, const std::vector<int> &cpus) {
+	Bandwidths result;
+
+	// One usable cpu of every core, grouped by node
+	std::map<int, std::vector<int>> nodes;
+	std::map<int, bool> seen;
+	for (int cpu : cpus) {
+		if (seen[topology.getCore(cpu)]) continue;
+		seen[topology.getCore(cpu)] = true;
+		nodes[topology.getNode(cpu)].push_back(cpu);
+	}
+
+	for (auto &node : nodes) {
+		const size_t size = elements * sizeof(double);
+		double *a = allocate(node.first, size), *b = allocate(node.first, size), *c = allocate(node.first, size);
+
+		if (a == nullptr || b == nullptr || c == nullptr) {
+			if (a != nullptr) release(a, size);
+			if (b != nullptr) release(b, size);
+			if (c != nullptr) release(c, size);
+			continue;
+		}
+
+		std::fill(a, a + elements, 0.0);
+		std::fill(b, b + elements, 1.0);
+		std::fill(c, c + elements, 2.0);
+
+		// Measure 1, 2, 4, ... cores and all cores of the node
+		std::map<int, float> measured;
+		int count = node.second.size();
+		for (int cores = 1;; cores = std::min(cores * 2, count)) {
+			std::vector<int> used(node.second.begin(), node.second.begin() + cores);
+
+			float best = 0;
+			for (int run = 0; run <= runs; run++) {
+				float bandwidth = triad(used, a, b, c);
+				if (run > 0) best = std::max(best, bandwidth);
+			}
+			if (best > 0) measured[cores] = best;
+
+			if (cores == count) break;
+		}
+
+		release(a, size);
+		release(b, size);
+		release(c, size);
+
+		if (measured.empty()) continue;
+
+		// Interpolate linearly between the measured core counts
+		if ((int)result.size() <= node.first) result.resize(node.first + 1);
+		for (int cores = 1; cores <= count; cores++) {
+			auto upper = measured.lower_bound(cores);
+			float bandwidth;
+
+			if (upper == measured.end())
+				bandwidth = measured.rbegin()->second;
+			else if (upper->first == cores || upper == measured.begin())
+				bandwidth = upper->second;
+			else {
+				auto lower = std::prev(upper);
+				float weight = float(cores - lower->first) / (upper->first - lower->first);
+				bandwidth = lower->second + weight * (upper->second - lower->second);
+			}
+
+			result[node.first].push_back(bandwidth);
+		}
+	}
+
+	return result;
+}
+
+bool BandwidthCalibration::load(QString path, Bandwidths &bandwidths) {
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) return false;
+
+	QTextStream stream(&file);
+	Bandwidths result;
+
+	for (auto line : stream.readAll().split("\n", QString::SkipEmptyParts)) {
+		QStringList values = line.split(" ", QString::SkipEmptyParts);
+		if (values.size() < 2) return false;
+
+		bool ok;
+		int node = values[0].toInt(&ok);
+		if (!ok || node < 0) return false;
+
+		if ((int)result.size() <= node) result.resize(node + 1);
+		for (int i = 1; i < values.size(); i++) {
+			result[node].push_back(values[i].toFloat(&ok));
+			if (!ok) return false;
+		}
+	}
+
+	if (result.empty()) return false;
+
+	bandwidths = result;
+	return true;
+}
+
+bool BandwidthCalibration::save(QString path, const Bandwidths &bandwidths) {
+	if (!QDir().mkpath(QFileInfo(path).absolutePath())) return false;
+
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+	QTextStream stream(&file);
+	for (unsigned int node = 0; node < bandwidths.size(); node++) {
+		if (bandwidths[node].empty()) continue;
+
+		stream << node;
+		for (auto bandwidth : bandwidths[node]) stream << " " << bandwidth;
+		stream << "\n";
+	}
+
+	return true;
+}
+
+} // namespace OS
+} // namespace AutopinPlus
@@ -0,0 +1,207 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/OS/BatchReader.h>
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <syscall.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define AUTOPIN_HAVE_IO_URING
+#endif
+#endif
+
+namespace AutopinPlus {
+namespace OS {
+
+BatchReader::BatchReader(unsigned int entries) {
+	if (!setup(entries)) teardown();
+}
+
+BatchReader::~BatchReader() { teardown(); }
+
+bool BatchReader::isAsync() const { return ring_fd != -1; }
+
+void BatchReader::clear() { requests.clear(); }
+
+size_t BatchReader::add(int fd, void *buffer, size_t size) {
+	requests.push_back({fd, buffer, size});
+	return requests.size() - 1;
+}
+
+size_t BatchReader::size() const { return requests.size(); }
+
+void BatchReader::submit() {
+	results.assign(requests.size(), -ECANCELED);
+	syscalls = 0;
+
+	// Submit the reads in chunks of the size of the submission queue. If the io_uring fails,
+	// it is not used again and the remaining reads are done with read().
+	size_t done = 0;
+	while (ring_fd != -1 && done < requests.size()) {
+		size_t last = std::min(done + sq_entries, requests.size());
+		if (!submitRing(done, last)) {
+			teardown();
+			break;
+		}
+		done = last;
+	}
+
+	for (size_t i = done; i < requests.size(); i++) {
+		ssize_t result = read(requests[i].fd, requests[i].buffer, requests[i].size);
+		results[i] = result < 0 ? -errno : result;
+		syscalls++;
+	}
+}
+
+ssize_t BatchReader::getResult(size_t index) const { return results[index]; }
+
+size_t BatchReader::getSyscalls() const { return syscalls; }
+
+#ifdef AUTOPIN_HAVE_IO_URING
+
+bool BatchReader::setup(unsigned int entries) {
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+	if (ring_fd < 0) {
+		ring_fd = -1;
+		return false;
+	}
+
+	// IORING_OP_READ is only supported since Linux 5.6, older kernels create the ring but fail every read with
+	// -EINVAL. These kernels don't support IORING_REGISTER_PROBE either.
+	const unsigned int ops = IORING_OP_READ + 1;
+	std::vector<uint64_t> probe_data((sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op)) / sizeof(uint64_t) + 1);
+	auto probe = reinterpret_cast<io_uring_probe *>(probe_data.data());
+	if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, ops) < 0) return false;
+	if (probe->last_op < IORING_OP_READ || !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)) return false;
+
+	sq_entries = params.sq_entries;
+	sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+	// Newer kernels map both rings with a single mmap()
+	bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_mmap) sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+	sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+				   IORING_OFF_SQ_RING);
+	if (sq_ring == MAP_FAILED) {
+		sq_ring = nullptr;
+		return false;
+	}
+
+	if (single_mmap) {
+		cq_ring = sq_ring;
+	} else {
+		cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+					   IORING_OFF_CQ_RING);
+		if (cq_ring == MAP_FAILED) {
+			cq_ring = nullptr;
+			return false;
+		}
+	}
+
+	sqes = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		sqes = nullptr;
+		return false;
+	}
+
+	char *sq = static_cast<char *>(sq_ring);
+	sq_head = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+	sq_tail = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+	sq_mask = reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+	sq_array = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+
+	char *cq = static_cast<char *>(cq_ring);
+	cq_head = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+	cq_tail = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+	cq_mask = reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+	cqes = cq + params.cq_off.cqes;
+
+	return true;
+}
+
+void BatchReader::teardown() {
+	if (sqes != nullptr) munmap(sqes, sqes_size);
+	if (cq_ring != nullptr && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+	if (sq_ring != nullptr) munmap(sq_ring, sq_ring_size);
+	if (ring_fd != -1) close(ring_fd);
+
+	sqes = sq_ring = cq_ring = nullptr;
+	ring_fd = -1;
+}
+
+bool BatchReader::submitRing(size_t first, size_t last) {
+	unsigned int count = last - first;
+	auto sqe_array = static_cast<io_uring_sqe *>(sqes);
+	auto cqe_array = static_cast<io_uring_cqe *>(cqes);
+
+	// Only this thread writes the tail of the submission queue, so no synchronization is needed for reading it
+	unsigned int tail = *sq_tail;
+	for (unsigned int i = 0; i < count; i++) {
+		const Request &request = requests[first + i];
+		unsigned int index = (tail + i) & *sq_mask;
+
+		io_uring_sqe *sqe = &sqe_array[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = request.fd;
+		sqe->addr = reinterpret_cast<uintptr_t>(request.buffer);
+		sqe->len = request.size;
+		sqe->user_data = first + i;
+
+		sq_array[index] = index;
+	}
+	__atomic_store_n(sq_tail, tail + count, __ATOMIC_RELEASE);
+
+	// Submit all reads and wait for all of them with as few calls as possible
+	unsigned int submitted = 0, completed = 0;
+	while (completed < count) {
+		int result = syscall(__NR_io_uring_enter, ring_fd, count - submitted, count - completed,
+							 IORING_ENTER_GETEVENTS, nullptr, 0);
+		syscalls++;
+		if (result < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		submitted += result;
+
+		unsigned int head = *cq_head;
+		unsigned int cq_end = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != cq_end; head++, completed++) {
+			const io_uring_cqe &cqe = cqe_array[head & *cq_mask];
+			results[cqe.user_data] = cqe.res;
+		}
+		__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	return true;
+}
+
+#else
+
+bool BatchReader::setup(unsigned int) { return false; }
+
+void BatchReader::teardown() {}
+
+bool BatchReader::submitRing(size_t, size_t) { return false; }
+
+#endif
+
+} // namespace OS
+} // namespace AutopinPlus
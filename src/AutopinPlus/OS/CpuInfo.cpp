@@ -6,8 +6,13 @@
  */
 
 #include <AutopinPlus/OS/CpuInfo.h>
+#include <AutopinPlus/OS/OSServices.h>
+#include <AutopinPlus/OS/SystemPaths.h>
+#include <algorithm>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/sysinfo.h>
+#include <QCryptographicHash>
 #include <QFile>
 #include <QTextStream>
 #include <QStringList>
@@ -21,32 +26,144 @@ namespace OS {
 static std::vector<std::vector<int>> distances;
 
 /*!
- * Mapping between cpu and numa node.
+ * Topology of the cpus.
  */
-static std::vector<int> mapping;
+static Topology topology;
+
+/*!
+ * Stores if the n-th cpu is usable.
+ */
+static std::vector<bool> usable;
+
+/*!
+ * Measured latencies between all pairs of cpus, empty if not available.
+ */
+static std::vector<float> latencies;
+
+/*!
+ * Measured bandwidth of every numa node by number of cores, empty if not available.
+ */
+static std::vector<std::vector<float>> bandwidths;
+
+/*!
+ * \brief Returns the effective cpuset of the cgroup (v2) of autopin+
+ *
+ * If the cgroup of autopin+ has no cpuset controller, the parent
+ * cgroups are checked. Returns an empty vector if there is no
+ * cgroup v2 hierarchy.
+ */
+static std::vector<int> getCgroupCpus() {
+	QFile file(SystemPaths::procfs("/self/cgroup"));
+	if (!file.open(QIODevice::ReadOnly)) return std::vector<int>();
+
+	QTextStream stream(&file);
+	QString path;
+	for (auto line : stream.readAll().split("\n")) {
+		if (line.startsWith("0::")) path = line.mid(3).trimmed();
+	}
+	if (path.isEmpty()) return std::vector<int>();
+
+	while (true) {
+		QString cpuset = SystemPaths::sysfs("/fs/cgroup" + path + "/cpuset.cpus.effective");
+		if (QFile::exists(cpuset)) return CpuInfo::parseSysRangeFile(cpuset);
+
+		if (path == "/" || path.isEmpty()) break;
+		path = path.left(path.lastIndexOf('/'));
+		if (path.isEmpty()) path = "/";
+	}
+
+	return std::vector<int>();
+}
 
 void CpuInfo::setupCpuInfo() {
-	for (int i = 0; i < get_nprocs(); i++) mapping.push_back(0);
+	int count = getCpuCount();
 
-	auto nodes = parseSysRangeFile("/sys/devices/system/node/online");
-	for (int node : nodes) {
-		// Mapping
-		auto cpus = parseSysRangeFile("/sys/devices/system/node/node" + QString::number(node) + "/cpulist");
+	topology = Topology::read(count, SystemPaths::getSysfsRoot());
+	distances.clear();
+
+	// Usable cpus are online, in our affinity mask and in our cpuset
+	usable.assign(count, false);
+	for (int cpu : parseSysRangeFile(SystemPaths::sysfs("/devices/system/cpu/online"))) {
+		if (cpu < count) usable[cpu] = true;
+	}
+
+	auto intersect = [&](const std::vector<int> &cpus) {
+		if (cpus.empty()) return;
+		std::vector<bool> allowed(count, false);
 		for (int cpu : cpus) {
-			mapping[cpu] = node;
+			if (cpu < count) allowed[cpu] = true;
 		}
+		for (int cpu = 0; cpu < count; cpu++) usable[cpu] = usable[cpu] && allowed[cpu];
+	};
+	intersect(getAffinity(0));
+	intersect(getCgroupCpus());
 
+	auto nodes = parseSysRangeFile(SystemPaths::sysfs("/devices/system/node/online"));
+	for (int node : nodes) {
 		// Distance
-		auto distance = parseSysNodeDistance("/sys/devices/system/node/node" + QString::number(node) + "/distance");
+		auto distance =
+			parseSysNodeDistance(SystemPaths::sysfs("/devices/system/node/node" + QString::number(node) + "/distance"));
 		distances.push_back(distance);
 	}
 }
 
-int CpuInfo::getCpuCount() { return get_nprocs(); }
+int CpuInfo::getCpuCount() {
+	auto possible = parseSysRangeFile(SystemPaths::sysfs("/devices/system/cpu/possible"));
+	if (possible.empty()) return get_nprocs_conf();
+	return *std::max_element(possible.begin(), possible.end()) + 1;
+}
+
+bool CpuInfo::isCpuUsable(int cpu) { return cpu >= 0 && (unsigned int)cpu < usable.size() && usable[cpu]; }
+
+std::vector<int> CpuInfo::getUsableCpus() {
+	std::vector<int> result;
+	for (unsigned int cpu = 0; cpu < usable.size(); cpu++) {
+		if (usable[cpu]) result.push_back(cpu);
+	}
+	return result;
+}
+
+std::vector<int> CpuInfo::getAffinity(int tid) {
+	std::vector<int> result;
+	int count = getCpuCount();
+
+	// Tasks are not actually pinned, so all cpus of the (possibly synthetic) topology are allowed
+	if (OSServices::isRecordingAffinity()) {
+		for (int cpu = 0; cpu < count; cpu++) result.push_back(cpu);
+		return result;
+	}
+
+	cpu_set_t *set = CPU_ALLOC(count);
+	size_t size = CPU_ALLOC_SIZE(count);
+	CPU_ZERO_S(size, set);
+
+	if (sched_getaffinity(tid, size, set) == 0) {
+		for (int cpu = 0; cpu < count; cpu++) {
+			if (CPU_ISSET_S(cpu, size, set)) result.push_back(cpu);
+		}
+	}
+
+	CPU_FREE(set);
+	return result;
+}
+
+bool CpuInfo::pinCurrentThread(int cpu) {
+	cpu_set_t *set = CPU_ALLOC(cpu + 1);
+	size_t size = CPU_ALLOC_SIZE(cpu + 1);
+	CPU_ZERO_S(size, set);
+	CPU_SET_S(cpu, size, set);
+
+	int ret = sched_setaffinity(0, size, set);
+	CPU_FREE(set);
+
+	return ret == 0;
+}
 
 int CpuInfo::getCpuDistance(int cpu1, int cpu2) {
-	int node1 = mapping[cpu1];
-	int node2 = mapping[cpu2];
+	if (!latencies.empty()) return latencies[cpu1 * topology.getCpuCount() + cpu2] + 0.5;
+
+	int node1 = topology.getNode(cpu1);
+	int node2 = topology.getNode(cpu2);
 	return distances[node1][node2];
 }
 
@@ -55,8 +172,8 @@ std::vector<int> CpuInfo::parseSysRangeFile(QString path) {
 	QFile file(path);
 	if (file.open(QIODevice::ReadOnly)) {
 		QTextStream stream(&file);
-		auto text = stream.readAll();
-		for (auto range : text.split(",")) {
+		auto text = stream.readAll().trimmed();
+		for (auto range : text.split(",", QString::SkipEmptyParts)) {
 			auto values = range.split("-");
 			if (values.size() == 2) {
 				int start = values.at(0).toInt();
@@ -85,15 +202,66 @@ std::vector<int> CpuInfo::parseSysNodeDistance(QString path) {
 
 std::vector<int> CpuInfo::getCpusByNode(int node) {
 	std::vector<int> result;
-	for (uint i = 0; i < mapping.size(); i++) {
-		if (mapping[i] == node) result.push_back(i);
+	for (int cpu = 0; cpu < topology.getCpuCount(); cpu++) {
+		if (topology.getNode(cpu) == node) {
+			auto cpus = topology.getNodeCpus(cpu);
+			result.assign(cpus.begin(), cpus.end());
+			break;
+		}
 	}
 	return result;
 }
 
 int CpuInfo::getNodeCount() { return distances.size(); }
 
-int CpuInfo::getNodeByCpu(int cpu) { return mapping[cpu]; }
+int CpuInfo::getNodeByCpu(int cpu) { return topology.getNode(cpu); }
+
+const Topology &CpuInfo::getTopology() { return topology; }
+
+void CpuInfo::setLatencies(const std::vector<float> &values) {
+	int count = topology.getCpuCount();
+	if (values.size() == (unsigned int)(count * count))
+		latencies = values;
+	else
+		latencies.clear();
+}
+
+bool CpuInfo::hasLatencies() { return !latencies.empty(); }
+
+void CpuInfo::setBandwidths(const std::vector<std::vector<float>> &values) { bandwidths = values; }
+
+float CpuInfo::getNodeBandwidth(int node, int cores) {
+	if (node < 0 || (unsigned int)node >= bandwidths.size() || bandwidths[node].empty()) return 0;
+
+	int index = std::max(1, std::min(cores, (int)bandwidths[node].size())) - 1;
+	return bandwidths[node][index];
+}
+
+QString CpuInfo::getSignature() {
+	QString text;
+
+	QFile file(SystemPaths::procfs("/cpuinfo"));
+	if (file.open(QIODevice::ReadOnly)) {
+		QTextStream stream(&file);
+		for (auto line : stream.readAll().split("\n")) {
+			if (line.startsWith("model name")) {
+				text += line.trimmed() + "\n";
+				break;
+			}
+		}
+	}
+
+	for (int cpu = 0; cpu < topology.getCpuCount(); cpu++) {
+		text += QString::number(topology.getPackage(cpu)) + "," + QString::number(topology.getNode(cpu)) + "," +
+				QString::number(topology.getCore(cpu)) + "," + QString::number(topology.getL2(cpu)) + "," +
+				QString::number(topology.getLLC(cpu)) + ";";
+	}
+
+	text += "\n";
+	for (int cpu : getUsableCpus()) text += QString::number(cpu) + ",";
+
+	return QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+}
 
 } // namespace OS
 } // namespace AutopinPlus
@@ -0,0 +1,81 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/OS/HotplugDispatcher.h>
+#include <AutopinPlus/OS/CpuInfo.h>
+#include <linux/netlink.h>
+#include <QString>
+#include <QStringList>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace AutopinPlus {
+namespace OS {
+
+HotplugDispatcher &HotplugDispatcher::getInstance() {
+	static HotplugDispatcher instance;
+	return instance;
+}
+
+HotplugDispatcher::HotplugDispatcher() : context(std::string("HotplugDispatcher")){};
+
+int HotplugDispatcher::setupHotplugHandler() { return getInstance().init(); }
+
+int HotplugDispatcher::init() {
+	fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+	if (fd == -1) return -1;
+
+	// Group 1 receives the events sent by the kernel
+	struct sockaddr_nl addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_pid = 0;
+	addr.nl_groups = 1;
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		close(fd);
+		fd = -1;
+		return -1;
+	}
+
+	snUevent = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+	connect(snUevent, SIGNAL(activated(int)), this, SLOT(slot_handleUevent()));
+
+	return 0;
+}
+
+void HotplugDispatcher::slot_handleUevent() {
+	char buffer[8192];
+
+	while (true) {
+		ssize_t len = recv(fd, buffer, sizeof(buffer) - 1, 0);
+		if (len <= 0) break;
+		buffer[len] = '\0';
+
+		// The header of a uevent has the format "<action>@<devpath>"
+		QStringList header = QString(buffer).split('@');
+		if (header.size() != 2 || !header[1].startsWith("/devices/system/cpu/cpu")) continue;
+
+		bool ok;
+		int cpu = header[1].mid(QString("/devices/system/cpu/cpu").size()).toInt(&ok);
+		if (!ok) continue;
+
+		if (header[0] == "online") {
+			context.info("Cpu " + QString::number(cpu) + " is now online");
+			CpuInfo::setupCpuInfo();
+			emit sig_CpuOnline(cpu);
+		} else if (header[0] == "offline") {
+			context.info("Cpu " + QString::number(cpu) + " is now offline");
+			CpuInfo::setupCpuInfo();
+			emit sig_CpuOffline(cpu);
+		}
+	}
+}
+
+} // namespace OS
+} // namespace AutopinPlus
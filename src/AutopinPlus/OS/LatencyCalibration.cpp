@@ -0,0 +1,253 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/OS/LatencyCalibration.h>
+
+#include <AutopinPlus/OS/CpuInfo.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+#include <thread>
+#include <tuple>
+
+namespace AutopinPlus {
+namespace OS {
+
+/*!
+ * Number of round trips per timed batch
+ */
+static const int rounds = 1000;
+
+/*!
+ * Number of timed batches per pair, the fastest one is used
+ */
+static const int batches = 5;
+
+/*!
+ * \brief A cache line which is bounced between two cpus
+ */
+struct alignas(64) CacheLine {
+	std::atomic<int> value;
+	char padding[64 - sizeof(std::atomic<int>)];
+};
+
+/*!
+ * \brief A pair of cpus to measure and the class of pairs it represents
+ */
+struct Sample {
+	int cpu_a;
+	int cpu_b;
+	std::tuple<int, int, int> key;
+	double latency;
+};
+
+//@{
+/*!
+ * Kinds of sampled pairs
+ */
+static const int smt = 0;
+static const int cache = 1;
+static const int cross = 2;
+//@}
+
+/*!
+ * \brief Measures the one-way latency of a cache line transfer between two cpus
+ *
+ * \return The latency in nanoseconds or a negative value if pinning failed
+ */
+static double pingPong(int cpu_a, int cpu_b) {
+	CacheLine line;
+	line.value.store(0);
+	std::atomic<int> ready(0);
+	const int total = (batches + 1) * rounds;
+
+	std::thread partner([&]() {
+		if (!CpuInfo::pinCurrentThread(cpu_b)) {
+			ready.store(-1);
+			return;
+		}
+		ready.store(1);
+
+		for (int i = 0; i < total; i++) {
+			while (line.value.load(std::memory_order_acquire) != 1) {
+			}
+			line.value.store(0, std::memory_order_release);
+		}
+	});
+
+	bool pinned = CpuInfo::pinCurrentThread(cpu_a);
+	while (ready.load() == 0) {
+	}
+
+	if (!pinned || ready.load() < 0) {
+		// Release the partner, if it is waiting
+		if (ready.load() > 0) {
+			for (int i = 0; i < total; i++) {
+				line.value.store(1, std::memory_order_release);
+				while (line.value.load(std::memory_order_acquire) != 0) {
+				}
+			}
+		}
+		partner.join();
+		return -1;
+	}
+
+	double best = std::numeric_limits<double>::max();
+
+	// The first batch warms up caches and frequencies and is not timed
+	for (int batch = 0; batch <= batches; batch++) {
+		auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < rounds; i++) {
+			line.value.store(1, std::memory_order_release);
+			while (line.value.load(std::memory_order_acquire) != 0) {
+			}
+		}
+
+		auto stop = std::chrono::steady_clock::now();
+		double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+		if (batch > 0) best = std::min(best, ns / (2.0 * rounds));
+	}
+
+	partner.join();
+	return best;
+}
+
+std::vector<float> LatencyCalibration::measure(const Topology &topology, const std::vector<int> &cpus) {
+	int cpu_count = topology.getCpuCount();
+	if (cpus.size() < 2) return std::vector<float>();
+
+	// Usable cpus of every core, grouped by last level cache
+	std::map<int, std::map<int, std::vector<int>>> caches;
+	for (int cpu : cpus) caches[topology.getLLC(cpu)][topology.getCore(cpu)].push_back(cpu);
+
+	// Select one pair for every class of pairs
+	std::vector<Sample> samples;
+	for (auto &llc : caches) {
+		for (auto &core : llc.second) {
+			if (core.second.size() >= 2) {
+				samples.push_back({core.second[0], core.second[1], std::make_tuple(smt, llc.first, 0), -1});
+				break;
+			}
+		}
+
+		if (llc.second.size() >= 2) {
+			auto first = llc.second.begin();
+			auto second = std::next(first);
+			samples.push_back({first->second[0], second->second[0], std::make_tuple(cache, llc.first, 0), -1});
+		}
+	}
+
+	for (auto llc_a = caches.begin(); llc_a != caches.end(); llc_a++) {
+		for (auto llc_b = std::next(llc_a); llc_b != caches.end(); llc_b++) {
+			int cpu_a = llc_a->second.begin()->second[0];
+			int cpu_b = llc_b->second.begin()->second[0];
+			samples.push_back({cpu_a, cpu_b, std::make_tuple(cross, llc_a->first, llc_b->first), -1});
+		}
+	}
+
+	// Measure disjoint pairs in parallel
+	std::vector<bool> done(samples.size(), false);
+	unsigned int remaining = samples.size();
+	while (remaining > 0) {
+		std::vector<bool> busy(cpu_count, false);
+		std::vector<std::thread> workers;
+
+		for (unsigned int i = 0; i < samples.size(); i++) {
+			Sample &sample = samples[i];
+			if (done[i] || busy[sample.cpu_a] || busy[sample.cpu_b]) continue;
+
+			busy[sample.cpu_a] = busy[sample.cpu_b] = true;
+			done[i] = true;
+			remaining--;
+
+			workers.push_back(std::thread([&sample]() { sample.latency = pingPong(sample.cpu_a, sample.cpu_b); }));
+		}
+
+		for (auto &worker : workers) worker.join();
+	}
+
+	std::map<std::tuple<int, int, int>, double> results;
+	double worst = 0;
+	for (auto &sample : samples) {
+		if (sample.latency < 0) continue;
+		results[sample.key] = sample.latency;
+		worst = std::max(worst, sample.latency);
+	}
+
+	if (results.empty()) return std::vector<float>();
+
+	// Expand the sampled classes to the full matrix, unknown pairs are assumed to be the slowest ones
+	auto lookup = [&](const std::tuple<int, int, int> &key) {
+		auto it = results.find(key);
+		return it == results.end() ? worst : it->second;
+	};
+
+	std::vector<float> latencies(cpu_count * cpu_count, worst);
+	for (int a = 0; a < cpu_count; a++) {
+		for (int b = 0; b < cpu_count; b++) {
+			int llc_a = topology.getLLC(a), llc_b = topology.getLLC(b);
+			double latency;
+
+			if (a == b)
+				latency = 0;
+			else if (topology.getCore(a) == topology.getCore(b))
+				latency = lookup(std::make_tuple(smt, llc_a, 0));
+			else if (llc_a == llc_b)
+				latency = lookup(std::make_tuple(cache, llc_a, 0));
+			else
+				latency = lookup(std::make_tuple(cross, std::min(llc_a, llc_b), std::max(llc_a, llc_b)));
+
+			latencies[a * cpu_count + b] = latency;
+		}
+	}
+
+	return latencies;
+}
+
+bool LatencyCalibration::load(QString path, int cpu_count, std::vector<float> &latencies) {
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) return false;
+
+	QTextStream stream(&file);
+	QStringList values = stream.readAll().split(QRegExp("\\s+"), QString::SkipEmptyParts);
+	if (values.size() != cpu_count * cpu_count) return false;
+
+	std::vector<float> result;
+	for (auto value : values) {
+		bool ok;
+		result.push_back(value.toFloat(&ok));
+		if (!ok) return false;
+	}
+
+	latencies = result;
+	return true;
+}
+
+bool LatencyCalibration::save(QString path, int cpu_count, const std::vector<float> &latencies) {
+	if (!QDir().mkpath(QFileInfo(path).absolutePath())) return false;
+
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+	QTextStream stream(&file);
+	for (int a = 0; a < cpu_count; a++) {
+		for (int b = 0; b < cpu_count; b++) stream << latencies[a * cpu_count + b] << (b + 1 < cpu_count ? " " : "\n");
+	}
+
+	return true;
+}
+
+} // namespace OS
+} // namespace AutopinPlus
@@ -8,6 +8,8 @@
 #include <AutopinPlus/OS/OSServices.h>
 
 #include <AutopinPlus/ObservedProcess.h>
+#include <AutopinPlus/OS/SystemPaths.h>
+#include <QDateTime>
 #include <errno.h>
 #include <fcntl.h>
 #include <iostream>
@@ -37,6 +39,16 @@
 namespace AutopinPlus {
 namespace OS {
 
+/*!
+ * File for recording pinnings, if setAffinityLog() has been called.
+ */
+static QFile affinity_log;
+
+/*!
+ * Protects affinity_log, as all instances of OSServices share it.
+ */
+static QMutex affinity_log_mutex;
+
 OSServices::OSServices(AutopinContext &context)
 	: tracer(context), comm_notifier(nullptr), server_socket(-1), client_socket(-1), context(context) {
 	integer = QRegExp("\\d+");
@@ -368,7 +380,7 @@ ProcessTree::autopin_tid_list OSServices::getProcessThreads(int pid) {
 	bool ret;
 
 	// set path
-	procpath = "/proc/" + QString::number(pid) + "/task";
+	procpath = SystemPaths::procfs("/" + QString::number(pid) + "/task");
 
 	procdir.setSorting(QDir::Name);
 	procdir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
@@ -400,7 +412,7 @@ ProcessTree::autopin_tid_list OSServices::getChildProcesses(int pid) {
 	bool success = true;
 
 	// set path
-	procpath = "/proc";
+	procpath = SystemPaths::procfs("");
 
 	procdir.setSorting(QDir::Name);
 	procdir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
@@ -445,18 +457,51 @@ int OSServices::getTaskSortId(int tid) {
 	return str_result.toInt();
 }
 
+qint64 OSServices::getTaskCpuTime(int tid) {
+	QMutexLocker locker(&mutex);
+
+	bool ok_user, ok_system;
+	qint64 user = getProcEntry(tid, 13, false).toLongLong(&ok_user);
+	qint64 system = getProcEntry(tid, 14, false).toLongLong(&ok_system);
+	if (!ok_user || !ok_system) return -1;
+
+	return user + system;
+}
+
 int OSServices::setAffinity(int tid, int cpu) {
-	cpu_set_t cores;
+	if (isRecordingAffinity()) {
+		QMutexLocker locker(&affinity_log_mutex);
+		QTextStream stream(&affinity_log);
+		stream << QDateTime::currentMSecsSinceEpoch() << " " << tid << " " << cpu << "\n";
+		return 0;
+	}
+
 	pid_t linux_tid = tid;
 
-	// Setup CPU mask
-	CPU_ZERO(&cores);
-	CPU_SET(cpu, &cores);
+	// Setup CPU mask, cpu ids may exceed the size of a static cpu_set_t
+	cpu_set_t *cores = CPU_ALLOC(cpu + 1);
+	size_t size = CPU_ALLOC_SIZE(cpu + 1);
+	CPU_ZERO_S(size, cores);
+	CPU_SET_S(cpu, size, cores);
 
 	// set affinity
-	return sched_setaffinity(linux_tid, sizeof(cores), &cores);
+	int ret = sched_setaffinity(linux_tid, size, cores);
+	CPU_FREE(cores);
+
+	return ret;
 }
 
+bool OSServices::setAffinityLog(const QString &path) {
+	QMutexLocker locker(&affinity_log_mutex);
+
+	if (affinity_log.isOpen()) affinity_log.close();
+	affinity_log.setFileName(path);
+
+	return affinity_log.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
+
+bool OSServices::isRecordingAffinity() { return affinity_log.isOpen(); }
+
 ProcessTree::autopin_tid_list OSServices::getPid(QString proc) {
 	QMutexLocker locker(&mutex);
 
@@ -470,7 +515,7 @@ ProcessTree::autopin_tid_list OSServices::getPid(QString proc) {
 	procdir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
 
 	// try to enter proc directory
-	ret = procdir.cd("/proc");
+	ret = procdir.cd(SystemPaths::procfs(""));
 	if (ret == false) {
 		context.report(Error::SYSTEM, "access_proc", "Could not access the proc filesystem");
 		return result;
@@ -499,7 +544,7 @@ QString OSServices::getCmd(int pid) {
 	QMutexLocker locker(&mutex);
 	QString result;
 
-	QFile procfile("/proc/" + QString::number(pid) + "/cmdline");
+	QFile procfile(SystemPaths::procfs("/" + QString::number(pid) + "/cmdline"));
 	if (!procfile.open(QIODevice::ReadOnly)) return result;
 
 	// The last byte of the file is 0 and is ignored
@@ -528,7 +573,7 @@ QString OSServices::getProcEntry(int tid, int index, bool error) {
 		return result;
 	}
 
-	QFile stat_file("/proc/" + QString::number(tid) + "/stat");
+	QFile stat_file(SystemPaths::procfs("/" + QString::number(tid) + "/stat"));
 
 	if (!stat_file.open(QIODevice::ReadOnly)) {
 		if (error)
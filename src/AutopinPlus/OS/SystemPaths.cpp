@@ -0,0 +1,50 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/OS/SystemPaths.h>
+
+namespace AutopinPlus {
+namespace OS {
+
+/*!
+ * Mount point of sysfs.
+ */
+static QString sysfs_root = "/sys";
+
+/*!
+ * Mount point of procfs.
+ */
+static QString procfs_root = "/proc";
+
+void SystemPaths::setSysfsRoot(const QString &root) {
+	sysfs_root = root;
+	while (sysfs_root.endsWith("/")) sysfs_root.chop(1);
+	if (sysfs_root.isEmpty()) sysfs_root = "/";
+}
+
+void SystemPaths::setProcfsRoot(const QString &root) {
+	procfs_root = root;
+	while (procfs_root.endsWith("/")) procfs_root.chop(1);
+	if (procfs_root.isEmpty()) procfs_root = "/";
+}
+
+QString SystemPaths::getSysfsRoot() { return sysfs_root; }
+
+bool SystemPaths::isSysfsOverridden() { return sysfs_root != "/sys"; }
+
+QString SystemPaths::sysfs(const QString &path) { return sysfs_root + path; }
+
+QString SystemPaths::procfs(const QString &path) { return procfs_root + path; }
+
+QString SystemPaths::mapSysfs(const QString &path) {
+	if (path == "/sys" || path.startsWith("/sys/")) return sysfs_root + path.mid(4);
+
+	return path;
+}
+
+} // namespace OS
+} // namespace AutopinPlus
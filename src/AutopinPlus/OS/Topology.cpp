@@ -0,0 +1,231 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/OS/Topology.h>
+
+#include <AutopinPlus/OS/CpuInfo.h>
+#include <algorithm>
+#include <map>
+#include <QFile>
+#include <QString>
+#include <QTextStream>
+
+namespace AutopinPlus {
+namespace OS {
+
+/*!
+ * \brief Returns the trimmed content of a sysfs file or an empty string
+ */
+static QString readSysFile(QString path) {
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) return "";
+
+	QTextStream stream(&file);
+	return stream.readAll().trimmed();
+}
+
+/*!
+ * \brief Returns the lowest cpu listed in a sysfs range file or -1
+ */
+static int readSysRangeMin(QString path) {
+	auto cpus = CpuInfo::parseSysRangeFile(path);
+	if (cpus.empty()) return -1;
+	return *std::min_element(cpus.begin(), cpus.end());
+}
+
+Topology::Topology() {}
+
+Topology Topology::read(int cpu_count, const QString &root) {
+	Topology result;
+
+	// Performance and efficiency cores of hybrid processors are exposed as separate pmus
+	auto performance = CpuInfo::parseSysRangeFile(root + "/devices/cpu_core/cpus");
+	auto efficiency = CpuInfo::parseSysRangeFile(root + "/devices/cpu_atom/cpus");
+
+	std::vector<int> raw_capacity(cpu_count, 0);
+	int highest = 0;
+
+	for (int cpu = 0; cpu < cpu_count; cpu++) {
+		QString path = root + "/devices/system/cpu/cpu" + QString::number(cpu);
+		Cpu entry;
+
+		bool ok;
+		entry.package = readSysFile(path + "/topology/physical_package_id").toInt(&ok);
+		if (!ok || entry.package < 0) entry.package = 0;
+
+		entry.node = 0;
+
+		entry.core = readSysRangeMin(path + "/topology/thread_siblings_list");
+		if (entry.core == -1) entry.core = cpu;
+
+		// Instruction caches are ignored, the last level cache is the data cache with the highest level
+		entry.l2 = -1;
+		entry.llc = -1;
+		int llc_level = 0;
+		for (int index = 0; QFile::exists(path + "/cache/index" + QString::number(index)); index++) {
+			QString cache = path + "/cache/index" + QString::number(index);
+			if (readSysFile(cache + "/type") == "Instruction") continue;
+
+			int level = readSysFile(cache + "/level").toInt();
+			int shared = readSysRangeMin(cache + "/shared_cpu_list");
+			if (shared == -1) continue;
+
+			if (level == 2) entry.l2 = shared;
+			if (level >= llc_level) {
+				llc_level = level;
+				entry.llc = shared;
+			}
+		}
+		if (entry.l2 == -1) entry.l2 = entry.core;
+		if (entry.llc == -1) entry.llc = entry.l2;
+
+		entry.core_class = STANDARD;
+		if (std::find(performance.begin(), performance.end(), cpu) != performance.end()) entry.core_class = PERFORMANCE;
+		if (std::find(efficiency.begin(), efficiency.end(), cpu) != efficiency.end()) entry.core_class = EFFICIENCY;
+
+		raw_capacity[cpu] = readSysFile(path + "/cpu_capacity").toInt(&ok);
+		if (!ok) raw_capacity[cpu] = readSysFile(path + "/acpi_cppc/highest_perf").toInt(&ok);
+		if (!ok) raw_capacity[cpu] = 0;
+		highest = std::max(highest, raw_capacity[cpu]);
+
+		result.cpus.push_back(entry);
+	}
+
+	// Cores of the same type differ slightly in highest_perf on processors with "preferred cores", which must not
+	// create classes of their own. If the kernel exposes the core types, every class gets the highest capacity of
+	// its cpus. Otherwise sorted capacities less than 10% apart form one class.
+	std::map<int, int> class_capacity;
+	if (!performance.empty() || !efficiency.empty()) {
+		for (int cpu = 0; cpu < cpu_count; cpu++) {
+			int &capacity = class_capacity[result.cpus[cpu].core_class];
+			capacity = std::max(capacity, raw_capacity[cpu]);
+		}
+		for (int cpu = 0; cpu < cpu_count; cpu++) raw_capacity[cpu] = class_capacity[result.cpus[cpu].core_class];
+	} else {
+		std::vector<int> sorted(raw_capacity);
+		std::sort(sorted.rbegin(), sorted.rend());
+		for (unsigned int i = 0; i < sorted.size(); i++) {
+			bool same = i > 0 && (long long)sorted[i] * 10 >= (long long)sorted[i - 1] * 9;
+			class_capacity[sorted[i]] = same ? class_capacity[sorted[i - 1]] : sorted[i];
+		}
+
+		// Slower classes are efficiency cores, so that big.LITTLE processors are hybrid as well
+		bool hybrid = false;
+		for (int cpu = 0; cpu < cpu_count; cpu++) {
+			raw_capacity[cpu] = class_capacity[raw_capacity[cpu]];
+			if (raw_capacity[cpu] > 0 && raw_capacity[cpu] < highest) {
+				result.cpus[cpu].core_class = EFFICIENCY;
+				hybrid = true;
+			}
+		}
+		for (int cpu = 0; cpu < cpu_count; cpu++) {
+			if (hybrid && raw_capacity[cpu] == highest) result.cpus[cpu].core_class = PERFORMANCE;
+		}
+	}
+
+	for (int cpu = 0; cpu < cpu_count; cpu++) {
+		if (highest > 0 && raw_capacity[cpu] > 0)
+			result.cpus[cpu].capacity = (long long)raw_capacity[cpu] * max_capacity / highest;
+		else if (result.cpus[cpu].core_class == EFFICIENCY)
+			// Without any capacity information, efficiency cores are assumed to be half as fast
+			result.cpus[cpu].capacity = max_capacity / 2;
+		else
+			result.cpus[cpu].capacity = max_capacity;
+	}
+
+	for (int node : CpuInfo::parseSysRangeFile(root + "/devices/system/node/online")) {
+		auto node_cpus =
+			CpuInfo::parseSysRangeFile(root + "/devices/system/node/node" + QString::number(node) + "/cpulist");
+		for (int cpu : node_cpus) {
+			if (cpu < cpu_count) result.cpus[cpu].node = node;
+		}
+	}
+
+	std::vector<int> ids(cpu_count);
+
+	for (int cpu = 0; cpu < cpu_count; cpu++) ids[cpu] = result.cpus[cpu].core;
+	result.siblings.build(ids);
+
+	for (int cpu = 0; cpu < cpu_count; cpu++) ids[cpu] = result.cpus[cpu].l2;
+	result.l2.build(ids);
+
+	for (int cpu = 0; cpu < cpu_count; cpu++) ids[cpu] = result.cpus[cpu].llc;
+	result.llc.build(ids);
+
+	for (int cpu = 0; cpu < cpu_count; cpu++) ids[cpu] = result.cpus[cpu].package;
+	result.packages.build(ids);
+
+	for (int cpu = 0; cpu < cpu_count; cpu++) ids[cpu] = result.cpus[cpu].node;
+	result.nodes.build(ids);
+
+	return result;
+}
+
+int Topology::getCpuCount() const { return cpus.size(); }
+
+int Topology::getPackage(int cpu) const { return cpus[cpu].package; }
+
+int Topology::getNode(int cpu) const { return cpus[cpu].node; }
+
+int Topology::getCore(int cpu) const { return cpus[cpu].core; }
+
+int Topology::getL2(int cpu) const { return cpus[cpu].l2; }
+
+int Topology::getLLC(int cpu) const { return cpus[cpu].llc; }
+
+Topology::CoreClass Topology::getCoreClass(int cpu) const { return cpus[cpu].core_class; }
+
+int Topology::getCapacity(int cpu) const { return cpus[cpu].capacity; }
+
+bool Topology::isHybrid() const {
+	for (const auto &cpu : cpus) {
+		if (cpu.core_class != cpus[0].core_class) return true;
+	}
+
+	return false;
+}
+
+Topology::CpuList Topology::getSiblings(int cpu) const { return siblings.get(cpu); }
+
+Topology::CpuList Topology::getL2Sharers(int cpu) const { return l2.get(cpu); }
+
+Topology::CpuList Topology::getLLCSharers(int cpu) const { return llc.get(cpu); }
+
+Topology::CpuList Topology::getPackageCpus(int cpu) const { return packages.get(cpu); }
+
+Topology::CpuList Topology::getNodeCpus(int cpu) const { return nodes.get(cpu); }
+
+void Topology::Groups::build(const std::vector<int> &ids) {
+	std::map<int, int> index;
+	for (int id : ids) index.insert(std::make_pair(id, 0));
+
+	int count = 0;
+	for (auto &elem : index) elem.second = count++;
+
+	group.resize(ids.size());
+	offsets.assign(count + 1, 0);
+	members.resize(ids.size());
+
+	for (unsigned int cpu = 0; cpu < ids.size(); cpu++) {
+		group[cpu] = index[ids[cpu]];
+		offsets[group[cpu] + 1]++;
+	}
+
+	for (int i = 0; i < count; i++) offsets[i + 1] += offsets[i];
+
+	// Cpus are inserted in ascending order, so every group is sorted
+	std::vector<int> next(offsets.begin(), offsets.end() - 1);
+	for (unsigned int cpu = 0; cpu < ids.size(); cpu++) members[next[group[cpu]]++] = cpu;
+}
+
+Topology::CpuList Topology::Groups::get(int cpu) const {
+	const int *data = members.data();
+	return CpuList(data + offsets[group[cpu]], data + offsets[group[cpu] + 1]);
+}
+
+} // namespace OS
+} // namespace AutopinPlus
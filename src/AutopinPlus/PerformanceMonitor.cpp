@@ -9,17 +9,25 @@
 
 #include <AutopinPlus/Error.h>
 #include <AutopinPlus/Exception.h> // for Exception
+#include <algorithm>				   // for find
+#include <qmutex.h>				   // for QMutexLocker
+#include <time.h>				   // for clock_gettime
 #include <utility>				   // for pair
+#include <vector>				   // for vector
 
 namespace AutopinPlus {
 
 PerformanceMonitor::PerformanceMonitor(QString name, const Configuration &config, AutopinContext &context)
-	: config(config), context(context), valtype(UNKNOWN), name(name) {}
+	: config(config), context(context), valtype(UNKNOWN), valscope(THREAD), name(name) {}
 
 PerformanceMonitor::~PerformanceMonitor() {}
 
 PerformanceMonitor::montype PerformanceMonitor::getValType() { return valtype; }
 
+PerformanceMonitor::monscope PerformanceMonitor::getScope() { return valscope; }
+
+bool PerformanceMonitor::isCumulative() { return true; }
+
 QString PerformanceMonitor::getType() { return type; }
 
 QString PerformanceMonitor::getName() { return name; }
@@ -32,14 +40,24 @@ void PerformanceMonitor::setObservedProcessPid(int npid){
 }
 
 void PerformanceMonitor::start(ProcessTree::autopin_tid_list tasks) {
+	QMutexLocker locker(&access_mutex);
+
 	for (const auto &task : tasks) {
 		start(task);
 	}
 }
 
 PerformanceMonitor::autopin_measurements PerformanceMonitor::value(ProcessTree::autopin_tid_list tasks) {
+	QMutexLocker locker(&access_mutex);
+
 	autopin_measurements result;
 
+	// The tasks share the counters of a wider scope, which a batch reads only once per unit
+	if (getScope() != THREAD) {
+		readShared(tasks, result);
+		return result;
+	}
+
 	for (const auto &task : tasks) {
 		std::pair<int, double> respair;
 		respair.first = task;
@@ -54,9 +72,196 @@ PerformanceMonitor::autopin_measurements PerformanceMonitor::value(ProcessTree::
 	return result;
 }
 
+void PerformanceMonitor::values(const int *tids, size_t count, value_batch &result) {
+	QMutexLocker locker(&access_mutex);
+
+	result.resize(count);
+
+	// value() reports unmonitored tasks to the context as an error, so they are filtered out here.
+	ProcessTree::autopin_tid_list monitored = getMonitoredTasks();
+
+	for (size_t i = 0; i < count; i++) {
+		result.values[i] = 0;
+		result.timestamps[i] = getTimestamp();
+		result.coverage[i] = 0;
+
+		if (monitored.find(tids[i]) == monitored.end()) {
+			result.status[i] = VALUE_UNMONITORED;
+			continue;
+		}
+
+		// Other errors of value() are reported to the context, so stop at the first one
+		if (context.isError()) {
+			result.status[i] = VALUE_FAILED;
+			continue;
+		}
+
+		// On a sampler thread, the errors are only collected and must be detected by their count
+		int reports = AutopinContext::Quiet::getReports();
+		result.values[i] = value(tids[i]);
+		bool failed = context.isError() || AutopinContext::Quiet::getReports() != reports;
+
+		result.timestamps[i] = getTimestamp();
+		result.status[i] = failed ? VALUE_FAILED : VALUE_OK;
+		result.coverage[i] = failed ? 0 : coverage(tids[i]);
+	}
+}
+
+double PerformanceMonitor::coverage(int) { return 1.0; }
+
+void PerformanceMonitor::sample(const int *tids, size_t count, value_batch &result) {
+	QMutexLocker locker(&access_mutex);
+
+	values(tids, count, result);
+
+	QMutexLocker window_locker(&window_mutex);
+	for (size_t i = 0; i < result.count; i++) {
+		if (result.status[i] != VALUE_OK) continue;
+
+		auto window = windows.find(tids[i]);
+		if (window == windows.end()) window = windows.emplace(tids[i], SampleWindow(window_config)).first;
+		window->second.push(result.timestamps[i], result.values[i]);
+	}
+
+	// Drop the windows of tasks which are not monitored anymore.
+	if (windows.size() > count) {
+		for (auto window = windows.begin(); window != windows.end();) {
+			if (std::find(tids, tids + count, window->first) == tids + count) {
+				window = windows.erase(window);
+			} else {
+				window++;
+			}
+		}
+	}
+}
+
+void PerformanceMonitor::setWindowConfig(const SampleWindow::Config &config) {
+	QMutexLocker locker(&window_mutex);
+
+	window_config = config;
+}
+
+double PerformanceMonitor::getRate(int tid, int span, valstatus *status) {
+	QMutexLocker locker(&window_mutex);
+
+	auto window = findWindow(tid, 2, status);
+	return window != nullptr ? window->getRate((int64_t)span * 1000000) : 0;
+}
+
+double PerformanceMonitor::getEwma(int tid, valstatus *status) {
+	QMutexLocker locker(&window_mutex);
+
+	auto window = findWindow(tid, 1, status);
+	return window != nullptr ? window->getEwma() : 0;
+}
+
+double PerformanceMonitor::getMinimum(int tid, valstatus *status) {
+	QMutexLocker locker(&window_mutex);
+
+	auto window = findWindow(tid, 1, status);
+	return window != nullptr ? window->getMinimum() : 0;
+}
+
+double PerformanceMonitor::getMaximum(int tid, valstatus *status) {
+	QMutexLocker locker(&window_mutex);
+
+	auto window = findWindow(tid, 1, status);
+	return window != nullptr ? window->getMaximum() : 0;
+}
+
+double PerformanceMonitor::getMean(int tid, valstatus *status) {
+	QMutexLocker locker(&window_mutex);
+
+	auto window = findWindow(tid, 1, status);
+	return window != nullptr ? window->getMean() : 0;
+}
+
+double PerformanceMonitor::getPercentile(int tid, double quantile, valstatus *status) {
+	QMutexLocker locker(&window_mutex);
+
+	auto window = findWindow(tid, 1, status);
+	return window != nullptr ? window->getPercentile(quantile) : 0;
+}
+
+const SampleWindow *PerformanceMonitor::findWindow(int tid, size_t minimum, valstatus *status) {
+	readSamples();
+
+	// Without a sampler or logger calling sample(), no task has a window.
+	auto window = windows.find(tid);
+	bool ok = window != windows.end() && window->second.getCount() >= minimum;
+
+	if (status != nullptr) *status = ok ? VALUE_OK : VALUE_UNMONITORED;
+
+	return ok ? &window->second : nullptr;
+}
+
+bool PerformanceMonitor::readShared(const ProcessTree::autopin_tid_list &tasks, autopin_measurements &result) {
+	std::vector<int> tids(tasks.begin(), tasks.end());
+	value_batch batch;
+	values(tids.data(), tids.size(), batch);
+
+	for (size_t i = 0; i < tids.size(); i++) {
+		if (batch.status[i] != VALUE_OK) {
+			QString reason = batch.status[i] == VALUE_UNMONITORED ? "Thread is not being monitored."
+																	: "Could not read from monitor.";
+			context.report(Error::MONITOR, "value",
+						   name + ".value(" + QString::number(tids[i]) + ") failed: " + reason);
+			return false;
+		}
+
+		result[tids[i]] = batch.values[i];
+	}
+
+	return true;
+}
+
+void PerformanceMonitor::readSamples() {
+	if (samples == nullptr) return;
+
+	SampleRing::Sample sample;
+	while (samples->read(window_cursor, sample)) {
+		// The sampler publishes tasks which are not monitored anymore once with this status.
+		if (sample.status == VALUE_UNMONITORED) {
+			windows.erase(sample.tid);
+			continue;
+		}
+		if (sample.status != VALUE_OK) continue;
+
+		auto window = windows.find(sample.tid);
+		if (window == windows.end()) window = windows.emplace(sample.tid, SampleWindow(window_config)).first;
+		window->second.push(sample.timestamp, sample.value);
+	}
+}
+
+void PerformanceMonitor::value_batch::resize(size_t new_count) {
+	count = new_count;
+
+	// Never shrink, so that reusing the batch does not allocate memory
+	if (values.size() < count) {
+		values.resize(count);
+		timestamps.resize(count);
+		status.resize(count);
+		coverage.resize(count);
+	}
+}
+
 PerformanceMonitor::autopin_measurements PerformanceMonitor::stop(ProcessTree::autopin_tid_list tasks) {
+	QMutexLocker locker(&access_mutex);
+
 	autopin_measurements result;
 
+	// Stopping a task is reading its value and clearing it, so the values are read as one batch
+	if (getScope() != THREAD) {
+		if (!readShared(tasks, result)) return result;
+
+		for (const auto &task : tasks) {
+			clear(task);
+			if (context.isError()) return result;
+		}
+
+		return result;
+	}
+
 	for (const auto &task : tasks) {
 		std::pair<int, double> respair;
 		respair.first = task;
@@ -72,10 +277,14 @@ PerformanceMonitor::autopin_measurements PerformanceMonitor::stop(ProcessTree::a
 }
 
 void PerformanceMonitor::clear(ProcessTree::autopin_tid_list tasks) {
+	QMutexLocker locker(&access_mutex);
+
 	for (const auto &task : tasks) clear(task);
 }
 
 PerformanceMonitor::autopin_measurements PerformanceMonitor::stop() {
+	QMutexLocker locker(&access_mutex);
+
 	ProcessTree::autopin_tid_list tasks;
 	autopin_measurements result;
 
@@ -89,6 +298,8 @@ PerformanceMonitor::autopin_measurements PerformanceMonitor::stop() {
 }
 
 void PerformanceMonitor::clear() {
+	QMutexLocker locker(&access_mutex);
+
 	ProcessTree::autopin_tid_list tasks;
 	autopin_measurements result;
 
@@ -113,6 +324,66 @@ PerformanceMonitor::montype PerformanceMonitor::readMontype(const QString &strin
 	return result;
 }
 
+PerformanceMonitor::monscope PerformanceMonitor::readMonscope(const QString &string) {
+	PerformanceMonitor::monscope result;
+
+	if (string.toLower() == "thread") {
+		result = monscope::THREAD;
+	} else if (string.toLower() == "process") {
+		result = monscope::PROCESS;
+	} else if (string.toLower() == "node") {
+		result = monscope::NODE;
+	} else if (string.toLower() == "package") {
+		result = monscope::PACKAGE;
+	} else if (string.toLower() == "system") {
+		result = monscope::SYSTEM;
+	} else {
+		throw Exception("PerformanceMonitor::readMonscope(" + string +
+						") failed: Must be one of 'thread', 'process', 'node', 'package', 'system'.");
+	}
+
+	return result;
+}
+
+QString PerformanceMonitor::showMonscope(const monscope &scope) {
+	QString result;
+
+	switch (scope) {
+	case monscope::THREAD:
+		result = "thread";
+		break;
+	case monscope::PROCESS:
+		result = "process";
+		break;
+	case monscope::NODE:
+		result = "node";
+		break;
+	case monscope::PACKAGE:
+		result = "package";
+		break;
+	case monscope::SYSTEM:
+		result = "system";
+		break;
+	default:
+		throw Exception("PerformanceMonitor::showMonscope(" + QString::number(scope) + ") failed: Invalid monscope.");
+	}
+
+	return result;
+}
+
+QMutex &PerformanceMonitor::getMutex() { return access_mutex; }
+
+std::shared_ptr<const SampleRing> PerformanceMonitor::getSamples() const { return samples; }
+
+void PerformanceMonitor::setSamples(std::shared_ptr<const SampleRing> ring) { samples = ring; }
+
+int64_t PerformanceMonitor::getTimestamp() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 QString PerformanceMonitor::showMontype(const montype &type) {
 	QString result;
 
@@ -0,0 +1,218 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/PlacementTree.h>
+
+#include <AutopinPlus/OS/CpuInfo.h>
+#include <algorithm>
+#include <functional>
+#include <tuple>
+
+namespace CpuInfo = AutopinPlus::OS::CpuInfo;
+
+namespace AutopinPlus {
+
+PlacementTree::PlacementTree() {}
+
+void PlacementTree::build(const OS::Topology &topology) {
+	int cpu_count = topology.getCpuCount();
+
+	nodes.clear();
+	numa_nodes.clear();
+	leaves.assign(cpu_count, -1);
+	capacities.assign(cpu_count, 0);
+	cpu_classes.assign(cpu_count, 0);
+
+	// Group the cpus by their capacity, there are only a few distinct ones even on hybrid processors
+	classes.clear();
+	for (int cpu = 0; cpu < cpu_count; cpu++) {
+		capacities[cpu] = topology.getCapacity(cpu);
+		if (std::find(classes.begin(), classes.end(), capacities[cpu]) == classes.end())
+			classes.push_back(capacities[cpu]);
+	}
+	std::sort(classes.begin(), classes.end(), std::greater<int>());
+	for (int cpu = 0; cpu < cpu_count; cpu++)
+		cpu_classes[cpu] = std::find(classes.begin(), classes.end(), capacities[cpu]) - classes.begin();
+
+	nodes.push_back({MACHINE, -1, 0, 0, 0, 0, 0, std::vector<int>(classes.size(), 0), {}});
+
+	// Sort the cpus by their position in the hierarchy, so that the cpus of every subtree are adjacent
+	std::vector<std::tuple<int, int, int, int, int>> keys;
+	for (int cpu = 0; cpu < cpu_count; cpu++) {
+		keys.push_back(std::make_tuple(topology.getPackage(cpu), topology.getNode(cpu), topology.getLLC(cpu),
+									   topology.getCore(cpu), cpu));
+	}
+	std::sort(keys.begin(), keys.end());
+
+	for (const auto &key : keys) {
+		int ids[] = {std::get<0>(key), std::get<1>(key), std::get<2>(key), std::get<3>(key), std::get<4>(key)};
+		int cpu = ids[4];
+
+		int current = 0;
+		nodes[current].size++;
+		nodes[current].free++;
+		nodes[current].free_by_class[cpu_classes[cpu]]++;
+		nodes[current].capacity = std::max(nodes[current].capacity, capacities[cpu]);
+
+		for (int level = PACKAGE; level <= THREAD; level++) {
+			const int last = nodes[current].children.empty() ? -1 : nodes[current].children.back();
+
+			if (last == -1 || nodes[last].id != ids[level - 1]) {
+				int index = nodes.size();
+				nodes.push_back({static_cast<Level>(level), current, ids[level - 1], cpu, 0, 0, 0,
+								 std::vector<int>(classes.size(), 0), {}});
+				nodes[current].children.push_back(index);
+				if (level == NODE) numa_nodes.push_back(index);
+			}
+
+			current = nodes[current].children.back();
+			nodes[current].size++;
+			nodes[current].free++;
+			nodes[current].free_by_class[cpu_classes[cpu]]++;
+			nodes[current].capacity = std::max(nodes[current].capacity, capacities[cpu]);
+		}
+
+		leaves[cpu] = current;
+	}
+}
+
+void PlacementTree::setUsed(int cpu, bool used) {
+	if (cpu < 0 || (unsigned int)cpu >= leaves.size() || leaves[cpu] == -1) return;
+
+	int delta = used ? -1 : 1;
+	int cpu_class = cpu_classes[cpu];
+
+	// Nothing to do if the state of the cpu does not change
+	if (nodes[leaves[cpu]].free == (used ? 0 : 1)) return;
+
+	// Only the ancestors change, their highest free capacity follows from the counts per class
+	for (int current = leaves[cpu]; current != -1; current = nodes[current].parent) {
+		Node &elem = nodes[current];
+		elem.free += delta;
+		elem.free_by_class[cpu_class] += delta;
+
+		elem.capacity = 0;
+		for (size_t i = 0; i < classes.size(); i++) {
+			if (elem.free_by_class[i] > 0) {
+				elem.capacity = classes[i];
+				break;
+			}
+		}
+	}
+}
+
+bool PlacementTree::isFree(int cpu) const {
+	if (cpu < 0 || (unsigned int)cpu >= leaves.size() || leaves[cpu] == -1) return false;
+
+	return nodes[leaves[cpu]].free > 0;
+}
+
+int PlacementTree::getFreeCount() const {
+	if (nodes.empty()) return 0;
+
+	return nodes[0].free;
+}
+
+int PlacementTree::findCompact(int anchor) const {
+	if (getFreeCount() == 0) return -1;
+
+	if (anchor < 0 || (unsigned int)anchor >= leaves.size() || leaves[anchor] == -1) return descend(0, false);
+
+	// Find the lowest ancestor of the anchor which has a free cpu
+	int current = leaves[anchor];
+	while (nodes[current].free == 0) current = nodes[current].parent;
+
+	// Above the numa node level, the numa distance decides
+	if (nodes[current].level < NODE) {
+		int best_distance = -1;
+
+		for (int node : numa_nodes) {
+			if (nodes[node].free == 0) continue;
+
+			int distance = CpuInfo::getCpuDistance(anchor, nodes[node].cpu);
+			if (best_distance == -1 || distance < best_distance ||
+				(distance == best_distance && nodes[node].capacity > nodes[current].capacity)) {
+				best_distance = distance;
+				current = node;
+			}
+		}
+	}
+
+	// Every child of the ancestor is equally close to the anchor, as the one containing the anchor is full
+	return descend(current, false);
+}
+
+int PlacementTree::findScatter() const {
+	if (getFreeCount() == 0) return -1;
+
+	return descend(0, true);
+}
+
+int PlacementTree::findScatter(int node) const {
+	for (int index : numa_nodes) {
+		if (nodes[index].id == node && nodes[index].free > 0) return descend(index, true);
+	}
+
+	return -1;
+}
+
+int PlacementTree::getFreeCount(int node) const {
+	int result = 0;
+
+	// A numa node may span several packages
+	for (int index : numa_nodes) {
+		if (nodes[index].id == node) result += nodes[index].free;
+	}
+
+	return result;
+}
+
+std::vector<int> PlacementTree::getNodes() const {
+	std::vector<int> result;
+
+	for (int index : numa_nodes) {
+		if (std::find(result.begin(), result.end(), nodes[index].id) == result.end()) result.push_back(nodes[index].id);
+	}
+
+	return result;
+}
+
+int PlacementTree::getFreeCapacity() const {
+	if (nodes.empty()) return 0;
+
+	return nodes[0].capacity;
+}
+
+int PlacementTree::descend(int node, bool spread) const {
+	int current = node;
+
+	while (nodes[current].level != THREAD) {
+		int next = -1;
+
+		for (int child : nodes[current].children) {
+			if (nodes[child].free == 0) continue;
+
+			if (spread) {
+				int used = nodes[child].size - nodes[child].free;
+				int next_used = next == -1 ? 0 : nodes[next].size - nodes[next].free;
+
+				if (next == -1 || used < next_used || (used == next_used && nodes[child].free > nodes[next].free) ||
+					(used == next_used && nodes[child].free == nodes[next].free &&
+					 nodes[child].capacity > nodes[next].capacity))
+					next = child;
+			} else {
+				if (next == -1 || nodes[child].capacity > nodes[next].capacity) next = child;
+			}
+		}
+
+		current = next;
+	}
+
+	return nodes[current].id;
+}
+
+} // namespace AutopinPlus
@@ -0,0 +1,153 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/SampleBroker.h>
+
+#include <stdexcept> // for invalid_argument
+#include <time.h>	// for clock_gettime
+
+namespace AutopinPlus {
+
+SampleBroker &SampleBroker::getInstance() {
+	static SampleBroker instance;
+	return instance;
+}
+
+int SampleBroker::subscribe(const std::string &key, int64_t ttl, kind type, reader read) {
+	std::shared_ptr<Source> source;
+	int id;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto &entry = sources[key];
+		if (entry == nullptr) {
+			entry = std::make_shared<Source>();
+			entry->read = read;
+			entry->type = type;
+			entry->ttl = ttl;
+		}
+		entry->consumers++;
+
+		source = entry;
+		id = next++;
+		consumers[id].key = key;
+		consumers[id].source = source;
+	}
+
+	// The source is read outside of the lock, so that a slow source doesn't block the others.
+	try {
+		std::vector<double> baseline = update(*source);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		consumers[id].baseline = baseline;
+	} catch (...) {
+		unsubscribe(id);
+		throw;
+	}
+
+	return id;
+}
+
+std::vector<double> SampleBroker::value(int consumer) {
+	std::shared_ptr<Source> source;
+	std::vector<double> result;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = consumers.find(consumer);
+		if (it == consumers.end()) throw std::invalid_argument("SampleBroker::value(): Unknown consumer");
+
+		source = it->second.source;
+		result = it->second.baseline;
+	}
+
+	std::vector<double> totals = update(*source);
+
+	// The baseline is empty if the source returned nothing when the consumer subscribed.
+	result.resize(totals.size(), 0);
+	for (size_t i = 0; i < totals.size(); i++) result[i] = totals[i] - result[i];
+
+	return result;
+}
+
+void SampleBroker::reset(int consumer) {
+	std::shared_ptr<Source> source;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = consumers.find(consumer);
+		if (it == consumers.end()) throw std::invalid_argument("SampleBroker::reset(): Unknown consumer");
+
+		source = it->second.source;
+	}
+
+	std::vector<double> baseline = update(*source);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = consumers.find(consumer);
+	if (it != consumers.end()) it->second.baseline = baseline;
+}
+
+void SampleBroker::unsubscribe(int consumer) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = consumers.find(consumer);
+	if (it == consumers.end()) return;
+
+	// The source of a key is only replaced once it has been unregistered, so it is still the registered one.
+	if (--it->second.source->consumers == 0) sources.erase(it->second.key);
+	consumers.erase(it);
+}
+
+uint64_t SampleBroker::getReads(const std::string &key) const {
+	std::shared_ptr<Source> source;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = sources.find(key);
+		if (it == sources.end()) return 0;
+
+		source = it->second;
+	}
+
+	std::lock_guard<std::mutex> lock(source->mutex);
+	return source->reads;
+}
+
+std::vector<double> SampleBroker::update(Source &source) {
+	std::lock_guard<std::mutex> lock(source.mutex);
+
+	// Consumers which have been waiting for a concurrent read get its result instead of reading again.
+	int64_t time = now();
+	if (source.timestamp != -1 && time - source.timestamp < source.ttl) return source.totals;
+
+	std::vector<double> values = source.read();
+	source.reads++;
+	source.timestamp = now();
+
+	if (source.type == ABSOLUTE || source.totals.empty()) {
+		source.totals = values;
+	} else {
+		source.totals.resize(values.size(), 0);
+		for (size_t i = 0; i < values.size(); i++) source.totals[i] += values[i];
+	}
+
+	return source.totals;
+}
+
+int64_t SampleBroker::now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+} // namespace AutopinPlus
@@ -0,0 +1,72 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/SampleRing.h>
+
+namespace AutopinPlus {
+
+SampleRing::SampleRing(size_t capacity) {
+	size_t size = 1;
+	while (size < capacity) size *= 2;
+
+	buffer = std::vector<Slot>(size);
+}
+
+void SampleRing::push(const Sample &sample) {
+	uint64_t position = head.load(std::memory_order_relaxed);
+	Slot &slot = buffer[position & (buffer.size() - 1)];
+
+	// Mark the slot as being written before changing any field.
+	slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.timestamp.store(sample.timestamp, std::memory_order_relaxed);
+	slot.tid.store(sample.tid, std::memory_order_relaxed);
+	slot.status.store(sample.status, std::memory_order_relaxed);
+	slot.value.store(sample.value, std::memory_order_relaxed);
+	slot.coverage.store(sample.coverage, std::memory_order_relaxed);
+
+	slot.sequence.store(2 * position + 2, std::memory_order_release);
+	head.store(position + 1, std::memory_order_release);
+}
+
+bool SampleRing::read(uint64_t &cursor, Sample &sample) const {
+	while (true) {
+		uint64_t end = head.load(std::memory_order_acquire);
+		if (cursor >= end) return false;
+
+		// Skip the samples which have already been overwritten.
+		if (end - cursor > buffer.size()) {
+			skipped.fetch_add(end - buffer.size() - cursor, std::memory_order_relaxed);
+			cursor = end - buffer.size();
+		}
+
+		const Slot &slot = buffer[cursor & (buffer.size() - 1)];
+		uint64_t before = slot.sequence.load(std::memory_order_acquire);
+
+		sample.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+		sample.tid = slot.tid.load(std::memory_order_relaxed);
+		sample.status = slot.status.load(std::memory_order_relaxed);
+		sample.value = slot.value.load(std::memory_order_relaxed);
+		sample.coverage = slot.coverage.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+
+		// The slot has been overwritten while reading it, start over with the oldest sample.
+		if (before != 2 * cursor + 2 || after != before) continue;
+
+		cursor++;
+		return true;
+	}
+}
+
+uint64_t SampleRing::getHead() const { return head.load(std::memory_order_acquire); }
+
+uint64_t SampleRing::getSkipped() const { return skipped.load(std::memory_order_relaxed); }
+
+} // namespace AutopinPlus
@@ -0,0 +1,246 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/SampleWindow.h>
+
+#include <AutopinPlus/Exception.h> // for Exception
+#include <algorithm>			   // for max, min
+#include <math.h>				   // for ceil, exp, fabs, log, pow
+
+namespace AutopinPlus {
+
+/*!
+ * Magnitudes below this value are counted as zero by the histograms.
+ */
+static const double min_magnitude = 1e-9;
+
+SampleWindow::SampleWindow(const Config &config) : config(config) {
+	size_t size = 1;
+	while (size < config.capacity) size *= 2;
+	entries.resize(size);
+
+	double accuracy = std::min(std::max(config.accuracy, 1e-4), 0.5);
+	gamma = (1 + accuracy) / (1 - accuracy);
+	log_gamma = log(gamma);
+}
+
+void SampleWindow::push(int64_t timestamp, double value) {
+	Entry entry;
+	entry.timestamp = timestamp;
+	entry.value = value;
+	entry.signal = value;
+	entry.bucket = 0;
+	entry.valid = true;
+
+	// A rate needs a previous value, so the first value of a rate window has no signal. A cumulative value
+	// which decreases has been restarted (e.g. the counter was reset), so it starts over without a signal.
+	if (config.source == RATE) {
+		const Entry *previous = head > 0 ? &entries[(head - 1) & (entries.size() - 1)] : nullptr;
+		if (previous != nullptr && value < previous->value) {
+			entry.valid = false;
+			restart = head;
+		} else if (previous != nullptr && timestamp > previous->timestamp) {
+			entry.signal = (value - previous->value) / (timestamp - previous->timestamp) * 1e9;
+		} else {
+			entry.valid = false;
+		}
+	}
+
+	if (entry.valid) {
+		entry.bucket = getBucket(entry.signal);
+
+		// The weight of the new value depends on the time since the last one, so that the
+		// average doesn't depend on the sampling interval.
+		if (!averaged) {
+			ewma = entry.signal;
+			averaged = true;
+		} else {
+			int64_t elapsed = timestamp - entries[(head - 1) & (entries.size() - 1)].timestamp;
+			double alpha = config.ewma > 0 ? 1 - exp(-(double)elapsed / config.ewma) : 1;
+			ewma += alpha * (entry.signal - ewma);
+		}
+	}
+
+	// Make room for the new value, then drop all values which have become too old.
+	if (head - first >= entries.size()) evict(first++);
+
+	entries[head & (entries.size() - 1)] = entry;
+	insert(head++);
+
+	while (first < head && entries[first & (entries.size() - 1)].timestamp < timestamp - config.length) {
+		evict(first++);
+	}
+}
+
+size_t SampleWindow::getCount() const { return count; }
+
+double SampleWindow::getRate(int64_t span) const {
+	// Values which have left the window or precede a restart are not used.
+	uint64_t oldest = std::max(first, restart);
+	if (head - oldest < 2) return 0;
+
+	uint64_t mask = entries.size() - 1;
+	const Entry &newest = entries[(head - 1) & mask];
+
+	// Search the newest value which is at least "span" older than the newest one.
+	uint64_t low = oldest, high = head - 1;
+	while (low < high) {
+		uint64_t middle = low + (high - low + 1) / 2;
+		if (entries[middle & mask].timestamp <= newest.timestamp - span) {
+			low = middle;
+		} else {
+			high = middle - 1;
+		}
+	}
+
+	if (low == head - 1) low = head - 2;
+	const Entry &start = entries[low & mask];
+	if (newest.timestamp <= start.timestamp) return 0;
+
+	return (newest.value - start.value) / (newest.timestamp - start.timestamp) * 1e9;
+}
+
+double SampleWindow::getEwma() const { return ewma; }
+
+double SampleWindow::getMinimum() const {
+	if (minima.empty()) return 0;
+
+	return entries[minima.front() & (entries.size() - 1)].signal;
+}
+
+double SampleWindow::getMaximum() const {
+	if (maxima.empty()) return 0;
+
+	return entries[maxima.front() & (entries.size() - 1)].signal;
+}
+
+double SampleWindow::getMean() const {
+	if (count == 0) return 0;
+
+	return sum / count;
+}
+
+double SampleWindow::getPercentile(double quantile) const {
+	if (count == 0) return 0;
+
+	quantile = std::min(std::max(quantile, 0.0), 1.0);
+	size_t rank = (size_t)(quantile * (count - 1));
+	double result = 0;
+
+	// Walk the values in ascending order: negative values with decreasing magnitude, zeros and
+	// positive values with increasing magnitude.
+	size_t seen = 0;
+	bool found = false;
+	for (size_t i = negative.counts.size(); i > 0 && !found; i--) {
+		seen += negative.counts[i - 1];
+		if (seen > rank) {
+			result = -getBucketValue(negative.offset + (int)i - 1);
+			found = true;
+		}
+	}
+	if (!found) {
+		seen += zeros;
+		found = seen > rank;
+	}
+	for (size_t i = 0; i < positive.counts.size() && !found; i++) {
+		seen += positive.counts[i];
+		if (seen > rank) {
+			result = getBucketValue(positive.offset + (int)i);
+			found = true;
+		}
+	}
+
+	// The representative value of a bucket may lie outside of the actual values.
+	return std::min(std::max(result, getMinimum()), getMaximum());
+}
+
+void SampleWindow::insert(uint64_t position) {
+	const Entry &entry = entries[position & (entries.size() - 1)];
+	if (!entry.valid) return;
+
+	uint64_t mask = entries.size() - 1;
+	while (!minima.empty() && entries[minima.back() & mask].signal >= entry.signal) minima.pop_back();
+	minima.push_back(position);
+	while (!maxima.empty() && entries[maxima.back() & mask].signal <= entry.signal) maxima.pop_back();
+	maxima.push_back(position);
+
+	if (fabs(entry.signal) < min_magnitude) {
+		zeros++;
+	} else if (entry.signal > 0) {
+		positive.add(entry.bucket, 1);
+	} else {
+		negative.add(entry.bucket, 1);
+	}
+
+	sum += entry.signal;
+	count++;
+}
+
+void SampleWindow::evict(uint64_t position) {
+	const Entry &entry = entries[position & (entries.size() - 1)];
+	if (!entry.valid) return;
+
+	if (!minima.empty() && minima.front() == position) minima.pop_front();
+	if (!maxima.empty() && maxima.front() == position) maxima.pop_front();
+
+	if (fabs(entry.signal) < min_magnitude) {
+		zeros--;
+	} else if (entry.signal > 0) {
+		positive.add(entry.bucket, -1);
+	} else {
+		negative.add(entry.bucket, -1);
+	}
+
+	sum -= entry.signal;
+	count--;
+
+	// Start over with an exact sum once the window is empty, so that rounding errors don't accumulate.
+	if (count == 0) sum = 0;
+}
+
+int SampleWindow::getBucket(double signal) const {
+	double magnitude = fabs(signal);
+	if (magnitude < min_magnitude) return 0;
+
+	return (int)ceil(log(magnitude) / log_gamma);
+}
+
+double SampleWindow::getBucketValue(int bucket) const { return 2 * pow(gamma, bucket) / (gamma + 1); }
+
+void SampleWindow::Histogram::add(int bucket, int delta) {
+	if (counts.empty()) {
+		offset = bucket;
+		counts.push_back(0);
+	} else if (bucket < offset) {
+		counts.insert(counts.begin(), offset - bucket, 0);
+		offset = bucket;
+	} else if (bucket >= offset + (int)counts.size()) {
+		counts.resize(bucket - offset + 1, 0);
+	}
+
+	counts[bucket - offset] += delta;
+}
+
+SampleWindow::signal SampleWindow::readSignal(const QString &string) {
+	if (string.toLower() == "value") return VALUE;
+	if (string.toLower() == "rate") return RATE;
+
+	throw Exception("SampleWindow::readSignal(" + string + ") failed: Must be one of 'value', 'rate'.");
+}
+
+QString SampleWindow::showSignal(const signal &source) {
+	switch (source) {
+	case VALUE:
+		return "value";
+	case RATE:
+		return "rate";
+	}
+
+	throw Exception("SampleWindow::showSignal(" + QString::number(source) + ") failed: Invalid signal.");
+}
+
+} // namespace AutopinPlus
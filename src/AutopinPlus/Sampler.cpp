@@ -0,0 +1,184 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Sampler.h>
+
+#include <QMutexLocker>	  // for QMutexLocker
+#include <algorithm>	  // for binary_search
+#include <map>			  // for map
+#include <poll.h>		  // for poll
+#include <sys/eventfd.h>  // for eventfd
+#include <sys/timerfd.h>  // for timerfd_create, timerfd_settime
+#include <time.h>		  // for CLOCK_MONOTONIC
+#include <unistd.h>		  // for read, write, close
+
+namespace AutopinPlus {
+
+/*!
+ * The samplers by monitor type.
+ */
+static std::map<QString, std::unique_ptr<Sampler>> instances;
+
+/*!
+ * Protects "instances".
+ */
+static QMutex instances_mutex;
+
+Sampler &Sampler::getInstance(const QString &type) {
+	QMutexLocker locker(&instances_mutex);
+
+	auto &result = instances[type];
+	if (result == nullptr) result.reset(new Sampler());
+
+	return *result;
+}
+
+Sampler::Sampler() {
+	// Both are created in blocking mode, the thread only reads them after poll() reported them as readable.
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	event_fd = eventfd(0, EFD_CLOEXEC);
+}
+
+Sampler::~Sampler() {
+	exreq = true;
+	wakeup();
+	wait();
+
+	if (timer_fd != -1) close(timer_fd);
+	if (event_fd != -1) close(event_fd);
+}
+
+std::shared_ptr<const SampleRing> Sampler::add(PerformanceMonitor *monitor, int interval, size_t capacity) {
+	std::shared_ptr<SampleRing> ring(new SampleRing(capacity));
+
+	{
+		QMutexLocker locker(&entries_mutex);
+
+		Entry entry;
+		entry.monitor = monitor;
+		entry.interval = (int64_t)interval * 1000000;
+		entry.deadline = PerformanceMonitor::getTimestamp() + entry.interval;
+		entry.ring = ring;
+		entries.push_back(entry);
+	}
+
+	if (!isRunning()) {
+		start();
+	} else {
+		wakeup();
+	}
+
+	return ring;
+}
+
+void Sampler::remove(PerformanceMonitor *monitor) {
+	// The thread holds the lock while sampling, so the monitor is not in use anymore afterwards.
+	QMutexLocker locker(&entries_mutex);
+
+	for (auto it = entries.begin(); it != entries.end();) {
+		if (it->monitor == monitor) {
+			it = entries.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+uint64_t Sampler::getMissed() const { return missed.load(); }
+
+void Sampler::run() {
+	if (timer_fd == -1 || event_fd == -1) return;
+
+	while (!exreq) {
+		// Arm the timer for the earliest deadline of all monitors. Deadlines are absolute,
+		// so the time spent sampling doesn't shift the following samples.
+		int64_t deadline = -1;
+		{
+			QMutexLocker locker(&entries_mutex);
+			for (const auto &entry : entries) {
+				if (deadline == -1 || entry.deadline < deadline) deadline = entry.deadline;
+			}
+		}
+
+		// A zero it_value disarms the timer, if there is nothing to sample.
+		itimerspec spec = {};
+		if (deadline > 0) {
+			spec.it_value.tv_sec = deadline / 1000000000;
+			spec.it_value.tv_nsec = deadline % 1000000000;
+		}
+		timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+		pollfd fds[2] = {{timer_fd, POLLIN, 0}, {event_fd, POLLIN, 0}};
+		if (poll(fds, 2, -1) == -1) continue;
+
+		uint64_t count;
+		if (fds[1].revents & POLLIN) {
+			if (read(event_fd, &count, sizeof(count)) < 0) continue;
+		}
+		if (fds[0].revents & POLLIN) {
+			if (read(timer_fd, &count, sizeof(count)) < 0) continue;
+		}
+
+		QMutexLocker locker(&entries_mutex);
+		int64_t now = PerformanceMonitor::getTimestamp();
+		for (auto &entry : entries) {
+			if (entry.deadline > now) continue;
+
+			sample(entry);
+
+			// Skip all deadlines which have passed while sampling.
+			entry.deadline += entry.interval;
+			now = PerformanceMonitor::getTimestamp();
+			if (entry.deadline <= now) {
+				int64_t behind = (now - entry.deadline) / entry.interval + 1;
+				missed += behind;
+				entry.deadline += behind * entry.interval;
+			}
+		}
+	}
+}
+
+void Sampler::sample(Entry &entry) {
+	QMutexLocker locker(&entry.monitor->getMutex());
+
+	// Errors must not stop the watchdog from this thread, they only mark the values as failed.
+	AutopinContext::Quiet quiet;
+
+	tids.clear();
+	for (auto task : entry.monitor->getMonitoredTasks()) tids.push_back(task);
+
+	// Tasks which are not monitored anymore are published once, so that consumers can drop them.
+	int64_t timestamp = PerformanceMonitor::getTimestamp();
+	for (auto tid : entry.tasks) {
+		if (std::binary_search(tids.begin(), tids.end(), tid)) continue;
+
+		SampleRing::Sample sample = {timestamp, tid, PerformanceMonitor::VALUE_UNMONITORED, 0, 0};
+		entry.ring->push(sample);
+	}
+	entry.tasks = tids;
+
+	if (tids.empty()) return;
+
+	entry.monitor->values(tids.data(), tids.size(), batch);
+
+	for (size_t i = 0; i < batch.count; i++) {
+		SampleRing::Sample sample;
+		sample.timestamp = batch.timestamps[i];
+		sample.tid = tids[i];
+		sample.status = batch.status[i];
+		sample.value = batch.values[i];
+		sample.coverage = batch.coverage[i];
+		entry.ring->push(sample);
+	}
+}
+
+void Sampler::wakeup() {
+	uint64_t one = 1;
+	if (event_fd != -1 && write(event_fd, &one, sizeof(one)) < 0) return;
+}
+
+} // namespace AutopinPlus
@@ -0,0 +1,131 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+#include <AutopinPlus/Strategy/Autopin1/Coordinator.h>
+
+#include <QMutexLocker>
+
+namespace AutopinPlus {
+namespace Strategy {
+namespace Autopin1 {
+
+Coordinator::Coordinator() {}
+
+int Coordinator::join(const QString &fingerprint, int pinnings, PerformanceMonitor::montype type) {
+	QMutexLocker ml(&mutex);
+
+	if (explorations.contains(fingerprint)) {
+		Exploration &exploration = explorations[fingerprint];
+
+		// Replicas with the same fingerprint should never disagree here, but better safe than sorry.
+		if (exploration.results.size() != static_cast<size_t>(pinnings) || exploration.type != type) return -1;
+
+		return ++exploration.members;
+	}
+
+	Exploration exploration;
+	exploration.type = type;
+	exploration.members = 1;
+	exploration.measured = std::vector<bool>(pinnings, false);
+	exploration.results = std::vector<double>(pinnings, 0);
+	exploration.best = -1;
+	for (int i = 0; i < pinnings; i++) exploration.pending.push_back(i);
+
+	explorations.insert(fingerprint, exploration);
+
+	return 1;
+}
+
+void Coordinator::leave(const QString &fingerprint, int claimed) {
+	QMutexLocker ml(&mutex);
+
+	if (!explorations.contains(fingerprint)) return;
+
+	Exploration &exploration = explorations[fingerprint];
+	bool released = false;
+
+	// Hand an unfinished pinning back, so another member can measure it.
+	if (claimed >= 0 && static_cast<size_t>(claimed) < exploration.measured.size() && !exploration.measured[claimed]) {
+		exploration.pending.insert(exploration.pending.begin(), claimed);
+		released = true;
+	}
+
+	if (--exploration.members <= 0) {
+		explorations.remove(fingerprint);
+		return;
+	}
+
+	ml.unlock();
+	if (released) emit sig_pinningReleased(fingerprint);
+}
+
+int Coordinator::claimPinning(const QString &fingerprint) {
+	QMutexLocker ml(&mutex);
+
+	if (!explorations.contains(fingerprint)) return -1;
+
+	Exploration &exploration = explorations[fingerprint];
+	if (exploration.pending.empty()) return -1;
+
+	int result = exploration.pending.front();
+	exploration.pending.erase(exploration.pending.begin());
+
+	return result;
+}
+
+void Coordinator::reportResult(const QString &fingerprint, int pinning, double result) {
+	QMutexLocker ml(&mutex);
+
+	if (!explorations.contains(fingerprint)) return;
+
+	Exploration &exploration = explorations[fingerprint];
+	if (pinning < 0 || static_cast<size_t>(pinning) >= exploration.results.size()) return;
+
+	exploration.results[pinning] = result;
+	exploration.measured[pinning] = true;
+
+	if (finish(exploration)) {
+		int best = exploration.best;
+		double performance = exploration.results[best];
+
+		// The receivers will most likely call back into the coordinator, so the mutex must
+		// not be held while emitting the signal.
+		ml.unlock();
+		emit sig_explorationFinished(fingerprint, best, performance);
+	}
+}
+
+int Coordinator::getBestPinning(const QString &fingerprint) {
+	QMutexLocker ml(&mutex);
+
+	if (!explorations.contains(fingerprint)) return -1;
+
+	return explorations[fingerprint].best;
+}
+
+bool Coordinator::finish(Exploration &exploration) {
+	if (exploration.best != -1) return false;
+
+	for (auto measured : exploration.measured) {
+		if (!measured) return false;
+	}
+
+	int best = 0;
+	for (size_t i = 1; i < exploration.results.size(); i++) {
+		if ((exploration.type == PerformanceMonitor::montype::MAX && exploration.results[i] > exploration.results[best]) ||
+			(exploration.type == PerformanceMonitor::montype::MIN && exploration.results[i] < exploration.results[best]))
+			best = i;
+	}
+
+	exploration.best = best;
+
+	return true;
+}
+
+} // namespace Autopin1
+} // namespace Strategy
+} // namespace AutopinPlus
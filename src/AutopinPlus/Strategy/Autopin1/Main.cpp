@@ -7,6 +7,9 @@
 
 #include <AutopinPlus/Strategy/Autopin1/Main.h>
 
+#include <AutopinPlus/Strategy/Autopin1/Coordinator.h>
+#include <limits>
+
 namespace AutopinPlus {
 namespace Strategy {
 namespace Autopin1 {
@@ -14,7 +17,7 @@ namespace Autopin1 {
 Main::Main(const Configuration &config, const ObservedProcess &proc, OS::OSServices &service,
 		   const PerformanceMonitor::monitor_list &monitors, AutopinContext &context)
 	: ControlStrategy(config, proc, service, monitors, context), current_pinning(0), best_pinning(-1), monitor(nullptr),
-	  notifications(false) {
+	  notifications(false), share_exploration(false) {
 	// Setup timers
 	init_timer.setSingleShot(true);
 	connect(&init_timer, SIGNAL(timeout()), this, SLOT(slot_startPinning()));
@@ -28,14 +31,16 @@ Main::Main(const Configuration &config, const ObservedProcess &proc, OS::OSServi
 	this->name = "autopin1";
 }
 
+Main::~Main() {
+	if (share_exploration) Coordinator::getInstance().leave(fingerprint, current_pinning);
+}
+
 void Main::init() {
 
 	ControlStrategy::init();
 
 	context.info("Initializing control strategy autopin1");
 
-	QString config_prefix = "autopin1.";
-
 	// Read the pinnings from the configuration
 	pinnings = readPinnings(config_prefix + "schedule");
 
@@ -51,6 +56,9 @@ void Main::init() {
 	init_time = 15;
 	warmup_time = 15;
 	measure_time = 30;
+	min_coverage = 0;
+	max_extensions = 1;
+	extensions = 0;
 	openmp_icc = false;
 	skip.clear();
 	notification_interval = 0;
@@ -65,6 +73,12 @@ void Main::init() {
 	if (config.configOptionExists(config_prefix + "measure_time") > 0)
 		measure_time = config.getConfigOptionInt(config_prefix + "measure_time");
 
+	if (config.configOptionExists(config_prefix + "min_coverage") > 0)
+		min_coverage = config.getConfigOptionDouble(config_prefix + "min_coverage");
+
+	if (config.configOptionExists(config_prefix + "max_extensions") > 0)
+		max_extensions = config.getConfigOptionInt(config_prefix + "max_extensions");
+
 	if (config.configOptionBool(config_prefix + "openmp_icc"))
 		openmp_icc = config.getConfigOptionBool(config_prefix + "openmp_icc");
 
@@ -74,6 +88,9 @@ void Main::init() {
 	if (config.configOptionExists(config_prefix + "notification_interval") > 0)
 		notification_interval = config.getConfigOptionInt(config_prefix + "notification_interval");
 
+	if (config.configOptionBool(config_prefix + "share_exploration"))
+		share_exploration = config.getConfigOptionBool(config_prefix + "share_exploration");
+
 	for (int i = 0; i < skip_str.size(); i++) {
 		QString entry = skip_str[i];
 		bool ok;
@@ -88,16 +105,43 @@ void Main::init() {
 		context.report(Error::BAD_CONFIG, "invalid_value", "Invalid warmup time: " + QString::number(warmup_time));
 	if (measure_time <= 0)
 		context.report(Error::BAD_CONFIG, "invalid_value", "Invalid measure time: " + QString::number(measure_time));
+	if (min_coverage < 0 || min_coverage > 1)
+		context.report(Error::BAD_CONFIG, "invalid_value", "Invalid minimum coverage: " + QString::number(min_coverage));
+	if (max_extensions < 0)
+		context.report(Error::BAD_CONFIG, "invalid_value",
+					   "Invalid maximum number of extensions: " + QString::number(max_extensions));
 
 	context.info("  - Init time: " + QString::number(init_time));
 	context.info("  - Warmup time: " + QString::number(warmup_time));
 	context.info("  - Measure time: " + QString::number(measure_time));
+	if (min_coverage > 0)
+		context.info("  - Minimum coverage: " + QString::number(min_coverage) + " (at most " +
+					 QString::number(max_extensions) + " extensions)");
 	if (openmp_icc) context.info("  - OpenMP/ICC support is enabled");
 	if (!skip.empty()) context.info("  - These tasks will be skipped: " + skip_str.join(" "));
 
 	if (proc.getCommChanAddr() != "")
 		context.info("  - Minimum phase notification interval: " + QString::number(notification_interval));
 
+	if (share_exploration && monitor != nullptr) {
+		fingerprint = getFingerprint();
+
+		int members = Coordinator::getInstance().join(fingerprint, pinnings.size(), monitor_type);
+		if (members < 0) {
+			context.warn("  - Cannot share the exploration with other watchdogs: incompatible schedule");
+			share_exploration = false;
+		} else {
+			context.info("  - Exploration is shared with other watchdogs (members: " + QString::number(members) + ")");
+			connect(&Coordinator::getInstance(), SIGNAL(sig_explorationFinished(QString, int, double)), this,
+					SLOT(slot_explorationFinished(QString, int, double)));
+			connect(&Coordinator::getInstance(), SIGNAL(sig_pinningReleased(QString)), this,
+					SLOT(slot_pinningReleased(QString)));
+
+			// Pinnings are claimed from the coordinator when the measurement starts
+			current_pinning = -1;
+		}
+	}
+
 	init_timer.setInterval(init_time * 1000);
 	warmup_timer.setInterval(warmup_time * 1000);
 	measure_timer.setInterval(measure_time * 1000);
@@ -109,6 +153,8 @@ Configuration::configopts Main::getConfigOpts() {
 	result.push_back(Configuration::configopt("init_time", QStringList(QString::number(init_time))));
 	result.push_back(Configuration::configopt("warmup_time", QStringList(QString::number(warmup_time))));
 	result.push_back(Configuration::configopt("measure_time", QStringList(QString::number(measure_time))));
+	result.push_back(Configuration::configopt("min_coverage", QStringList(QString::number(min_coverage))));
+	result.push_back(Configuration::configopt("max_extensions", QStringList(QString::number(max_extensions))));
 
 	if (openmp_icc)
 		result.push_back(Configuration::configopt("openmp_icc", QStringList("true")));
@@ -120,6 +166,11 @@ Configuration::configopts Main::getConfigOpts() {
 	result.push_back(
 		Configuration::configopt("notification_interval", QStringList(QString::number(notification_interval))));
 
+	if (share_exploration)
+		result.push_back(Configuration::configopt("share_exploration", QStringList("true")));
+	else
+		result.push_back(Configuration::configopt("share_exploration", QStringList("false")));
+
 	return result;
 }
 
@@ -134,6 +185,24 @@ void Main::slot_watchdogReady() {
 }
 
 void Main::slot_startPinning() {
+	// Claim the next untested pinning, unless the current one is restarted
+	if (share_exploration && current_pinning == -1) {
+		current_pinning = Coordinator::getInstance().claimPinning(fingerprint);
+
+		if (current_pinning == -1) {
+			best_pinning = Coordinator::getInstance().getBestPinning(fingerprint);
+
+			if (best_pinning == -1) {
+				context.info("");
+				context.info("All pinnings are being tested by other watchdogs - waiting for their results");
+			} else {
+				applyBestPinning();
+			}
+
+			return;
+		}
+	}
+
 	// Refresh the list with tasks
 	refreshTasks();
 
@@ -165,12 +234,15 @@ void Main::slot_startMonitor() {
 
 	context.info("Start performance monitoring");
 	checkPinnedTasks();
+	extensions = 0;
 
+	ProcessTree::autopin_tid_list tasks;
 	for (auto it = pinned_tasks.begin(); it != pinned_tasks.end(); it++) {
-		monitor->start(it->tid);
+		tasks.insert(it->tid);
 		it->start = measure_start.elapsed();
 		it->stop = -1;
 	}
+	monitor->start(tasks);
 
 	// Start timer
 	context.info("Waiting " + QString::number(measure_time) + " seconds (measure time)");
@@ -179,26 +251,59 @@ void Main::slot_startMonitor() {
 }
 
 void Main::slot_stopPinning() {
+	checkPinnedTasks();
+
+	// If the counters of the monitor have been multiplexed too much, measure for a longer time or
+	// ignore the result, as it would be compared to results of pinnings with a different coverage
+	bool discard = false;
+	double coverage = getCoverage();
+	if (coverage < min_coverage) {
+		if (extensions < max_extensions) {
+			extensions++;
+			context.info("Coverage of the performance monitor is too low (" + QString::number(coverage) +
+						 ") - extending the measure time");
+			measure_timer.start();
+			return;
+		}
+
+		context.warn("Coverage of the performance monitor is too low (" + QString::number(coverage) +
+					 ") - discarding the result of pinning " + QString::number(current_pinning + 1));
+		discard = true;
+	}
+
 	notifications = false;
 
 	context.info("Reading results of pinning " + QString::number(current_pinning + 1));
-	checkPinnedTasks();
 
 	double current_result = 0;
 
+	// The tasks which are still running are stopped together, so that shared counters are read only once
+	ProcessTree::autopin_tid_list running;
 	for (auto &elem : pinned_tasks) {
-		if (elem.stop == -1) {
-			elem.stop = measure_start.elapsed();
-			elem.result = monitor->stop(elem.tid);
-		}
-		double tres = elem.result;
-		elem.result = tres / (elem.stop - elem.start);
+		if (elem.stop != -1) continue;
+		elem.stop = measure_start.elapsed();
+		running.insert(elem.tid);
+	}
+	PerformanceMonitor::autopin_measurements results = monitor->stop(running);
+
+	for (auto &elem : pinned_tasks) {
+		auto it = results.find(elem.tid);
+		if (it != results.end()) elem.result = it->second;
+		else if (running.count(elem.tid) != 0) elem.result = 0;
+		// Cumulative values depend on how long the task was measured, ratios and rates don't
+		if (monitor->isCumulative()) elem.result = elem.result / (elem.stop - elem.start);
 		context.info("  :: Result for task " + QString::number(elem.tid) + ": " + QString::number(elem.result));
 		current_result += elem.result;
 	}
 
 	current_result = current_result / pinned_tasks.size();
 
+	// A discarded result must never be chosen as the best one
+	if (discard) {
+		current_result = std::numeric_limits<double>::infinity();
+		if (monitor_type == PerformanceMonitor::montype::MAX) current_result = -current_result;
+	}
+
 	switch (monitor_type) {
 	case PerformanceMonitor::montype::MAX:
 		if (best_pinning == -1) {
@@ -229,20 +334,34 @@ void Main::slot_stopPinning() {
 	// addPinningToHistory(pinnings[current_pinning], current_result);
 	pinned_tasks.clear();
 
+	if (share_exploration) {
+		int measured_pinning = current_pinning;
+		current_pinning = -1;
+
+		// If this was the last missing result, slot_explorationFinished() applies the best pinning
+		Coordinator::getInstance().reportResult(fingerprint, measured_pinning, current_result);
+		if (Coordinator::getInstance().getBestPinning(fingerprint) == -1)
+			QTimer::singleShot(0, this, SLOT(slot_startPinning()));
+		return;
+	}
+
 	current_pinning++;
 	if ((uint)current_pinning < pinnings.size()) {
 		QTimer::singleShot(0, this, SLOT(slot_startPinning()));
 	} else {
-		context.info("");
-		context.info("All pinnings have been tested");
-		context.info("Applying best pinning: " + QString::number(best_pinning + 1));
-		refreshTasks();
-		applyPinning(pinnings[best_pinning]);
-		context.info("Control strategy autopin1 has finished");
-		// if (history != nullptr) history->deinit();
+		applyBestPinning();
 	}
 }
 
+void Main::slot_explorationFinished(QString fingerprint, int best, double performance) {
+	// Members which are still in their init time or currently measuring will pick up the result later
+	if (fingerprint != this->fingerprint || current_pinning != -1 || init_timer.isActive()) return;
+
+	best_pinning = best;
+	best_performance = performance;
+	applyBestPinning();
+}
+
 void Main::slot_TaskCreated(int tid) {
 	// Only pin new tasks when the measurement is currently running
 	if (notifications) {
@@ -318,6 +437,24 @@ void Main::slot_PhaseChanged(int) {
 	}
 }
 
+void Main::slot_pinningReleased(QString fingerprint) {
+	// Only idle members which are waiting for the results of other watchdogs take over released pinnings
+	if (fingerprint != this->fingerprint || current_pinning != -1 || init_timer.isActive()) return;
+	if (Coordinator::getInstance().getBestPinning(fingerprint) != -1) return;
+
+	QTimer::singleShot(0, this, SLOT(slot_startPinning()));
+}
+
+void Main::applyBestPinning() {
+	context.info("");
+	context.info("All pinnings have been tested");
+	context.info("Applying best pinning: " + QString::number(best_pinning + 1));
+	refreshTasks();
+	applyPinning(pinnings[best_pinning]);
+	context.info("Control strategy autopin1 has finished");
+	// if (history != nullptr) history->deinit();
+}
+
 void Main::applyPinning(autopin_pinning pinning) {
 	// i counts the pinnings
 	// j counts the tasks
@@ -372,6 +509,41 @@ Main::pinning_list Main::readPinnings(QString opt) {
 	return result;
 }
 
+QString Main::getFingerprint() {
+	QStringList result;
+
+	// Processes which are attached to by pid have no command, so only the option itself can be compared
+	if (proc.getCmd() != "")
+		result.push_back(proc.getCmd());
+	else
+		result.push_back(config.getConfigOption("Attach"));
+
+	result.push_back("schedule=" + config.getConfigOptionList(config_prefix + "schedule").join(" "));
+	for (auto &opt : getConfigOpts()) result.push_back(opt.first + "=" + opt.second.join(" "));
+
+	result.push_back("monitor=" + monitor->getType());
+	for (auto &opt : monitor->getConfigOpts())
+		result.push_back(monitor->getType() + "." + opt.first + "=" + opt.second.join(" "));
+
+	return result.join(";");
+}
+
+double Main::getCoverage() {
+	double result = 1.0;
+	if (min_coverage <= 0) return result;
+
+	ProcessTree::autopin_tid_list running;
+	for (const auto &elem : pinned_tasks) {
+		if (elem.stop == -1) running.insert(elem.tid);
+	}
+
+	// The coverage refers to the last value which has been read
+	monitor->value(running);
+	for (int tid : running) result = std::min(result, monitor->coverage(tid));
+
+	return result;
+}
+
 void Main::checkPinnedTasks() {
 	// There is no need to check for terminated tasks if process tracing is enabled
 	if (proc.getTrace()) return;
@@ -11,9 +11,6 @@
 #include <AutopinPlus/Exception.h> // for Exception
 #include <AutopinPlus/Tools.h>	 // for Tools
 #include <QString>				   // for operator+, QString
-#include <AutopinPlus/OS/CpuInfo.h>
-
-namespace CpuInfo = AutopinPlus::OS::CpuInfo;
 
 namespace AutopinPlus {
 namespace Strategy {
@@ -41,6 +38,8 @@ void Main::init() {
 			return;
 		}
 	}
+
+	readLoadOptions();
 }
 
 Configuration::configopts Main::getConfigOpts() {
@@ -48,6 +47,8 @@ Configuration::configopts Main::getConfigOpts() {
 
 	result.push_back(Configuration::configopt("interval", QStringList(QString::number(interval))));
 
+	getLoadConfigOpts(result);
+
 	return result;
 }
 
@@ -63,33 +64,16 @@ ControlStrategy::Pinning Main::getPinning(const Pinning &current_pinning) {
 	if (new_task_tid == 0) return current_pinning;
 
 	Pinning result = current_pinning;
-	int pid = proc.getPid();
-
-	auto min_distance = result.size();
-	int pin_cpu_pos = -1;
-
-	for (unsigned int i = 0; i < result.size(); i++) {
-		Task task = current_pinning[i];
-		if (task.isCpuFree()) {
-			if (pin_cpu_pos == -1) pin_cpu_pos = i;
-
-			for (uint j = 0; j < result.size(); j++) {
-				if (current_pinning[j].pid == pid) {
-					uint distance = CpuInfo::getCpuDistance(i, j);
-					if (distance < min_distance) {
-						min_distance = distance;
-						pin_cpu_pos = i;
-					}
-				}
-			}
-		}
-	}
+
+	// Pin the new task as close as possible to the previous one
+	int pin_cpu_pos = getPlacementTree().findCompact(anchor_cpu);
 
 	if (pin_cpu_pos != -1) {
 		Task t;
-		t.pid = pid;
+		t.pid = proc.getPid();
 		t.tid = new_task_tid;
 		result[pin_cpu_pos] = t;
+		anchor_cpu = pin_cpu_pos;
 	}
 
 	return result;
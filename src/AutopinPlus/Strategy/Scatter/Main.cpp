@@ -12,6 +12,8 @@
 #include <AutopinPlus/Tools.h>	 // for Tools
 #include <QString>				   // for operator+, QString
 #include <AutopinPlus/OS/CpuInfo.h>
+#include <algorithm>
+#include <set>
 
 namespace CpuInfo = AutopinPlus::OS::CpuInfo;
 
@@ -23,6 +25,8 @@ Main::Main(const Configuration &config, const ObservedProcess &proc, OS::OSServi
 		   const PerformanceMonitor::monitor_list &monitors, AutopinContext &context)
 	: ControlStrategy(config, proc, service, monitors, context) {
 	name = "scatter";
+
+	connect(&rebalance_timer, SIGNAL(timeout()), this, SLOT(slot_rebalance()));
 }
 
 void Main::init() {
@@ -42,7 +46,56 @@ void Main::init() {
 		}
 	}
 
-	for (int node = 0; node < CpuInfo::getNodeCount(); node++) pinCount.push_back(0);
+	// Read the options for bandwidth-aware placement
+	if (config.configOptionExists(name + ".bandwidth_monitor") > 0) {
+		QString monitor_name = config.getConfigOption(name + ".bandwidth_monitor");
+
+		for (auto &monitor : monitors) {
+			if (monitor->getName() == monitor_name) bandwidth_monitor = monitor.get();
+		}
+
+		if (bandwidth_monitor == nullptr) {
+			context.report(Error::BAD_CONFIG, "no_monitor",
+						   name + ".init() failed: Could not find the monitor \"" + monitor_name + "\".");
+			return;
+		}
+
+		context.info("  - " + name + ".bandwidth_monitor = " + monitor_name);
+		bool calibrated = false;
+		for (int node : getPlacementTree().getNodes()) calibrated |= CpuInfo::getNodeBandwidth(node, 1) > 0;
+		if (!calibrated) context.warn("  - No bandwidth calibration available, assuming equal bandwidth per cpu");
+	}
+
+	if (config.configOptionExists(name + ".bytes_per_event") > 0) {
+		try {
+			bytes_per_event = Tools::readDouble(config.getConfigOption(name + ".bytes_per_event"));
+			context.info("  - " + name + ".bytes_per_event = " + QString::number(bytes_per_event));
+		} catch (const Exception &) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init() failed: Could not parse the 'bytes_per_event' option.");
+			return;
+		}
+	}
+
+	if (config.configOptionExists(name + ".rebalance_interval") > 0) {
+		try {
+			rebalance_interval = Tools::readInt(config.getConfigOption(name + ".rebalance_interval"));
+			context.info("  - " + name + ".rebalance_interval = " + QString::number(rebalance_interval));
+		} catch (const Exception &) {
+			context.report(Error::BAD_CONFIG, "option_format",
+						   name + ".init() failed: Could not parse the 'rebalance_interval' option.");
+			return;
+		}
+	}
+
+	if (bandwidth_monitor != nullptr && rebalance_interval > 0) {
+		rebalance_timer.setInterval(rebalance_interval);
+		rebalance_timer.start();
+	}
+
+	clock.start();
+
+	readLoadOptions();
 }
 
 Configuration::configopts Main::getConfigOpts() {
@@ -50,6 +103,15 @@ Configuration::configopts Main::getConfigOpts() {
 
 	result.push_back(Configuration::configopt("interval", QStringList(QString::number(interval))));
 
+	if (bandwidth_monitor != nullptr) {
+		result.push_back(Configuration::configopt("bandwidth_monitor", QStringList(bandwidth_monitor->getName())));
+		result.push_back(Configuration::configopt("bytes_per_event", QStringList(QString::number(bytes_per_event))));
+		result.push_back(
+			Configuration::configopt("rebalance_interval", QStringList(QString::number(rebalance_interval))));
+	}
+
+	getLoadConfigOpts(result);
+
 	return result;
 }
 
@@ -59,33 +121,137 @@ void Main::slot_TaskCreated(int tid) {
 	// we need to update the pinning.
 	ControlStrategy::slot_TaskCreated(tid);
 	new_task_tid = 0;
+
+	if (bandwidth_monitor != nullptr && getCpuByTask(tid) != -1) {
+		bandwidth_monitor->start(tid);
+		demands[tid] = {0, clock.elapsed(), getAverageDemand()};
+	}
 }
 
 void Main::slot_TaskTerminated(int tid) {
-	int cpu = getCpuByTask(tid);
-	int node = CpuInfo::getNodeByCpu(cpu);
-	pinCount[node]--;
+	if (demands.erase(tid) > 0) bandwidth_monitor->clear(tid);
+
 	ControlStrategy::slot_TaskTerminated(tid);
 }
 
+void Main::slot_rebalance() {
+	qint64 now = clock.elapsed();
+
+	// Read all tasks at once, so that counters shared by a wider scope are read only once
+	ProcessTree::autopin_tid_list tasks;
+	for (const auto &entry : demands) tasks.insert(entry.first);
+	PerformanceMonitor::autopin_measurements values = bandwidth_monitor->value(tasks);
+
+	// Update the demand of every task
+	for (auto &entry : demands) {
+		Demand &demand = entry.second;
+		auto it = values.find(entry.first);
+		double value = it != values.end() ? it->second : 0;
+
+		if (now > demand.time)
+			demand.rate = std::max(0.0, value - demand.value) * bytes_per_event * 1000 / (now - demand.time);
+
+		demand.value = value;
+		demand.time = now;
+	}
+
+	// Sum up the demand on every node
+	std::map<int, double> node_demand;
+	std::map<int, std::vector<int>> node_tasks, node_cpus;
+	for (auto &entry : demands) {
+		int cpu = getCpuByTask(entry.first);
+		if (cpu == -1) continue;
+
+		int node = CpuInfo::getTopology().getNode(cpu);
+		node_demand[node] += entry.second.rate;
+		node_tasks[node].push_back(entry.first);
+		node_cpus[node].push_back(cpu);
+	}
+
+	const auto &tree = getPlacementTree();
+	auto nodes = tree.getNodes();
+	if (nodes.size() < 2) return;
+
+	// Find the most and the least utilised node. Only the cores used by our own tasks count, the
+	// used cpus of the tree also include blocked cpus and cpus of other processes.
+	int high = -1, low = -1;
+	double high_util = 0, low_util = 0;
+	for (int node : nodes) {
+		double util = getUtilisation(node, node_demand[node], countCores(node_cpus[node]));
+
+		if (!node_tasks[node].empty() && (high == -1 || util > high_util)) {
+			high = node;
+			high_util = util;
+		}
+		if (tree.getFreeCount(node) > 0 && (low == -1 || util < low_util)) {
+			low = node;
+			low_util = util;
+		}
+	}
+
+	if (high == -1 || low == -1 || high == low) return;
+
+	int target = tree.findScatter(low);
+	if (target == -1) return;
+
+	// Move the task which minimises the utilisation of the more utilised of both nodes
+	std::vector<int> low_cpus = node_cpus[low];
+	low_cpus.push_back(target);
+	int low_cores = countCores(low_cpus);
+
+	int best_tid = 0;
+	double best_util = high_util;
+	for (int tid : node_tasks[high]) {
+		std::vector<int> high_cpus = node_cpus[high];
+		auto cpu = std::find(high_cpus.begin(), high_cpus.end(), getCpuByTask(tid));
+		if (cpu != high_cpus.end()) high_cpus.erase(cpu);
+
+		double rate = demands[tid].rate;
+		double util = std::max(getUtilisation(high, node_demand[high] - rate, countCores(high_cpus)),
+							   getUtilisation(low, node_demand[low] + rate, low_cores));
+
+		if (util < best_util) {
+			best_util = util;
+			best_tid = tid;
+		}
+	}
+
+	// Only move, if it reduces the imbalance noticeably
+	if (best_tid == 0 || best_util > 0.9 * high_util) return;
+
+	context.info("Moving task " + QString::number(best_tid) + " from node " + QString::number(high) + " to node " +
+				 QString::number(low) + " (utilisation " + QString::number(high_util) + " -> " +
+				 QString::number(best_util) + ")");
+
+	moveTasks({{best_tid, target}});
+}
+
 ControlStrategy::Pinning Main::getPinning(const Pinning &current_pinning) {
 	if (new_task_tid == 0) return current_pinning;
 
 	Pinning result = current_pinning;
-
 	int pin_cpu_pos = -1;
-	for (auto node : sort_indexes(pinCount)) {
-		auto cpus = CpuInfo::getCpusByNode(node);
-		for (auto cpu : cpus) {
-			Task task = current_pinning[cpu];
-			if (task.isCpuFree()) {
-				pin_cpu_pos = cpu;
-				pinCount[node]++;
-				goto LoopEnd;
-			}
+
+	if (bandwidth_monitor != nullptr) {
+		// Pin the new task to the node with the lowest predicted bandwidth utilisation
+		std::map<int, double> node_demand;
+		std::map<int, std::vector<int>> node_cpus;
+		for (unsigned int cpu = 0; cpu < current_pinning.size(); cpu++) {
+			if (current_pinning[cpu].pid != proc.getPid()) continue;
+
+			int node = CpuInfo::getTopology().getNode(cpu);
+			node_cpus[node].push_back(cpu);
+
+			auto it = demands.find(current_pinning[cpu].tid);
+			if (it != demands.end()) node_demand[node] += it->second.rate;
 		}
+
+		int node = selectNode(node_demand, node_cpus, getAverageDemand());
+		if (node != -1) pin_cpu_pos = getPlacementTree().findScatter(node);
+	} else {
+		// Pin the new task into the least used part of the machine
+		pin_cpu_pos = getPlacementTree().findScatter();
 	}
-LoopEnd:
 
 	if (pin_cpu_pos != -1) {
 		Task t;
@@ -97,6 +263,65 @@ LoopEnd:
 	return result;
 }
 
+int Main::selectNode(const std::map<int, double> &node_demand, const std::map<int, std::vector<int>> &node_cpus,
+					  double demand) {
+	const auto &tree = getPlacementTree();
+	int result = -1;
+	double result_util = 0;
+
+	for (int node : tree.getNodes()) {
+		int target = tree.findScatter(node);
+		if (target == -1) continue;
+
+		auto it = node_demand.find(node);
+		double current = it == node_demand.end() ? 0 : it->second;
+
+		// The new task may share a core with one of our tasks, then it doesn't add bandwidth.
+		auto cpus_it = node_cpus.find(node);
+		std::vector<int> cpus = cpus_it == node_cpus.end() ? std::vector<int>() : cpus_it->second;
+		cpus.push_back(target);
+
+		double util = getUtilisation(node, current + demand, countCores(cpus));
+		if (result == -1 || util < result_util ||
+			(util == result_util && tree.getFreeCount(node) > tree.getFreeCount(result))) {
+			result = node;
+			result_util = util;
+		}
+	}
+
+	return result;
+}
+
+double Main::getUtilisation(int node, double demand, int cores) {
+	if (cores <= 0) return 0;
+
+	// The calibration measures the bandwidth per number of cores, not hardware threads.
+	double bandwidth = CpuInfo::getNodeBandwidth(node, cores);
+	if (bandwidth > 0) return demand / (bandwidth * 1e6);
+
+	// Without a calibration, relate the demand to the size of the node, so that the value is
+	// still a measure of how saturated the node is and not the average demand per task.
+	int size = CpuInfo::getCpusByNode(node).size();
+	return size > 0 ? demand / size : 0;
+}
+
+int Main::countCores(const std::vector<int> &cpus) {
+	// Cores are identified by their lowest cpu, see Topology::getCore().
+	std::set<int> cores;
+	for (int cpu : cpus) cores.insert(CpuInfo::getTopology().getCore(cpu));
+
+	return cores.size();
+}
+
+double Main::getAverageDemand() {
+	if (demands.empty()) return 0;
+
+	double sum = 0;
+	for (auto &entry : demands) sum += entry.second.rate;
+
+	return sum / demands.size();
+}
+
 } // namespace Scatter
 } // namespace Strategy
 } // namespace AutopinPlus
@@ -9,7 +9,10 @@
 #include <AutopinPlus/Watchdog.h>
 #include <AutopinPlus/Logger/External/Main.h>
 #include <AutopinPlus/Monitor/ClustSafe/Main.h>
+#include <AutopinPlus/Monitor/Derived/Main.h>
 #include <AutopinPlus/Monitor/GPerf/Main.h>
+#include <AutopinPlus/Monitor/Powercap/Main.h>
+#include <AutopinPlus/Monitor/ProcStat/Main.h>
 #include <AutopinPlus/Monitor/Random/Main.h>
 #include <AutopinPlus/Monitor/PageMigrate/Main.h>
 #include <AutopinPlus/Strategy/Autopin1/Main.h>
@@ -18,6 +21,11 @@
 #include <AutopinPlus/Strategy/Scatter/Main.h>
 #include <AutopinPlus/OS/OSServices.h>
 #include <AutopinPlus/OS/SignalDispatcher.h>
+#include <AutopinPlus/Error.h>
+#include <AutopinPlus/Exception.h>
+#include <AutopinPlus/SampleWindow.h>
+#include <AutopinPlus/Sampler.h>
+#include <AutopinPlus/Tools.h>
 #include <QString>
 #include <QTimer>
 #include <QList>
@@ -30,7 +38,14 @@ std::atomic_int Watchdog::counter(0);
 Watchdog::Watchdog(std::unique_ptr<const Configuration> config)
 	: context(nullptr), config(std::move(config)), service(nullptr), process(nullptr), strategy(nullptr) {}
 
-Watchdog::~Watchdog() { context->info("Watchdog destroyed"); }
+Watchdog::~Watchdog() {
+	// The sampler threads outlive the watchdog, so they must stop reading its monitors first.
+	for (auto &elem : monitors) {
+		if (elem->getSamples() != nullptr) Sampler::getInstance(elem->getType()).remove(elem.get());
+	}
+
+	context->info("Watchdog destroyed");
+}
 
 void Watchdog::slot_watchdogRun() {
 	createContext();
@@ -84,6 +99,11 @@ void Watchdog::slot_watchdogRun() {
 		elem->setObservedProcessPid(npid);
 		
 	}
+
+	configureWindows();
+	if (context->isError()) return;
+
+	startSamplers();
 	
 	emit sig_watchdogReady();
 }
@@ -136,12 +156,30 @@ void Watchdog::createPerformanceMonitors() {
 			continue;
 		}
 
+		if (current_type == "derived") {
+			monitors.push_back(std::unique_ptr<Monitor::Derived::Main>(
+				new Monitor::Derived::Main(current_monitor, *config, monitors, *context)));
+			continue;
+		}
+
 		if (current_type == "gperf") {
 			monitors.push_back(
 				std::unique_ptr<Monitor::GPerf::Main>(new Monitor::GPerf::Main(current_monitor, *config, *context)));
 			continue;
 		}
 
+		if (current_type == "powercap") {
+			monitors.push_back(std::unique_ptr<Monitor::Powercap::Main>(
+				new Monitor::Powercap::Main(current_monitor, *config, *context)));
+			continue;
+		}
+
+		if (current_type == "procstat") {
+			monitors.push_back(std::unique_ptr<Monitor::ProcStat::Main>(
+				new Monitor::ProcStat::Main(current_monitor, *config, *context)));
+			continue;
+		}
+
 		if (current_type == "random") {
 			monitors.push_back(
 				std::unique_ptr<Monitor::Random::Main>(new Monitor::Random::Main(current_monitor, *config, *context)));
@@ -208,6 +246,75 @@ void Watchdog::createDataLoggers() {
 	}
 }
 
+void Watchdog::configureWindows() {
+	for (auto &elem : monitors) {
+		QString name = elem->getName();
+		SampleWindow::Config window;
+
+		try {
+			if (config->configOptionExists(name + ".window") > 0) {
+				window.length = (int64_t)Tools::readInt(config->getConfigOption(name + ".window")) * 1000000;
+				window.ewma = window.length;
+			}
+			if (config->configOptionExists(name + ".window_capacity") > 0) {
+				window.capacity = Tools::readInt(config->getConfigOption(name + ".window_capacity"));
+			}
+			if (config->configOptionExists(name + ".window_ewma") > 0) {
+				window.ewma = (int64_t)Tools::readInt(config->getConfigOption(name + ".window_ewma")) * 1000000;
+			}
+			if (config->configOptionExists(name + ".window_signal") > 0) {
+				window.source = SampleWindow::readSignal(config->getConfigOption(name + ".window_signal"));
+			}
+			if (config->configOptionExists(name + ".window_accuracy") > 0) {
+				window.accuracy = Tools::readDouble(config->getConfigOption(name + ".window_accuracy"));
+			}
+		} catch (const Exception &e) {
+			context->report(Error::BAD_CONFIG, "option_format",
+							"Could not parse the window options of monitor " + name + " (" + QString(e.what()) + ")");
+			return;
+		}
+
+		if (window.length <= 0 || (int)window.capacity <= 0 || window.ewma < 0 || window.accuracy <= 0 ||
+			window.accuracy >= 1) {
+			context->report(Error::BAD_CONFIG, "option_format", "Invalid window options for monitor " + name);
+			return;
+		}
+
+		elem->setWindowConfig(window);
+	}
+}
+
+void Watchdog::startSamplers() {
+	for (auto &elem : monitors) {
+		QString name = elem->getName();
+		if (config->configOptionExists(name + ".sampler_interval") <= 0) continue;
+
+		int interval = 0, capacity = 4096;
+		try {
+			interval = Tools::readInt(config->getConfigOption(name + ".sampler_interval"));
+			if (config->configOptionExists(name + ".sampler_capacity") > 0) {
+				capacity = Tools::readInt(config->getConfigOption(name + ".sampler_capacity"));
+			}
+		} catch (const Exception &e) {
+			context->report(Error::BAD_CONFIG, "option_format",
+							"Could not parse the sampler options of monitor " + name + " (" + QString(e.what()) + ")");
+			return;
+		}
+
+		// An interval of 0 disables the sampler.
+		if (interval <= 0) continue;
+		if (capacity <= 0) {
+			context->report(Error::BAD_CONFIG, "option_format", "The sampler capacity of monitor " + name +
+																	  " must be positive");
+			return;
+		}
+
+		context->info("Sampling " + name + " every " + QString::number(interval) + " ms on the " + elem->getType() +
+					  " sampler thread");
+		elem->setSamples(Sampler::getInstance(elem->getType()).add(elem.get(), interval, capacity));
+	}
+}
+
 void Watchdog::createOSServices() { service = std::unique_ptr<OS::OSServices>(new OS::OSServices(*context)); }
 
 void Watchdog::createObservedProcess() {
@@ -0,0 +1,112 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+/*
+ * Compares reading many perf counters with one read() per counter and with
+ * a single OS::BatchReader batch, as done by the gperf monitor with the
+ * io_uring option. Build and run it with
+ *
+ *     g++ -O2 -std=c++11 -I include -I vendor/linux tools/batch-read-benchmark.cpp \
+ *         src/AutopinPlus/OS/BatchReader.cpp -o batch-read-benchmark
+ *     ./batch-read-benchmark [counters] [rounds]
+ *
+ * The counters are software task-clock counters of the benchmark itself, so
+ * that no special privileges or hardware counters are required. The default
+ * of 10000 counters needs a sufficiently large limit of open files, the soft
+ * limit is raised to the hard limit automatically.
+ */
+
+#include <AutopinPlus/OS/BatchReader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <syscall.h>
+#include <unistd.h>
+#include <vector>
+
+using AutopinPlus::OS::BatchReader;
+
+int main(int argc, char **argv) {
+	long counters = argc > 1 ? atol(argv[1]) : 10000;
+	long rounds = argc > 2 ? atol(argv[2]) : 100;
+	if (counters <= 0 || rounds <= 0) {
+		fprintf(stderr, "usage: %s [counters] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	rlimit limit;
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_SOFTWARE;
+	attr.config = PERF_COUNT_SW_TASK_CLOCK;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED |
+					   PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	std::vector<int> fds;
+	for (long i = 0; i < counters; i++) {
+		int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if (fd < 0) {
+			perror("perf_event_open");
+			fprintf(stderr, "opened %zu of %ld counters\n", fds.size(), counters);
+			return 1;
+		}
+		fds.push_back(fd);
+	}
+
+	// A group with one counter: nr, time_enabled, time_running, value, id
+	const size_t words = 5;
+	std::vector<uint64_t> data(fds.size() * words);
+
+	auto start = std::chrono::steady_clock::now();
+	for (long round = 0; round < rounds; round++) {
+		for (size_t i = 0; i < fds.size(); i++) {
+			if (read(fds[i], &data[i * words], words * sizeof(uint64_t)) < 0) {
+				perror("read");
+				return 1;
+			}
+		}
+	}
+	auto middle = std::chrono::steady_clock::now();
+
+	BatchReader reader;
+	size_t syscalls = 0, failed = 0;
+	for (long round = 0; round < rounds; round++) {
+		reader.clear();
+		for (size_t i = 0; i < fds.size(); i++) reader.add(fds[i], &data[i * words], words * sizeof(uint64_t));
+		reader.submit();
+
+		syscalls += reader.getSyscalls();
+		for (size_t i = 0; i < fds.size(); i++) {
+			if (reader.getResult(i) != (ssize_t)(words * sizeof(uint64_t))) failed++;
+		}
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	double plain_us = std::chrono::duration<double, std::micro>(middle - start).count() / rounds;
+	double batch_us = std::chrono::duration<double, std::micro>(stop - middle).count() / rounds;
+
+	printf("%zu counters, %ld rounds\n", fds.size(), rounds);
+	printf("read():      %10.1f us per round, %zu syscalls per round\n", plain_us, fds.size());
+	printf("BatchReader: %10.1f us per round, %.1f syscalls per round (%s)\n", batch_us, (double)syscalls / rounds,
+		   reader.isAsync() ? "io_uring" : "fallback to read()");
+	if (failed > 0) printf("%zu reads failed\n", failed);
+
+	for (int fd : fds) close(fd);
+
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,215 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+/*
+ * Simulates a ClustSafe device from MEGWARE, so that the clustsafe monitor can
+ * be tested and benchmarked without the hardware. Build and run it with
+ *
+ *     g++ -O2 -std=c++11 tools/clustsafe-simulator.cpp -o clustsafe-simulator
+ *     ./clustsafe-simulator [port] [watts] [outlets] [loss_percent] [delay_ms] [password]
+ *
+ * and point the monitor at it with "clust.host = localhost" and "clust.port".
+ * The simulator listens on UDP (IPv4 and IPv6) and speaks the same protocol
+ * as the monitor: requests start with the signature "MEGware", a zero byte and
+ * the password padded to 16 bytes, followed by the command, the length of the
+ * data, the data and a checksum over the last three fields. Requests with a
+ * wrong signature, password, length or checksum are ignored like the device
+ * does.
+ *
+ * Every outlet draws the given power. Command 0x010F answers with the energy
+ * in Joules consumed on every outlet since the last reset as big-endian 32-bit
+ * integers, with the sum of all outlets in front (so outlet n is at index n),
+ * and resets the counters if the data is 0x01. All other commands are answered
+ * with an empty payload. Requests are dropped with the given probability and
+ * answered after the given delay, so that lost requests and requests in
+ * flight can be tested. The numbers of requests are printed on SIGINT.
+ */
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <netinet/in.h>
+#include <poll.h>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const std::string signature = "MEGware";
+
+static volatile sig_atomic_t stopped = 0;
+
+static void stop(int) { stopped = 1; }
+
+static void append16(std::string &buffer, uint16_t value) {
+	buffer += (char)(value >> 8);
+	buffer += (char)(value & 0xFF);
+}
+
+static void append32(std::string &buffer, uint32_t value) {
+	append16(buffer, value >> 16);
+	append16(buffer, value & 0xFFFF);
+}
+
+static uint16_t read16(const std::string &buffer, size_t offset) {
+	return (uint16_t)((uint8_t)buffer[offset] << 8 | (uint8_t)buffer[offset + 1]);
+}
+
+static uint8_t checksum(const std::string &buffer, size_t offset, size_t length) {
+	uint8_t result = 0;
+	for (size_t i = offset; i < offset + length; i++) result += (uint8_t)buffer[i];
+
+	return result;
+}
+
+/*
+ * An answer which is sent after the configured delay
+ */
+struct Answer {
+	Clock::time_point due;
+	sockaddr_in6 address;
+	std::string data;
+};
+
+int main(int argc, char **argv) {
+	long port = argc > 1 ? atol(argv[1]) : 2010;
+	double watts = argc > 2 ? atof(argv[2]) : 100;
+	long outlets = argc > 3 ? atol(argv[3]) : 8;
+	double loss = argc > 4 ? atof(argv[4]) : 0;
+	long delay = argc > 5 ? atol(argv[5]) : 0;
+	std::string password = argc > 6 ? argv[6] : "";
+	if (port <= 0 || port > 65535 || watts < 0 || outlets <= 0 || loss < 0 || loss > 100 || delay < 0) {
+		fprintf(stderr, "usage: %s [port] [watts] [outlets] [loss_percent] [delay_ms] [password]\n", argv[0]);
+		return 1;
+	}
+	password.resize(16, '\0');
+
+	// A dual-stack socket, as "localhost" may be resolved to both addresses.
+	int fd = socket(AF_INET6, SOCK_DGRAM, 0);
+	int off = 0;
+	setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+	sockaddr_in6 address;
+	memset(&address, 0, sizeof(address));
+	address.sin6_family = AF_INET6;
+	address.sin6_addr = in6addr_any;
+	address.sin6_port = htons(port);
+	if (fd == -1 || bind(fd, (sockaddr *)&address, sizeof(address)) == -1) {
+		perror("bind");
+		return 1;
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+
+	printf("Simulating %ld outlets with %.1f W each on port %ld (%.1f%% loss, %ld ms delay)\n", outlets, watts, port,
+		   loss, delay);
+	fflush(stdout);
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<double> percent(0, 100);
+
+	// The energy of all outlets is the same, the fraction of a Joule is kept for the next answer.
+	Clock::time_point reset = Clock::now();
+	double carry = 0;
+
+	uint64_t requests = 0, answers = 0, dropped = 0, malformed = 0;
+	std::deque<Answer> queue;
+	std::vector<char> buffer(65536);
+
+	while (!stopped) {
+		int wait = -1;
+		if (!queue.empty()) {
+			auto left = std::chrono::duration_cast<std::chrono::milliseconds>(queue.front().due - Clock::now());
+			wait = left.count() > 0 ? (int)left.count() : 0;
+		}
+
+		pollfd pfd = {fd, POLLIN, 0};
+		int ready = poll(&pfd, 1, wait);
+
+		// Send all answers which are due, in the order of their requests.
+		while (!queue.empty() && queue.front().due <= Clock::now()) {
+			const Answer &answer = queue.front();
+			sendto(fd, answer.data.data(), answer.data.size(), 0, (const sockaddr *)&answer.address,
+				   sizeof(answer.address));
+			answers++;
+			queue.pop_front();
+		}
+
+		if (ready <= 0 || !(pfd.revents & POLLIN)) continue;
+
+		sockaddr_in6 from;
+		socklen_t from_size = sizeof(from);
+		ssize_t size = recvfrom(fd, buffer.data(), buffer.size(), 0, (sockaddr *)&from, &from_size);
+		if (size < 0) continue;
+		requests++;
+
+		std::string request(buffer.data(), size);
+		size_t header = signature.size() + 1 + 16;
+		if (request.size() < header + 5 || request.compare(0, signature.size() + 1, signature + '\0') != 0 ||
+			request.compare(signature.size() + 1, 16, password) != 0) {
+			malformed++;
+			continue;
+		}
+
+		uint16_t command = read16(request, header);
+		uint16_t length = read16(request, header + 2);
+		if (request.size() != header + 4 + length + 1 ||
+			checksum(request, header, 4 + length) != (uint8_t)request[header + 4 + length]) {
+			malformed++;
+			continue;
+		}
+		std::string data = request.substr(header + 4, length);
+
+		if (percent(random) < loss) {
+			dropped++;
+			continue;
+		}
+
+		std::string payload;
+		if (command == 0x010F) {
+			Clock::time_point now = Clock::now();
+			double energy = watts * std::chrono::duration<double>(now - reset).count() + carry;
+			uint32_t joules = (uint32_t)energy;
+
+			append32(payload, (uint32_t)(joules * outlets));
+			for (long i = 0; i < outlets; i++) append32(payload, joules);
+
+			if (data.size() == 1 && data[0] == 1) {
+				reset = now;
+				carry = energy - joules;
+			}
+		}
+
+		Answer answer;
+		answer.due = Clock::now() + std::chrono::milliseconds(delay);
+		answer.address = from;
+		answer.data = signature + '\1' + '\1' + std::string(15, '\0');
+		append16(answer.data, command);
+		append16(answer.data, payload.size());
+		answer.data += payload;
+		answer.data += (char)checksum(answer.data, answer.data.size() - payload.size() - 4, payload.size() + 4);
+		queue.push_back(answer);
+	}
+
+	printf("%llu requests, %llu answers, %llu dropped, %llu malformed\n", (unsigned long long)requests,
+		   (unsigned long long)answers, (unsigned long long)dropped, (unsigned long long)malformed);
+
+	close(fd);
+	return 0;
+}
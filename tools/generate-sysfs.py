@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+#
+# This file is part of Autopin+.
+# Copyright (C) 2015 Technische Universität München - LRR
+#
+# This file is licensed under the GNU General Public License Version 3
+#
+"""Writes a synthetic sysfs tree describing the topology of a machine.
+
+The tree contains the files read by autopin+ (cpu topology, caches, numa
+nodes and distances, core types, a cpu pmu and optionally the RAPL
+energy counters of the powercap class) and can be used with
+
+    autopin+ --sysfs=DIR --record-affinity=pinnings.log ...
+
+to evaluate control strategies on machines which are not available.
+
+Example: an 8-socket machine with 2 numa nodes per socket, 2 last level
+caches per node, 8 cores per cache and 2 hardware threads per core
+(512 cpus):
+
+    generate-sysfs.py --packages 8 --nodes 2 --caches 2 --cores 8 --threads 2 DIR
+"""
+
+import argparse
+import os
+import sys
+
+
+def write(root, path, content):
+    path = os.path.join(root, path)
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w") as f:
+        f.write(str(content) + "\n")
+
+
+def cpu_range(cpus):
+    """Formats a list of cpus like the kernel, e.g. "0-3,8-11"."""
+    cpus = sorted(set(cpus))
+    ranges = []
+    for cpu in cpus:
+        if ranges and ranges[-1][1] == cpu - 1:
+            ranges[-1][1] = cpu
+        else:
+            ranges.append([cpu, cpu])
+    return ",".join(str(a) if a == b else "%d-%d" % (a, b) for a, b in ranges)
+
+
+def parse_range(text):
+    result = []
+    for part in filter(None, text.split(",")):
+        if "-" in part:
+            a, b = part.split("-")
+            result.extend(range(int(a), int(b) + 1))
+        else:
+            result.append(int(part))
+    return result
+
+
+def build(args):
+    """Returns a list of cpus, each a dict describing its position in the machine."""
+    cores = []
+    for package in range(args.packages):
+        for local_node in range(args.nodes):
+            node = package * args.nodes + local_node
+            for local_cache in range(args.caches):
+                cache = node * args.caches + local_cache
+                for core in range(args.cores):
+                    cores.append(dict(package=package, node=node, cache=cache, threads=args.threads,
+                                      efficiency=False, cluster=None))
+                # Efficiency cores share an L2 cache in clusters
+                for core in range(args.efficiency_cores):
+                    cores.append(dict(package=package, node=node, cache=cache, threads=1, efficiency=True,
+                                      cluster=(cache, core // args.cluster_size)))
+
+    # Like Linux, number the first hardware thread of all cores first, then the second ones
+    cpus = []
+    for thread in range(max(core["threads"] for core in cores)):
+        for index, core in enumerate(cores):
+            if thread < core["threads"]:
+                cpus.append(dict(core, core_index=index, thread=thread))
+
+    for cpu, entry in enumerate(cpus):
+        entry["cpu"] = cpu
+
+    return cpus
+
+
+def generate(root, args):
+    cpus = build(args)
+    count = len(cpus)
+    offline = set(parse_range(args.offline))
+    online = [cpu["cpu"] for cpu in cpus if cpu["cpu"] not in offline]
+    node_count = args.packages * args.nodes
+
+    def group(key):
+        result = {}
+        for cpu in cpus:
+            result.setdefault(key(cpu), []).append(cpu["cpu"])
+        return result
+
+    siblings = group(lambda cpu: cpu["core_index"])
+    l2 = group(lambda cpu: cpu["cluster"] if cpu["efficiency"] else ("core", cpu["core_index"]))
+    llc = group(lambda cpu: cpu["cache"])
+    packages = group(lambda cpu: cpu["package"])
+    nodes = group(lambda cpu: cpu["node"])
+
+    system = "devices/system"
+    write(root, system + "/cpu/possible", cpu_range(range(count)))
+    write(root, system + "/cpu/present", cpu_range(range(count)))
+    write(root, system + "/cpu/online", cpu_range(online))
+
+    for cpu in cpus:
+        base = "%s/cpu/cpu%d" % (system, cpu["cpu"])
+        core_id = cpu["core_index"] - min(c["core_index"] for c in cpus if c["package"] == cpu["package"])
+
+        if cpu["cpu"] != 0:
+            write(root, base + "/online", 0 if cpu["cpu"] in offline else 1)
+
+        write(root, base + "/topology/physical_package_id", cpu["package"])
+        write(root, base + "/topology/die_id", 0)
+        write(root, base + "/topology/core_id", core_id)
+        write(root, base + "/topology/thread_siblings_list", cpu_range(siblings[cpu["core_index"]]))
+        write(root, base + "/topology/core_siblings_list", cpu_range(packages[cpu["package"]]))
+        write(root, base + "/topology/package_cpus_list", cpu_range(packages[cpu["package"]]))
+
+        l2_key = cpu["cluster"] if cpu["efficiency"] else ("core", cpu["core_index"])
+        caches = [
+            (1, "Data", 48, siblings[cpu["core_index"]]),
+            (1, "Instruction", 32, siblings[cpu["core_index"]]),
+            (2, "Unified", 2048, l2[l2_key]),
+            (3, "Unified", 32768, llc[cpu["cache"]]),
+        ]
+        for index, (level, kind, size, shared) in enumerate(caches):
+            cache = "%s/cache/index%d" % (base, index)
+            write(root, cache + "/level", level)
+            write(root, cache + "/type", kind)
+            write(root, cache + "/size", "%dK" % size)
+            write(root, cache + "/shared_cpu_list", cpu_range(shared))
+
+        if args.efficiency_cores > 0:
+            write(root, base + "/cpu_capacity", args.efficiency_capacity if cpu["efficiency"] else 1024)
+
+        write(root, "%s/node/node%d/cpu%d/online" % (system, cpu["node"], cpu["cpu"]), 1)
+
+    write(root, system + "/node/possible", cpu_range(range(node_count)))
+    write(root, system + "/node/online", cpu_range(range(node_count)))
+    for node in range(node_count):
+        distances = []
+        for other in range(node_count):
+            if other == node:
+                distances.append(10)
+            elif other // args.nodes == node // args.nodes:
+                distances.append(12)
+            else:
+                distances.append(21)
+
+        # Like Linux, only online cpus are listed
+        write(root, "%s/node/node%d/cpulist" % (system, node), cpu_range(c for c in nodes[node] if c not in offline))
+        write(root, "%s/node/node%d/distance" % (system, node), " ".join(map(str, distances)))
+
+    if args.efficiency_cores > 0:
+        write(root, "devices/cpu_core/cpus", cpu_range(c["cpu"] for c in cpus if not c["efficiency"]))
+        write(root, "devices/cpu_atom/cpus", cpu_range(c["cpu"] for c in cpus if c["efficiency"]))
+
+    # A minimal cpu pmu, so that gperf sensors given as sysfs paths can be parsed
+    pmu = "bus/event_source/devices/cpu"
+    write(root, pmu + "/type", 4)
+    write(root, pmu + "/cpumask", cpu_range(min(members) for members in packages.values()))
+    write(root, pmu + "/format/event", "config:0-7")
+    write(root, pmu + "/format/umask", "config:8-15")
+    write(root, pmu + "/events/cpu-cycles", "event=0x3c")
+    write(root, pmu + "/events/instructions", "event=0xc0")
+    write(root, pmu + "/events/cache-misses", "event=0x2e,umask=0x41")
+
+    # RAPL energy counters in the powercap class, with a core and a dram subzone per package.
+    # The counters don't advance, they can be overwritten in place to simulate energy consumption.
+    if args.rapl:
+        for package in range(args.packages):
+            # Like Linux, the subzones are listed in the class directory next to their package
+            for suffix, name in [("", "package-%d" % package), (":0", "core"), (":1", "dram")]:
+                path = "class/powercap/intel-rapl:%d%s" % (package, suffix)
+                write(root, path + "/name", name)
+                write(root, path + "/energy_uj", 0)
+                write(root, path + "/max_energy_range_uj", 262143328850)
+
+    return count
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--packages", type=int, default=2, help="number of packages (default: 2)")
+    parser.add_argument("--nodes", type=int, default=1, help="numa nodes per package (default: 1)")
+    parser.add_argument("--caches", type=int, default=1, help="last level caches per numa node (default: 1)")
+    parser.add_argument("--cores", type=int, default=8, help="cores per last level cache (default: 8)")
+    parser.add_argument("--threads", type=int, default=2, help="hardware threads per core (default: 2)")
+    parser.add_argument("--efficiency-cores", type=int, default=0,
+                        help="additional efficiency cores without SMT per last level cache (default: 0)")
+    parser.add_argument("--cluster-size", type=int, default=4,
+                        help="efficiency cores sharing an L2 cache (default: 4)")
+    parser.add_argument("--efficiency-capacity", type=int, default=512,
+                        help="cpu_capacity of efficiency cores, performance cores have 1024 (default: 512)")
+    parser.add_argument("--rapl", action="store_true",
+                        help="add RAPL energy counters (package, core and dram) in class/powercap")
+    parser.add_argument("--offline", default="", help="cpus to mark as offline, e.g. 4-7,12")
+    parser.add_argument("root", help="directory to write the tree to, must not exist")
+    args = parser.parse_args()
+
+    for value in (args.packages, args.nodes, args.caches, args.threads, args.cluster_size):
+        if value < 1:
+            parser.error("all counts must be positive")
+    if args.cores < 0 or args.efficiency_cores < 0 or args.cores + args.efficiency_cores == 0:
+        parser.error("every last level cache needs at least one core")
+
+    if os.path.exists(args.root):
+        parser.error("%s already exists" % args.root)
+
+    count = generate(args.root, args)
+    print("Wrote a topology with %d cpus to %s" % (count, args.root))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,137 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+/*
+ * Compares the cost of reading a perf counter with the read() syscall and
+ * from userspace with rdpmc, as done by the gperf monitor with the rdpmc
+ * option. The counter monitors the benchmark itself, so that rdpmc can be
+ * used. Build and run it with
+ *
+ *     g++ -O2 -std=c++11 -I vendor/linux tools/gperf-read-benchmark.cpp -o gperf-read-benchmark
+ *     ./gperf-read-benchmark [iterations]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <syscall.h>
+#include <unistd.h>
+
+static inline uint64_t rdpmc_read(uint32_t counter) {
+	uint32_t low, high;
+	asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+	return low | ((uint64_t)high) << 32;
+}
+
+static inline uint64_t rdtsc_read() {
+	uint32_t low, high;
+	asm volatile("rdtsc" : "=a"(low), "=d"(high));
+	return low | ((uint64_t)high) << 32;
+}
+
+// Same protocol as readPage() in src/AutopinPlus/Monitor/GPerf/Main.cpp
+static bool readPage(const volatile perf_event_mmap_page *page, uint64_t &count, uint64_t &enabled,
+					 uint64_t &running) {
+	uint32_t seq;
+	do {
+		seq = page->lock;
+		asm volatile("" ::: "memory");
+
+		uint32_t index = page->index;
+		if (!page->cap_user_rdpmc || !page->cap_user_time || index == 0) return false;
+
+		enabled = page->time_enabled;
+		running = page->time_running;
+
+		uint64_t cycles = rdtsc_read();
+		uint16_t shift = page->time_shift;
+		uint64_t mult = page->time_mult;
+		uint64_t quot = cycles >> shift;
+		uint64_t rem = cycles & (((uint64_t)1 << shift) - 1);
+		uint64_t delta = page->time_offset + quot * mult + ((rem * mult) >> shift);
+		enabled += delta;
+		running += delta;
+
+		uint16_t width = page->pmc_width;
+		int64_t pmc = rdpmc_read(index - 1);
+		pmc <<= 64 - width;
+		pmc >>= 64 - width;
+		count = page->offset + pmc;
+
+		asm volatile("" ::: "memory");
+	} while (page->lock != seq);
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+	if (iterations <= 0) {
+		fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.exclude_kernel = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED |
+					   PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fd < 0) {
+		perror("perf_event_open");
+		return 1;
+	}
+
+	void *addr = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	auto page = static_cast<perf_event_mmap_page *>(addr);
+
+	uint64_t buffer[5], sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < iterations; i++) {
+		if (read(fd, buffer, sizeof(buffer)) != sizeof(buffer)) {
+			perror("read");
+			return 1;
+		}
+		sum += buffer[3];
+	}
+	auto middle = std::chrono::steady_clock::now();
+
+	long fallbacks = 0;
+	for (long i = 0; i < iterations; i++) {
+		uint64_t count, enabled, running;
+		if (!readPage(page, count, enabled, running)) {
+			fallbacks++;
+			if (read(fd, buffer, sizeof(buffer)) != sizeof(buffer)) return 1;
+			count = buffer[3];
+		}
+		sum += count;
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	double syscall_ns = std::chrono::duration<double, std::nano>(middle - start).count() / iterations;
+	double rdpmc_ns = std::chrono::duration<double, std::nano>(stop - middle).count() / iterations;
+
+	printf("read():  %8.1f ns per read\n", syscall_ns);
+	printf("rdpmc:   %8.1f ns per read (%ld of %ld reads fell back to read())\n", rdpmc_ns, fallbacks, iterations);
+	printf("speedup: %8.1fx\n", syscall_ns / rdpmc_ns);
+
+	// Keep the compiler from optimizing the reads away
+	return sum == 0 ? 2 : 0;
+}
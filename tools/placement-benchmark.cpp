@@ -0,0 +1,155 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+/*
+ * Measures the cost of placing threads with the PlacementTree used by the
+ * Compact and Scatter strategies on a synthetic topology. Create a topology
+ * with tools/generate-sysfs.py, then build and run the benchmark with
+ *
+ *     tools/generate-sysfs.py --packages 8 --nodes 2 --caches 2 --cores 8 --threads 2 /tmp/sysfs-512
+ *     g++ -O2 -std=c++11 -fPIC -I include $(pkg-config --cflags Qt5Core) tools/placement-benchmark.cpp \
+ *         src/AutopinPlus/PlacementTree.cpp src/AutopinPlus/OS/Topology.cpp \
+ *         $(pkg-config --libs Qt5Core) -o placement-benchmark
+ *     ./placement-benchmark /tmp/sysfs-512 [threads] [rounds]
+ *
+ * Every round places the given number of threads (default 1000) one after
+ * another with findCompact(), anchored at the cpu of the previous thread, and
+ * with findScatter(). Once all cpus are used, the oldest thread terminates
+ * before the next one is placed, so that more threads than cpus exercise both
+ * full and partially used subtrees. The benchmark prints the average time of
+ * a single setUsed() and of placing one thread, which is the lookup, its
+ * setUsed() and, once the machine is full, the release of the oldest thread.
+ *
+ * CpuInfo depends on the OS services of autopin+, so the two functions of
+ * CpuInfo needed by Topology and PlacementTree are implemented here. The node
+ * distances are read from the synthetic tree.
+ */
+
+#include <AutopinPlus/OS/CpuInfo.h>
+#include <AutopinPlus/OS/Topology.h>
+#include <AutopinPlus/PlacementTree.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <vector>
+
+using AutopinPlus::OS::Topology;
+using AutopinPlus::PlacementTree;
+
+static std::vector<std::vector<int>> distances;
+
+static const Topology *topology = nullptr;
+
+std::vector<int> AutopinPlus::OS::CpuInfo::parseSysRangeFile(QString path) {
+	std::vector<int> result;
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) return result;
+
+	QTextStream stream(&file);
+	for (auto range : stream.readAll().trimmed().split(",", QString::SkipEmptyParts)) {
+		auto values = range.split("-");
+		int start = values.at(0).toInt();
+		int stop = values.size() == 2 ? values.at(1).toInt() : start;
+		for (int value = start; value <= stop; value++) result.push_back(value);
+	}
+	return result;
+}
+
+int AutopinPlus::OS::CpuInfo::getCpuDistance(int cpu0, int cpu1) {
+	int node0 = topology->getNode(cpu0);
+	int node1 = topology->getNode(cpu1);
+	if ((unsigned int)node0 >= distances.size() || (unsigned int)node1 >= distances[node0].size()) return 10;
+	return distances[node0][node1];
+}
+
+static double elapsed(std::chrono::steady_clock::time_point start, long operations) {
+	std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+	return time.count() / operations;
+}
+
+/*
+ * Places the threads one after another, releasing the oldest thread whenever all cpus are used
+ */
+template <typename Find> static void place(PlacementTree &tree, long threads, Find find) {
+	std::deque<int> placed;
+	int previous = -1;
+
+	for (long thread = 0; thread < threads; thread++) {
+		if (tree.getFreeCount() == 0) {
+			tree.setUsed(placed.front(), false);
+			placed.pop_front();
+		}
+
+		int cpu = find(previous);
+		tree.setUsed(cpu, true);
+		placed.push_back(cpu);
+		previous = cpu;
+	}
+
+	for (int cpu : placed) tree.setUsed(cpu, false);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s SYSFS [threads] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	QString root = argv[1];
+	long threads = argc > 2 ? atol(argv[2]) : 1000;
+	long rounds = argc > 3 ? atol(argv[3]) : 1000;
+
+	auto possible = AutopinPlus::OS::CpuInfo::parseSysRangeFile(root + "/devices/system/cpu/possible");
+	if (possible.empty()) {
+		fprintf(stderr, "No cpus found in %s\n", argv[1]);
+		return 1;
+	}
+
+	Topology machine = Topology::read(possible.back() + 1, root);
+	topology = &machine;
+
+	for (int node : AutopinPlus::OS::CpuInfo::parseSysRangeFile(root + "/devices/system/node/online")) {
+		QFile file(root + "/devices/system/node/node" + QString::number(node) + "/distance");
+		if (!file.open(QIODevice::ReadOnly)) continue;
+
+		QTextStream stream(&file);
+		std::vector<int> row;
+		for (auto value : stream.readAll().trimmed().split(" ", QString::SkipEmptyParts)) row.push_back(value.toInt());
+		distances.resize(node + 1);
+		distances[node] = row;
+	}
+
+	PlacementTree tree;
+	tree.build(machine);
+
+	int cpus = machine.getCpuCount();
+	printf("%d cpus, %zu nodes, %ld threads, %ld rounds\n", cpus, distances.size(), threads, rounds);
+
+	auto start = std::chrono::steady_clock::now();
+	for (long round = 0; round < rounds; round++) {
+		for (int cpu = 0; cpu < cpus; cpu++) tree.setUsed(cpu, true);
+		for (int cpu = 0; cpu < cpus; cpu++) tree.setUsed(cpu, false);
+	}
+	printf("setUsed:               %8.1f ns\n", elapsed(start, rounds * cpus * 2));
+
+	start = std::chrono::steady_clock::now();
+	for (long round = 0; round < rounds; round++)
+		place(tree, threads, [&](int previous) { return tree.findCompact(previous); });
+	printf("findCompact + setUsed: %8.1f ns\n", elapsed(start, rounds * threads));
+
+	start = std::chrono::steady_clock::now();
+	for (long round = 0; round < rounds; round++) place(tree, threads, [&](int) { return tree.findScatter(); });
+	printf("findScatter + setUsed: %8.1f ns\n", elapsed(start, rounds * threads));
+
+	return 0;
+}
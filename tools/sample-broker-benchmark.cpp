@@ -0,0 +1,177 @@
+/*
+ * This file is part of Autopin+.
+ * Copyright (C) 2015 Technische Universität München - LRR
+ *
+ * This file is licensed under the GNU General Public License Version 3
+ */
+
+/*
+ * Compares many watchdogs reading a system-wide sensor on their own and
+ * through the SampleBroker, as done by the clustsafe monitor. Build and run
+ * it with
+ *
+ *     g++ -O2 -std=c++11 -pthread -I include tools/sample-broker-benchmark.cpp \
+ *         src/AutopinPlus/SampleBroker.cpp -o sample-broker-benchmark
+ *     ./sample-broker-benchmark [watchdogs] [seconds] [latency_us] [ttl_ms]
+ *
+ * The sensor is simulated: a read takes the given latency, only one read can
+ * be in flight at a time (like a single UDP device) and it returns the time
+ * since the previous read, like the energy counters which the ClustSafe
+ * device resets on every read. Every watchdog polls the sensor as fast as it
+ * can, so its last value must equal the time since its start. With the broker,
+ * both its baseline and its last value may be as old as the time to live, so
+ * the error may be up to twice the time to live (plus scheduling delays).
+ */
+
+#include <AutopinPlus/SampleBroker.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using AutopinPlus::SampleBroker;
+using Clock = std::chrono::steady_clock;
+
+/*
+ * A sensor which only serves one read at a time and is reset on every read
+ */
+class Sensor {
+  public:
+	explicit Sensor(long latency_us) : latency(latency_us), last(Clock::now()) {}
+
+	std::vector<double> read() {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::this_thread::sleep_for(std::chrono::microseconds(latency));
+		reads++;
+
+		// The "energy" is the time in seconds since the previous read.
+		Clock::time_point now = Clock::now();
+		double result = std::chrono::duration<double>(now - last).count();
+		last = now;
+
+		return {result};
+	}
+
+	std::atomic<uint64_t> reads{0};
+
+  private:
+	long latency;
+	Clock::time_point last;
+	std::mutex mutex;
+};
+
+struct Result {
+	double seconds;
+	uint64_t reads;
+	uint64_t sensor_reads;
+	double max_error;
+};
+
+/*
+ * Every watchdog reads the sensor on its own and keeps a running total of the
+ * deltas it read. As every read resets the sensor, each watchdog misses the
+ * energy read by all others, which shows up as the error.
+ */
+static Result runDirect(long watchdogs, double seconds, long latency_us) {
+	Sensor sensor(latency_us);
+
+	std::atomic<uint64_t> reads{0};
+	std::vector<double> errors(watchdogs, 0);
+	std::vector<std::thread> threads;
+
+	Clock::time_point start = Clock::now();
+	for (long i = 0; i < watchdogs; i++) {
+		threads.emplace_back([&, i]() {
+			Clock::time_point begin = Clock::now();
+			sensor.read();
+
+			double total = 0;
+			while (std::chrono::duration<double>(Clock::now() - start).count() < seconds) {
+				total += sensor.read()[0];
+				reads++;
+			}
+
+			errors[i] = std::fabs(total - std::chrono::duration<double>(Clock::now() - begin).count());
+		});
+	}
+	for (auto &thread : threads) thread.join();
+
+	Result result;
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	result.reads = reads;
+	result.sensor_reads = sensor.reads;
+	result.max_error = *std::max_element(errors.begin(), errors.end());
+
+	return result;
+}
+
+/*
+ * All watchdogs share one sensor through the broker.
+ */
+static Result runBroker(long watchdogs, double seconds, long latency_us, long ttl_ms) {
+	Sensor sensor(latency_us);
+	SampleBroker &broker = SampleBroker::getInstance();
+
+	std::atomic<uint64_t> reads{0};
+	std::vector<double> errors(watchdogs, 0);
+	std::vector<std::thread> threads;
+
+	Clock::time_point start = Clock::now();
+	for (long i = 0; i < watchdogs; i++) {
+		threads.emplace_back([&, i]() {
+			Clock::time_point begin = Clock::now();
+			int consumer = broker.subscribe("sensor", ttl_ms * 1000000, SampleBroker::DELTA,
+											[&sensor]() { return sensor.read(); });
+
+			double value = 0;
+			while (std::chrono::duration<double>(Clock::now() - start).count() < seconds) {
+				value = broker.value(consumer)[0];
+				reads++;
+			}
+
+			errors[i] = std::fabs(value - std::chrono::duration<double>(Clock::now() - begin).count());
+			broker.unsubscribe(consumer);
+		});
+	}
+	for (auto &thread : threads) thread.join();
+
+	Result result;
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	result.reads = reads;
+	result.sensor_reads = sensor.reads;
+	result.max_error = *std::max_element(errors.begin(), errors.end());
+
+	return result;
+}
+
+static void print(const char *mode, const Result &result) {
+	printf("%-8s %12.0f values/s %10.0f sensor reads/s %10.1f us per value, max. error %.1f ms\n", mode,
+		   result.reads / result.seconds, result.sensor_reads / result.seconds,
+		   result.reads > 0 ? result.seconds * 1e6 / result.reads : 0.0, result.max_error * 1e3);
+}
+
+int main(int argc, char **argv) {
+	long watchdogs = argc > 1 ? atol(argv[1]) : 50;
+	double seconds = argc > 2 ? atof(argv[2]) : 2;
+	long latency = argc > 3 ? atol(argv[3]) : 200;
+	long ttl = argc > 4 ? atol(argv[4]) : 10;
+	if (watchdogs <= 0 || seconds <= 0 || latency < 0 || ttl < 0) {
+		fprintf(stderr, "usage: %s [watchdogs] [seconds] [latency_us] [ttl_ms]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%ld watchdogs, %.1f s, %ld us per sensor read, %ld ms time to live\n", watchdogs, seconds, latency, ttl);
+	print("direct", runDirect(watchdogs, seconds, latency));
+	print("broker", runBroker(watchdogs, seconds, latency, ttl));
+
+	return 0;
+}